@@ -12,6 +12,7 @@ const char *ConnectionNames[] {
 	"ZeroTier",
 	N_("Client-Server (TCP)"),
 	N_("Loopback"),
+	"Simulator",
 };
 
 namespace {
@@ -438,7 +438,8 @@ static bool IsGameCompatible(const GameData &data)
 	if (data.versionMajor == PROJECT_VERSION_MAJOR
 	    && data.versionMinor == PROJECT_VERSION_MINOR
 	    && data.versionPatch == PROJECT_VERSION_PATCH
-	    && data.programid == GAME_ID) {
+	    && data.programid == GAME_ID
+	    && data.protocolVersion == NetProtocolVersion) {
 		return IsDifficultyAllowed(data.nDifficulty);
 	}
 
@@ -446,6 +447,8 @@ static bool IsGameCompatible(const GameData &data)
 
 	if (data.programid != GAME_ID) {
 		UiSelOkDialog(title, _("The host is running a different game than you."), false);
+	} else if (data.protocolVersion != NetProtocolVersion) {
+		UiSelOkDialog(title, _("The host is using a different network protocol than you."), false);
 	} else {
 		char msg[128];
 		strcpy(msg, fmt::format(_(/* TRANSLATORS: Error message when somebody tries to join a game running another version. */ "Your version {:s} does not match the host {:d}.{:d}.{:d}."), PROJECT_VERSION, data.versionMajor, data.versionMinor, data.versionPatch).c_str());
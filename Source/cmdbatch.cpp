@@ -0,0 +1,324 @@
+/**
+ * @file cmdbatch.cpp
+ *
+ * Implementation of the coalescing and compact encoding of the commands a player sends each turn.
+ */
+#include "cmdbatch.h"
+
+#include <cstring>
+
+namespace devilution {
+
+namespace {
+
+/** Set on the command id of a packed command that is stored as a length followed by the raw bytes */
+constexpr uint8_t PackedRaw = 0x80;
+
+static_assert(NUM_CMDS <= PackedRaw, "command ids must leave the top bit free for PackedRaw");
+
+enum class Coalesce : uint8_t {
+	Never,
+	/** A newer command of the same type replaces any queued one */
+	SameType,
+	/** A command identical to the last queued one is only sent once */
+	Repeat,
+};
+
+/** Fields of the TCmd structure used for a command: a tile position followed by 16 bit parameters */
+struct CommandLayout {
+	bool hasPosition;
+	uint8_t params;
+
+	size_t Size() const
+	{
+		return 1 + (hasPosition ? 2 : 0) + params * sizeof(uint16_t);
+	}
+};
+
+Coalesce GetCoalesceRule(_cmd_id cmd)
+{
+	switch (cmd) {
+	case CMD_WALKXY:
+		return Coalesce::SameType;
+	case CMD_ATTACKXY:
+	case CMD_SATTACKXY:
+	case CMD_RATTACKXY:
+	case CMD_ATTACKID:
+	case CMD_ATTACKPID:
+	case CMD_RATTACKID:
+	case CMD_RATTACKPID:
+	case CMD_OPOBJXY:
+	case CMD_DISARMXY:
+	case CMD_TALKXY:
+		return Coalesce::Repeat;
+	default:
+		return Coalesce::Never;
+	}
+}
+
+CommandLayout GetCommandLayout(_cmd_id cmd)
+{
+	switch (cmd) {
+	case CMD_WALKXY:
+	case CMD_ATTACKXY:
+	case CMD_SATTACKXY:
+	case CMD_RATTACKXY:
+	case CMD_NOVA:
+		return { true, 0 };
+	case CMD_OPOBJXY:
+	case CMD_DISARMXY:
+	case CMD_TALKXY:
+	case CMD_GOTOAGETITEM:
+	case CMD_MONSTDEATH:
+	case CMD_KILLGOLEM:
+	case CMD_PLAYER_JOINLEVEL:
+		return { true, 1 };
+	case CMD_TSPELLXY:
+		return { true, 2 };
+	case CMD_SPELLXY:
+	case CMD_ACTIVATEPORTAL:
+		return { true, 3 };
+	case CMD_SPELLXYD:
+		return { true, 4 };
+	case CMD_ATTACKID:
+	case CMD_ATTACKPID:
+	case CMD_RATTACKID:
+	case CMD_RATTACKPID:
+	case CMD_OPOBJT:
+	case CMD_OPENDOOR:
+	case CMD_CLOSEDOOR:
+	case CMD_OPERATEOBJ:
+	case CMD_KNOCKBACK:
+	case CMD_RESURRECT:
+	case CMD_HEALOTHER:
+	case CMD_PLRDEAD:
+	case CMD_PLRLEVEL:
+	case CMD_WARP:
+	case CMD_ADDSTR:
+	case CMD_ADDMAG:
+	case CMD_ADDDEX:
+	case CMD_ADDVIT:
+	case CMD_SETSTR:
+	case CMD_SETMAG:
+	case CMD_SETDEX:
+	case CMD_SETVIT:
+	case CMD_SETREFLECT:
+		return { false, 1 };
+	case CMD_NEWLVL:
+	case CMD_PLROPOBJ:
+	case CMD_BREAKOBJ:
+		return { false, 2 };
+	case CMD_TSPELLID:
+	case CMD_TSPELLPID:
+		return { false, 3 };
+	case CMD_SPELLID:
+	case CMD_SPELLPID:
+		return { false, 4 };
+	default:
+		return { false, 0 };
+	}
+}
+
+size_t WriteVarint(uint32_t value, byte *out, size_t outSize)
+{
+	size_t i = 0;
+	do {
+		if (i == outSize)
+			return 0;
+		uint8_t bits = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			bits |= 0x80;
+		out[i++] = static_cast<byte>(bits);
+	} while (value != 0);
+	return i;
+}
+
+size_t ReadVarint(const byte *data, size_t size, uint32_t &value)
+{
+	value = 0;
+	for (size_t i = 0; i < size && i < 3; i++) {
+		const auto bits = static_cast<uint8_t>(data[i]);
+		value |= static_cast<uint32_t>(bits & 0x7F) << (7 * i);
+		if ((bits & 0x80) == 0)
+			return i + 1;
+	}
+	return 0;
+}
+
+/** Walks the entries of a TBuffer, each one is a length byte followed by the command */
+template <typename F>
+byte *FindQueuedCommand(TBuffer &buf, F &&predicate)
+{
+	byte *last = nullptr;
+	for (byte *p = buf.bData; p < &buf.bData[buf.dwNextWriteOffset];) {
+		const auto size = static_cast<uint8_t>(*p);
+		if (size == 0)
+			break;
+		if (predicate(p + 1, size))
+			last = p;
+		p += size + 1;
+	}
+	return last;
+}
+
+void RemoveQueuedCommand(TBuffer &buf, byte *entry)
+{
+	const size_t entrySize = static_cast<uint8_t>(*entry) + 1;
+	byte *end = &buf.bData[buf.dwNextWriteOffset];
+	// Also move the terminating zero
+	memmove(entry, entry + entrySize, end - (entry + entrySize) + 1);
+	buf.dwNextWriteOffset -= entrySize;
+}
+
+byte *LastQueuedCommand(TBuffer &buf)
+{
+	return FindQueuedCommand(buf, [](const byte * /*cmd*/, uint8_t /*size*/) { return true; });
+}
+
+} // namespace
+
+void QueueCommand(TBuffer &buf, const byte *cmd, uint8_t size)
+{
+	const auto cmdId = static_cast<_cmd_id>(cmd[0]);
+	switch (GetCoalesceRule(cmdId)) {
+	case Coalesce::SameType: {
+		byte *entry = FindQueuedCommand(buf, [cmdId](const byte *queued, uint8_t /*size*/) {
+			return static_cast<_cmd_id>(queued[0]) == cmdId;
+		});
+		if (entry != nullptr)
+			RemoveQueuedCommand(buf, entry);
+	} break;
+	case Coalesce::Repeat: {
+		byte *entry = LastQueuedCommand(buf);
+		if (entry != nullptr && static_cast<uint8_t>(*entry) == size && memcmp(entry + 1, cmd, size) == 0)
+			return;
+	} break;
+	case Coalesce::Never:
+		break;
+	}
+
+	if (buf.dwNextWriteOffset + size + 2 > sizeof(buf.bData)) {
+		return;
+	}
+
+	byte *p = &buf.bData[buf.dwNextWriteOffset];
+	buf.dwNextWriteOffset += size + 1;
+	*p = static_cast<byte>(size);
+	p++;
+	memcpy(p, cmd, size);
+	p[size] = byte { 0 };
+}
+
+size_t PackQueuedCommands(TBuffer &buf, byte *out, size_t outSize)
+{
+	if (buf.dwNextWriteOffset == 0)
+		return 0;
+
+	size_t written = 0;
+	byte *srcPtr = buf.bData;
+	while (true) {
+		const auto size = static_cast<uint8_t>(*srcPtr);
+		if (size == 0)
+			break;
+		const size_t packedSize = PackCommand(srcPtr + 1, size, out + written, outSize - written);
+		if (packedSize == 0)
+			break;
+		written += packedSize;
+		srcPtr += size + 1;
+	}
+
+	memmove(buf.bData, srcPtr, (buf.bData - srcPtr) + buf.dwNextWriteOffset + 1);
+	buf.dwNextWriteOffset += (buf.bData - srcPtr);
+	return written;
+}
+
+size_t PackCommand(const byte *cmd, size_t size, byte *out, size_t outSize)
+{
+	if (size == 0 || size > MaxQueuedCommandSize || outSize == 0)
+		return 0;
+
+	const auto cmdId = static_cast<uint8_t>(cmd[0]);
+	const CommandLayout layout = GetCommandLayout(static_cast<_cmd_id>(cmdId));
+	if (cmdId >= PackedRaw || layout.Size() != size || (!layout.hasPosition && layout.params == 0)) {
+		// Unknown layout, store the command as it is
+		out[0] = static_cast<byte>(cmdId | PackedRaw);
+		const size_t lengthSize = WriteVarint(size - 1, out + 1, outSize - 1);
+		if (lengthSize == 0 || 1 + lengthSize + size - 1 > outSize)
+			return 0;
+		memcpy(out + 1 + lengthSize, cmd + 1, size - 1);
+		return 1 + lengthSize + size - 1;
+	}
+
+	size_t written = 0;
+	out[written++] = static_cast<byte>(cmdId);
+	const byte *src = cmd + 1;
+	if (layout.hasPosition) {
+		if (outSize - written < 2)
+			return 0;
+		out[written++] = *src++;
+		out[written++] = *src++;
+	}
+	for (int i = 0; i < layout.params; i++) {
+		// Parameters are stored in host order by NetSendCmd*, most of them are small indices
+		uint16_t param;
+		memcpy(&param, src, sizeof(param));
+		src += sizeof(param);
+		const size_t paramSize = WriteVarint(param, out + written, outSize - written);
+		if (paramSize == 0)
+			return 0;
+		written += paramSize;
+	}
+	return written;
+}
+
+size_t UnpackCommand(const byte *data, size_t size, byte *cmd, size_t &cmdSize)
+{
+	if (size == 0)
+		return 0;
+
+	const auto packedId = static_cast<uint8_t>(data[0]);
+	const auto cmdId = static_cast<uint8_t>(packedId & ~PackedRaw);
+	if (cmdId >= NUM_CMDS || cmdId == CMD_BATCH)
+		return 0;
+
+	cmd[0] = static_cast<byte>(cmdId);
+	size_t read = 1;
+	if ((packedId & PackedRaw) != 0) {
+		uint32_t length;
+		const size_t lengthSize = ReadVarint(data + read, size - read, length);
+		if (lengthSize == 0 || length >= MaxQueuedCommandSize)
+			return 0;
+		read += lengthSize;
+		if (size - read < length)
+			return 0;
+		memcpy(cmd + 1, data + read, length);
+		cmdSize = length + 1;
+		return read + length;
+	}
+
+	const CommandLayout layout = GetCommandLayout(static_cast<_cmd_id>(cmdId));
+	if (!layout.hasPosition && layout.params == 0)
+		return 0;
+	byte *dst = cmd + 1;
+	if (layout.hasPosition) {
+		if (size - read < 2)
+			return 0;
+		*dst++ = data[read++];
+		*dst++ = data[read++];
+	}
+	for (int i = 0; i < layout.params; i++) {
+		uint32_t value;
+		const size_t paramSize = ReadVarint(data + read, size - read, value);
+		if (paramSize == 0 || value > UINT16_MAX)
+			return 0;
+		read += paramSize;
+		const auto param = static_cast<uint16_t>(value);
+		memcpy(dst, &param, sizeof(param));
+		dst += sizeof(param);
+	}
+	cmdSize = layout.Size();
+	return read;
+}
+
+} // namespace devilution
@@ -0,0 +1,55 @@
+/**
+ * @file cmdbatch.h
+ *
+ * Interface of the coalescing and compact encoding of the commands a player sends each turn.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "msg.h"
+#include "utils/stdcompat/cstddef.hpp"
+
+namespace devilution {
+
+/** Largest command that can be queued, its size has to fit the length byte of TBuffer */
+constexpr size_t MaxQueuedCommandSize = 255;
+
+/**
+ * @brief Adds a command to the queue of a turn
+ *
+ * Commands that only restate the player's intent, like walking or repeatedly attacking the same
+ * target, replace the queued command they make redundant instead of being sent twice.
+ * @param buf Queue of commands that have not been sent yet
+ * @param cmd Command in the layout of its TCmd structure
+ * @param size Size of the command
+ */
+void QueueCommand(TBuffer &buf, const byte *cmd, uint8_t size);
+
+/**
+ * @brief Moves as many queued commands as fit into a packed batch
+ * @param buf Queue of commands, the commands that didn't fit stay queued
+ * @param out Destination for the packed commands
+ * @param outSize Space available in out
+ * @return Number of bytes written
+ */
+size_t PackQueuedCommands(TBuffer &buf, byte *out, size_t outSize);
+
+/**
+ * @brief Writes a single command in packed form
+ * @return Number of bytes written, or 0 if the command doesn't fit in outSize
+ */
+size_t PackCommand(const byte *cmd, size_t size, byte *out, size_t outSize);
+
+/**
+ * @brief Reads a single command written by PackCommand
+ * @param data Packed commands
+ * @param size Size of the packed commands
+ * @param cmd Buffer of at least MaxQueuedCommandSize bytes that receives the command
+ * @param cmdSize Receives the size of the command
+ * @return Number of bytes read, or 0 if the data doesn't start with a valid packed command
+ */
+size_t UnpackCommand(const byte *data, size_t size, byte *cmd, size_t &cmdSize);
+
+} // namespace devilution
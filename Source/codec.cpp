@@ -6,6 +6,7 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
 
 #include "appfat.h"
 #include "sha.h"
@@ -29,7 +30,7 @@ std::array<byte, sizeof...(Ts)> make_bytes(Ts &&...args) noexcept
 	return { byte(std::forward<Ts>(args))... };
 }
 
-void CodecInitKey(const char *pszPassword)
+SHA1Context CodecInitKey(const char *pszPassword)
 {
 	byte pw[BlockSize]; // Repeat password until 64 char long
 	std::size_t j = 0;
@@ -39,10 +40,11 @@ void CodecInitKey(const char *pszPassword)
 		pw[i] = static_cast<byte>(pszPassword[j]);
 	}
 
+	SHA1Context context;
 	byte digest[SHA1HashSize];
-	SHA1Reset(0);
-	SHA1Calculate(0, pw, digest);
-	SHA1Clear();
+	SHA1Reset(context);
+	SHA1Calculate(context, pw);
+	SHA1Result(context, digest);
 
 	// declaring key as a std::array to make the initialization easier, otherwise we would need to explicitly
 	// declare every value as a byte on platforms that use std::byte.
@@ -57,54 +59,75 @@ void CodecInitKey(const char *pszPassword)
 		key[i] ^= digest[(i + 12) % SHA1HashSize];
 	memset(pw, 0, sizeof(pw));
 	memset(digest, 0, sizeof(digest));
-	for (int n = 0; n < 3; ++n) {
-		SHA1Reset(n);
-		SHA1Calculate(n, key.data(), nullptr);
-	}
+	SHA1Reset(context);
+	SHA1Calculate(context, key.data());
 	memset(key.data(), 0, sizeof(key));
+	return context;
+}
+
+/**
+ * @brief XORs a block with the repeated digest of the data preceding it, one machine word at a time.
+ */
+void XorBlock(byte *block, const byte digest[SHA1HashSize])
+{
+	byte key[BlockSize];
+	memcpy(&key[0], digest, SHA1HashSize);
+	memcpy(&key[SHA1HashSize], digest, SHA1HashSize);
+	memcpy(&key[2 * SHA1HashSize], digest, SHA1HashSize);
+	memcpy(&key[3 * SHA1HashSize], digest, BlockSize - 3 * SHA1HashSize);
+
+	for (size_t i = 0; i < BlockSize; i += sizeof(uint64_t)) {
+		uint64_t data;
+		uint64_t mask;
+		memcpy(&data, &block[i], sizeof(data));
+		memcpy(&mask, &key[i], sizeof(mask));
+		data ^= mask;
+		memcpy(&block[i], &data, sizeof(data));
+	}
+	memset(key, 0, sizeof(key));
 }
+
+/**
+ * @brief Reads the checksum the signature stores for the data.
+ */
+uint32_t GetChecksum(const SHA1Context &context)
+{
+	byte digest[SHA1HashSize];
+	SHA1Result(context, digest);
+	uint32_t checksum;
+	memcpy(&checksum, digest, sizeof(checksum));
+	memset(digest, 0, sizeof(digest));
+	return checksum;
+}
+
 } // namespace
 
 std::size_t codec_decode(byte *pbSrcDst, std::size_t size, const char *pszPassword)
 {
-	byte buf[BlockSize];
-	byte dst[SHA1HashSize];
+	byte digest[SHA1HashSize];
 
-	CodecInitKey(pszPassword);
+	SHA1Context context = CodecInitKey(pszPassword);
 	if (size <= sizeof(CodecSignature))
 		return 0;
 	size -= sizeof(CodecSignature);
 	if (size % BlockSize != 0)
 		return 0;
+	// Blocks are decoded in place, each one is keyed by the digest of the plaintext before it.
 	for (auto i = size; i != 0; pbSrcDst += BlockSize, i -= BlockSize) {
-		memcpy(buf, pbSrcDst, BlockSize);
-		SHA1Result(0, dst);
-		for (unsigned j = 0; j < BlockSize; j++) {
-			buf[j] ^= dst[j % SHA1HashSize];
-		}
-		SHA1Calculate(0, buf, nullptr);
-		memset(dst, 0, sizeof(dst));
-		memcpy(pbSrcDst, buf, BlockSize);
-	}
-
-	memset(buf, 0, sizeof(buf));
-	auto *sig = reinterpret_cast<CodecSignature *>(pbSrcDst);
-	if (sig->error > 0) {
-		goto error;
+		SHA1Result(context, digest);
+		XorBlock(pbSrcDst, digest);
+		SHA1Calculate(context, pbSrcDst);
 	}
+	memset(digest, 0, sizeof(digest));
 
-	SHA1Result(0, dst);
-	if (sig->checksum != *reinterpret_cast<uint32_t *>(dst)) {
-		memset(dst, 0, sizeof(dst));
-		goto error;
-	}
+	CodecSignature sig;
+	memcpy(&sig, pbSrcDst, sizeof(sig));
+	const bool valid = sig.error == 0 && sig.checksum == GetChecksum(context);
+	memset(&context, 0, sizeof(context));
+	if (!valid)
+		return 0;
 
-	size += sig->lastChunkSize - BlockSize;
-	SHA1Clear();
-	return size;
-error:
-	SHA1Clear();
-	return 0;
+	return size + sig.lastChunkSize - BlockSize;
 }
 
 std::size_t codec_get_encoded_len(std::size_t dwSrcBytes)
@@ -116,39 +139,34 @@ std::size_t codec_get_encoded_len(std::size_t dwSrcBytes)
 
 void codec_encode(byte *pbSrcDst, std::size_t size, std::size_t size64, const char *pszPassword)
 {
-	byte buf[BlockSize];
-	byte tmp[SHA1HashSize];
-	byte dst[SHA1HashSize];
+	byte digest[SHA1HashSize];
 
 	if (size64 != codec_get_encoded_len(size))
 		app_fatal("Invalid encode parameters");
-	CodecInitKey(pszPassword);
+	SHA1Context context = CodecInitKey(pszPassword);
 
+	// Blocks are encoded in place, the buffer has room for padding the last one.
 	size_t lastChunk = 0;
 	while (size != 0) {
 		size_t chunk = size < BlockSize ? size : BlockSize;
-		memcpy(buf, pbSrcDst, chunk);
 		if (chunk < BlockSize)
-			memset(buf + chunk, 0, BlockSize - chunk);
-		SHA1Result(0, dst);
-		SHA1Calculate(0, buf, nullptr);
-		for (unsigned j = 0; j < BlockSize; j++) {
-			buf[j] ^= dst[j % SHA1HashSize];
-		}
-		memset(dst, 0, sizeof(dst));
-		memcpy(pbSrcDst, buf, BlockSize);
+			memset(pbSrcDst + chunk, 0, BlockSize - chunk);
+		SHA1Result(context, digest);
+		SHA1Calculate(context, pbSrcDst);
+		XorBlock(pbSrcDst, digest);
 		lastChunk = chunk;
 		pbSrcDst += BlockSize;
 		size -= chunk;
 	}
-	memset(buf, 0, sizeof(buf));
-	SHA1Result(0, tmp);
-	auto *sig = reinterpret_cast<CodecSignature *>(pbSrcDst);
-	sig->error = 0;
-	sig->unused = 0;
-	sig->checksum = *reinterpret_cast<uint32_t *>(tmp);
-	sig->lastChunkSize = static_cast<uint8_t>(lastChunk); // lastChunk is at most 64 so will always fit in an 8 bit var
-	SHA1Clear();
+	memset(digest, 0, sizeof(digest));
+
+	CodecSignature sig;
+	sig.error = 0;
+	sig.unused = 0;
+	sig.checksum = GetChecksum(context);
+	sig.lastChunkSize = static_cast<uint8_t>(lastChunk); // lastChunk is at most 64 so will always fit in an 8 bit var
+	memcpy(pbSrcDst, &sig, sizeof(sig));
+	memset(&context, 0, sizeof(context));
 }
 
 } // namespace devilution
@@ -21,6 +21,7 @@
 #include "monstdat.h"
 #include "monster.h"
 #include "setmaps.h"
+#include "sound.h"
 #include "spells.h"
 #include "towners.h"
 #include "utils/language.h"
@@ -33,6 +34,7 @@ bool DebugToggle = false;
 bool DebugGodMode = false;
 bool DebugVision = false;
 bool DebugGrid = false;
+bool DebugNetStats = false;
 std::unordered_map<int, Point> DebugCoordsMap;
 bool DebugScrollViewEnabled = false;
 std::unordered_map<int, int> DebugIndexToObjectID;
@@ -490,11 +492,30 @@ std::string DebugCmdShowGrid(const string_view parameter)
 	return "Back to boring.";
 }
 
+std::string DebugCmdShowNetStats(const string_view parameter)
+{
+	DebugNetStats = !DebugNetStats;
+	if (DebugNetStats)
+		return "Counting every byte.";
+
+	return "Bytes are free again.";
+}
+
 std::string DebugCmdLevelSeed(const string_view parameter)
 {
 	return fmt::format("Seedinfo for level {}\nseed: {}\nMid1: {}\nMid2: {}\nMid3: {}\nEnd: {}", currlevel, glSeedTbl[currlevel], glMid1Seed[currlevel], glMid2Seed[currlevel], glMid3Seed[currlevel], glEndSeed[currlevel]);
 }
 
+std::string DebugCmdSoundInfo(const string_view parameter)
+{
+	const VoicePoolStats stats = GetSoundVoiceStats();
+	const SoundMixerStats mixer = GetSoundMixerStats();
+	return fmt::format("Sound voices: {} of {} playing\nStolen: {}\nDropped: {}\n"
+	                   "Mixer voices: {} of {} playing, peak {}\nStolen: {}\nDropped: {}\nMixed {} frames in {} us, max {} us",
+	    stats.active, stats.voices, stats.stolen, stats.dropped,
+	    mixer.active, mixer.voices, mixer.peak, mixer.stolen, mixer.dropped, mixer.frames, mixer.mixMicroseconds, mixer.maxMixMicroseconds);
+}
+
 std::string DebugCmdSpawnMonster(const string_view parameter)
 {
 	if (currlevel == 0)
@@ -735,7 +756,9 @@ std::vector<DebugCmdItem> DebugCmdList = {
 	{ "exit", "Exits the game.", "", &DebugCmdExit },
 	{ "arrow", "Changes arrow effect (normal, fire, lightning, explosion).", "{effect}", &DebugCmdArrow },
 	{ "grid", "Toggles showing grid.", "", &DebugCmdShowGrid },
+	{ "netstats", "Toggles showing network traffic per player.", "", &DebugCmdShowNetStats },
 	{ "seedinfo", "Show seed infos for current level.", "", &DebugCmdLevelSeed },
+	{ "soundinfo", "Shows usage of the voices for overlapping sounds and of the sound mixer.", "", &DebugCmdSoundInfo },
 	{ "spawn", "Spawns monster {name}.", "({count}) {name}", &DebugCmdSpawnMonster },
 	{ "tiledata", "Toggles showing tile data {name} (leave name empty to see a list).", "{name}", &DebugCmdShowTileData },
 	{ "scrollview", "Toggles scroll view feature (with shift+mouse).", "", &DebugCmdScrollView },
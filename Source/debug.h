@@ -20,6 +20,7 @@ extern bool DebugToggle;
 extern bool DebugGodMode;
 extern bool DebugVision;
 extern bool DebugGrid;
+extern bool DebugNetStats;
 extern std::unordered_map<int, Point> DebugCoordsMap;
 extern bool DebugScrollViewEnabled;
 extern std::unordered_map<int, int> DebugIndexToObjectID;
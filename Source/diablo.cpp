@@ -30,6 +30,7 @@
 #include "dx.h"
 #include "encrypt.h"
 #include "engine/cel_sprite.hpp"
+#include "engine/benchmark.hpp"
 #include "engine/demomode.h"
 #include "engine/load_cel.hpp"
 #include "engine/load_file.hpp"
@@ -57,6 +58,7 @@
 #include "quests.h"
 #include "restrict.h"
 #include "setmaps.h"
+#include "statehash.h"
 #include "sound.h"
 #include "stores.h"
 #include "storm/storm.h"
@@ -68,6 +70,7 @@
 #include "utils/console.h"
 #include "utils/language.h"
 #include "utils/paths.h"
+#include "utils/profiler.hpp"
 
 #ifdef __vita__
 #include "platform/vita/touch.h"
@@ -717,6 +720,8 @@ void RunGameLoop(interface_mode uMsg)
 		}
 #endif
 
+		DVL_PROFILE_SCOPE("RunGameLoop");
+		BenchmarkTimer frameTimer(BenchmarkPhase::Frame);
 		while (FetchMessage(&msg)) {
 			if (msg.message == DVL_WM_QUIT) {
 				gbRunGameResult = false;
@@ -737,8 +742,10 @@ void RunGameLoop(interface_mode uMsg)
 		if (!runGameLoop) {
 			if (processInput)
 				ProcessInput();
-			if (!drawGame)
+			if (!drawGame) {
+				frameTimer.Cancel();
 				continue;
+			}
 			force_redraw |= 1;
 			DrawAndBlit();
 			continue;
@@ -792,6 +799,9 @@ void RunGameLoop(interface_mode uMsg)
 	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--record <#>", _("Record a demo file"));
 	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--demo <#>", _("Play a demo file"));
 	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--timedemo", _("Disable all frame limiting during demo playback"));
+	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--benchmark <file>", _("Play a demo as a timedemo and write its timings to a file"));
+	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--benchmark-baseline <file>", _("Fail if the timings are worse than in this file"));
+	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--benchmark-tolerance <#>", _("Slowdown in percent the baseline allows (default 10)"));
 	printInConsole("%s", _(/* TRANSLATORS: Commandline Option */ "\nGame selection:\n"));
 	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--spawn", _("Force Shareware mode"));
 	printInConsole("    %-20s %-30s\n", /* TRANSLATORS: Commandline Option */ "--diablo", _("Force Diablo mode"));
@@ -815,6 +825,9 @@ void DiabloParseFlags(int argc, char **argv)
 #endif
 	bool timedemo = false;
 	int demoNumber = -1;
+	std::string benchmarkPath;
+	std::string benchmarkBaseline;
+	int benchmarkTolerance = 10;
 	int recordNumber = -1;
 	for (int i = 1; i < argc; i++) {
 		if (strcasecmp("-h", argv[i]) == 0 || strcasecmp("--help", argv[i]) == 0) {
@@ -831,6 +844,13 @@ void DiabloParseFlags(int argc, char **argv)
 			gbShowIntro = false;
 		} else if (strcasecmp("--timedemo", argv[i]) == 0) {
 			timedemo = true;
+		} else if (strcasecmp("--benchmark", argv[i]) == 0) {
+			benchmarkPath = argv[++i];
+			timedemo = true;
+		} else if (strcasecmp("--benchmark-baseline", argv[i]) == 0) {
+			benchmarkBaseline = argv[++i];
+		} else if (strcasecmp("--benchmark-tolerance", argv[i]) == 0) {
+			benchmarkTolerance = SDL_atoi(argv[++i]);
 		} else if (strcasecmp("--record", argv[i]) == 0) {
 			recordNumber = SDL_atoi(argv[++i]);
 		} else if (strcasecmp("--config-dir", argv[i]) == 0) {
@@ -877,8 +897,11 @@ void DiabloParseFlags(int argc, char **argv)
 		DebugCmdsFromCommandLine.push_back(currentCommand);
 #endif
 
-	if (demoNumber != -1)
+	if (demoNumber != -1) {
 		demo::InitPlayBack(demoNumber, timedemo);
+		if (!benchmarkPath.empty())
+			benchmark::Init(benchmarkPath, benchmarkBaseline, benchmarkTolerance / 100.0);
+	}
 	if (recordNumber != -1)
 		demo::InitRecording(recordNumber);
 }
@@ -1165,32 +1188,44 @@ void UpdateMonsterLights()
 
 void GameLogic()
 {
+	DVL_PROFILE_SCOPE("GameLogic");
 	if (!ProcessInput()) {
 		return;
 	}
+	BenchmarkTimer timer;
 	if (gbProcessPlayers) {
 		gGameLogicStep = GameLogicStep::ProcessPlayers;
+		timer.Start(BenchmarkPhase::ProcessPlayers);
 		ProcessPlayers();
 	}
 	if (leveltype != DTYPE_TOWN) {
 		gGameLogicStep = GameLogicStep::ProcessMonsters;
+		timer.Start(BenchmarkPhase::ProcessMonsters);
 		ProcessMonsters();
 		gGameLogicStep = GameLogicStep::ProcessObjects;
+		timer.Start(BenchmarkPhase::ProcessObjects);
 		ProcessObjects();
 		gGameLogicStep = GameLogicStep::ProcessMissiles;
+		timer.Start(BenchmarkPhase::ProcessMissiles);
 		ProcessMissiles();
 		gGameLogicStep = GameLogicStep::ProcessItems;
+		timer.Start(BenchmarkPhase::ProcessItems);
 		ProcessItems();
+		timer.Start(BenchmarkPhase::LightingAndVision);
 		ProcessLightList();
 		ProcessVisionList();
 	} else {
 		gGameLogicStep = GameLogicStep::ProcessTowners;
+		timer.Start(BenchmarkPhase::ProcessTowners);
 		ProcessTowners();
 		gGameLogicStep = GameLogicStep::ProcessItemsTown;
+		timer.Start(BenchmarkPhase::ProcessItems);
 		ProcessItems();
 		gGameLogicStep = GameLogicStep::ProcessMissilesTown;
+		timer.Start(BenchmarkPhase::ProcessMissiles);
 		ProcessMissiles();
 	}
+	timer.Stop();
 	gGameLogicStep = GameLogicStep::None;
 
 #ifdef _DEBUG
@@ -1493,6 +1528,21 @@ void InitKeymapActions()
 	    [] { Players[MyPlayerId].Stop(); },
 	    [&]() { return !IsPlayerDead(); },
 	});
+#ifdef ZONE_PROFILER
+	keymapper.AddAction({
+	    "ToggleProfiler",
+	    DVL_VK_SCROLL,
+	    [] {
+		    if (!profiler::IsCapturing()) {
+			    profiler::StartCapture();
+			    return;
+		    }
+		    const std::string path = profiler::SaveCapture();
+		    if (!path.empty())
+			    EventPlrMsg("Profile saved to %s", path.c_str());
+	    },
+	});
+#endif
 #ifdef _DEBUG
 	keymapper.AddAction({
 	    "DebugToggle",
@@ -1594,7 +1644,7 @@ int DiabloMain(int argc, char **argv)
 	mainmenu_loop();
 	DiabloDeinit();
 
-	return 0;
+	return benchmark::ExitStatus();
 }
 
 bool TryIconCurs()
@@ -2076,6 +2126,7 @@ void game_loop(bool bStartup)
 		}
 		TimeoutCursor(false);
 		GameLogic();
+		StateHashTick();
 
 		if (!gbRunGame || !gbIsMultiplayer || demo::IsRunning() || demo::IsRecording() || !nthread_has_500ms_passed())
 			break;
@@ -4,6 +4,7 @@
 #ifndef NONET
 #include "dvlnet/base_protocol.h"
 #include "dvlnet/cdwrap.h"
+#include "dvlnet/protocol_sim.h"
 #ifndef DISABLE_ZERO_TIER
 #include "dvlnet/protocol_zt.h"
 #endif
@@ -33,6 +34,8 @@ std::unique_ptr<abstract_net> abstract_net::MakeNet(provider_t provider)
 #endif
 	case SELCONN_LOOPBACK:
 		return std::make_unique<loopback>();
+	case SELCONN_SIM:
+		return std::make_unique<cdwrap<base_protocol<protocol_sim>>>();
 	default:
 		ABORT();
 	}
@@ -61,6 +61,21 @@ public:
 		return std::vector<std::string>();
 	}
 
+	/**
+	 * @brief Blocks until the provider has received data or the timeout expires
+	 * @return False if the provider can't signal incoming data, in which case nothing was waited for
+	 */
+	virtual bool SNetWaitForData(uint32_t timeoutMs)
+	{
+		return false;
+	}
+
+	/** @brief Returns true if the server said no other player was in the game when this one joined */
+	virtual bool SNetJoinedEmptyGame()
+	{
+		return false;
+	}
+
 	static std::unique_ptr<abstract_net> MakeNet(provider_t provider);
 };
 
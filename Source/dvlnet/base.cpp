@@ -86,6 +86,9 @@ void base::RecvLocal(packet &pkt)
 	case PT_CONNECT:
 		connected_table[pkt.NewPlayer()] = true; // this can probably be removed
 		break;
+	case PT_GAME_EMPTY:
+		joined_empty_game = true;
+		break;
 	case PT_DISCONNECT:
 		if (pkt.NewPlayer() != plr_self) {
 			if (connected_table[pkt.NewPlayer()]) {
@@ -267,5 +270,10 @@ bool base::SNetGetTurnsInTransit(uint32_t *turns)
 	return true;
 }
 
+bool base::SNetJoinedEmptyGame()
+{
+	return joined_empty_game;
+}
+
 } // namespace net
 } // namespace devilution
@@ -29,6 +29,7 @@ public:
 	virtual bool SNetDropPlayer(int playerid, uint32_t flags);
 	virtual bool SNetGetOwnerTurnsWaiting(uint32_t *turns);
 	virtual bool SNetGetTurnsInTransit(uint32_t *turns);
+	virtual bool SNetJoinedEmptyGame();
 
 	virtual void poll() = 0;
 	virtual void send(packet &pkt) = 0;
@@ -68,6 +69,8 @@ protected:
 
 	plr_t plr_self = PLR_BROADCAST;
 	cookie_t cookie_self = 0;
+	/** A dedicated server told us nobody else was in the game, so nobody will send the level data */
+	bool joined_empty_game = false;
 
 	std::unique_ptr<packet_factory> pktfty;
 
@@ -153,7 +153,7 @@ template <class P>
 void base_protocol<P>::send(packet &pkt)
 {
 	if (pkt.Destination() < MAX_PLRS) {
-		if (pkt.Destination() == MyPlayerId)
+		if (pkt.Destination() == plr_self)
 			return;
 		if (peers[pkt.Destination()])
 			proto.send(peers[pkt.Destination()], pkt.Data());
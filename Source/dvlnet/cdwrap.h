@@ -41,6 +41,8 @@ public:
 	virtual void send_info_request();
 	virtual void clear_gamelist();
 	virtual std::vector<std::string> get_gamelist();
+	virtual bool SNetWaitForData(uint32_t timeoutMs);
+	virtual bool SNetJoinedEmptyGame();
 	virtual void setup_password(std::string pw);
 	virtual void clear_password();
 
@@ -190,6 +192,18 @@ std::vector<std::string> cdwrap<T>::get_gamelist()
 	return dvlnet_wrap->get_gamelist();
 }
 
+template <class T>
+bool cdwrap<T>::SNetWaitForData(uint32_t timeoutMs)
+{
+	return dvlnet_wrap->SNetWaitForData(timeoutMs);
+}
+
+template <class T>
+bool cdwrap<T>::SNetJoinedEmptyGame()
+{
+	return dvlnet_wrap->SNetJoinedEmptyGame();
+}
+
 template <class T>
 void cdwrap<T>::setup_password(std::string pw)
 {
@@ -2,75 +2,125 @@
 
 #include <cstring>
 
-#include "dvlnet/packet.h"
+#include "utils/stubs.h"
 
 namespace devilution {
 namespace net {
 
-framesize_t frame_queue::Size() const
+frame_queue::frame_queue(size_t capacity)
+    : buffer_(capacity)
 {
-	return current_size;
 }
 
-buffer_t frame_queue::Read(framesize_t s)
+size_t frame_queue::Size() const
 {
-	if (current_size < s)
-		throw frame_queue_exception();
-	buffer_t ret;
-	while (s > 0 && s >= buffer_deque.front().size()) {
-		s -= buffer_deque.front().size();
-		current_size -= buffer_deque.front().size();
-		ret.insert(ret.end(),
-		    buffer_deque.front().begin(),
-		    buffer_deque.front().end());
-		buffer_deque.pop_front();
+	return writePos_ - readPos_;
+}
+
+void frame_queue::Reserve(size_t size)
+{
+	if (readPos_ == writePos_) {
+		readPos_ = 0;
+		writePos_ = 0;
 	}
-	if (s > 0) {
-		ret.insert(ret.end(),
-		    buffer_deque.front().begin(),
-		    buffer_deque.front().begin() + s);
-		buffer_deque.front().erase(buffer_deque.front().begin(),
-		    buffer_deque.front().begin() + s);
-		current_size -= s;
+	if (buffer_.size() - writePos_ >= size)
+		return;
+
+	size_t unread = Size();
+	if (readPos_ != 0) {
+		std::memmove(buffer_.data(), buffer_.data() + readPos_, unread);
+		readPos_ = 0;
+		writePos_ = unread;
 	}
-	return ret;
+	if (buffer_.size() - writePos_ < size)
+		buffer_.resize(writePos_ + size);
+}
+
+unsigned char *frame_queue::WriteBuffer()
+{
+	Reserve(header_size + max_frame_size);
+	return buffer_.data() + writePos_;
 }
 
-void frame_queue::Write(buffer_t buf)
+size_t frame_queue::WriteCapacity() const
 {
-	current_size += buf.size();
-	buffer_deque.push_back(std::move(buf));
+	return buffer_.size() - writePos_;
+}
+
+void frame_queue::CommitWrite(size_t size)
+{
+	if (size > WriteCapacity())
+		ABORT();
+	writePos_ += size;
+}
+
+void frame_queue::Write(const unsigned char *data, size_t size)
+{
+	Reserve(size);
+	std::memcpy(buffer_.data() + writePos_, data, size);
+	writePos_ += size;
 }
 
 bool frame_queue::PacketReady()
 {
 	if (nextsize == 0) {
-		if (Size() < sizeof(framesize_t))
+		if (Size() < header_size)
 			return false;
-		auto szbuf = Read(sizeof(framesize_t));
-		std::memcpy(&nextsize, &szbuf[0], sizeof(framesize_t));
-		if (nextsize == 0)
+		std::memcpy(&nextsize, buffer_.data() + readPos_, header_size);
+		readPos_ += header_size;
+		if (nextsize == 0 || nextsize > max_frame_size)
 			throw frame_queue_exception();
 	}
 	return Size() >= nextsize;
 }
 
-buffer_t frame_queue::ReadPacket()
+frame_view frame_queue::PeekPacket() const
 {
 	if (nextsize == 0 || Size() < nextsize)
 		throw frame_queue_exception();
-	auto ret = Read(nextsize);
+	return { buffer_.data() + readPos_, nextsize };
+}
+
+void frame_queue::PopPacket()
+{
+	if (nextsize == 0 || Size() < nextsize)
+		throw frame_queue_exception();
+	readPos_ += nextsize;
 	nextsize = 0;
+}
+
+buffer_t frame_queue::ReadPacket()
+{
+	frame_view frame = PeekPacket();
+	buffer_t ret(frame.data, frame.data + frame.size);
+	PopPacket();
 	return ret;
 }
 
-buffer_t frame_queue::MakeFrame(buffer_t packetbuf)
+frame_header frame_queue::MakeHeader(size_t size)
 {
-	buffer_t ret;
-	if (packetbuf.size() > max_frame_size)
+	if (size > max_frame_size)
 		ABORT();
-	framesize_t size = packetbuf.size();
-	ret.insert(ret.end(), packet_out::begin(size), packet_out::end(size));
+	framesize_t framesize = static_cast<framesize_t>(size);
+	frame_header header;
+	std::memcpy(header.data(), &framesize, header_size);
+	return header;
+}
+
+std::shared_ptr<const outgoing_frame> frame_queue::MakeOutgoingFrame(std::shared_ptr<const buffer_t> packetbuf)
+{
+	auto frame = std::make_shared<outgoing_frame>();
+	frame->header = MakeHeader(packetbuf->size());
+	frame->payload = std::move(packetbuf);
+	return frame;
+}
+
+buffer_t frame_queue::MakeFrame(const buffer_t &packetbuf)
+{
+	frame_header header = MakeHeader(packetbuf.size());
+	buffer_t ret;
+	ret.reserve(header_size + packetbuf.size());
+	ret.insert(ret.end(), header.begin(), header.end());
 	ret.insert(ret.end(), packetbuf.begin(), packetbuf.end());
 	return ret;
 }
@@ -1,9 +1,11 @@
 #pragma once
 
-#include <deque>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <memory>
 #include <vector>
-#include <cstdint>
 
 namespace devilution {
 namespace net {
@@ -20,24 +22,66 @@ public:
 
 typedef uint32_t framesize_t;
 
+/** Length prefix sent ahead of every frame, in native byte order */
+typedef std::array<unsigned char, sizeof(framesize_t)> frame_header;
+
+/** Non-owning view of a frame payload inside a frame_queue */
+struct frame_view {
+	const unsigned char *data;
+	framesize_t size;
+};
+
+/**
+ * An outgoing frame kept as header and payload so it can be written with a single
+ * scatter/gather call. It is shared between all the connections it is sent to, and
+ * the payload is the data of the packet it was made from.
+ */
+struct outgoing_frame {
+	frame_header header;
+	std::shared_ptr<const buffer_t> payload;
+};
+
+/**
+ * Receive buffer that splits a byte stream into length prefixed frames.
+ *
+ * Sockets receive straight into the free space at the end of the buffer and frames are
+ * handed out as views into it, so a frame is only copied when the caller needs to own it.
+ * Consumed bytes are reclaimed by moving the unread tail (at most one partial frame) back
+ * to the front, which keeps every frame contiguous.
+ */
 class frame_queue {
 public:
 	constexpr static framesize_t max_frame_size = 0xFFFF;
+	constexpr static size_t header_size = sizeof(framesize_t);
+	/** Enough room to receive a whole frame behind an incomplete one without growing */
+	constexpr static size_t default_capacity = 2 * (header_size + max_frame_size);
 
-private:
-	framesize_t current_size = 0;
-	std::deque<buffer_t> buffer_deque;
-	framesize_t nextsize = 0;
-
-	framesize_t Size() const;
-	buffer_t Read(framesize_t s);
+	frame_queue(size_t capacity = default_capacity);
 
-public:
 	bool PacketReady();
+	/** @brief Returns the frame found by PacketReady, valid until the next write to the queue */
+	frame_view PeekPacket() const;
+	void PopPacket();
 	buffer_t ReadPacket();
-	void Write(buffer_t buf);
 
-	static buffer_t MakeFrame(buffer_t packetbuf);
+	/** @brief Returns free space to receive into, followed by a call to CommitWrite */
+	unsigned char *WriteBuffer();
+	size_t WriteCapacity() const;
+	void CommitWrite(size_t size);
+	void Write(const unsigned char *data, size_t size);
+
+	static frame_header MakeHeader(size_t size);
+	static std::shared_ptr<const outgoing_frame> MakeOutgoingFrame(std::shared_ptr<const buffer_t> packetbuf);
+	static buffer_t MakeFrame(const buffer_t &packetbuf);
+
+private:
+	std::vector<unsigned char> buffer_;
+	size_t readPos_ = 0;
+	size_t writePos_ = 0;
+	framesize_t nextsize = 0;
+
+	size_t Size() const;
+	void Reserve(size_t size);
 };
 
 } // namespace net
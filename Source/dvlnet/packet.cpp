@@ -64,6 +64,8 @@ const char *packet_type_to_string(uint8_t packetType)
 		return "PT_CONNECT";
 	case PT_DISCONNECT:
 		return "PT_DISCONNECT";
+	case PT_GAME_EMPTY:
+		return "PT_GAME_EMPTY";
 	case PT_INFO_REQUEST:
 		return "PT_INFO_REQUEST";
 	case PT_INFO_REPLY:
@@ -106,14 +108,40 @@ void CheckPacketTypeOneOf(std::initializer_list<packet_type> expectedTypes, std:
 
 } // namespace
 
+void packet::Reset()
+{
+	have_encrypted = false;
+	have_decrypted = false;
+	read_offset = 0;
+	m_message.clear();
+	m_info.clear();
+	encrypted_buffer.clear();
+	decrypted_buffer.clear();
+	shared_data = nullptr;
+}
+
 const buffer_t &packet::Data()
 {
 	assert(have_encrypted || have_decrypted);
+	if (shared_data)
+		return *shared_data;
 	if (have_encrypted)
 		return encrypted_buffer;
 	return decrypted_buffer;
 }
 
+std::shared_ptr<const buffer_t> packet::ShareData()
+{
+	assert(have_encrypted || have_decrypted);
+	if (!shared_data) {
+		// The fields were parsed when the packet was made, so the buffer isn't read again
+		buffer_t &data = have_encrypted ? encrypted_buffer : decrypted_buffer;
+		shared_data = std::make_shared<const buffer_t>(std::move(data));
+		data.clear();
+	}
+	return shared_data;
+}
+
 packet_type packet::Type()
 {
 	assert(have_decrypted);
@@ -174,27 +202,24 @@ leaveinfo_t packet::LeaveInfo()
 	return m_leaveinfo;
 }
 
-void packet_in::Create(buffer_t buf)
+void packet_in::Create(const unsigned char *data, size_t size)
 {
 	assert(!have_encrypted && !have_decrypted);
-	if (buf.size() < sizeof(packet_type) + 2 * sizeof(plr_t))
+	if (size < sizeof(packet_type) + 2 * sizeof(plr_t))
 		throw packet_exception();
 
-	decrypted_buffer = std::move(buf);
+	// Parsing leaves decrypted_buffer intact, so it doubles as the
+	// original data that the TCP server forwards to clients
+	decrypted_buffer.assign(data, data + size);
 	have_decrypted = true;
-
-	// TCP server implementation forwards the original data to clients
-	// so although we are not decrypting anything,
-	// we save a copy in encrypted_buffer anyway
-	encrypted_buffer = decrypted_buffer;
-	have_encrypted = true;
 }
 
 #ifdef PACKET_ENCRYPTION
-void packet_in::Decrypt(buffer_t buf)
+void packet_in::Decrypt(const unsigned char *data, size_t size)
 {
 	assert(!have_encrypted && !have_decrypted);
-	encrypted_buffer = std::move(buf);
+	// The ciphertext is kept for forwarding, so the cleartext goes to a separate (recycled) buffer
+	encrypted_buffer.assign(data, data + size);
 	have_encrypted = true;
 
 	if (encrypted_buffer.size() < crypto_secretbox_NONCEBYTES
@@ -205,11 +230,14 @@ void packet_in::Decrypt(buffer_t buf)
 	    - crypto_secretbox_NONCEBYTES
 	    - crypto_secretbox_MACBYTES);
 	decrypted_buffer.resize(pktlen);
-	int status = crypto_secretbox_open_easy(
+	const unsigned char *nonce = encrypted_buffer.data();
+	const unsigned char *mac = nonce + crypto_secretbox_NONCEBYTES;
+	int status = crypto_secretbox_open_detached(
 	    decrypted_buffer.data(),
-	    encrypted_buffer.data() + crypto_secretbox_NONCEBYTES,
-	    encrypted_buffer.size() - crypto_secretbox_NONCEBYTES,
-	    encrypted_buffer.data(),
+	    mac + crypto_secretbox_MACBYTES,
+	    mac,
+	    pktlen,
+	    nonce,
 	    key.data());
 	if (status != 0)
 		throw packet_exception();
@@ -219,6 +247,12 @@ void packet_in::Decrypt(buffer_t buf)
 #endif
 
 #ifdef PACKET_ENCRYPTION
+void packet_out::ReserveEncryptionHeader()
+{
+	assert(!have_encrypted && !have_decrypted);
+	decrypted_buffer.assign(crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES, 0);
+}
+
 void packet_out::Encrypt()
 {
 	assert(have_decrypted);
@@ -226,17 +260,21 @@ void packet_out::Encrypt()
 	if (have_encrypted)
 		return;
 
-	auto lenCleartext = decrypted_buffer.size();
-	encrypted_buffer.insert(encrypted_buffer.begin(),
-	    crypto_secretbox_NONCEBYTES, 0);
-	encrypted_buffer.insert(encrypted_buffer.end(),
-	    crypto_secretbox_MACBYTES + lenCleartext, 0);
-	randombytes_buf(encrypted_buffer.data(), crypto_secretbox_NONCEBYTES);
-	int status = crypto_secretbox_easy(
-	    encrypted_buffer.data() + crypto_secretbox_NONCEBYTES,
-	    decrypted_buffer.data(),
-	    lenCleartext,
-	    encrypted_buffer.data(),
+	// process_data() appended the cleartext behind room for the nonce and MAC,
+	// which is the layout crypto_secretbox_easy produces, so encrypt it in place
+	constexpr size_t headerSize = crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES;
+	assert(decrypted_buffer.size() >= headerSize);
+	encrypted_buffer.swap(decrypted_buffer);
+	unsigned char *nonce = encrypted_buffer.data();
+	unsigned char *mac = nonce + crypto_secretbox_NONCEBYTES;
+	unsigned char *text = mac + crypto_secretbox_MACBYTES;
+	randombytes_buf(nonce, crypto_secretbox_NONCEBYTES);
+	int status = crypto_secretbox_detached(
+	    text,
+	    mac,
+	    text,
+	    encrypted_buffer.size() - headerSize,
+	    nonce,
 	    key.data());
 	if (status != 0)
 		ABORT();
@@ -250,6 +288,12 @@ packet_factory::packet_factory()
 	secure = false;
 }
 
+packet_factory::packet_factory(const packet_factory &other)
+    : key(other.key)
+    , secure(other.secure)
+{
+}
+
 packet_factory::packet_factory(std::string pw)
 {
 	secure = false;
@@ -5,6 +5,8 @@
 #include <memory>
 #include <array>
 #include <cstring>
+#include <utility>
+#include <vector>
 #ifdef PACKET_ENCRYPTION
 #include <sodium.h>
 #endif
@@ -23,6 +25,7 @@ enum packet_type : uint8_t {
 	PT_JOIN_ACCEPT  = 0x12,
 	PT_CONNECT      = 0x13,
 	PT_DISCONNECT   = 0x14,
+	PT_GAME_EMPTY   = 0x15,
 	PT_INFO_REQUEST = 0x21,
 	PT_INFO_REPLY   = 0x22,
 	// clang-format on
@@ -83,12 +86,24 @@ protected:
 	bool have_decrypted = false;
 	buffer_t encrypted_buffer;
 	buffer_t decrypted_buffer;
+	/** Data() once it was handed to frames in flight, see ShareData */
+	std::shared_ptr<const buffer_t> shared_data;
+	/** Number of bytes of decrypted_buffer already parsed by packet_in */
+	size_t read_offset = 0;
 
 public:
 	packet(const key_t &k)
 	    : key(k) {};
 
+	/** @brief Clears the packet for reuse, keeping the capacity of its buffers */
+	void Reset();
+
 	const buffer_t &Data();
+	/**
+	 * @brief Returns Data() as a buffer that outgoing frames keep without copying it.
+	 * The packet gives up its own buffer, so it allocates a new one when it is reused.
+	 */
+	std::shared_ptr<const buffer_t> ShareData();
 
 	packet_type Type();
 	plr_t Source() const;
@@ -111,11 +126,11 @@ public:
 class packet_in : public packet_proc<packet_in> {
 public:
 	using packet_proc<packet_in>::packet_proc;
-	void Create(buffer_t buf);
+	void Create(const unsigned char *data, size_t size);
 	void process_element(buffer_t &x);
 	template <class T>
 	void process_element(T &x);
-	void Decrypt(buffer_t buf);
+	void Decrypt(const unsigned char *data, size_t size);
 };
 
 class packet_out : public packet_proc<packet_out> {
@@ -133,6 +148,7 @@ public:
 	template <class T>
 	static const unsigned char *end(const T &x);
 	static cookie_t GenerateCookie();
+	void ReserveEncryptionHeader();
 	void Encrypt();
 };
 
@@ -171,24 +187,24 @@ void packet_proc<P>::process_data()
 		self.process_element(m_info);
 		break;
 	case PT_INFO_REQUEST:
+	case PT_GAME_EMPTY:
 		break;
 	}
 }
 
 inline void packet_in::process_element(buffer_t &x)
 {
-	x.insert(x.begin(), decrypted_buffer.begin(), decrypted_buffer.end());
-	decrypted_buffer.resize(0);
+	x.assign(decrypted_buffer.begin() + read_offset, decrypted_buffer.end());
+	read_offset = decrypted_buffer.size();
 }
 
 template <class T>
 void packet_in::process_element(T &x)
 {
-	if (decrypted_buffer.size() < sizeof(T))
+	if (decrypted_buffer.size() - read_offset < sizeof(T))
 		throw packet_exception();
-	std::memcpy(&x, decrypted_buffer.data(), sizeof(T));
-	decrypted_buffer.erase(decrypted_buffer.begin(),
-	    decrypted_buffer.begin() + sizeof(T));
+	std::memcpy(&x, decrypted_buffer.data() + read_offset, sizeof(T));
+	read_offset += sizeof(T);
 }
 
 template <>
@@ -249,7 +265,7 @@ inline void packet_out::create<PT_JOIN_REQUEST>(plr_t s, plr_t d,
 	m_src = s;
 	m_dest = d;
 	m_cookie = c;
-	m_info = i;
+	m_info = std::move(i);
 }
 
 template <>
@@ -264,7 +280,7 @@ inline void packet_out::create<PT_JOIN_ACCEPT>(plr_t s, plr_t d, cookie_t c,
 	m_dest = d;
 	m_cookie = c;
 	m_newplr = n;
-	m_info = i;
+	m_info = std::move(i);
 }
 
 template <>
@@ -277,7 +293,7 @@ inline void packet_out::create<PT_CONNECT>(plr_t s, plr_t d, plr_t n, buffer_t i
 	m_src = s;
 	m_dest = d;
 	m_newplr = n;
-	m_info = i;
+	m_info = std::move(i);
 }
 
 template <>
@@ -292,6 +308,17 @@ inline void packet_out::create<PT_CONNECT>(plr_t s, plr_t d, plr_t n)
 	m_newplr = n;
 }
 
+template <>
+inline void packet_out::create<PT_GAME_EMPTY>(plr_t s, plr_t d)
+{
+	if (have_encrypted || have_decrypted)
+		ABORT();
+	have_decrypted = true;
+	m_type = PT_GAME_EMPTY;
+	m_src = s;
+	m_dest = d;
+}
+
 template <>
 inline void packet_out::create<PT_DISCONNECT>(plr_t s, plr_t d, plr_t n,
     leaveinfo_t l)
@@ -329,45 +356,111 @@ const unsigned char *packet_out::end(const T &x)
 	return reinterpret_cast<const unsigned char *>(&x) + sizeof(T);
 }
 
+class packet_factory;
+
+/** Hands a packet back to the pool of the packet_factory that made it */
+struct packet_recycler {
+	packet_factory *factory = nullptr;
+	bool outgoing = false;
+
+	void operator()(packet *pkt) const;
+};
+
+typedef std::unique_ptr<packet, packet_recycler> packet_ptr;
+
 class packet_factory {
 	key_t key = {};
 	bool secure;
+	std::vector<std::unique_ptr<packet_in>> free_in;
+	std::vector<std::unique_ptr<packet_out>> free_out;
+
+	friend struct packet_recycler;
+
+	template <class P>
+	static P *Acquire(std::vector<std::unique_ptr<P>> &pool, const key_t &key);
+	template <class P>
+	static void Release(std::vector<std::unique_ptr<P>> &pool, P *pkt);
 
 public:
 	static constexpr unsigned short max_packet_size = 0xFFFF;
+	/** Number of idle packets of each direction kept for reuse */
+	static constexpr size_t max_pooled_packets = 16;
 
 	packet_factory();
 	packet_factory(std::string pw);
-	std::unique_ptr<packet> make_packet(buffer_t buf);
+	/** @brief Makes a factory with the same key but a pool of its own, for use on another thread */
+	packet_factory(const packet_factory &other);
+	packet_factory &operator=(const packet_factory &) = delete;
+	packet_ptr make_packet(const unsigned char *data, size_t size);
+	packet_ptr make_packet(const buffer_t &buf);
 	template <packet_type t, typename... Args>
-	std::unique_ptr<packet> make_packet(Args... args);
+	packet_ptr make_packet(Args &&...args);
 };
 
-inline std::unique_ptr<packet> packet_factory::make_packet(buffer_t buf)
+template <class P>
+P *packet_factory::Acquire(std::vector<std::unique_ptr<P>> &pool, const key_t &key)
+{
+	if (pool.empty())
+		return new P(key);
+	P *pkt = pool.back().release();
+	pool.pop_back();
+	return pkt;
+}
+
+template <class P>
+void packet_factory::Release(std::vector<std::unique_ptr<P>> &pool, P *pkt)
 {
-	auto ret = std::make_unique<packet_in>(key);
+	if (pool.size() >= max_pooled_packets) {
+		delete pkt;
+		return;
+	}
+	pkt->Reset();
+	pool.emplace_back(pkt);
+}
+
+inline void packet_recycler::operator()(packet *pkt) const
+{
+	if (outgoing)
+		packet_factory::Release(factory->free_out, static_cast<packet_out *>(pkt));
+	else
+		packet_factory::Release(factory->free_in, static_cast<packet_in *>(pkt));
+}
+
+inline packet_ptr packet_factory::make_packet(const unsigned char *data, size_t size)
+{
+	packet_ptr ret(Acquire(free_in, key), packet_recycler { this, false });
+	auto &in = static_cast<packet_in &>(*ret);
 #ifndef PACKET_ENCRYPTION
-	ret->Create(std::move(buf));
+	in.Create(data, size);
 #else
 	if (!secure)
-		ret->Create(std::move(buf));
+		in.Create(data, size);
 	else
-		ret->Decrypt(std::move(buf));
+		in.Decrypt(data, size);
 #endif
-	size_t size = ret->Data().size();
-	ret->process_data();
+	in.process_data();
 	return ret;
 }
 
+inline packet_ptr packet_factory::make_packet(const buffer_t &buf)
+{
+	return make_packet(buf.data(), buf.size());
+}
+
 template <packet_type t, typename... Args>
-std::unique_ptr<packet> packet_factory::make_packet(Args... args)
+packet_ptr packet_factory::make_packet(Args &&...args)
 {
-	auto ret = std::make_unique<packet_out>(key);
-	ret->create<t>(args...);
-	ret->process_data();
+	packet_ptr ret(Acquire(free_out, key), packet_recycler { this, true });
+	auto &out = static_cast<packet_out &>(*ret);
+#ifdef PACKET_ENCRYPTION
+	if (secure)
+		out.ReserveEncryptionHeader();
+#endif
+	out.create<t>(std::forward<Args>(args)...);
+	out.process_data();
 #ifdef PACKET_ENCRYPTION
 	if (secure)
-		ret->Encrypt();
+		out.Encrypt();
 #endif
 	return ret;
 }
@@ -0,0 +1,302 @@
+#include "dvlnet/protocol_sim.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include <SDL.h>
+
+namespace devilution {
+namespace net {
+
+sim_network &sim_network::get()
+{
+	static sim_network network;
+	return network;
+}
+
+void sim_network::reset(const sim_settings &newSettings)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	settings = newSettings;
+	counters = {};
+	endpoints.clear();
+	link_last_delivery.clear();
+	turn_hashes.clear();
+	next_id = 1;
+	next_order = 0;
+	rng_state = settings.seed * 2654435761U + 1;
+	manual_clock = false;
+	idle_handler = nullptr;
+}
+
+void sim_network::use_manual_clock(uint32_t start)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	manual_clock = true;
+	manual_now = start;
+}
+
+void sim_network::advance(uint32_t ms)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	manual_now += ms;
+}
+
+void sim_network::set_idle_handler(std::function<void()> handler)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	idle_handler = std::move(handler);
+}
+
+uint32_t sim_network::now()
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	return clock();
+}
+
+sim_stats sim_network::stats()
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	return counters;
+}
+
+uint32_t sim_network::clock()
+{
+	return manual_clock ? manual_now : SDL_GetTicks();
+}
+
+uint32_t sim_network::random(uint32_t range)
+{
+	// xorshift32, good enough for spreading delays and independent of the game's RNG
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return range == 0 ? 0 : rng_state % range;
+}
+
+uint32_t sim_network::attach()
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	uint32_t id = next_id++;
+	endpoints[id];
+	return id;
+}
+
+void sim_network::detach(uint32_t id)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	auto it = endpoints.find(id);
+	if (it == endpoints.end())
+		return;
+	for (uint32_t peer : it->second.peers)
+		notify_disconnect(peer, id);
+	endpoints.erase(it);
+}
+
+void sim_network::disconnect(uint32_t id, uint32_t peer)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	auto it = endpoints.find(id);
+	if (it == endpoints.end())
+		return;
+	it->second.peers.erase(peer);
+	notify_disconnect(peer, id);
+}
+
+void sim_network::notify_disconnect(uint32_t id, uint32_t peer)
+{
+	auto it = endpoints.find(id);
+	if (it == endpoints.end() || it->second.peers.erase(peer) == 0)
+		return;
+	auto &inbox = it->second.inbox;
+	inbox.erase(std::remove_if(inbox.begin(), inbox.end(), [&](const in_flight &pkt) { return pkt.from == peer; }), inbox.end());
+	it->second.disconnected.push_back(peer);
+}
+
+void sim_network::send(uint32_t from, uint32_t to, const buffer_t &data, bool oob)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	enqueue(from, to, data, oob);
+}
+
+void sim_network::send_all(uint32_t from, const buffer_t &data)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	for (auto &endpoint : endpoints) {
+		if (endpoint.first != from)
+			enqueue(from, endpoint.first, data, true);
+	}
+}
+
+void sim_network::enqueue(uint32_t from, uint32_t to, const buffer_t &data, bool oob)
+{
+	auto sender = endpoints.find(from);
+	auto receiver = endpoints.find(to);
+	if (sender == endpoints.end() || receiver == endpoints.end())
+		return;
+
+	counters.packets_sent++;
+	counters.bytes_sent += data.size();
+
+	const uint32_t now = clock();
+	uint32_t sentAt = std::max(now, sender->second.tx_free_at);
+	if (settings.bandwidth != 0)
+		sentAt += static_cast<uint32_t>(uint64_t { data.size() } * 1000 / settings.bandwidth);
+	sender->second.tx_free_at = sentAt;
+
+	uint32_t deliverAt = sentAt + settings.latency_ms + random(settings.jitter_ms + 1);
+	if (random(100) < settings.loss_percent) {
+		if (oob) {
+			counters.oob_dropped++;
+			return;
+		}
+		counters.retransmissions++;
+		deliverAt += settings.retransmit_ms;
+	}
+
+	if (!oob) {
+		// Streams never overtake themselves, jitter only delays what comes after
+		uint32_t &last = link_last_delivery[{ from, to }];
+		deliverAt = std::max(deliverAt, last);
+		last = deliverAt;
+		sender->second.peers.insert(to);
+		receiver->second.peers.insert(from);
+	}
+
+	auto &inbox = receiver->second.inbox;
+	in_flight pkt { deliverAt, next_order++, from, data };
+	auto pos = std::upper_bound(inbox.begin(), inbox.end(), pkt, [](const in_flight &a, const in_flight &b) {
+		return a.deliver_at != b.deliver_at ? a.deliver_at < b.deliver_at : a.order < b.order;
+	});
+	inbox.insert(pos, std::move(pkt));
+}
+
+bool sim_network::recv(uint32_t id, uint32_t &from, buffer_t &data)
+{
+	std::function<void()> handler;
+	{
+		std::lock_guard<SdlMutex> lock(mutex);
+		auto it = endpoints.find(id);
+		if (it == endpoints.end())
+			return false;
+		auto &inbox = it->second.inbox;
+		if (!inbox.empty() && inbox.front().deliver_at <= clock()) {
+			from = inbox.front().from;
+			data = std::move(inbox.front().data);
+			inbox.pop_front();
+			counters.packets_delivered++;
+			return true;
+		}
+		if (!idle_handler || idle)
+			return false;
+		handler = idle_handler;
+		idle = true;
+	}
+	// Outside the lock, the handler polls other endpoints
+	handler();
+	std::lock_guard<SdlMutex> lock(mutex);
+	idle = false;
+	return false;
+}
+
+bool sim_network::get_disconnected(uint32_t id, uint32_t &peer)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	auto it = endpoints.find(id);
+	if (it == endpoints.end() || it->second.disconnected.empty())
+		return false;
+	peer = it->second.disconnected.front();
+	it->second.disconnected.pop_front();
+	return true;
+}
+
+void sim_network::record_turn_hash(int instance, uint32_t turn, uint64_t hash)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	turn_hashes[turn][instance] = hash;
+}
+
+bool sim_network::find_desync(uint32_t &turn)
+{
+	std::lock_guard<SdlMutex> lock(mutex);
+	for (const auto &hashes : turn_hashes) {
+		for (const auto &hash : hashes.second) {
+			if (hash.second != hashes.second.begin()->second) {
+				turn = hashes.first;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+buffer_t protocol_sim::endpoint::serialize() const
+{
+	buffer_t buf(sizeof(id));
+	std::memcpy(buf.data(), &id, sizeof(id));
+	return buf;
+}
+
+void protocol_sim::endpoint::unserialize(const buffer_t &buf)
+{
+	if (buf.size() != sizeof(id))
+		throw dvlnet_exception();
+	std::memcpy(&id, buf.data(), sizeof(id));
+}
+
+protocol_sim::protocol_sim()
+    : self(sim_network::get().attach())
+{
+}
+
+protocol_sim::~protocol_sim()
+{
+	sim_network::get().detach(self);
+}
+
+void protocol_sim::disconnect(const endpoint &peer)
+{
+	sim_network::get().disconnect(self, peer.id);
+}
+
+bool protocol_sim::send(const endpoint &peer, const buffer_t &data)
+{
+	sim_network::get().send(self, peer.id, data, false);
+	return true;
+}
+
+bool protocol_sim::send_oob(const endpoint &peer, const buffer_t &data) const
+{
+	sim_network::get().send(self, peer.id, data, true);
+	return true;
+}
+
+bool protocol_sim::send_oob_mc(const buffer_t &data) const
+{
+	sim_network::get().send_all(self, data);
+	return true;
+}
+
+bool protocol_sim::recv(endpoint &peer, buffer_t &data)
+{
+	return sim_network::get().recv(self, peer.id, data);
+}
+
+bool protocol_sim::get_disconnected(endpoint &peer)
+{
+	return sim_network::get().get_disconnected(self, peer.id);
+}
+
+bool protocol_sim::network_online()
+{
+	return true;
+}
+
+std::string protocol_sim::make_default_gamename()
+{
+	return "sim";
+}
+
+} // namespace net
+} // namespace devilution
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "dvlnet/abstract_net.h"
+#include "utils/sdl_mutex.h"
+
+namespace devilution {
+namespace net {
+
+/**
+ * @brief Behaviour of the simulated links between endpoints
+ *
+ * Links carry game traffic reliably and in order like the TCP streams of the ZeroTier provider,
+ * so a lost packet costs a retransmission instead of being dropped. Out-of-band packets
+ * (game discovery) are datagrams and really are dropped.
+ */
+struct sim_settings {
+	uint32_t latency_ms = 0;
+	/** Additional random delay of up to this many milliseconds */
+	uint32_t jitter_ms = 0;
+	/** Chance of a packet getting lost, in percent */
+	uint32_t loss_percent = 0;
+	/** Extra delay of a reliable packet that got lost */
+	uint32_t retransmit_ms = 200;
+	/** Bytes per second each endpoint can send, 0 for no limit */
+	uint32_t bandwidth = 0;
+	uint32_t seed = 0;
+};
+
+struct sim_stats {
+	uint64_t packets_sent = 0;
+	uint64_t bytes_sent = 0;
+	uint64_t packets_delivered = 0;
+	uint64_t retransmissions = 0;
+	uint64_t oob_dropped = 0;
+};
+
+/**
+ * @brief In-process network connecting any number of protocol_sim endpoints
+ *
+ * Delivery only depends on the settings, the seed and the clock, so a test driving the clock
+ * itself gets the same timing on every run.
+ */
+class sim_network {
+public:
+	static sim_network &get();
+
+	/** @brief Drops all endpoints, traffic, statistics and turn hashes and applies new settings */
+	void reset(const sim_settings &settings = {});
+	/** @brief Stops following SDL_GetTicks, time only moves on with advance() */
+	void use_manual_clock(uint32_t start = 0);
+	void advance(uint32_t ms);
+	/**
+	 * @brief Sets a function that runs whenever an endpoint finds nothing to receive
+	 *
+	 * join() blocks until the game replies, so a test driving every endpoint from one thread
+	 * uses this to poll the other endpoints and move the clock on in the meantime.
+	 */
+	void set_idle_handler(std::function<void()> handler);
+	uint32_t now();
+	sim_stats stats();
+
+	uint32_t attach();
+	void detach(uint32_t id);
+	void disconnect(uint32_t id, uint32_t peer);
+	void send(uint32_t from, uint32_t to, const buffer_t &data, bool oob);
+	void send_all(uint32_t from, const buffer_t &data);
+	bool recv(uint32_t id, uint32_t &from, buffer_t &data);
+	bool get_disconnected(uint32_t id, uint32_t &peer);
+
+	/**
+	 * @brief Remembers the state hash an instance computed after executing a turn
+	 * @param instance Player id or any other number identifying the game instance
+	 */
+	void record_turn_hash(int instance, uint32_t turn, uint64_t hash);
+	/**
+	 * @brief Looks for a turn after which the instances didn't agree on the state
+	 * @return True if a desync was found, turn receives the first turn that differs
+	 */
+	bool find_desync(uint32_t &turn);
+
+private:
+	struct in_flight {
+		uint32_t deliver_at;
+		uint64_t order;
+		uint32_t from;
+		buffer_t data;
+	};
+
+	struct endpoint_state {
+		std::deque<in_flight> inbox;
+		std::set<uint32_t> peers;
+		std::deque<uint32_t> disconnected;
+		uint32_t tx_free_at = 0;
+	};
+
+	SdlMutex mutex;
+	sim_settings settings;
+	sim_stats counters;
+	std::map<uint32_t, endpoint_state> endpoints;
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> link_last_delivery;
+	std::map<uint32_t, std::map<int, uint64_t>> turn_hashes;
+	uint32_t next_id = 1;
+	uint64_t next_order = 0;
+	uint32_t rng_state = 1;
+	bool manual_clock = false;
+	uint32_t manual_now = 0;
+	std::function<void()> idle_handler;
+	/** The idle handler is running, endpoints it polls don't start it again */
+	bool idle = false;
+
+	uint32_t clock();
+	uint32_t random(uint32_t range);
+	void enqueue(uint32_t from, uint32_t to, const buffer_t &data, bool oob);
+	void notify_disconnect(uint32_t id, uint32_t peer);
+};
+
+/**
+ * @brief Transport for base_protocol that sends everything through sim_network::get()
+ */
+class protocol_sim {
+public:
+	class endpoint {
+	public:
+		uint32_t id = 0;
+
+		explicit operator bool() const
+		{
+			return id != 0;
+		}
+
+		bool operator==(const endpoint &rhs) const
+		{
+			return id == rhs.id;
+		}
+
+		bool operator!=(const endpoint &rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+		bool operator<(const endpoint &rhs) const
+		{
+			return id < rhs.id;
+		}
+
+		buffer_t serialize() const;
+		void unserialize(const buffer_t &buf);
+	};
+
+	protocol_sim();
+	~protocol_sim();
+	void disconnect(const endpoint &peer);
+	bool send(const endpoint &peer, const buffer_t &data);
+	bool send_oob(const endpoint &peer, const buffer_t &data) const;
+	bool send_oob_mc(const buffer_t &data) const;
+	bool recv(endpoint &peer, buffer_t &data);
+	bool get_disconnected(endpoint &peer);
+	bool network_online();
+	static std::string make_default_gamename();
+
+private:
+	uint32_t self;
+};
+
+} // namespace net
+} // namespace devilution
@@ -1,8 +1,11 @@
 #include "dvlnet/tcp_client.h"
 #include "options.h"
 #include "utils/language.h"
+#include "utils/log.hpp"
 
 #include <SDL.h>
+#include <array>
+#include <chrono>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -43,6 +46,7 @@ int tcp_client::join(std::string addrstr)
 		return -1;
 	}
 	StartReceive();
+	StartIoThread();
 	{
 		cookie_self = packet_out::GenerateCookie();
 		auto pkt = pktfty->make_packet<PT_JOIN_REQUEST>(PLR_BROADCAST,
@@ -69,9 +73,61 @@ int tcp_client::join(std::string addrstr)
 	return plr_self;
 }
 
+int SDLCALL tcp_client::RunIoThread(void *data)
+{
+	auto &self = *static_cast<tcp_client *>(data);
+	try {
+		self.ioc.run();
+	} catch (const std::exception &e) {
+		// The message of the exception doesn't outlive it, poll reports a fixed one
+		Log("Network error: {}", e.what());
+		self.io_error = N_("error: network thread stopped");
+		self.data_ready.Post();
+	}
+	return 0;
+}
+
+void tcp_client::StartIoThread()
+{
+	if (io_thread.joinable())
+		return;
+	ioc.restart();
+	io_thread = SdlThread { RunIoThread, this };
+}
+
+void tcp_client::StopIoThread()
+{
+	if (!io_thread.joinable())
+		return;
+	asio::post(ioc, [this]() { ioc.stop(); });
+	io_thread.join();
+}
+
 void tcp_client::poll()
 {
-	ioc.poll();
+	if (!io_thread.joinable())
+		ioc.poll();
+
+	const char *error = io_error.exchange(nullptr);
+	if (error != nullptr)
+		throw std::runtime_error(_(error));
+
+	buffer_t frame;
+	while (received_frames.TryPop(frame)) {
+		auto pkt = pktfty->make_packet(frame);
+		free_frames.TryPush(std::move(frame));
+		RecvLocal(*pkt);
+	}
+}
+
+bool tcp_client::SNetWaitForData(uint32_t timeoutMs)
+{
+	if (!io_thread.joinable())
+		return false;
+	if (received_frames.Empty())
+		data_ready.WaitTimeout(timeoutMs);
+	data_ready.Drain();
+	return true;
 }
 
 void tcp_client::HandleReceive(const asio::error_code &error, size_t bytesRead)
@@ -83,22 +139,50 @@ void tcp_client::HandleReceive(const asio::error_code &error, size_t bytesRead)
 		return;
 	}
 	if (bytesRead == 0) {
-		throw std::runtime_error(_("error: read 0 bytes from server"));
+		io_error = N_("error: read 0 bytes from server");
+		data_ready.Post();
+		return;
 	}
-	recv_buffer.resize(bytesRead);
-	recv_queue.Write(std::move(recv_buffer));
-	recv_buffer.resize(frame_queue::max_frame_size);
-	while (recv_queue.PacketReady()) {
-		auto pkt = pktfty->make_packet(recv_queue.ReadPacket());
-		RecvLocal(*pkt);
+	recv_queue.CommitWrite(bytesRead);
+	DeliverFrames();
+}
+
+void tcp_client::DeliverFrames()
+{
+	bool delivered = false;
+	try {
+		while (recv_queue.PacketReady()) {
+			buffer_t frame;
+			free_frames.TryPop(frame);
+			frame_view view = recv_queue.PeekPacket();
+			frame.assign(view.data, view.data + view.size);
+			if (!received_frames.TryPush(std::move(frame))) {
+				// The game thread is falling behind, hold off reading until it catches up
+				deliver_retry.expires_after(std::chrono::milliseconds(1));
+				deliver_retry.async_wait([this](const asio::error_code &error) {
+					if (!error)
+						DeliverFrames();
+				});
+				data_ready.Post();
+				return;
+			}
+			recv_queue.PopPacket();
+			delivered = true;
+		}
+	} catch (const frame_queue_exception &e) {
+		io_error = e.what();
+		data_ready.Post();
+		return;
 	}
+	if (delivered)
+		data_ready.Post();
 	StartReceive();
 }
 
 void tcp_client::StartReceive()
 {
 	sock.async_receive(
-	    asio::buffer(recv_buffer),
+	    asio::buffer(recv_queue.WriteBuffer(), recv_queue.WriteCapacity()),
 	    std::bind(&tcp_client::HandleReceive, this, std::placeholders::_1, std::placeholders::_2));
 }
 
@@ -109,17 +193,23 @@ void tcp_client::HandleSend(const asio::error_code &error, size_t bytesSent)
 
 void tcp_client::send(packet &pkt)
 {
-	auto frame = std::make_unique<buffer_t>(frame_queue::MakeFrame(pkt.Data()));
-	auto buf = asio::buffer(*frame);
-	asio::async_write(sock, buf, [this, frame = std::move(frame)](const asio::error_code &error, size_t bytesSent) {
-		HandleSend(error, bytesSent);
+	auto frame = frame_queue::MakeOutgoingFrame(pkt.ShareData());
+	// The socket belongs to the I/O thread, so writes are started there
+	asio::post(ioc, [this, frame]() {
+		std::array<asio::const_buffer, 2> bufs { asio::buffer(frame->header), asio::buffer(*frame->payload) };
+		asio::async_write(sock, bufs, [this, frame](const asio::error_code &error, size_t bytesSent) {
+			HandleSend(error, bytesSent);
+		});
 	});
+	if (!io_thread.joinable())
+		ioc.poll();
 }
 
 bool tcp_client::SNetLeaveGame(int type)
 {
 	auto ret = base::SNetLeaveGame(type);
 	poll();
+	StopIoThread();
 	if (local_server != nullptr)
 		local_server->Close();
 	sock.close();
@@ -132,7 +222,9 @@ std::string tcp_client::make_default_gamename()
 }
 
 tcp_client::~tcp_client()
-    = default;
+{
+	StopIoThread();
+}
 
 } // namespace net
 } // namespace devilution
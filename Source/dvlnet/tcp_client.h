@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <asio/ts/buffer.hpp>
@@ -11,6 +12,9 @@
 #include "dvlnet/frame_queue.h"
 #include "dvlnet/base.h"
 #include "dvlnet/tcp_server.h"
+#include "utils/sdl_semaphore.h"
+#include "utils/sdl_thread.h"
+#include "utils/spsc_queue.hpp"
 
 namespace devilution {
 namespace net {
@@ -24,21 +28,36 @@ public:
 	virtual void send(packet &pkt);
 
 	virtual bool SNetLeaveGame(int type);
+	virtual bool SNetWaitForData(uint32_t timeoutMs);
 
 	virtual ~tcp_client();
 
 	virtual std::string make_default_gamename();
 
 private:
+	/** Frames in flight from the I/O thread to the game thread */
+	static constexpr size_t frame_queue_capacity = 256;
+
 	frame_queue recv_queue;
-	buffer_t recv_buffer = buffer_t(frame_queue::max_frame_size);
+	SpscQueue<buffer_t, frame_queue_capacity> received_frames;
+	/** Emptied frame buffers handed back to the I/O thread for reuse */
+	SpscQueue<buffer_t, frame_queue_capacity> free_frames;
+	SdlSemaphore data_ready;
+	/** Untranslated message of an error on the I/O thread, rethrown by poll */
+	std::atomic<const char *> io_error { nullptr };
 
 	asio::io_context ioc;
 	asio::ip::tcp::resolver resolver = asio::ip::tcp::resolver(ioc);
 	asio::ip::tcp::socket sock = asio::ip::tcp::socket(ioc);
+	asio::steady_timer deliver_retry = asio::steady_timer(ioc);
 	std::unique_ptr<tcp_server> local_server; // must be declared *after* ioc
+	SdlThread io_thread;
 
+	static int SDLCALL RunIoThread(void *data);
+	void StartIoThread();
+	void StopIoThread();
 	void HandleReceive(const asio::error_code &error, size_t bytesRead);
+	void DeliverFrames();
 	void StartReceive();
 	void HandleSend(const asio::error_code &error, size_t bytesSent);
 };
@@ -1,5 +1,6 @@
 #include "dvlnet/tcp_server.h"
 
+#include <array>
 #include <chrono>
 #include <functional>
 #include <memory>
@@ -12,9 +13,11 @@ namespace devilution {
 namespace net {
 
 tcp_server::tcp_server(asio::io_context &ioc, const std::string &bindaddr,
-    unsigned short port, packet_factory &pktfty)
+    unsigned short port, const packet_factory &pktfty, buffer_t gameInitInfo)
     : ioc(ioc)
     , pktfty(pktfty)
+    , game_init_info(std::move(gameInitInfo))
+    , dedicated(!game_init_info.empty())
 {
 	auto addr = asio::ip::address::from_string(bindaddr);
 	auto ep = asio::ip::tcp::endpoint(addr, port);
@@ -61,7 +64,7 @@ bool tcp_server::Empty()
 void tcp_server::StartReceive(const scc &con)
 {
 	con->socket.async_receive(
-	    asio::buffer(con->recv_buffer),
+	    asio::buffer(con->recv_queue.WriteBuffer(), con->recv_queue.WriteCapacity()),
 	    std::bind(&tcp_server::HandleReceive, this, con, std::placeholders::_1, std::placeholders::_2));
 }
 
@@ -72,23 +75,28 @@ void tcp_server::HandleReceive(const scc &con, const asio::error_code &ec,
 		DropConnection(con);
 		return;
 	}
-	con->recv_buffer.resize(bytesRead);
-	con->recv_queue.Write(std::move(con->recv_buffer));
-	con->recv_buffer.resize(frame_queue::max_frame_size);
-	while (con->recv_queue.PacketReady()) {
-		try {
-			auto pkt = pktfty.make_packet(con->recv_queue.ReadPacket());
+	con->recv_queue.CommitWrite(bytesRead);
+	try {
+		while (con->recv_queue.PacketReady()) {
+			frame_view frame = con->recv_queue.PeekPacket();
+			auto pkt = pktfty.make_packet(frame.data, frame.size);
+			con->recv_queue.PopPacket();
 			if (con->plr == PLR_BROADCAST) {
 				HandleReceiveNewPlayer(con, *pkt);
 			} else {
 				con->timeout = timeout_active;
 				HandleReceivePacket(*pkt);
 			}
-		} catch (dvlnet_exception &e) {
-			Log("Network error: {}", e.what());
-			DropConnection(con);
-			return;
 		}
+	} catch (dvlnet_exception &e) {
+		Log("Network error: {}", e.what());
+		DropConnection(con);
+		return;
+	} catch (frame_queue_exception &e) {
+		// A malformed frame leaves the rest of the stream unreadable
+		Log("Network error: {}", e.what());
+		DropConnection(con);
+		return;
 	}
 	StartReceive(con);
 }
@@ -105,12 +113,24 @@ void tcp_server::HandleReceiveNewPlayer(const scc &con, packet &pkt)
 	auto newplr = NextFree();
 	if (newplr == PLR_BROADCAST)
 		throw server_exception();
-	if (Empty())
+	if (Empty() && !dedicated)
 		game_init_info = pkt.Info();
 	auto reply = pktfty.make_packet<PT_JOIN_ACCEPT>(PLR_MASTER, PLR_BROADCAST,
 	    pkt.Cookie(), newplr,
 	    game_init_info);
 	StartSend(con, *reply);
+	if (Empty() && dedicated) {
+		auto empty = pktfty.make_packet<PT_GAME_EMPTY>(PLR_MASTER, PLR_BROADCAST);
+		StartSend(con, *empty);
+	}
+	// Introduce the players already in the game, so the new player knows
+	// whether anyone is left to send it the level data
+	for (plr_t i = 0; i < MAX_PLRS; ++i) {
+		if (connections[i]) {
+			auto connect = pktfty.make_packet<PT_CONNECT>(PLR_MASTER, PLR_BROADCAST, i);
+			StartSend(con, *connect);
+		}
+	}
 	con->plr = newplr;
 	connections[newplr] = con;
 	con->timeout = timeout_active;
@@ -125,9 +145,14 @@ void tcp_server::HandleReceivePacket(packet &pkt)
 void tcp_server::SendPacket(packet &pkt)
 {
 	if (pkt.Destination() == PLR_BROADCAST) {
-		for (auto i = 0; i < MAX_PLRS; ++i)
-			if (i != pkt.Source() && connections[i])
-				StartSend(connections[i], pkt);
+		std::shared_ptr<const outgoing_frame> frame;
+		for (auto i = 0; i < MAX_PLRS; ++i) {
+			if (i != pkt.Source() && connections[i]) {
+				if (!frame)
+					frame = frame_queue::MakeOutgoingFrame(pkt.ShareData());
+				StartSend(connections[i], frame);
+			}
+		}
 	} else {
 		if (pkt.Destination() >= MAX_PLRS)
 			throw server_exception();
@@ -138,10 +163,14 @@ void tcp_server::SendPacket(packet &pkt)
 
 void tcp_server::StartSend(const scc &con, packet &pkt)
 {
-	auto frame = std::make_unique<buffer_t>(frame_queue::MakeFrame(pkt.Data()));
-	auto buf = asio::buffer(*frame);
-	asio::async_write(con->socket, buf,
-	    [this, con, frame = std::move(frame)](const asio::error_code &ec, size_t bytesSent) {
+	StartSend(con, frame_queue::MakeOutgoingFrame(pkt.ShareData()));
+}
+
+void tcp_server::StartSend(const scc &con, const std::shared_ptr<const outgoing_frame> &frame)
+{
+	std::array<asio::const_buffer, 2> bufs { asio::buffer(frame->header), asio::buffer(*frame->payload) };
+	asio::async_write(con->socket, bufs,
+	    [this, con, frame](const asio::error_code &ec, size_t bytesSent) {
 		    HandleSend(con, ec, bytesSent);
 	    });
 }
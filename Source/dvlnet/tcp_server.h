@@ -25,8 +25,12 @@ public:
 
 class tcp_server {
 public:
+	/**
+	 * @param gameInitInfo Game data handed to every player that joins, if empty it is taken
+	 *                     from the first player joining the game
+	 */
 	tcp_server(asio::io_context &ioc, const std::string &bindaddr,
-	    unsigned short port, packet_factory &pktfty);
+	    unsigned short port, const packet_factory &pktfty, buffer_t gameInitInfo = {});
 	std::string LocalhostSelf();
 	void Close();
 	virtual ~tcp_server();
@@ -37,7 +41,6 @@ private:
 
 	struct client_connection {
 		frame_queue recv_queue;
-		buffer_t recv_buffer = buffer_t(frame_queue::max_frame_size);
 		plr_t plr = PLR_BROADCAST;
 		asio::ip::tcp::socket socket;
 		asio::steady_timer timer;
@@ -52,10 +55,12 @@ private:
 	typedef std::shared_ptr<client_connection> scc;
 
 	asio::io_context &ioc;
-	packet_factory &pktfty;
+	packet_factory pktfty;
 	std::unique_ptr<asio::ip::tcp::acceptor> acceptor;
 	std::array<scc, MAX_PLRS> connections;
 	buffer_t game_init_info;
+	/** The game data was set by whoever runs the server and outlives the players */
+	bool dedicated;
 
 	scc MakeConnection();
 	plr_t NextFree();
@@ -69,6 +74,7 @@ private:
 	void SendConnect(const scc &con);
 	void SendPacket(packet &pkt);
 	void StartSend(const scc &con, packet &pkt);
+	void StartSend(const scc &con, const std::shared_ptr<const outgoing_frame> &frame);
 	void HandleSend(const scc &con, const asio::error_code &ec, size_t bytesSent);
 	void StartTimeout(const scc &con);
 	void HandleTimeout(const scc &con, const asio::error_code &ec);
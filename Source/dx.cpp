@@ -13,6 +13,7 @@
 #include "storm/storm.h"
 #include "utils/display.h"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include "utils/sdl_wrap.h"
 
 #ifdef __3DS__
@@ -247,6 +248,7 @@ void Blit(SDL_Surface *src, SDL_Rect *srcRect, SDL_Rect *dstRect)
 
 void RenderPresent()
 {
+	DVL_PROFILE_SCOPE("RenderPresent");
 	SDL_Surface *surface = GetOutputSurface();
 
 	if (!gbActive) {
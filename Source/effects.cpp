@@ -1181,7 +1181,7 @@ void PrivSoundInit(BYTE bLoadMask)
 			continue;
 		}
 
-		sfx.pSnd = sound_file_load(sfx.pszName);
+		sfx.pSnd = sound_file_preload(sfx.pszName);
 	}
 }
 
@@ -1219,7 +1219,7 @@ void InitMonsterSND(int monst)
 			for (int j = 0; j < 2; j++) {
 				char path[MAX_PATH];
 				sprintf(path, MonstersData[mtype].sndfile, MonstSndChar[i], j + 1);
-				LevelMonsterTypes[monst].Snds[i][j] = sound_file_load(path);
+				LevelMonsterTypes[monst].Snds[i][j] = sound_file_preload(path);
 			}
 		}
 	}
@@ -1363,6 +1363,7 @@ int GetSFXLength(int nSFX)
 	if (sgSFX[nSFX].pSnd == nullptr)
 		sgSFX[nSFX].pSnd = sound_file_load(sgSFX[nSFX].pszName,
 		    /*stream=*/AllowStreaming && (sgSFX[nSFX].bFlags & sfx_STREAM) != 0);
+	snd_finish_load(sgSFX[nSFX].pSnd.get());
 	return sgSFX[nSFX].pSnd->DSB.GetLength();
 }
 
@@ -4,9 +4,11 @@
  * Implementation of functions for compression and decompressing MPQ data.
  */
 #include <SDL.h>
+#include <algorithm>
+#include <array>
 #include <cctype>
+#include <cstring>
 #include <memory>
-#include <array>
 
 #include "encrypt.h"
 #include "pkware.h"
@@ -36,7 +38,9 @@ void PkwareBufferWrite(char *buf, unsigned int *size, void *param) // NOLINT(rea
 {
 	auto *pInfo = reinterpret_cast<TDataInfo *>(param);
 
-	memcpy(pInfo->destData + pInfo->destOffset, buf, *size);
+	// Keep counting past the end of the destination so that callers can tell the output didn't fit
+	if (pInfo->destOffset < pInfo->destSize)
+		memcpy(pInfo->destData + pInfo->destOffset, buf, std::min(*size, pInfo->destSize - pInfo->destOffset));
 	pInfo->destOffset += *size;
 }
 
@@ -99,50 +103,72 @@ uint32_t Hash(const char *s, int type)
 	return seed1;
 }
 
-uint32_t PkwareCompress(byte *srcData, uint32_t size)
+char *PkwareWorkBuffer::WorkArea()
 {
-	std::unique_ptr<char[]> ptr { new char[CMP_BUFFER_SIZE] };
-
-	unsigned destSize = 2 * size;
-	if (destSize < 2 * 4096)
-		destSize = 2 * 4096;
+	if (workArea_ == nullptr)
+		workArea_.reset(new char[std::max(CMP_BUFFER_SIZE, EXP_BUFFER_SIZE)]);
+	return workArea_.get();
+}
 
-	std::unique_ptr<byte[]> destData { new byte[destSize] };
+byte *PkwareWorkBuffer::Output(size_t size)
+{
+	if (outputSize_ < size) {
+		output_.reset(new byte[size]);
+		outputSize_ = size;
+	}
+	return output_.get();
+}
 
+uint32_t PkwareCompress(const byte *src, uint32_t srcSize, byte *dest, uint32_t destSize, PkwareWorkBuffer &work)
+{
 	TDataInfo param;
-	param.srcData = srcData;
+	param.srcData = src;
 	param.srcOffset = 0;
-	param.destData = destData.get();
+	param.destData = dest;
 	param.destOffset = 0;
-	param.size = size;
+	param.size = srcSize;
+	param.destSize = destSize;
 
 	unsigned type = 0;
 	unsigned dsize = 4096;
-	implode(PkwareBufferRead, PkwareBufferWrite, ptr.get(), &param, &type, &dsize);
+	implode(PkwareBufferRead, PkwareBufferWrite, work.WorkArea(), &param, &type, &dsize);
 
-	if (param.destOffset < size) {
-		memcpy(srcData, destData.get(), param.destOffset);
-		size = param.destOffset;
-	}
+	if (param.destOffset >= srcSize || param.destOffset > destSize)
+		return 0;
 
-	return size;
+	return param.destOffset;
 }
 
-void PkwareDecompress(byte *inBuff, int recvSize, int maxBytes)
+uint32_t PkwareCompress(byte *srcData, uint32_t size, PkwareWorkBuffer &work)
 {
-	TDataInfo info;
+	byte *destData = work.Output(size);
+	const uint32_t compressedSize = PkwareCompress(srcData, size, destData, size, work);
+	if (compressedSize == 0)
+		return size;
 
-	std::unique_ptr<char[]> ptr { new char[CMP_BUFFER_SIZE] };
-	std::unique_ptr<byte[]> outBuff { new byte[maxBytes] };
+	memcpy(srcData, destData, compressedSize);
+	return compressedSize;
+}
 
-	info.srcData = inBuff;
+uint32_t PkwareDecompress(const byte *src, uint32_t srcSize, byte *dest, uint32_t destSize, PkwareWorkBuffer &work)
+{
+	TDataInfo info;
+	info.srcData = src;
 	info.srcOffset = 0;
-	info.destData = outBuff.get();
+	info.destData = dest;
 	info.destOffset = 0;
-	info.size = recvSize;
+	info.size = srcSize;
+	info.destSize = destSize;
+
+	explode(PkwareBufferRead, PkwareBufferWrite, work.WorkArea(), &info);
+	return std::min(info.destOffset, destSize);
+}
 
-	explode(PkwareBufferRead, PkwareBufferWrite, ptr.get(), &info);
-	memcpy(inBuff, outBuff.get(), info.destOffset);
+void PkwareDecompress(byte *inBuff, int recvSize, int maxBytes, PkwareWorkBuffer &work)
+{
+	byte *outBuff = work.Output(maxBytes);
+	const uint32_t size = PkwareDecompress(inBuff, recvSize, outBuff, maxBytes, work);
+	memcpy(inBuff, outBuff, size);
 }
 
 } // namespace devilution
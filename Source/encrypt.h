@@ -5,24 +5,73 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 
 #include "utils/stdcompat/cstddef.hpp"
 
 namespace devilution {
 
 struct TDataInfo {
-	byte *srcData;
+	const byte *srcData;
 	uint32_t srcOffset;
 	byte *destData;
 	uint32_t destOffset;
 	uint32_t size;
+	uint32_t destSize;
+};
+
+/**
+ * @brief Scratch memory for the PKWARE routines.
+ *
+ * Reusing one for a series of calls saves allocating the work area every time.
+ * It must not be used by more than one thread at a time.
+ */
+class PkwareWorkBuffer {
+public:
+	/** Work area for implode and explode, allocated on first use. */
+	char *WorkArea();
+
+	/** Temporary output buffer of at least the given size. */
+	byte *Output(size_t size);
+
+private:
+	std::unique_ptr<char[]> workArea_;
+	std::unique_ptr<byte[]> output_;
+	size_t outputSize_ = 0;
 };
 
 void Decrypt(uint32_t *castBlock, uint32_t size, uint32_t key);
 void Encrypt(uint32_t *castBlock, uint32_t size, uint32_t key);
 uint32_t Hash(const char *s, int type);
-uint32_t PkwareCompress(byte *srcData, uint32_t size);
-void PkwareDecompress(byte *inBuff, int recvSize, int maxBytes);
+
+/**
+ * @brief Compresses data into a separate buffer
+ * @param src Data to compress
+ * @param srcSize Size of the data
+ * @param dest Receives the compressed data
+ * @param destSize Capacity of dest
+ * @param work Scratch memory
+ * @return Size of the compressed data, 0 if it isn't smaller than the input or doesn't fit in dest
+ */
+uint32_t PkwareCompress(const byte *src, uint32_t srcSize, byte *dest, uint32_t destSize, PkwareWorkBuffer &work);
+
+/**
+ * @brief Compresses data in place
+ * @return Size of the compressed data, or the original size if it couldn't be compressed
+ */
+uint32_t PkwareCompress(byte *srcData, uint32_t size, PkwareWorkBuffer &work);
+
+/**
+ * @brief Decompresses data into a separate buffer
+ * @return Size of the decompressed data, output beyond destSize is dropped
+ */
+uint32_t PkwareDecompress(const byte *src, uint32_t srcSize, byte *dest, uint32_t destSize, PkwareWorkBuffer &work);
+
+/**
+ * @brief Decompresses data in place, inBuff must be able to hold maxBytes
+ */
+void PkwareDecompress(byte *inBuff, int recvSize, int maxBytes, PkwareWorkBuffer &work);
 
 } // namespace devilution
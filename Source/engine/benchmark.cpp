@@ -0,0 +1,348 @@
+/**
+ * @file benchmark.cpp
+ *
+ * Implementation of the timing of demo playback for benchmarking.
+ */
+#include "engine/benchmark.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/resource.h>
+#define DVL_HAS_GETRUSAGE
+#endif
+
+#include <fmt/format.h>
+
+#include "utils/log.hpp"
+
+namespace devilution {
+
+namespace {
+
+constexpr const char *PhaseNames[] = {
+	"Frame",
+	"ProcessPlayers",
+	"ProcessMonsters",
+	"ProcessObjects",
+	"ProcessMissiles",
+	"ProcessItems",
+	"ProcessTowners",
+	"LightingAndVision",
+	"DrawAndBlit",
+};
+static_assert(sizeof(PhaseNames) / sizeof(PhaseNames[0]) == NumBenchmarkPhases, "every phase needs a name");
+
+/** Differences below this are noise of the clock rather than a regression */
+constexpr double MinRegressionMs = 0.01;
+
+/**
+ * @brief Reads the objects, numbers and strings of a JSON document into a map of numbers.
+ *
+ * Nested keys are joined with dots, for example "phases.Frame.p95_ms".
+ */
+class JsonFlattener {
+public:
+	JsonFlattener(string_view text, std::map<std::string, double> &values)
+	    : text_(text)
+	    , values_(values)
+	{
+	}
+
+	bool Parse()
+	{
+		if (!ParseValue(""))
+			return false;
+		SkipSpace();
+		return pos_ == text_.size();
+	}
+
+private:
+	void SkipSpace()
+	{
+		while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r'))
+			pos_++;
+	}
+
+	bool Consume(char c)
+	{
+		SkipSpace();
+		if (pos_ == text_.size() || text_[pos_] != c)
+			return false;
+		pos_++;
+		return true;
+	}
+
+	bool ParseString(std::string &out)
+	{
+		if (!Consume('"'))
+			return false;
+		out.clear();
+		while (pos_ < text_.size()) {
+			char c = text_[pos_++];
+			if (c == '"')
+				return true;
+			if (c == '\\') {
+				if (pos_ == text_.size())
+					return false;
+				c = text_[pos_++];
+			}
+			out += c;
+		}
+		return false;
+	}
+
+	bool ParseObject(const std::string &path)
+	{
+		if (!Consume('{'))
+			return false;
+		if (Consume('}'))
+			return true;
+		do {
+			std::string key;
+			if (!ParseString(key) || !Consume(':'))
+				return false;
+			if (!ParseValue(path.empty() ? key : path + "." + key))
+				return false;
+		} while (Consume(','));
+		return Consume('}');
+	}
+
+	bool ParseValue(const std::string &path)
+	{
+		SkipSpace();
+		if (pos_ == text_.size())
+			return false;
+		if (text_[pos_] == '{')
+			return ParseObject(path);
+		if (text_[pos_] == '"') {
+			std::string ignored;
+			return ParseString(ignored);
+		}
+
+		const size_t start = pos_;
+		while (pos_ < text_.size() && strchr("+-.0123456789eE", text_[pos_]) != nullptr)
+			pos_++;
+		if (pos_ == start)
+			return false;
+		const std::string number(text_.substr(start, pos_ - start));
+		char *end;
+		const double value = strtod(number.c_str(), &end);
+		if (*end != '\0')
+			return false;
+		values_[path] = value;
+		return true;
+	}
+
+	string_view text_;
+	size_t pos_ = 0;
+	std::map<std::string, double> &values_;
+};
+
+double NanosecondsToMs(uint64_t nanoseconds)
+{
+	return static_cast<double>(nanoseconds) / 1000000.0;
+}
+
+uint64_t GetPeakRssKb()
+{
+#ifdef DVL_HAS_GETRUSAGE
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#else
+	return 0;
+#endif
+}
+
+void CheckRegression(std::vector<std::string> &regressions, const char *name, const char *metric, double baseline, double current, double tolerance)
+{
+	if (current - baseline < MinRegressionMs || current <= baseline * (1 + tolerance))
+		return;
+	const double percent = baseline > 0 ? (current / baseline - 1) * 100 : 100;
+	regressions.push_back(fmt::format("{} {}: {:.3f} ms -> {:.3f} ms (+{:.0f}%)", name, metric, baseline, current, percent));
+}
+
+} // namespace
+
+const char *BenchmarkPhaseName(BenchmarkPhase phase)
+{
+	return PhaseNames[static_cast<size_t>(phase)];
+}
+
+PhaseTimings SummarizeSamples(std::vector<uint64_t> &samples)
+{
+	PhaseTimings timings {};
+	if (samples.empty())
+		return timings;
+
+	std::sort(samples.begin(), samples.end());
+	uint64_t total = 0;
+	for (uint64_t sample : samples)
+		total += sample;
+
+	// Nearest rank, so a percentile is always one of the measured durations
+	auto percentile = [&samples](size_t p) {
+		const size_t rank = (samples.size() * p + 99) / 100;
+		return NanosecondsToMs(samples[std::max<size_t>(rank, 1) - 1]);
+	};
+
+	timings.samples = static_cast<uint32_t>(samples.size());
+	timings.meanMs = NanosecondsToMs(total) / samples.size();
+	timings.p50Ms = percentile(50);
+	timings.p95Ms = percentile(95);
+	timings.p99Ms = percentile(99);
+	return timings;
+}
+
+std::string FormatBenchmarkJson(const BenchmarkReport &report)
+{
+	std::string json = fmt::format("{{\n  \"demo\": {},\n  \"frames\": {},\n  \"seconds\": {:.3f},\n  \"peak_rss_kb\": {},\n  \"phases\": {{",
+	    report.demo, report.frames, report.seconds, report.peakRssKb);
+	for (size_t i = 0; i < NumBenchmarkPhases; i++) {
+		const PhaseTimings &timings = report.phases[i];
+		json += fmt::format("{}\n    \"{}\": {{ \"samples\": {}, \"mean_ms\": {:.4f}, \"p50_ms\": {:.4f}, \"p95_ms\": {:.4f}, \"p99_ms\": {:.4f} }}",
+		    i == 0 ? "" : ",", PhaseNames[i], timings.samples, timings.meanMs, timings.p50Ms, timings.p95Ms, timings.p99Ms);
+	}
+	json += "\n  }\n}\n";
+	return json;
+}
+
+bool ParseBenchmarkJson(string_view json, BenchmarkReport &report)
+{
+	std::map<std::string, double> values;
+	if (!JsonFlattener(json, values).Parse())
+		return false;
+
+	auto get = [&values](const std::string &key, double &value) {
+		auto it = values.find(key);
+		if (it == values.end())
+			return false;
+		value = it->second;
+		return true;
+	};
+
+	double demo;
+	double frames;
+	double peakRssKb;
+	if (!get("demo", demo) || !get("frames", frames) || !get("seconds", report.seconds) || !get("peak_rss_kb", peakRssKb))
+		return false;
+	report.demo = static_cast<int>(demo);
+	report.frames = static_cast<uint32_t>(frames);
+	report.peakRssKb = static_cast<uint64_t>(peakRssKb);
+
+	for (size_t i = 0; i < NumBenchmarkPhases; i++) {
+		const std::string prefix = std::string("phases.") + PhaseNames[i] + ".";
+		PhaseTimings &timings = report.phases[i];
+		double samples;
+		if (!get(prefix + "samples", samples) || !get(prefix + "mean_ms", timings.meanMs) || !get(prefix + "p50_ms", timings.p50Ms)
+		    || !get(prefix + "p95_ms", timings.p95Ms) || !get(prefix + "p99_ms", timings.p99Ms))
+			return false;
+		timings.samples = static_cast<uint32_t>(samples);
+	}
+	return true;
+}
+
+std::vector<std::string> FindBenchmarkRegressions(const BenchmarkReport &baseline, const BenchmarkReport &current, double tolerance)
+{
+	std::vector<std::string> regressions;
+	for (size_t i = 0; i < NumBenchmarkPhases; i++) {
+		const PhaseTimings &before = baseline.phases[i];
+		const PhaseTimings &after = current.phases[i];
+		if (before.samples == 0 || after.samples == 0)
+			continue;
+		CheckRegression(regressions, PhaseNames[i], "p50", before.p50Ms, after.p50Ms, tolerance);
+		CheckRegression(regressions, PhaseNames[i], "p95", before.p95Ms, after.p95Ms, tolerance);
+	}
+	if (baseline.peakRssKb != 0 && current.peakRssKb > baseline.peakRssKb * (1 + tolerance))
+		regressions.push_back(fmt::format("peak RSS: {} KiB -> {} KiB", baseline.peakRssKb, current.peakRssKb));
+	return regressions;
+}
+
+namespace benchmark {
+
+bool gbEnabled;
+
+namespace {
+
+std::string OutputPath;
+std::string BaselinePath;
+double Tolerance;
+std::array<std::vector<uint64_t>, NumBenchmarkPhases> Samples;
+int ExitCode = 0;
+
+} // namespace
+
+void Init(std::string outputPath, std::string baselinePath, double tolerance)
+{
+	OutputPath = std::move(outputPath);
+	BaselinePath = std::move(baselinePath);
+	Tolerance = tolerance;
+	for (auto &samples : Samples)
+		samples.reserve(1 << 16);
+	gbEnabled = true;
+}
+
+void AddSample(BenchmarkPhase phase, uint64_t nanoseconds)
+{
+	Samples[static_cast<size_t>(phase)].push_back(nanoseconds);
+}
+
+void Finish(int demoNumber, uint32_t frames, double seconds)
+{
+	BenchmarkReport report {};
+	report.demo = demoNumber;
+	report.frames = frames;
+	report.seconds = seconds;
+	report.peakRssKb = GetPeakRssKb();
+	for (size_t i = 0; i < NumBenchmarkPhases; i++) {
+		report.phases[i] = SummarizeSamples(Samples[i]);
+		Samples[i].clear();
+	}
+	gbEnabled = false;
+
+	std::ofstream output(OutputPath, std::ios::trunc);
+	output << FormatBenchmarkJson(report);
+	if (!output) {
+		LogError("Unable to write benchmark results to {}", OutputPath);
+		ExitCode = 1;
+	}
+
+	if (BaselinePath.empty())
+		return;
+
+	std::ifstream baselineFile(BaselinePath);
+	std::stringstream baselineText;
+	baselineText << baselineFile.rdbuf();
+	BenchmarkReport baseline;
+	if (!baselineFile.is_open() || !ParseBenchmarkJson(baselineText.str(), baseline)) {
+		LogError("Unable to read benchmark baseline {}", BaselinePath);
+		ExitCode = 1;
+		return;
+	}
+
+	const std::vector<std::string> regressions = FindBenchmarkRegressions(baseline, report, Tolerance);
+	for (const std::string &regression : regressions)
+		LogError("Benchmark regression: {}", regression);
+	if (!regressions.empty())
+		ExitCode = 1;
+}
+
+int ExitStatus()
+{
+	return ExitCode;
+}
+
+} // namespace benchmark
+
+} // namespace devilution
@@ -0,0 +1,155 @@
+/**
+ * @file benchmark.hpp
+ *
+ * Interface of the timing of demo playback for benchmarking.
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils/stdcompat/string_view.hpp"
+
+namespace devilution {
+
+enum class BenchmarkPhase : uint8_t {
+	/** A pass through the main loop that ran game logic or drew the screen */
+	Frame,
+	ProcessPlayers,
+	ProcessMonsters,
+	ProcessObjects,
+	ProcessMissiles,
+	ProcessItems,
+	ProcessTowners,
+	LightingAndVision,
+	DrawAndBlit,
+
+	LAST = DrawAndBlit,
+};
+
+constexpr size_t NumBenchmarkPhases = static_cast<size_t>(BenchmarkPhase::LAST) + 1;
+
+struct PhaseTimings {
+	uint32_t samples;
+	double meanMs;
+	double p50Ms;
+	double p95Ms;
+	double p99Ms;
+};
+
+struct BenchmarkReport {
+	int demo;
+	uint32_t frames;
+	double seconds;
+	/** Peak resident set size in KiB, 0 where the platform doesn't report it */
+	uint64_t peakRssKb;
+	std::array<PhaseTimings, NumBenchmarkPhases> phases;
+};
+
+const char *BenchmarkPhaseName(BenchmarkPhase phase);
+
+/**
+ * @brief Computes the distribution of the given durations
+ * @param samples Durations in nanoseconds, reordered by the call
+ */
+PhaseTimings SummarizeSamples(std::vector<uint64_t> &samples);
+
+std::string FormatBenchmarkJson(const BenchmarkReport &report);
+
+/** @return false if the text isn't a benchmark report */
+bool ParseBenchmarkJson(string_view json, BenchmarkReport &report);
+
+/**
+ * @brief Lists the timings and memory use that got worse than the baseline by more than the tolerance
+ * @param tolerance Allowed slowdown as a fraction, 0.1 allows 10%
+ */
+std::vector<std::string> FindBenchmarkRegressions(const BenchmarkReport &baseline, const BenchmarkReport &current, double tolerance);
+
+namespace benchmark {
+
+extern bool gbEnabled;
+
+/**
+ * @brief Turns on timing of the demo that is played
+ * @param outputPath Where the report is written
+ * @param baselinePath Report to compare the results to, or empty
+ * @param tolerance Allowed slowdown compared to the baseline, as a fraction
+ */
+void Init(std::string outputPath, std::string baselinePath, double tolerance);
+
+inline bool IsEnabled()
+{
+	return gbEnabled;
+}
+
+void AddSample(BenchmarkPhase phase, uint64_t nanoseconds);
+
+/** @brief Writes the report of the demo that was played and compares it to the baseline */
+void Finish(int demoNumber, uint32_t frames, double seconds);
+
+/** @return Exit status of the process, 1 if the benchmark found a regression */
+int ExitStatus();
+
+} // namespace benchmark
+
+/**
+ * @brief Measures phases of a frame while benchmarking, does nothing otherwise.
+ */
+class BenchmarkTimer {
+public:
+	BenchmarkTimer() = default;
+
+	explicit BenchmarkTimer(BenchmarkPhase phase)
+	{
+		Start(phase);
+	}
+
+	~BenchmarkTimer()
+	{
+		Stop();
+	}
+
+	BenchmarkTimer(const BenchmarkTimer &) = delete;
+	BenchmarkTimer &operator=(const BenchmarkTimer &) = delete;
+
+	/** @brief Ends the phase that is being measured and starts the given one */
+	void Start(BenchmarkPhase phase)
+	{
+		if (!benchmark::IsEnabled())
+			return;
+		const auto now = std::chrono::steady_clock::now();
+		Record(now);
+		phase_ = phase;
+		start_ = now;
+		running_ = true;
+	}
+
+	void Stop()
+	{
+		if (running_)
+			Record(std::chrono::steady_clock::now());
+		running_ = false;
+	}
+
+	/** @brief Drops the current phase, for frames that turned out to do no work */
+	void Cancel()
+	{
+		running_ = false;
+	}
+
+private:
+	void Record(std::chrono::steady_clock::time_point now)
+	{
+		if (running_)
+			benchmark::AddSample(phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count());
+	}
+
+	BenchmarkPhase phase_ = BenchmarkPhase::Frame;
+	std::chrono::steady_clock::time_point start_;
+	bool running_ = false;
+};
+
+} // namespace devilution
@@ -0,0 +1,367 @@
+/**
+ * @file demofile.cpp
+ *
+ * Implementation of the binary file format of recorded demos.
+ */
+#include "engine/demofile.hpp"
+
+#include <cstring>
+
+#include "utils/endian.hpp"
+
+namespace devilution {
+
+namespace {
+
+constexpr char DemoMagic[4] = { 'D', 'V', 'D', 'M' };
+constexpr size_t DemoFileHeaderSize = sizeof(DemoMagic) + 1 + 3 * sizeof(uint32_t);
+
+/** Size at which a block is ended, the last event may go slightly past it */
+constexpr size_t MaxDemoBlockSize = 32768;
+/** Largest encoded event: tag, progress and three 32 bit varints */
+constexpr size_t MaxEncodedEventSize = 1 + 4 + 3 * 5;
+
+enum BlockFlags : uint8_t {
+	BlockKeyframe = 1 << 0,
+	BlockCompressed = 1 << 1,
+};
+
+/** flags, tick, state hash, raw size, stored size */
+constexpr size_t BlockHeaderSize = 1 + 4 * sizeof(uint32_t);
+
+/** Set in the tag of an event whose progress differs from the previous event */
+constexpr uint8_t TagProgress = 1 << 2;
+/** Set in the tag of a message whose id differs from the previous message */
+constexpr uint8_t TagMessage = 1 << 3;
+constexpr uint8_t TagTypeMask = 0x03;
+
+void WriteLE32(byte *out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		out[i] = static_cast<byte>(value >> (8 * i));
+}
+
+void AppendLE32(std::vector<byte> &out, uint32_t value)
+{
+	byte buf[4];
+	WriteLE32(buf, value);
+	out.insert(out.end(), buf, buf + sizeof(buf));
+}
+
+void AppendVarint(std::vector<byte> &out, uint32_t value)
+{
+	do {
+		uint8_t bits = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			bits |= 0x80;
+		out.push_back(static_cast<byte>(bits));
+	} while (value != 0);
+}
+
+bool ReadVarint(const std::vector<byte> &data, size_t &offset, uint32_t &value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35 && offset < data.size(); shift += 7) {
+		const auto bits = static_cast<uint8_t>(data[offset++]);
+		value |= static_cast<uint32_t>(bits & 0x7F) << shift;
+		if ((bits & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+uint32_t ZigZag(int32_t value)
+{
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t UnZigZag(uint32_t value)
+{
+	return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+uint32_t FloatBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+} // namespace
+
+DemoWriter::~DemoWriter()
+{
+	Close();
+}
+
+bool DemoWriter::Open(const std::string &path, const DemoHeader &header)
+{
+	file_.open(path, std::ios::binary | std::ios::trunc);
+	if (!file_.is_open())
+		return false;
+
+	byte buf[DemoFileHeaderSize];
+	memcpy(buf, DemoMagic, sizeof(DemoMagic));
+	buf[4] = static_cast<byte>(DemoFormatVersion);
+	WriteLE32(&buf[5], header.saveNumber);
+	WriteLE32(&buf[9], header.width);
+	WriteLE32(&buf[13], header.height);
+	file_.write(reinterpret_cast<const char *>(buf), sizeof(buf));
+
+	block_.clear();
+	block_.reserve(MaxDemoBlockSize + MaxEncodedEventSize);
+	keyframe_ = false;
+	last_ = {};
+	return true;
+}
+
+void DemoWriter::Close()
+{
+	if (!file_.is_open())
+		return;
+	FlushBlock();
+	file_.close();
+}
+
+void DemoWriter::WriteKeyframe(uint32_t tick, uint32_t stateHash)
+{
+	FlushBlock();
+	keyframe_ = true;
+	nextKeyframe_ = { tick, stateHash };
+}
+
+void DemoWriter::WriteEvent(const DemoEvent &event)
+{
+	uint8_t tag = static_cast<uint8_t>(event.type) & TagTypeMask;
+	const uint32_t progress = FloatBits(event.progressToNextGameTick);
+	if (progress != FloatBits(last_.progressToNextGameTick))
+		tag |= TagProgress;
+	if (event.type == DemoMsgType::Message && event.message != last_.message)
+		tag |= TagMessage;
+
+	block_.push_back(static_cast<byte>(tag));
+	if ((tag & TagProgress) != 0)
+		AppendLE32(block_, progress);
+	last_.progressToNextGameTick = event.progressToNextGameTick;
+
+	if (event.type == DemoMsgType::Message) {
+		if ((tag & TagMessage) != 0)
+			AppendVarint(block_, event.message);
+		AppendVarint(block_, ZigZag(event.wParam));
+		// Mouse messages pack the cursor position in lParam, it rarely moves far between two of them
+		AppendVarint(block_, ZigZag(static_cast<int32_t>(static_cast<uint32_t>(event.lParam) - static_cast<uint32_t>(last_.lParam))));
+		last_.message = event.message;
+		last_.lParam = event.lParam;
+	}
+
+	if (block_.size() >= MaxDemoBlockSize)
+		FlushBlock();
+}
+
+void DemoWriter::FlushBlock()
+{
+	if (block_.empty())
+		return;
+
+	const auto rawSize = static_cast<uint32_t>(block_.size());
+	compressed_.resize(rawSize);
+	const uint32_t compressedSize = PkwareCompress(block_.data(), rawSize, compressed_.data(), rawSize, work_);
+
+	uint8_t flags = keyframe_ ? BlockKeyframe : 0;
+	if (compressedSize != 0)
+		flags |= BlockCompressed;
+	const uint32_t storedSize = compressedSize != 0 ? compressedSize : rawSize;
+
+	byte header[BlockHeaderSize];
+	header[0] = static_cast<byte>(flags);
+	WriteLE32(&header[1], keyframe_ ? nextKeyframe_.tick : 0);
+	WriteLE32(&header[5], keyframe_ ? nextKeyframe_.stateHash : 0);
+	WriteLE32(&header[9], rawSize);
+	WriteLE32(&header[13], storedSize);
+	file_.write(reinterpret_cast<const char *>(header), sizeof(header));
+	file_.write(reinterpret_cast<const char *>(compressedSize != 0 ? compressed_.data() : block_.data()), storedSize);
+
+	block_.clear();
+	keyframe_ = false;
+	last_ = {};
+}
+
+bool DemoReader::Open(const std::string &path, DemoHeader &header)
+{
+	file_.open(path, std::ios::binary);
+	if (!file_.is_open())
+		return false;
+
+	byte buf[DemoFileHeaderSize];
+	if (!file_.read(reinterpret_cast<char *>(buf), sizeof(buf))
+	    || memcmp(buf, DemoMagic, sizeof(DemoMagic)) != 0
+	    || static_cast<uint8_t>(buf[4]) != DemoFormatVersion) {
+		Close();
+		return false;
+	}
+	header.saveNumber = LoadLE32(&buf[5]);
+	header.width = LoadLE32(&buf[9]);
+	header.height = LoadLE32(&buf[13]);
+
+	firstBlock_ = file_.tellg();
+	block_.clear();
+	offset_ = 0;
+	hasEvent_ = false;
+	keyframePending_ = false;
+	return true;
+}
+
+void DemoReader::Close()
+{
+	file_.close();
+	block_.clear();
+	block_.shrink_to_fit();
+	compressed_.clear();
+	compressed_.shrink_to_fit();
+	offset_ = 0;
+	hasEvent_ = false;
+	keyframePending_ = false;
+}
+
+bool DemoReader::Peek(DemoEvent &event)
+{
+	if (!hasEvent_) {
+		while (offset_ >= block_.size()) {
+			if (!ReadBlock())
+				return false;
+		}
+		if (!DecodeEvent()) {
+			block_.clear();
+			offset_ = 0;
+			return false;
+		}
+		hasEvent_ = true;
+	}
+	event = next_;
+	return true;
+}
+
+void DemoReader::Pop()
+{
+	hasEvent_ = false;
+}
+
+bool DemoReader::TakeKeyframe(DemoKeyframe &keyframe)
+{
+	if (!keyframePending_)
+		return false;
+	keyframePending_ = false;
+	keyframe = keyframe_;
+	return true;
+}
+
+bool DemoReader::SeekToKeyframe(uint32_t tick)
+{
+	if (!file_.is_open())
+		return false;
+
+	const std::streampos current = file_.tellg();
+	std::streampos found = -1;
+	DemoKeyframe foundKeyframe {};
+
+	file_.clear();
+	file_.seekg(firstBlock_);
+	byte header[BlockHeaderSize];
+	while (file_.read(reinterpret_cast<char *>(header), sizeof(header))) {
+		const auto flags = static_cast<uint8_t>(header[0]);
+		const uint32_t blockTick = LoadLE32(&header[1]);
+		if ((flags & BlockKeyframe) != 0) {
+			if (blockTick > tick)
+				break;
+			found = file_.tellg() - static_cast<std::streamoff>(sizeof(header));
+			foundKeyframe = { blockTick, LoadLE32(&header[5]) };
+		}
+		file_.seekg(LoadLE32(&header[13]), std::ios::cur);
+	}
+
+	file_.clear();
+	if (found == std::streampos(-1)) {
+		file_.seekg(current);
+		return false;
+	}
+
+	file_.seekg(found);
+	block_.clear();
+	offset_ = 0;
+	hasEvent_ = false;
+	keyframePending_ = false;
+	return true;
+}
+
+bool DemoReader::ReadBlock()
+{
+	byte header[BlockHeaderSize];
+	if (!file_.read(reinterpret_cast<char *>(header), sizeof(header)))
+		return false;
+
+	const auto flags = static_cast<uint8_t>(header[0]);
+	const uint32_t rawSize = LoadLE32(&header[9]);
+	const uint32_t storedSize = LoadLE32(&header[13]);
+	if (rawSize == 0 || rawSize > MaxDemoBlockSize + MaxEncodedEventSize || storedSize > rawSize)
+		return false;
+
+	block_.resize(rawSize);
+	if ((flags & BlockCompressed) != 0) {
+		compressed_.resize(storedSize);
+		if (!file_.read(reinterpret_cast<char *>(compressed_.data()), storedSize))
+			return false;
+		if (PkwareDecompress(compressed_.data(), storedSize, block_.data(), rawSize, work_) != rawSize)
+			return false;
+	} else {
+		if (storedSize != rawSize || !file_.read(reinterpret_cast<char *>(block_.data()), rawSize))
+			return false;
+	}
+
+	offset_ = 0;
+	last_ = {};
+	keyframePending_ = (flags & BlockKeyframe) != 0;
+	if (keyframePending_)
+		keyframe_ = { LoadLE32(&header[1]), LoadLE32(&header[5]) };
+	return true;
+}
+
+bool DemoReader::DecodeEvent()
+{
+	const auto tag = static_cast<uint8_t>(block_[offset_++]);
+	const auto type = static_cast<DemoMsgType>(tag & TagTypeMask);
+	if (type != DemoMsgType::GameTick && type != DemoMsgType::Rendering && type != DemoMsgType::Message)
+		return false;
+
+	if ((tag & TagProgress) != 0) {
+		if (block_.size() - offset_ < 4)
+			return false;
+		const uint32_t bits = LoadLE32(&block_[offset_]);
+		offset_ += 4;
+		memcpy(&last_.progressToNextGameTick, &bits, sizeof(bits));
+	}
+
+	next_ = {};
+	next_.type = type;
+	next_.progressToNextGameTick = last_.progressToNextGameTick;
+	if (type != DemoMsgType::Message)
+		return true;
+
+	uint32_t value;
+	if ((tag & TagMessage) != 0) {
+		if (!ReadVarint(block_, offset_, value))
+			return false;
+		last_.message = value;
+	}
+	if (!ReadVarint(block_, offset_, value))
+		return false;
+	next_.wParam = UnZigZag(value);
+	if (!ReadVarint(block_, offset_, value))
+		return false;
+	last_.lParam = static_cast<int32_t>(static_cast<uint32_t>(last_.lParam) + static_cast<uint32_t>(UnZigZag(value)));
+	next_.message = last_.message;
+	next_.lParam = last_.lParam;
+	return true;
+}
+
+} // namespace devilution
@@ -0,0 +1,127 @@
+/**
+ * @file demofile.hpp
+ *
+ * Interface of the binary file format of recorded demos.
+ *
+ * A demo starts with a header followed by blocks of events. Each block is compressed on its own
+ * and encodes its events relative to each other, so blocks can be skipped and read without the
+ * ones before them. Blocks that start a keyframe carry the game tick they begin at and a hash of
+ * the game state at that point, which playback uses to detect that it diverged from the recording.
+ */
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "encrypt.h"
+#include "utils/stdcompat/cstddef.hpp"
+
+namespace devilution {
+
+/** Version written to new demos, version 0 was the old text format */
+constexpr uint8_t DemoFormatVersion = 1;
+
+/** Number of game ticks between keyframes */
+constexpr uint32_t DemoKeyframeInterval = 600;
+
+enum class DemoMsgType : uint8_t {
+	GameTick = 0,
+	Rendering = 1,
+	Message = 2,
+};
+
+struct DemoEvent {
+	DemoMsgType type;
+	uint32_t message;
+	int32_t wParam;
+	int32_t lParam;
+	float progressToNextGameTick;
+};
+
+struct DemoHeader {
+	uint32_t saveNumber;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct DemoKeyframe {
+	uint32_t tick;
+	uint32_t stateHash;
+};
+
+class DemoWriter {
+public:
+	~DemoWriter();
+
+	/** @return false if the file could not be created */
+	bool Open(const std::string &path, const DemoHeader &header);
+	void Close();
+
+	[[nodiscard]] bool IsOpen() const
+	{
+		return file_.is_open();
+	}
+
+	/** @brief Ends the current block and starts the next one at the given state of the game */
+	void WriteKeyframe(uint32_t tick, uint32_t stateHash);
+	void WriteEvent(const DemoEvent &event);
+
+private:
+	void FlushBlock();
+
+	std::ofstream file_;
+	std::vector<byte> block_;
+	std::vector<byte> compressed_;
+	PkwareWorkBuffer work_;
+	bool keyframe_ = false;
+	DemoKeyframe nextKeyframe_ {};
+	DemoEvent last_ {};
+};
+
+/**
+ * @brief Reads a demo one block at a time, so only a small part of it is held in memory.
+ */
+class DemoReader {
+public:
+	/** @return false if the file is missing or isn't a demo in the current format */
+	bool Open(const std::string &path, DemoHeader &header);
+	void Close();
+
+	/**
+	 * @brief Looks at the next event without consuming it
+	 * @return false at the end of the demo or if it is damaged
+	 */
+	bool Peek(DemoEvent &event);
+	void Pop();
+
+	/**
+	 * @brief Takes the keyframe of the block the next event is in, if there is one that wasn't taken yet
+	 */
+	bool TakeKeyframe(DemoKeyframe &keyframe);
+
+	/**
+	 * @brief Moves to the last keyframe at or before the given tick without decoding the blocks in between
+	 * @return false if the demo has no such keyframe, the position is then unchanged
+	 */
+	bool SeekToKeyframe(uint32_t tick);
+
+private:
+	bool ReadBlock();
+	bool DecodeEvent();
+
+	std::ifstream file_;
+	std::streampos firstBlock_;
+	std::vector<byte> block_;
+	std::vector<byte> compressed_;
+	PkwareWorkBuffer work_;
+	size_t offset_ = 0;
+	bool hasEvent_ = false;
+	bool keyframePending_ = false;
+	DemoKeyframe keyframe_ {};
+	DemoEvent next_ {};
+	DemoEvent last_ {};
+};
+
+} // namespace devilution
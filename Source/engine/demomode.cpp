@@ -4,121 +4,89 @@
  * Contains most of the the demomode specific logic
  */
 
-#include <deque>
-#include <fstream>
-#include <sstream>
-#include <iostream>
-
 #include "demomode.h"
+#include "engine/benchmark.hpp"
+#include "engine/demofile.hpp"
+#include "engine/random.hpp"
 #include "utils/display.h"
+#include "utils/log.hpp"
 #include "utils/paths.h"
 #include "menu.h"
+#include "monster.h"
 #include "options.h"
 #include "nthread.h"
 #include "pfile.h"
+#include "player.h"
 
 namespace devilution {
 
 namespace {
 
-enum class DemoMsgType {
-	GameTick = 0,
-	Rendering = 1,
-	Message = 2,
-};
-
-struct demoMsg {
-	DemoMsgType type;
-	uint32_t message;
-	int32_t wParam;
-	int32_t lParam;
-	float progressToNextGameTick;
-};
-
 int DemoNumber = -1;
 bool Timedemo = false;
 int RecordNumber = -1;
 
-std::ofstream DemoRecording;
-std::deque<demoMsg> Demo_Message_Queue;
+DemoWriter DemoRecording;
+DemoReader DemoPlayback;
 uint32_t DemoModeLastTick = 0;
 
 int LogicTick = 0;
 int StartTime = 0;
+bool Desynced = false;
 
 int DemoGraphicsWidth = 640;
 int DemoGraphicsHeight = 480;
 
-void PumpDemoMessage(DemoMsgType demoMsgType, uint32_t message, int32_t wParam, int32_t lParam, float progressToNextGameTick)
+std::string DemoPath(int i)
 {
-	demoMsg msg;
-	msg.type = demoMsgType;
-	msg.message = message;
-	msg.wParam = wParam;
-	msg.lParam = lParam;
-	msg.progressToNextGameTick = progressToNextGameTick;
-
-	Demo_Message_Queue.push_back(msg);
+	char demoFilename[16];
+	snprintf(demoFilename, 15, "demo_%d.dmo", i);
+	return paths::PrefPath() + demoFilename;
 }
 
-bool LoadDemoMessages(int i)
+/** @brief Hash of the state a replay has to reproduce, compared at each keyframe */
+uint32_t HashGameState()
 {
-	std::ifstream demofile;
-	char demoFilename[16];
-	snprintf(demoFilename, 15, "demo_%d.dmo", i);
-	demofile.open(paths::PrefPath() + demoFilename);
-	if (!demofile.is_open()) {
-		return false;
+	uint32_t hash = 2166136261U;
+	auto add = [&hash](uint32_t value) {
+		for (int i = 0; i < 4; i++) {
+			hash ^= (value >> (8 * i)) & 0xFF;
+			hash *= 16777619U;
+		}
+	};
+	add(GetLCGEngineState());
+	add(currlevel);
+	add(ActiveMonsterCount);
+	if (MyPlayer != nullptr) {
+		add(MyPlayer->position.tile.x);
+		add(MyPlayer->position.tile.y);
+		add(MyPlayer->_pHitPoints);
+		add(MyPlayer->_pGold);
 	}
+	return hash;
+}
 
-	std::string line;
-	std::getline(demofile, line);
-	std::stringstream header(line);
-
-	std::string number;
-	std::getline(header, number, ','); // Demo version
-	if (std::stoi(number) != 0) {
-		return false;
+void CheckKeyframe()
+{
+	DemoKeyframe keyframe;
+	if (!DemoPlayback.TakeKeyframe(keyframe) || Desynced)
+		return;
+	if (keyframe.tick != static_cast<uint32_t>(LogicTick) || keyframe.stateHash != HashGameState()) {
+		LogWarn("Demo playback diverged from the recording at tick {}", LogicTick);
+		Desynced = true;
 	}
+}
 
-	std::getline(header, number, ',');
-	gSaveNumber = std::stoi(number);
-
-	std::getline(header, number, ',');
-	DemoGraphicsWidth = std::stoi(number);
-
-	std::getline(header, number, ',');
-	DemoGraphicsHeight = std::stoi(number);
-
-	while (std::getline(demofile, line)) {
-		std::stringstream command(line);
-
-		std::getline(command, number, ',');
-		int typeNum = std::stoi(number);
-		auto type = static_cast<DemoMsgType>(typeNum);
-
-		std::getline(command, number, ',');
-		float progressToNextGameTick = std::stof(number);
-
-		switch (type) {
-		case DemoMsgType::Message: {
-			std::getline(command, number, ',');
-			uint32_t message = std::stoi(number);
-			std::getline(command, number, ',');
-			int32_t wParam = std::stoi(number);
-			std::getline(command, number, ',');
-			int32_t lParam = std::stoi(number);
-			PumpDemoMessage(type, message, wParam, lParam, progressToNextGameTick);
-			break;
-		}
-		default:
-			PumpDemoMessage(type, 0, 0, 0, progressToNextGameTick);
-			break;
-		}
+bool LoadDemoHeader(int i)
+{
+	DemoHeader header;
+	if (!DemoPlayback.Open(DemoPath(i), header)) {
+		return false;
 	}
 
-	demofile.close();
-
+	gSaveNumber = header.saveNumber;
+	DemoGraphicsWidth = header.width;
+	DemoGraphicsHeight = header.height;
 	DemoModeLastTick = SDL_GetTicks();
 
 	return true;
@@ -133,7 +101,7 @@ void InitPlayBack(int demoNumber, bool timedemo)
 	DemoNumber = demoNumber;
 	Timedemo = timedemo;
 
-	if (!LoadDemoMessages(demoNumber)) {
+	if (!LoadDemoHeader(demoNumber)) {
 		SDL_Log("Unable to load demo file");
 		diablo_quit(1);
 	}
@@ -168,9 +136,9 @@ bool IsRecording()
 
 bool GetRunGameLoop(bool &drawGame, bool &processInput)
 {
-	if (Demo_Message_Queue.empty())
+	DemoEvent dmsg;
+	if (!DemoPlayback.Peek(dmsg))
 		app_fatal("Demo queue empty");
-	demoMsg dmsg = Demo_Message_Queue.front();
 	if (dmsg.type == DemoMsgType::Message)
 		app_fatal("Unexpected Message");
 	if (Timedemo) {
@@ -197,7 +165,9 @@ bool GetRunGameLoop(bool &drawGame, bool &processInput)
 		}
 	}
 	gfProgressToNextGameTick = dmsg.progressToNextGameTick;
-	Demo_Message_Queue.pop_front();
+	if (dmsg.type == DemoMsgType::GameTick)
+		CheckKeyframe();
+	DemoPlayback.Pop();
 	if (dmsg.type == DemoMsgType::GameTick)
 		LogicTick++;
 	return dmsg.type == DemoMsgType::GameTick;
@@ -214,7 +184,7 @@ bool FetchMessage(tagMSG *lpMsg)
 			return true;
 		}
 		if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE) {
-			Demo_Message_Queue.clear();
+			DemoPlayback.Close();
 			ClearMessageQueue();
 			DemoNumber = -1;
 			Timedemo = false;
@@ -232,16 +202,14 @@ bool FetchMessage(tagMSG *lpMsg)
 		}
 	}
 
-	if (!Demo_Message_Queue.empty()) {
-		demoMsg dmsg = Demo_Message_Queue.front();
-		if (dmsg.type == DemoMsgType::Message) {
-			lpMsg->message = dmsg.message;
-			lpMsg->lParam = dmsg.lParam;
-			lpMsg->wParam = dmsg.wParam;
-			gfProgressToNextGameTick = dmsg.progressToNextGameTick;
-			Demo_Message_Queue.pop_front();
-			return true;
-		}
+	DemoEvent dmsg;
+	if (DemoPlayback.Peek(dmsg) && dmsg.type == DemoMsgType::Message) {
+		lpMsg->message = dmsg.message;
+		lpMsg->lParam = dmsg.lParam;
+		lpMsg->wParam = dmsg.wParam;
+		gfProgressToNextGameTick = dmsg.progressToNextGameTick;
+		DemoPlayback.Pop();
+		return true;
 	}
 
 	lpMsg->message = 0;
@@ -253,35 +221,43 @@ bool FetchMessage(tagMSG *lpMsg)
 
 void RecordGameLoopResult(bool runGameLoop)
 {
-	DemoRecording << static_cast<uint32_t>(runGameLoop ? DemoMsgType::GameTick : DemoMsgType::Rendering) << "," << gfProgressToNextGameTick << "\n";
+	if (!DemoRecording.IsOpen())
+		return;
+	if (runGameLoop) {
+		if (LogicTick % DemoKeyframeInterval == 0)
+			DemoRecording.WriteKeyframe(LogicTick, HashGameState());
+		LogicTick++;
+	}
+	DemoRecording.WriteEvent({ runGameLoop ? DemoMsgType::GameTick : DemoMsgType::Rendering, 0, 0, 0, gfProgressToNextGameTick });
 }
 
 void RecordMessage(tagMSG *lpMsg)
 {
-	if (!gbRunGame || !DemoRecording.is_open())
+	if (!gbRunGame || !DemoRecording.IsOpen())
 		return;
-	DemoRecording << static_cast<uint32_t>(DemoMsgType::Message) << "," << gfProgressToNextGameTick << "," << lpMsg->message << "," << lpMsg->wParam << "," << lpMsg->lParam << "\n";
+	DemoRecording.WriteEvent({ DemoMsgType::Message, lpMsg->message, lpMsg->wParam, lpMsg->lParam, gfProgressToNextGameTick });
 }
 
 void NotifyGameLoopStart()
 {
 	if (IsRecording()) {
-		char demoFilename[16];
-		snprintf(demoFilename, 15, "demo_%d.dmo", RecordNumber);
-		DemoRecording.open(paths::PrefPath() + demoFilename, std::fstream::trunc);
-		DemoRecording << "0," << gSaveNumber << "," << gnScreenWidth << "," << gnScreenHeight << "\n";
+		const DemoHeader header { gSaveNumber, static_cast<uint32_t>(gnScreenWidth), static_cast<uint32_t>(gnScreenHeight) };
+		if (!DemoRecording.Open(DemoPath(RecordNumber), header))
+			LogError("Unable to create demo file");
+		LogicTick = 0;
 	}
 
 	if (IsRunning()) {
 		StartTime = SDL_GetTicks();
 		LogicTick = 0;
+		Desynced = false;
 	}
 }
 
 void NotifyGameLoopEnd()
 {
 	if (IsRecording()) {
-		DemoRecording.close();
+		DemoRecording.Close();
 
 		RecordNumber = -1;
 	}
@@ -289,6 +265,9 @@ void NotifyGameLoopEnd()
 	if (IsRunning()) {
 		float secounds = (SDL_GetTicks() - StartTime) / 1000.0;
 		SDL_Log("%d frames, %.2f seconds: %.1f fps", LogicTick, secounds, LogicTick / secounds);
+		if (benchmark::IsEnabled())
+			benchmark::Finish(DemoNumber, LogicTick, secounds);
+		DemoPlayback.Close();
 		gbRunGameResult = false;
 		gbRunGame = false;
 	}
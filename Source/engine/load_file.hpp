@@ -9,6 +9,7 @@
 #include "diablo.h"
 #include "storm/storm.h"
 #include "storm/storm_sdl_rw.h"
+#include "utils/profiler.hpp"
 #include "utils/stdcompat/cstddef.hpp"
 
 namespace devilution {
@@ -58,6 +59,7 @@ private:
 template <typename T>
 void LoadFileInMem(const char *path, T *data)
 {
+	DVL_PROFILE_SCOPE("LoadFileInMem");
 	SFile file { path };
 	if (!file.Ok())
 		return;
@@ -70,6 +72,7 @@ void LoadFileInMem(const char *path, T *data)
 template <typename T>
 void LoadFileInMem(const char *path, T *data, std::size_t count)
 {
+	DVL_PROFILE_SCOPE("LoadFileInMem");
 	SFile file { path };
 	if (!file.Ok())
 		return;
@@ -91,6 +94,7 @@ void LoadFileInMem(const char *path, std::array<T, N> &data)
 template <typename T = byte>
 std::unique_ptr<T[]> LoadFileInMem(const char *path, std::size_t *numRead = nullptr)
 {
+	DVL_PROFILE_SCOPE("LoadFileInMem");
 	SFile file { path };
 	if (!file.Ok())
 		return nullptr;
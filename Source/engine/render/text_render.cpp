@@ -5,9 +5,12 @@
  */
 #include "text_render.hpp"
 
+#include <algorithm>
 #include <array>
+#include <limits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "DiabloUI/art_draw.h"
 #include "DiabloUI/diabloui.h"
@@ -18,6 +21,7 @@
 #include "engine/load_file.hpp"
 #include "engine/point.hpp"
 #include "palette.h"
+#include "utils/hash.hpp"
 #include "utils/display.h"
 #include "utils/sdl_compat.h"
 #include "utils/utf8.h"
@@ -28,8 +32,55 @@ namespace {
 
 constexpr char32_t ZWSP = U'\u200B'; // Zero-width space
 
+/** A glyph placed by DrawString, relative to the top left corner of the text rectangle */
+struct PositionedGlyph {
+	Art *font;
+	Point position;
+	uint8_t frame;
+};
+
+/** Start of a new line, where DrawString stops if the line would begin below the bottom margin */
+struct LineBreak {
+	/** Glyphs placed before the break */
+	uint32_t glyphs;
+	/** Position the previous line ended at */
+	Point end;
+	/** Bytes of the text before the break */
+	uint32_t bytes;
+};
+
+/**
+ * The glyphs of a text as DrawString places them, reused while the text is drawn the same way.
+ * Layouts are relative to the text rectangle and cover every line, so they don't depend on where the text is drawn.
+ */
+struct TextLayout {
+	std::string text;
+	UiFlags flags;
+	int spacing;
+	int lineHeight;
+	Size size;
+
+	std::vector<PositionedGlyph> glyphs;
+	std::vector<LineBreak> breaks;
+	/** Position after the last glyph, where the cursor goes */
+	Point end;
+	/** Bytes of the text that were placed */
+	uint32_t bytesDrawn;
+	/** Furthest position checked against the width, the layout is the same for any width at least this wide */
+	int extent;
+};
+
+/** Texts that change every frame, such as timers, would otherwise fill the cache */
+constexpr size_t MaxTextLayouts = 1024;
+
+/** Width of the layouts of texts that are only wrapped, not aligned, shared by every width they fit in */
+constexpr int UnboundedWidth = std::numeric_limits<int>::max();
+
 std::unordered_map<uint32_t, Art> Fonts;
 std::unordered_map<uint32_t, std::array<uint8_t, 256>> FontKerns;
+/** Layouts by hash of the text and parameters, they point into Fonts so they go when a font is unloaded */
+std::unordered_map<uint64_t, TextLayout> TextLayouts;
+
 std::array<int, 6> FontSizes = { 12, 24, 30, 42, 46, 22 };
 std::array<uint8_t, 6> FontFullwidth = { 16, 21, 29, 41, 43, 16 };
 std::array<int, 6> LineHeights = { 12, 26, 38, 42, 50, 22 };
@@ -175,6 +226,8 @@ Art *LoadFont(GameFontTables size, text_color color, uint16_t row)
 
 void UnloadFonts(GameFontTables size, text_color color)
 {
+	TextLayouts.clear();
+
 	uint32_t fontStyle = (color << 24) | (size << 16);
 
 	for (auto font = Fonts.begin(); font != Fonts.end();) {
@@ -188,27 +241,27 @@ void UnloadFonts(GameFontTables size, text_color color)
 
 void UnloadFonts()
 {
+	TextLayouts.clear();
 	Fonts.clear();
 	FontKerns.clear();
 }
 
+size_t GetTextLayoutCount()
+{
+	return TextLayouts.size();
+}
+
 int GetLineWidth(string_view text, GameFontTables size, int spacing, int *charactersInLine)
 {
 	int lineWidth = 0;
 
-	std::string textBuffer;
-	textBuffer.reserve(textBuffer.size() + 3); // Buffer must be padded before calling utf8_decode()
-	textBuffer.append(text.data(), text.size());
-	textBuffer.resize(textBuffer.size() + 3);
-	const char *textData = textBuffer.data();
-
 	uint32_t codepoints = 0;
 	uint32_t currentUnicodeRow = 0;
 	std::array<uint8_t, 256> *kerning = nullptr;
 	char32_t next;
 	int error;
-	while (*textData != '\0') {
-		textData = utf8_decode(textData, &next, &error);
+	while (!text.empty() && text[0] != '\0') {
+		text.remove_prefix(Utf8DecodeFirst(text, &next, &error));
 		if (error)
 			break;
 		if (next == ZWSP)
@@ -249,13 +302,10 @@ std::string WordWrapString(string_view text, size_t width, GameFontTables size,
 	int lastBreakableLen;
 	char32_t lastBreakableCodePoint;
 
-	std::string input;
 	std::string output;
-	input.reserve(input.size() + 3); // Buffer must be padded before calling utf8_decode()
-	input.append(text.data(), text.size());
-	input.resize(input.size() + 3);
 	output.reserve(text.size());
-	const char *begin = input.data();
+	const char *begin = text.data();
+	const char *end = begin + text.size();
 	const char *cur = begin;
 
 	const char *processedEnd = cur;
@@ -264,8 +314,8 @@ std::string WordWrapString(string_view text, size_t width, GameFontTables size,
 	std::array<uint8_t, 256> *kerning = nullptr;
 	char32_t next;
 	int error;
-	while (*cur != '\0') {
-		cur = utf8_decode(cur, &next, &error);
+	while (cur != end && *cur != '\0') {
+		cur += Utf8DecodeFirst({ cur, static_cast<size_t>(end - cur) }, &next, &error);
 		if (error != 0)
 			break;
 
@@ -307,13 +357,13 @@ std::string WordWrapString(string_view text, size_t width, GameFontTables size,
 		}
 
 		// Break line and continue to next line
-		const char *end = &input[lastBreakablePos];
+		const char *lineEnd = begin + lastBreakablePos;
 		if (!IsAnyOf(lastBreakableCodePoint, U' ', U'　', ZWSP)) {
-			end += lastBreakableLen;
+			lineEnd += lastBreakableLen;
 		}
-		output.append(processedEnd, end);
+		output.append(processedEnd, lineEnd);
 		output += '\n';
-		cur = &input[lastBreakablePos + lastBreakableLen];
+		cur = begin + lastBreakablePos + lastBreakableLen;
 		processedEnd = cur;
 		lastBreakablePos = -1;
 		lineWidth = 0;
@@ -322,13 +372,20 @@ std::string WordWrapString(string_view text, size_t width, GameFontTables size,
 	return output;
 }
 
-/**
- * @todo replace Rectangle with cropped Surface
- */
-uint32_t DrawString(const Surface &out, string_view text, const Rectangle &rect, UiFlags flags, int spacing, int lineHeight)
+namespace {
+
+bool IsLayoutOf(const TextLayout &layout, string_view text, UiFlags flags, int spacing, int lineHeight, Size size)
 {
-	GameFontTables size = GetSizeFromFlags(flags);
-	text_color color = GetColorFromFlags(flags);
+	return layout.flags == flags && layout.spacing == spacing && layout.lineHeight == lineHeight
+	    && layout.size == size && layout.text == text;
+}
+
+void LayoutText(TextLayout &layout, string_view text, GameFontTables size, text_color color)
+{
+	const UiFlags flags = layout.flags;
+	const int width = layout.size.width;
+	const int lineHeight = layout.lineHeight;
+	int spacing = layout.spacing;
 
 	int charactersInLine = 0;
 	int lineWidth = 0;
@@ -337,23 +394,17 @@ uint32_t DrawString(const Surface &out, string_view text, const Rectangle &rect,
 
 	int maxSpacing = spacing;
 	if (HasAnyOf(flags, UiFlags::KerningFitSpacing))
-		spacing = AdjustSpacingToFitHorizontally(lineWidth, maxSpacing, charactersInLine, rect.size.width);
+		spacing = AdjustSpacingToFitHorizontally(lineWidth, maxSpacing, charactersInLine, width);
 
-	Point characterPosition = rect.position;
+	Point characterPosition { 0, 0 };
 	if (HasAnyOf(flags, UiFlags::AlignCenter))
-		characterPosition.x += (rect.size.width - lineWidth) / 2;
+		characterPosition.x += (width - lineWidth) / 2;
 	else if (HasAnyOf(flags, UiFlags::AlignRight))
-		characterPosition.x += rect.size.width - lineWidth;
-
-	int rightMargin = rect.position.x + rect.size.width;
-	int bottomMargin = rect.size.height != 0 ? rect.position.y + rect.size.height : out.h();
-
-	if (lineHeight == -1)
-		lineHeight = LineHeights[size];
+		characterPosition.x += width - lineWidth;
 
 	if (HasAnyOf(flags, UiFlags::VerticalCenter)) {
 		int textHeight = (std::count(text.cbegin(), text.cend(), '\n') + 1) * lineHeight;
-		characterPosition.y += (rect.size.height - textHeight) / 2;
+		characterPosition.y += (layout.size.height - textHeight) / 2;
 	}
 
 	characterPosition.y += BaseLineOffset[size];
@@ -361,16 +412,14 @@ uint32_t DrawString(const Surface &out, string_view text, const Rectangle &rect,
 	Art *font = nullptr;
 	std::array<uint8_t, 256> *kerning = nullptr;
 
-	std::string textBuffer(text);
-	textBuffer.resize(textBuffer.size() + 4); // Buffer must be padded before calling utf8_decode()
-	const char *textData = textBuffer.data();
-	const char *previousPosition = textData;
+	size_t position = 0;
+	size_t previousPosition = 0;
 
 	char32_t next;
 	uint32_t currentUnicodeRow = 0;
 	int error;
-	for (; *textData != '\0'; previousPosition = textData) {
-		textData = utf8_decode(textData, &next, &error);
+	for (; position < text.size() && text[position] != '\0'; previousPosition = position) {
+		position += Utf8DecodeFirst(text.substr(position), &next, &error);
 		if (error)
 			break;
 		if (next == ZWSP)
@@ -384,38 +433,120 @@ uint32_t DrawString(const Surface &out, string_view text, const Rectangle &rect,
 		}
 
 		uint8_t frame = next & 0xFF;
-		if (next == '\n' || characterPosition.x > rightMargin) {
-			if (characterPosition.y + lineHeight >= bottomMargin)
-				break;
-			characterPosition.x = rect.position.x;
+		layout.extent = std::max(layout.extent, characterPosition.x);
+		if (next == '\n' || characterPosition.x > width) {
+			layout.breaks.push_back({ static_cast<uint32_t>(layout.glyphs.size()), characterPosition, static_cast<uint32_t>(previousPosition) });
+			characterPosition.x = 0;
 			characterPosition.y += lineHeight;
 
 			if (HasAnyOf(flags, (UiFlags::AlignCenter | UiFlags::AlignRight))) {
 				lineWidth = (*kerning)[frame];
-				if (*textData != '\0')
-					lineWidth += spacing + GetLineWidth(textData, size, spacing);
+				if (position < text.size() && text[position] != '\0')
+					lineWidth += spacing + GetLineWidth(text.substr(position), size, spacing);
 			}
 
 			if (HasAnyOf(flags, UiFlags::AlignCenter))
-				characterPosition.x += (rect.size.width - lineWidth) / 2;
+				characterPosition.x += (width - lineWidth) / 2;
 			else if (HasAnyOf(flags, UiFlags::AlignRight))
-				characterPosition.x += rect.size.width - lineWidth;
+				characterPosition.x += width - lineWidth;
 
 			if (next == '\n')
 				continue;
 		}
 
-		DrawArt(out, characterPosition, font, frame);
+		layout.glyphs.push_back({ font, characterPosition, frame });
 		characterPosition.x += (*kerning)[frame] + spacing;
 	}
 
+	layout.end = characterPosition;
+	layout.bytesDrawn = static_cast<uint32_t>(previousPosition);
+}
+
+const TextLayout &FindOrLayoutText(string_view text, UiFlags flags, int spacing, int lineHeight, Size size)
+{
+	const int parameters[] = { static_cast<int>(flags), spacing, lineHeight, size.width, size.height };
+	uint64_t hash = Fnv1a(reinterpret_cast<const byte *>(text.data()), text.size());
+	hash = Fnv1a(reinterpret_cast<const byte *>(parameters), sizeof(parameters), hash);
+
+	auto cached = TextLayouts.find(hash);
+	if (cached != TextLayouts.end() && IsLayoutOf(cached->second, text, flags, spacing, lineHeight, size))
+		return cached->second;
+
+	if (cached == TextLayouts.end() && TextLayouts.size() >= MaxTextLayouts)
+		TextLayouts.clear();
+
+	// A colliding layout is replaced, the text it belonged to will be placed again when it is drawn next
+	TextLayout &layout = TextLayouts[hash];
+	layout.text.assign(text.data(), text.size());
+	layout.flags = flags;
+	layout.spacing = spacing;
+	layout.lineHeight = lineHeight;
+	layout.size = size;
+	layout.glyphs.clear();
+	layout.breaks.clear();
+	layout.extent = 0;
+	LayoutText(layout, text, GetSizeFromFlags(flags), GetColorFromFlags(flags));
+	return layout;
+}
+
+/**
+ * @brief Looks up the layout of a text, placing its glyphs if it isn't cached
+ */
+const TextLayout &GetTextLayout(string_view text, UiFlags flags, int spacing, int lineHeight, Size size)
+{
+	// Without alignment the width only matters once a line reaches it, so texts drawn at different positions share a layout
+	if (!HasAnyOf(flags, (UiFlags::AlignCenter | UiFlags::AlignRight | UiFlags::KerningFitSpacing))) {
+		const TextLayout &unbounded = FindOrLayoutText(text, flags, spacing, lineHeight, { UnboundedWidth, size.height });
+		if (unbounded.extent <= size.width)
+			return unbounded;
+	}
+
+	return FindOrLayoutText(text, flags, spacing, lineHeight, size);
+}
+
+} // namespace
+
+/**
+ * @todo replace Rectangle with cropped Surface
+ */
+uint32_t DrawString(const Surface &out, string_view text, const Rectangle &rect, UiFlags flags, int spacing, int lineHeight)
+{
+	GameFontTables size = GetSizeFromFlags(flags);
+	text_color color = GetColorFromFlags(flags);
+
+	if (lineHeight == -1)
+		lineHeight = LineHeights[size];
+
+	int bottomMargin = rect.size.height != 0 ? rect.size.height : out.h() - rect.position.y;
+
+	const TextLayout &layout = GetTextLayout(text, flags, spacing, lineHeight, rect.size);
+
+	// No line is started below the bottom margin
+	uint32_t glyphs = static_cast<uint32_t>(layout.glyphs.size());
+	Point end = layout.end;
+	uint32_t bytesDrawn = layout.bytesDrawn;
+	for (const LineBreak &lineBreak : layout.breaks) {
+		if (lineBreak.end.y + lineHeight >= bottomMargin) {
+			glyphs = lineBreak.glyphs;
+			end = lineBreak.end;
+			bytesDrawn = lineBreak.bytes;
+			break;
+		}
+	}
+
+	for (uint32_t i = 0; i < glyphs; i++) {
+		const PositionedGlyph &glyph = layout.glyphs[i];
+		DrawArt(out, rect.position + Displacement { glyph.position.x, glyph.position.y }, glyph.font, glyph.frame);
+	}
+
+	Point characterPosition = rect.position + Displacement { end.x, end.y };
 	if (HasAnyOf(flags, UiFlags::PentaCursor)) {
 		CelDrawTo(out, characterPosition + Displacement { 0, lineHeight - BaseLineOffset[size] }, *pSPentSpn2Cels, PentSpn2Spin());
 	} else if (HasAnyOf(flags, UiFlags::TextCursor) && GetAnimationFrame(2, 500) != 0) {
 		DrawArt(out, characterPosition, LoadFont(size, color, 0), '|');
 	}
 
-	return previousPosition - textBuffer.data();
+	return bytesDrawn;
 }
 
 uint8_t PentSpn2Spin()
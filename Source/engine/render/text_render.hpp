@@ -107,4 +107,7 @@ inline void DrawString(const Surface &out, string_view text, const Point &positi
 uint8_t PentSpn2Spin();
 void UnloadFonts();
 
+/** @brief Number of texts whose glyph layout DrawString keeps */
+size_t GetTextLayoutCount();
+
 } // namespace devilution
@@ -0,0 +1,162 @@
+/**
+ * @file heroindex.cpp
+ *
+ * Implementation of the index of the heroes listed on the character selection screen.
+ */
+#include "heroindex.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "utils/endian.hpp"
+#include "utils/file_util.h"
+#include "utils/log.hpp"
+
+namespace devilution {
+
+namespace {
+
+constexpr char HeroIndexMagic[4] = { 'D', 'V', 'H', 'I' };
+constexpr uint8_t HeroIndexVersion = 1;
+constexpr size_t HeroIndexHeaderSize = sizeof(HeroIndexMagic) + 1 + sizeof(uint32_t);
+
+/** save number, file size, modification time, name, level, class, rank, four stats, saved game and spawn flags */
+constexpr size_t HeroIndexEntrySize = 4 + 8 + 8 + sizeof(_uiheroinfo::name) + 3 + 4 * 2 + 2;
+
+void AppendLE(std::string &out, uint64_t value, size_t bytes)
+{
+	for (size_t i = 0; i < bytes; i++)
+		out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+uint64_t LoadLE64(const uint8_t *b)
+{
+	return static_cast<uint64_t>(LoadLE32(b + 4)) << 32 | LoadLE32(b);
+}
+
+} // namespace
+
+std::string FormatHeroIndex(const std::vector<HeroIndexEntry> &entries)
+{
+	std::string out(HeroIndexMagic, sizeof(HeroIndexMagic));
+	out.reserve(HeroIndexHeaderSize + entries.size() * HeroIndexEntrySize);
+	out.push_back(static_cast<char>(HeroIndexVersion));
+	AppendLE(out, entries.size(), 4);
+
+	for (const HeroIndexEntry &entry : entries) {
+		const _uiheroinfo &hero = entry.hero;
+		AppendLE(out, hero.saveNumber, 4);
+		AppendLE(out, entry.fileSize, 8);
+		AppendLE(out, static_cast<uint64_t>(entry.modified), 8);
+		out.append(hero.name, sizeof(hero.name));
+		out.push_back(static_cast<char>(hero.level));
+		out.push_back(static_cast<char>(hero.heroclass));
+		out.push_back(static_cast<char>(hero.herorank));
+		AppendLE(out, hero.strength, 2);
+		AppendLE(out, hero.magic, 2);
+		AppendLE(out, hero.dexterity, 2);
+		AppendLE(out, hero.vitality, 2);
+		out.push_back(hero.hassaved ? 1 : 0);
+		out.push_back(hero.spawned ? 1 : 0);
+	}
+
+	return out;
+}
+
+bool ParseHeroIndex(string_view data, std::vector<HeroIndexEntry> &entries)
+{
+	entries.clear();
+	if (data.size() < HeroIndexHeaderSize || memcmp(data.data(), HeroIndexMagic, sizeof(HeroIndexMagic)) != 0)
+		return false;
+	if (static_cast<uint8_t>(data[sizeof(HeroIndexMagic)]) != HeroIndexVersion)
+		return false;
+	const auto *in = reinterpret_cast<const uint8_t *>(data.data());
+	const uint32_t count = LoadLE32(&in[sizeof(HeroIndexMagic) + 1]);
+	if (data.size() != HeroIndexHeaderSize + static_cast<uint64_t>(count) * HeroIndexEntrySize)
+		return false;
+
+	entries.resize(count);
+	in += HeroIndexHeaderSize;
+	for (HeroIndexEntry &entry : entries) {
+		_uiheroinfo &hero = entry.hero;
+		hero.saveNumber = LoadLE32(in);
+		entry.fileSize = LoadLE64(in + 4);
+		entry.modified = static_cast<int64_t>(LoadLE64(in + 12));
+		in += 20;
+		memcpy(hero.name, in, sizeof(hero.name));
+		hero.name[sizeof(hero.name) - 1] = '\0';
+		in += sizeof(hero.name);
+		hero.level = in[0];
+		hero.heroclass = static_cast<HeroClass>(in[1]);
+		hero.herorank = in[2];
+		hero.strength = LoadLE16(in + 3);
+		hero.magic = LoadLE16(in + 5);
+		hero.dexterity = LoadLE16(in + 7);
+		hero.vitality = LoadLE16(in + 9);
+		hero.hassaved = in[11] != 0;
+		hero.spawned = in[12] != 0;
+		in += 13;
+
+		if (hero.heroclass > HeroClass::LAST) {
+			entries.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::vector<HeroIndexEntry> LoadHeroIndex(const std::string &path)
+{
+	std::vector<HeroIndexEntry> entries;
+	std::optional<std::fstream> stream = CreateFileStream(path.c_str(), std::fstream::in | std::fstream::binary);
+	if (!stream || stream->fail())
+		return entries;
+
+	std::string data { std::istreambuf_iterator<char>(*stream), std::istreambuf_iterator<char>() };
+	if (!ParseHeroIndex(data, entries))
+		LogVerbose("Ignoring invalid hero index {}", path);
+	return entries;
+}
+
+bool SaveHeroIndex(const std::string &path, const std::vector<HeroIndexEntry> &entries)
+{
+	// Written next to the index and moved over it, so a crash can't leave half an index behind
+	const std::string tempPath = path + ".tmp";
+	{
+		std::optional<std::fstream> stream = CreateFileStream(tempPath.c_str(), std::fstream::out | std::fstream::trunc | std::fstream::binary);
+		if (!stream || stream->fail())
+			return false;
+		const std::string data = FormatHeroIndex(entries);
+		if (!stream->write(data.data(), data.size()) || !stream->flush()) {
+			LogError("Unable to write hero index {}", tempPath);
+			return false;
+		}
+	}
+	return RenameFile(tempPath.c_str(), path.c_str());
+}
+
+const HeroIndexEntry *FindHeroIndexEntry(const std::vector<HeroIndexEntry> &entries, const HeroIndexEntry &save)
+{
+	for (const HeroIndexEntry &entry : entries) {
+		if (entry.hero.saveNumber != save.hero.saveNumber)
+			continue;
+		if (entry.fileSize != save.fileSize || entry.modified != save.modified)
+			return nullptr;
+		return &entry;
+	}
+	return nullptr;
+}
+
+void UpdateHeroIndexEntry(std::vector<HeroIndexEntry> &entries, const HeroIndexEntry &entry)
+{
+	auto it = std::find_if(entries.begin(), entries.end(), [&entry](const HeroIndexEntry &other) {
+		return other.hero.saveNumber == entry.hero.saveNumber;
+	});
+	if (it != entries.end())
+		*it = entry;
+	else
+		entries.push_back(entry);
+}
+
+} // namespace devilution
@@ -0,0 +1,49 @@
+/**
+ * @file heroindex.h
+ *
+ * Interface of the index of the heroes listed on the character selection screen.
+ *
+ * The index keeps what the list shows of every hero next to the save files, so the list doesn't
+ * have to decode each save. An entry is only trusted while the size and modification time of its
+ * save are the ones recorded with it.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DiabloUI/diabloui.h"
+#include "utils/stdcompat/string_view.hpp"
+
+namespace devilution {
+
+struct HeroIndexEntry {
+	/** Size of the save when the entry was written */
+	uint64_t fileSize;
+	/** Modification time of the save when the entry was written */
+	int64_t modified;
+	_uiheroinfo hero;
+};
+
+std::string FormatHeroIndex(const std::vector<HeroIndexEntry> &entries);
+
+/** @return false if the data isn't a hero index of this version */
+bool ParseHeroIndex(string_view data, std::vector<HeroIndexEntry> &entries);
+
+/** @return The entries of the index, none if it is missing or invalid */
+std::vector<HeroIndexEntry> LoadHeroIndex(const std::string &path);
+
+bool SaveHeroIndex(const std::string &path, const std::vector<HeroIndexEntry> &entries);
+
+/**
+ * @brief Looks up the hero of a save
+ * @param save Save number, size and modification time of the save as it is now
+ * @return nullptr if the save isn't indexed or changed since
+ */
+const HeroIndexEntry *FindHeroIndexEntry(const std::vector<HeroIndexEntry> &entries, const HeroIndexEntry &save);
+
+/** @brief Adds the entry of a save, replacing the previous one */
+void UpdateHeroIndexEntry(std::vector<HeroIndexEntry> &entries, const HeroIndexEntry &entry);
+
+} // namespace devilution
@@ -33,6 +33,7 @@
 #include "town.h"
 #include "utils/language.h"
 #include "utils/math.h"
+#include "utils/profiler.hpp"
 #include "utils/stdcompat/algorithm.hpp"
 
 namespace devilution {
@@ -3628,6 +3629,7 @@ void DeleteItem(int ii, int i)
 
 void ProcessItems()
 {
+	DVL_PROFILE_SCOPE("ProcessItems");
 	for (int i = 0; i < ActiveItemCount; i++) {
 		int ii = ActiveItems[i];
 		auto &item = Items[ii];
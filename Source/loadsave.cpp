@@ -5,6 +5,7 @@
  */
 #include "loadsave.h"
 
+#include <algorithm>
 #include <climits>
 #include <cstring>
 
@@ -29,6 +30,7 @@
 #include "quests.h"
 #include "stores.h"
 #include "utils/endian.hpp"
+#include "utils/hash.hpp"
 #include "utils/language.h"
 
 namespace devilution {
@@ -41,6 +43,20 @@ namespace {
 uint8_t giNumberQuests;
 uint8_t giNumberOfSmithPremiumItems;
 
+/**
+ * First byte of level and game data that starts with a format header.
+ * The legacy formats can never start with this value at that position.
+ */
+constexpr uint8_t SaveFormatMarker = 0xFF;
+/** Dungeon grids are stored run-length encoded instead of as raw arrays. */
+constexpr uint8_t CompactGridsSaveFormat = 1;
+constexpr uint8_t CurrentSaveFormat = CompactGridsSaveFormat;
+
+/** A run of up to 128 literal values or of up to 129 repeated values, see `SaveHelper::WriteGrid`. */
+constexpr size_t MaxLiteralRun = 128;
+constexpr size_t MaxRepeatRun = 129;
+constexpr uint8_t RepeatRunBias = 126;
+
 template <class T>
 T SwapLE(T in)
 {
@@ -75,6 +91,7 @@ class LoadHelper {
 	std::unique_ptr<byte[]> m_buffer_;
 	size_t m_cur_ = 0;
 	size_t m_size_;
+	uint8_t m_formatVersion_ = 0;
 
 	template <class T>
 	T Next()
@@ -143,6 +160,87 @@ public:
 	{
 		return Next<uint32_t>() != 0;
 	}
+
+	/**
+	 * @brief Reads an array of big endian values with a single copy followed by one byte swap pass
+	 */
+	template <class T>
+	void NextBulkBE(T *values, size_t count)
+	{
+		const size_t size = count * sizeof(T);
+		if (!IsValid(size))
+			return;
+
+		memcpy(values, &m_buffer_[m_cur_], size);
+		m_cur_ += size;
+
+		if (sizeof(T) > 1) {
+			for (size_t i = 0; i < count; i++)
+				values[i] = SwapBE(values[i]);
+		}
+	}
+
+	/**
+	 * @brief Reads the format header if the file has one, files without one use the legacy format.
+	 * @return False if the file was written by a newer version of the game
+	 */
+	bool NextFormatHeader()
+	{
+		if (!IsValid() || static_cast<uint8_t>(m_buffer_[m_cur_]) != SaveFormatMarker)
+			return true;
+
+		m_cur_++;
+		m_formatVersion_ = Next<uint8_t>();
+		return m_formatVersion_ <= CurrentSaveFormat;
+	}
+
+	[[nodiscard]] bool HasCompactGrids() const
+	{
+		return m_formatVersion_ >= CompactGridsSaveFormat;
+	}
+
+	/**
+	 * @brief Reads a dungeon grid written by `SaveHelper::WriteGrid`
+	 * @tparam S Type the values are stored as
+	 * @param grid Grid to fill
+	 * @param project Converts the stored values to the values of the grid
+	 */
+	template <typename S, typename T, size_t Width, size_t Height, typename Projection>
+	void NextGrid(T (&grid)[Width][Height], Projection project)
+	{
+		constexpr size_t Size = Width * Height;
+		std::unique_ptr<S[]> values { new S[Size] {} };
+		size_t count = 0;
+		if (!HasCompactGrids()) {
+			NextBulkBE(values.get(), Size);
+		} else {
+			while (count < Size && IsValid()) {
+				const uint8_t control = Next<uint8_t>();
+				if (control < MaxLiteralRun) {
+					const size_t literals = std::min<size_t>(control + 1, Size - count);
+					NextBulkBE(&values[count], literals);
+					count += literals;
+				} else {
+					const size_t repeats = std::min<size_t>(control - RepeatRunBias, Size - count);
+					const S value = NextBE<S>();
+					std::fill_n(&values[count], repeats, value);
+					count += repeats;
+				}
+			}
+		}
+
+		count = 0;
+		for (size_t j = 0; j < Height; j++) {
+			for (size_t i = 0; i < Width; i++) // NOLINT(modernize-loop-convert)
+				grid[i][j] = project(values[count++]);
+		}
+	}
+
+	template <typename S, typename T, size_t Width, size_t Height>
+	void NextGrid(T (&grid)[Width][Height])
+	{
+		NextGrid<S>(grid, [](S value) { return value; });
+	}
 };
 
 class SaveHelper {
@@ -151,18 +249,31 @@ class SaveHelper {
 	size_t m_cur_ = 0;
 	size_t m_capacity_;
 
+	/**
+	 * @brief Makes room for at least len more bytes, growing the buffer geometrically
+	 */
+	void Reserve(size_t len)
+	{
+		if (m_capacity_ >= m_cur_ + len)
+			return;
+
+		const size_t capacity = std::max(m_capacity_ * 2, m_cur_ + len);
+		std::unique_ptr<byte[]> buffer { new byte[capacity] };
+		memcpy(buffer.get(), m_buffer_.get(), m_cur_);
+		m_buffer_ = std::move(buffer);
+		m_capacity_ = capacity;
+	}
+
 public:
+	/**
+	 * @param szFileName Name of the file in the save archive
+	 * @param bufferLen Expected size of the file, the buffer grows when more is written
+	 */
 	SaveHelper(const char *szFileName, size_t bufferLen)
 	    : m_szFileName_(szFileName)
 	    , m_buffer_(new byte[codec_get_encoded_len(bufferLen)])
-	    , m_capacity_(bufferLen)
-	{
-	}
-
-	bool IsValid(size_t len = 1)
+	    , m_capacity_(codec_get_encoded_len(bufferLen))
 	{
-		return m_buffer_ != nullptr
-		    && m_capacity_ >= (m_cur_ + len);
 	}
 
 	template <typename T>
@@ -173,19 +284,33 @@ public:
 
 	void Skip(size_t len)
 	{
+		Reserve(len);
 		std::memset(&m_buffer_[m_cur_], 0, len);
 		m_cur_ += len;
 	}
 
 	void WriteBytes(const void *bytes, size_t len)
 	{
-		if (!IsValid(len))
-			return;
-
+		Reserve(len);
 		memcpy(&m_buffer_[m_cur_], bytes, len);
 		m_cur_ += len;
 	}
 
+	/**
+	 * @brief Writes an array of values as big endian in a single pass
+	 */
+	template <class T>
+	void WriteBulkBE(const T *values, size_t count)
+	{
+		Reserve(count * sizeof(T));
+		byte *out = &m_buffer_[m_cur_];
+		for (size_t i = 0; i < count; i++) {
+			const T value = SwapBE(values[i]);
+			memcpy(out + i * sizeof(T), &value, sizeof(T));
+		}
+		m_cur_ += count * sizeof(T);
+	}
+
 	template <class T>
 	void WriteLE(T value)
 	{
@@ -200,97 +325,350 @@ public:
 		WriteBytes(&value, sizeof(value));
 	}
 
+	void WriteFormatHeader()
+	{
+		WriteLE<uint8_t>(SaveFormatMarker);
+		WriteLE<uint8_t>(CurrentSaveFormat);
+	}
+
+	/**
+	 * @brief Writes a dungeon grid using PackBits style run-length encoding.
+	 *
+	 * Each run starts with a control byte. Values below 128 are followed by that many plus one literal values,
+	 * higher values are followed by a single value that is repeated control - 126 times.
+	 * @tparam S Type the values are stored as
+	 * @param grid Grid to write
+	 * @param project Converts the values of the grid to the values that are stored
+	 */
+	template <typename S, typename T, size_t Width, size_t Height, typename Projection>
+	void WriteGrid(const T (&grid)[Width][Height], Projection project)
+	{
+		constexpr size_t Size = Width * Height;
+		std::unique_ptr<S[]> values { new S[Size] };
+		size_t n = 0;
+		for (size_t j = 0; j < Height; j++) {
+			for (size_t i = 0; i < Width; i++) // NOLINT(modernize-loop-convert)
+				values[n++] = static_cast<S>(project(grid[i][j]));
+		}
+
+		size_t pos = 0;
+		while (pos < Size) {
+			size_t repeats = 1;
+			while (pos + repeats < Size && repeats < MaxRepeatRun && values[pos + repeats] == values[pos])
+				repeats++;
+			if (repeats > 1) {
+				WriteLE<uint8_t>(static_cast<uint8_t>(repeats + RepeatRunBias));
+				WriteBE<S>(values[pos]);
+				pos += repeats;
+				continue;
+			}
+
+			// Gather literals up to the start of the next repeated run
+			size_t literals = 1;
+			while (pos + literals < Size && literals < MaxLiteralRun
+			    && !(pos + literals + 1 < Size && values[pos + literals] == values[pos + literals + 1]))
+				literals++;
+			WriteLE<uint8_t>(static_cast<uint8_t>(literals - 1));
+			WriteBulkBE(&values[pos], literals);
+			pos += literals;
+		}
+	}
+
+	template <typename S, typename T, size_t Width, size_t Height>
+	void WriteGrid(const T (&grid)[Width][Height])
+	{
+		WriteGrid<S>(grid, [](T value) { return value; });
+	}
+
 	~SaveHelper()
 	{
+		// Skip files the archive already holds with the same contents, such as levels that
+		// haven't changed since they were last saved.
+		const uint64_t contentHash = Fnv1a(m_buffer_.get(), m_cur_);
+		if (mpqapi_has_unchanged_file(m_szFileName_, contentHash))
+			return;
+
 		const auto encodedLen = codec_get_encoded_len(m_cur_);
+		Reserve(encodedLen - m_cur_);
 		const char *const password = pfile_get_password();
 		codec_encode(m_buffer_.get(), m_cur_, encodedLen, password);
-		mpqapi_write_file(m_szFileName_, m_buffer_.get(), encodedLen);
+		mpqapi_write_file(m_szFileName_, m_buffer_.get(), encodedLen, contentHash);
 	}
 };
 
+/*
+ * The Schema functions below declare the layout of a struct once for both loading and saving.
+ * They are instantiated with LoadHelper or SaveHelper and use these primitives for every field.
+ */
+
+/** Reads a field stored as little endian S. */
+template <typename S, typename T>
+void SchemaField(LoadHelper &file, T &value)
+{
+	value = static_cast<T>(file.NextLE<S>());
+}
+
+/** Writes a field as little endian S. */
+template <typename S, typename T>
+void SchemaField(SaveHelper &file, const T &value)
+{
+	file.WriteLE<S>(static_cast<S>(value));
+}
+
+template <typename S>
+void SchemaConstant(LoadHelper &file, S /*value*/)
+{
+	file.Skip<S>();
+}
+
+/** Writes a value that is ignored when loading, e.g. for compatibility with vanilla. */
+template <typename S>
+void SchemaConstant(SaveHelper &file, S value)
+{
+	file.WriteLE<S>(value);
+}
+
+void SchemaPadding(LoadHelper &file, size_t len)
+{
+	file.Skip(len);
+}
+
+void SchemaPadding(SaveHelper &file, size_t len)
+{
+	file.Skip(len);
+}
+
+void SchemaBytes(LoadHelper &file, void *bytes, size_t len)
+{
+	file.NextBytes(bytes, len);
+}
+
+void SchemaBytes(SaveHelper &file, const void *bytes, size_t len)
+{
+	file.WriteBytes(bytes, len);
+}
+
+/**
+ * @brief Declares the layout of an item in the save files.
+ * @param itemType Stored in place of item._itype as it may be remapped when saving
+ * @param idx Stored in place of item.IDidx as it gets remapped when loading and saving
+ */
+template <typename Helper, typename ItemT, typename ItemTypeT, typename IndexT>
+void ItemSchema(Helper &file, ItemT &item, ItemTypeT &itemType, IndexT &idx)
+{
+	SchemaField<int32_t>(file, item._iSeed);
+	SchemaField<uint16_t>(file, item._iCreateInfo);
+	SchemaPadding(file, 2); // Alignment
+	SchemaField<uint32_t>(file, itemType);
+	SchemaField<int32_t>(file, item.position.x);
+	SchemaField<int32_t>(file, item.position.y);
+	SchemaField<uint32_t>(file, item._iAnimFlag);
+	SchemaPadding(file, 4); // Skip pointer _iAnimData
+	SchemaField<int32_t>(file, item.AnimInfo.NumberOfFrames);
+	SchemaField<int32_t>(file, item.AnimInfo.CurrentFrame);
+	// _iAnimWidth and _iAnimWidth2 for vanilla compatibility
+	SchemaConstant<int32_t>(file, ItemAnimWidth);
+	SchemaConstant<int32_t>(file, CalculateWidth2(ItemAnimWidth));
+	SchemaPadding(file, 4); // _delFlag, unused since 1.02
+	SchemaField<uint8_t>(file, item._iSelFlag);
+	SchemaPadding(file, 3); // Alignment
+	SchemaField<uint32_t>(file, item._iPostDraw);
+	SchemaField<uint32_t>(file, item._iIdentified);
+	SchemaField<int8_t>(file, item._iMagical);
+	SchemaBytes(file, item._iName, 64);
+	SchemaBytes(file, item._iIName, 64);
+	SchemaField<int8_t>(file, item._iLoc);
+	SchemaField<uint8_t>(file, item._iClass);
+	SchemaPadding(file, 1); // Alignment
+	SchemaField<int32_t>(file, item._iCurs);
+	SchemaField<int32_t>(file, item._ivalue);
+	SchemaField<int32_t>(file, item._iIvalue);
+	SchemaField<int32_t>(file, item._iMinDam);
+	SchemaField<int32_t>(file, item._iMaxDam);
+	SchemaField<int32_t>(file, item._iAC);
+	SchemaField<uint32_t>(file, item._iFlags);
+	SchemaField<int32_t>(file, item._iMiscId);
+	SchemaField<int32_t>(file, item._iSpell);
+	SchemaField<int32_t>(file, item._iCharges);
+	SchemaField<int32_t>(file, item._iMaxCharges);
+	SchemaField<int32_t>(file, item._iDurability);
+	SchemaField<int32_t>(file, item._iMaxDur);
+	SchemaField<int32_t>(file, item._iPLDam);
+	SchemaField<int32_t>(file, item._iPLToHit);
+	SchemaField<int32_t>(file, item._iPLAC);
+	SchemaField<int32_t>(file, item._iPLStr);
+	SchemaField<int32_t>(file, item._iPLMag);
+	SchemaField<int32_t>(file, item._iPLDex);
+	SchemaField<int32_t>(file, item._iPLVit);
+	SchemaField<int32_t>(file, item._iPLFR);
+	SchemaField<int32_t>(file, item._iPLLR);
+	SchemaField<int32_t>(file, item._iPLMR);
+	SchemaField<int32_t>(file, item._iPLMana);
+	SchemaField<int32_t>(file, item._iPLHP);
+	SchemaField<int32_t>(file, item._iPLDamMod);
+	SchemaField<int32_t>(file, item._iPLGetHit);
+	SchemaField<int32_t>(file, item._iPLLight);
+	SchemaField<int8_t>(file, item._iSplLvlAdd);
+	SchemaField<int8_t>(file, item._iRequest);
+	SchemaPadding(file, 2); // Alignment
+	SchemaField<int32_t>(file, item._iUid);
+	SchemaField<int32_t>(file, item._iFMinDam);
+	SchemaField<int32_t>(file, item._iFMaxDam);
+	SchemaField<int32_t>(file, item._iLMinDam);
+	SchemaField<int32_t>(file, item._iLMaxDam);
+	SchemaField<int32_t>(file, item._iPLEnAc);
+	SchemaField<int8_t>(file, item._iPrePower);
+	SchemaField<int8_t>(file, item._iSufPower);
+	SchemaPadding(file, 2); // Alignment
+	SchemaField<int32_t>(file, item._iVAdd1);
+	SchemaField<int32_t>(file, item._iVMult1);
+	SchemaField<int32_t>(file, item._iVAdd2);
+	SchemaField<int32_t>(file, item._iVMult2);
+	SchemaField<int8_t>(file, item._iMinStr);
+	SchemaField<uint8_t>(file, item._iMinMag);
+	SchemaField<int8_t>(file, item._iMinDex);
+	SchemaPadding(file, 1); // Alignment
+	SchemaField<uint32_t>(file, item._iStatFlag);
+	SchemaField<int32_t>(file, idx);
+	SchemaField<uint32_t>(file, item.dwBuff);
+}
+
+/**
+ * @brief Declares the layout of a monster in the save files, up to the fields that need special handling.
+ */
+template <typename Helper, typename MonsterT>
+void MonsterSchema(Helper &file, MonsterT &monster)
+{
+	SchemaField<int32_t>(file, monster._mMTidx);
+	SchemaField<int32_t>(file, monster._mmode);
+	SchemaField<uint8_t>(file, monster._mgoal);
+	SchemaPadding(file, 3); // Alignment
+	SchemaField<int32_t>(file, monster._mgoalvar1);
+	SchemaField<int32_t>(file, monster._mgoalvar2);
+	SchemaField<int32_t>(file, monster._mgoalvar3);
+	SchemaPadding(file, 4); // Unused
+	SchemaField<uint8_t>(file, monster._pathcount);
+	SchemaPadding(file, 3); // Alignment
+	SchemaField<int32_t>(file, monster.position.tile.x);
+	SchemaField<int32_t>(file, monster.position.tile.y);
+	SchemaField<int32_t>(file, monster.position.future.x);
+	SchemaField<int32_t>(file, monster.position.future.y);
+	SchemaField<int32_t>(file, monster.position.old.x);
+	SchemaField<int32_t>(file, monster.position.old.y);
+	SchemaField<int32_t>(file, monster.position.offset.deltaX);
+	SchemaField<int32_t>(file, monster.position.offset.deltaY);
+	SchemaField<int32_t>(file, monster.position.velocity.deltaX);
+	SchemaField<int32_t>(file, monster.position.velocity.deltaY);
+	SchemaField<int32_t>(file, monster._mdir);
+	SchemaField<int32_t>(file, monster._menemy);
+	SchemaField<uint8_t>(file, monster.enemyPosition.x);
+	SchemaField<uint8_t>(file, monster.enemyPosition.y);
+	SchemaPadding(file, 2); // Unused
+
+	SchemaPadding(file, 4); // Skip pointer _mAnimData
+	SchemaField<int32_t>(file, monster.AnimInfo.TicksPerFrame);
+	SchemaField<int32_t>(file, monster.AnimInfo.TickCounterOfCurrentFrame);
+	SchemaField<int32_t>(file, monster.AnimInfo.NumberOfFrames);
+	SchemaField<int32_t>(file, monster.AnimInfo.CurrentFrame);
+	SchemaPadding(file, 4); // Skip _meflag
+	SchemaField<uint32_t>(file, monster._mDelFlag);
+	SchemaField<int32_t>(file, monster._mVar1);
+	SchemaField<int32_t>(file, monster._mVar2);
+	SchemaField<int32_t>(file, monster._mVar3);
+	SchemaField<int32_t>(file, monster.position.temp.x);
+	SchemaField<int32_t>(file, monster.position.temp.y);
+	SchemaField<int32_t>(file, monster.position.offset2.deltaX);
+	SchemaField<int32_t>(file, monster.position.offset2.deltaY);
+	SchemaPadding(file, 4); // Skip actionFrame
+	SchemaField<int32_t>(file, monster._mmaxhp);
+	SchemaField<int32_t>(file, monster._mhitpoints);
+
+	SchemaField<uint8_t>(file, monster._mAi);
+	SchemaField<uint8_t>(file, monster._mint);
+	SchemaPadding(file, 2); // Alignment
+	SchemaField<uint32_t>(file, monster._mFlags);
+	SchemaField<uint8_t>(file, monster._msquelch);
+	SchemaPadding(file, 3); // Alignment
+	SchemaPadding(file, 4); // Unused
+	SchemaField<int32_t>(file, monster.position.last.x);
+	SchemaField<int32_t>(file, monster.position.last.y);
+	SchemaField<uint32_t>(file, monster._mRndSeed);
+	SchemaField<uint32_t>(file, monster._mAISeed);
+	SchemaPadding(file, 4); // Unused
+
+	SchemaField<uint8_t>(file, monster._uniqtype);
+	SchemaField<uint8_t>(file, monster._uniqtrans);
+	SchemaField<int8_t>(file, monster._udeadval);
+
+	SchemaField<int8_t>(file, monster.mWhoHit);
+	SchemaField<int8_t>(file, monster.mLevel);
+	SchemaPadding(file, 1); // Alignment
+	SchemaField<uint16_t>(file, monster.mExp);
+}
+
+/**
+ * @brief Declares the layout of a missile in the save files.
+ */
+template <typename Helper, typename MissileT>
+void MissileSchema(Helper &file, MissileT &missile)
+{
+	SchemaField<int32_t>(file, missile._mitype);
+	SchemaField<int32_t>(file, missile.position.tile.x);
+	SchemaField<int32_t>(file, missile.position.tile.y);
+	SchemaField<int32_t>(file, missile.position.offset.deltaX);
+	SchemaField<int32_t>(file, missile.position.offset.deltaY);
+	SchemaField<int32_t>(file, missile.position.velocity.deltaX);
+	SchemaField<int32_t>(file, missile.position.velocity.deltaY);
+	SchemaField<int32_t>(file, missile.position.start.x);
+	SchemaField<int32_t>(file, missile.position.start.y);
+	SchemaField<int32_t>(file, missile.position.traveled.deltaX);
+	SchemaField<int32_t>(file, missile.position.traveled.deltaY);
+	SchemaField<int32_t>(file, missile._mimfnum);
+	SchemaField<int32_t>(file, missile._mispllvl);
+	SchemaField<uint32_t>(file, missile._miDelFlag);
+	SchemaField<uint8_t>(file, missile._miAnimType);
+	SchemaPadding(file, 3); // Alignment
+	SchemaField<int32_t>(file, missile._miAnimFlags);
+	SchemaPadding(file, 4); // Skip pointer _miAnimData
+	SchemaField<int32_t>(file, missile._miAnimDelay);
+	SchemaField<int32_t>(file, missile._miAnimLen);
+	SchemaField<int32_t>(file, missile._miAnimWidth);
+	SchemaField<int32_t>(file, missile._miAnimWidth2);
+	SchemaField<int32_t>(file, missile._miAnimCnt);
+	SchemaField<int32_t>(file, missile._miAnimAdd);
+	SchemaField<int32_t>(file, missile._miAnimFrame);
+	SchemaField<uint32_t>(file, missile._miDrawFlag);
+	SchemaField<uint32_t>(file, missile._miLightFlag);
+	SchemaField<uint32_t>(file, missile._miPreFlag);
+	SchemaField<uint32_t>(file, missile._miUniqTrans);
+	SchemaField<int32_t>(file, missile._mirange);
+	SchemaField<int32_t>(file, missile._misource);
+	SchemaField<int32_t>(file, missile._micaster);
+	SchemaField<int32_t>(file, missile._midam);
+	SchemaField<uint32_t>(file, missile._miHitFlag);
+	SchemaField<int32_t>(file, missile._midist);
+	SchemaField<int32_t>(file, missile._mlid);
+	SchemaField<int32_t>(file, missile._mirnd);
+	SchemaField<int32_t>(file, missile.var1);
+	SchemaField<int32_t>(file, missile.var2);
+	SchemaField<int32_t>(file, missile.var3);
+	SchemaField<int32_t>(file, missile.var4);
+	SchemaField<int32_t>(file, missile.var5);
+	SchemaField<int32_t>(file, missile.var6);
+	SchemaField<int32_t>(file, missile.var7);
+	SchemaField<uint32_t>(file, missile.limitReached);
+}
+
 void LoadItemData(LoadHelper &file, Item &item)
 {
-	item._iSeed = file.NextLE<int32_t>();
-	item._iCreateInfo = file.NextLE<uint16_t>();
-	file.Skip(2); // Alignment
-	item._itype = static_cast<ItemType>(file.NextLE<uint32_t>());
-	item.position.x = file.NextLE<int32_t>();
-	item.position.y = file.NextLE<int32_t>();
-	item._iAnimFlag = file.NextBool32();
-	file.Skip(4); // Skip pointer _iAnimData
 	item.AnimInfo = {};
-	item.AnimInfo.NumberOfFrames = file.NextLE<int32_t>();
-	item.AnimInfo.CurrentFrame = file.NextLE<int32_t>();
-	file.Skip(8); // Skip _iAnimWidth and _iAnimWidth2
-	file.Skip(4); // Unused since 1.02
-	item._iSelFlag = file.NextLE<uint8_t>();
-	file.Skip(3); // Alignment
-	item._iPostDraw = file.NextBool32();
-	item._iIdentified = file.NextBool32();
-	item._iMagical = static_cast<item_quality>(file.NextLE<int8_t>());
-	file.NextBytes(item._iName, 64);
-	file.NextBytes(item._iIName, 64);
-	item._iLoc = static_cast<item_equip_type>(file.NextLE<int8_t>());
-	item._iClass = static_cast<item_class>(file.NextLE<uint8_t>());
-	file.Skip(1); // Alignment
-	item._iCurs = file.NextLE<int32_t>();
-	item._ivalue = file.NextLE<int32_t>();
-	item._iIvalue = file.NextLE<int32_t>();
-	item._iMinDam = file.NextLE<int32_t>();
-	item._iMaxDam = file.NextLE<int32_t>();
-	item._iAC = file.NextLE<int32_t>();
-	item._iFlags = file.NextLE<uint32_t>();
-	item._iMiscId = static_cast<item_misc_id>(file.NextLE<int32_t>());
-	item._iSpell = static_cast<spell_id>(file.NextLE<int32_t>());
-	item._iCharges = file.NextLE<int32_t>();
-	item._iMaxCharges = file.NextLE<int32_t>();
-	item._iDurability = file.NextLE<int32_t>();
-	item._iMaxDur = file.NextLE<int32_t>();
-	item._iPLDam = file.NextLE<int32_t>();
-	item._iPLToHit = file.NextLE<int32_t>();
-	item._iPLAC = file.NextLE<int32_t>();
-	item._iPLStr = file.NextLE<int32_t>();
-	item._iPLMag = file.NextLE<int32_t>();
-	item._iPLDex = file.NextLE<int32_t>();
-	item._iPLVit = file.NextLE<int32_t>();
-	item._iPLFR = file.NextLE<int32_t>();
-	item._iPLLR = file.NextLE<int32_t>();
-	item._iPLMR = file.NextLE<int32_t>();
-	item._iPLMana = file.NextLE<int32_t>();
-	item._iPLHP = file.NextLE<int32_t>();
-	item._iPLDamMod = file.NextLE<int32_t>();
-	item._iPLGetHit = file.NextLE<int32_t>();
-	item._iPLLight = file.NextLE<int32_t>();
-	item._iSplLvlAdd = file.NextLE<int8_t>();
-	item._iRequest = file.NextBool8();
-	file.Skip(2); // Alignment
-	item._iUid = file.NextLE<int32_t>();
-	item._iFMinDam = file.NextLE<int32_t>();
-	item._iFMaxDam = file.NextLE<int32_t>();
-	item._iLMinDam = file.NextLE<int32_t>();
-	item._iLMaxDam = file.NextLE<int32_t>();
-	item._iPLEnAc = file.NextLE<int32_t>();
-	item._iPrePower = static_cast<item_effect_type>(file.NextLE<int8_t>());
-	item._iSufPower = static_cast<item_effect_type>(file.NextLE<int8_t>());
-	file.Skip(2); // Alignment
-	item._iVAdd1 = file.NextLE<int32_t>();
-	item._iVMult1 = file.NextLE<int32_t>();
-	item._iVAdd2 = file.NextLE<int32_t>();
-	item._iVMult2 = file.NextLE<int32_t>();
-	item._iMinStr = file.NextLE<int8_t>();
-	item._iMinMag = file.NextLE<uint8_t>();
-	item._iMinDex = file.NextLE<int8_t>();
-	file.Skip(1); // Alignment
-	item._iStatFlag = file.NextBool32();
-	item.IDidx = static_cast<_item_indexes>(file.NextLE<int32_t>());
+	ItemSchema(file, item, item._itype, item.IDidx);
 	if (gbIsSpawn) {
 		item.IDidx = RemapItemIdxFromSpawn(item.IDidx);
 	}
 	if (!gbIsHellfireSaveGame) {
 		item.IDidx = RemapItemIdxFromDiablo(item.IDidx);
 	}
-	item.dwBuff = file.NextLE<uint32_t>();
 	if (gbIsHellfireSaveGame)
 		item._iDamAcFlags = file.NextLE<uint32_t>();
 	else
@@ -544,72 +922,8 @@ bool gbSkipSync = false;
 
 void LoadMonster(LoadHelper *file, Monster &monster)
 {
-	monster._mMTidx = file->NextLE<int32_t>();
-	monster._mmode = static_cast<MonsterMode>(file->NextLE<int32_t>());
-	monster._mgoal = static_cast<monster_goal>(file->NextLE<uint8_t>());
-	file->Skip(3); // Alignment
-	monster._mgoalvar1 = file->NextLE<int32_t>();
-	monster._mgoalvar2 = file->NextLE<int32_t>();
-	monster._mgoalvar3 = file->NextLE<int32_t>();
-	file->Skip(4); // Unused
-	monster._pathcount = file->NextLE<uint8_t>();
-	file->Skip(3); // Alignment
-	monster.position.tile.x = file->NextLE<int32_t>();
-	monster.position.tile.y = file->NextLE<int32_t>();
-	monster.position.future.x = file->NextLE<int32_t>();
-	monster.position.future.y = file->NextLE<int32_t>();
-	monster.position.old.x = file->NextLE<int32_t>();
-	monster.position.old.y = file->NextLE<int32_t>();
-	monster.position.offset.deltaX = file->NextLE<int32_t>();
-	monster.position.offset.deltaY = file->NextLE<int32_t>();
-	monster.position.velocity.deltaX = file->NextLE<int32_t>();
-	monster.position.velocity.deltaY = file->NextLE<int32_t>();
-	monster._mdir = static_cast<Direction>(file->NextLE<int32_t>());
-	monster._menemy = file->NextLE<int32_t>();
-	monster.enemyPosition.x = file->NextLE<uint8_t>();
-	monster.enemyPosition.y = file->NextLE<uint8_t>();
-	file->Skip(2); // Unused
-
-	file->Skip(4); // Skip pointer _mAnimData
 	monster.AnimInfo = {};
-	monster.AnimInfo.TicksPerFrame = file->NextLE<int32_t>();
-	monster.AnimInfo.TickCounterOfCurrentFrame = file->NextLE<int32_t>();
-	monster.AnimInfo.NumberOfFrames = file->NextLE<int32_t>();
-	monster.AnimInfo.CurrentFrame = file->NextLE<int32_t>();
-	file->Skip(4); // Skip _meflag
-	monster._mDelFlag = file->NextBool32();
-	monster._mVar1 = file->NextLE<int32_t>();
-	monster._mVar2 = file->NextLE<int32_t>();
-	monster._mVar3 = file->NextLE<int32_t>();
-	monster.position.temp.x = file->NextLE<int32_t>();
-	monster.position.temp.y = file->NextLE<int32_t>();
-	monster.position.offset2.deltaX = file->NextLE<int32_t>();
-	monster.position.offset2.deltaY = file->NextLE<int32_t>();
-	file->Skip(4); // Skip actionFrame
-	monster._mmaxhp = file->NextLE<int32_t>();
-	monster._mhitpoints = file->NextLE<int32_t>();
-
-	monster._mAi = static_cast<_mai_id>(file->NextLE<uint8_t>());
-	monster._mint = file->NextLE<uint8_t>();
-	file->Skip(2); // Alignment
-	monster._mFlags = file->NextLE<uint32_t>();
-	monster._msquelch = file->NextLE<uint8_t>();
-	file->Skip(3); // Alignment
-	file->Skip(4); // Unused
-	monster.position.last.x = file->NextLE<int32_t>();
-	monster.position.last.y = file->NextLE<int32_t>();
-	monster._mRndSeed = file->NextLE<uint32_t>();
-	monster._mAISeed = file->NextLE<uint32_t>();
-	file->Skip(4); // Unused
-
-	monster._uniqtype = file->NextLE<uint8_t>();
-	monster._uniqtrans = file->NextLE<uint8_t>();
-	monster._udeadval = file->NextLE<int8_t>();
-
-	monster.mWhoHit = file->NextLE<int8_t>();
-	monster.mLevel = file->NextLE<int8_t>();
-	file->Skip(1); // Alignment
-	monster.mExp = file->NextLE<uint16_t>();
+	MonsterSchema(*file, monster);
 
 	if ((monster._mFlags & MFLAG_GOLEM) != 0) // Don't skip for golems
 		monster.mHit = file->NextLE<uint8_t>();
@@ -671,51 +985,7 @@ void SyncPackSize(Monster &leader)
 
 void LoadMissile(LoadHelper *file, Missile &missile)
 {
-	missile._mitype = static_cast<missile_id>(file->NextLE<int32_t>());
-	missile.position.tile.x = file->NextLE<int32_t>();
-	missile.position.tile.y = file->NextLE<int32_t>();
-	missile.position.offset.deltaX = file->NextLE<int32_t>();
-	missile.position.offset.deltaY = file->NextLE<int32_t>();
-	missile.position.velocity.deltaX = file->NextLE<int32_t>();
-	missile.position.velocity.deltaY = file->NextLE<int32_t>();
-	missile.position.start.x = file->NextLE<int32_t>();
-	missile.position.start.y = file->NextLE<int32_t>();
-	missile.position.traveled.deltaX = file->NextLE<int32_t>();
-	missile.position.traveled.deltaY = file->NextLE<int32_t>();
-	missile._mimfnum = file->NextLE<int32_t>();
-	missile._mispllvl = file->NextLE<int32_t>();
-	missile._miDelFlag = file->NextBool32();
-	missile._miAnimType = file->NextLE<uint8_t>();
-	file->Skip(3); // Alignment
-	missile._miAnimFlags = static_cast<MissileDataFlags>(file->NextLE<int32_t>());
-	file->Skip(4); // Skip pointer _miAnimData
-	missile._miAnimDelay = file->NextLE<int32_t>();
-	missile._miAnimLen = file->NextLE<int32_t>();
-	missile._miAnimWidth = file->NextLE<int32_t>();
-	missile._miAnimWidth2 = file->NextLE<int32_t>();
-	missile._miAnimCnt = file->NextLE<int32_t>();
-	missile._miAnimAdd = file->NextLE<int32_t>();
-	missile._miAnimFrame = file->NextLE<int32_t>();
-	missile._miDrawFlag = file->NextBool32();
-	missile._miLightFlag = file->NextBool32();
-	missile._miPreFlag = file->NextBool32();
-	missile._miUniqTrans = file->NextLE<uint32_t>();
-	missile._mirange = file->NextLE<int32_t>();
-	missile._misource = file->NextLE<int32_t>();
-	missile._micaster = static_cast<mienemy_type>(file->NextLE<int32_t>());
-	missile._midam = file->NextLE<int32_t>();
-	missile._miHitFlag = file->NextBool32();
-	missile._midist = file->NextLE<int32_t>();
-	missile._mlid = file->NextLE<int32_t>();
-	missile._mirnd = file->NextLE<int32_t>();
-	missile.var1 = file->NextLE<int32_t>();
-	missile.var2 = file->NextLE<int32_t>();
-	missile.var3 = file->NextLE<int32_t>();
-	missile.var4 = file->NextLE<int32_t>();
-	missile.var5 = file->NextLE<int32_t>();
-	missile.var6 = file->NextLE<int32_t>();
-	missile.var7 = file->NextLE<int32_t>();
-	missile.limitReached = file->NextBool32();
+	MissileSchema(*file, missile);
 	missile.lastCollisionTargetHash = 0;
 }
 
@@ -918,82 +1188,7 @@ void SaveItem(SaveHelper &file, const Item &item)
 		iType = ItemType::None;
 	}
 
-	file.WriteLE<int32_t>(item._iSeed);
-	file.WriteLE<int16_t>(item._iCreateInfo);
-	file.Skip(2); // Alignment
-	file.WriteLE<int32_t>(static_cast<int32_t>(iType));
-	file.WriteLE<int32_t>(item.position.x);
-	file.WriteLE<int32_t>(item.position.y);
-	file.WriteLE<uint32_t>(item._iAnimFlag ? 1 : 0);
-	file.Skip(4); // Skip pointer _iAnimData
-	file.WriteLE<int32_t>(item.AnimInfo.NumberOfFrames);
-	file.WriteLE<int32_t>(item.AnimInfo.CurrentFrame);
-	// write _iAnimWidth for vanilla compatibility
-	file.WriteLE<int32_t>(ItemAnimWidth);
-	// write _iAnimWidth2 for vanilla compatibility
-	file.WriteLE<int32_t>(CalculateWidth2(ItemAnimWidth));
-	file.Skip<uint32_t>(); // _delFlag, unused since 1.02
-	file.WriteLE<uint8_t>(item._iSelFlag);
-	file.Skip(3); // Alignment
-	file.WriteLE<uint32_t>(item._iPostDraw ? 1 : 0);
-	file.WriteLE<uint32_t>(item._iIdentified ? 1 : 0);
-	file.WriteLE<int8_t>(item._iMagical);
-	file.WriteBytes(item._iName, 64);
-	file.WriteBytes(item._iIName, 64);
-	file.WriteLE<int8_t>(item._iLoc);
-	file.WriteLE<uint8_t>(item._iClass);
-	file.Skip(1); // Alignment
-	file.WriteLE<int32_t>(item._iCurs);
-	file.WriteLE<int32_t>(item._ivalue);
-	file.WriteLE<int32_t>(item._iIvalue);
-	file.WriteLE<int32_t>(item._iMinDam);
-	file.WriteLE<int32_t>(item._iMaxDam);
-	file.WriteLE<int32_t>(item._iAC);
-	file.WriteLE<uint32_t>(item._iFlags);
-	file.WriteLE<int32_t>(item._iMiscId);
-	file.WriteLE<int32_t>(item._iSpell);
-	file.WriteLE<int32_t>(item._iCharges);
-	file.WriteLE<int32_t>(item._iMaxCharges);
-	file.WriteLE<int32_t>(item._iDurability);
-	file.WriteLE<int32_t>(item._iMaxDur);
-	file.WriteLE<int32_t>(item._iPLDam);
-	file.WriteLE<int32_t>(item._iPLToHit);
-	file.WriteLE<int32_t>(item._iPLAC);
-	file.WriteLE<int32_t>(item._iPLStr);
-	file.WriteLE<int32_t>(item._iPLMag);
-	file.WriteLE<int32_t>(item._iPLDex);
-	file.WriteLE<int32_t>(item._iPLVit);
-	file.WriteLE<int32_t>(item._iPLFR);
-	file.WriteLE<int32_t>(item._iPLLR);
-	file.WriteLE<int32_t>(item._iPLMR);
-	file.WriteLE<int32_t>(item._iPLMana);
-	file.WriteLE<int32_t>(item._iPLHP);
-	file.WriteLE<int32_t>(item._iPLDamMod);
-	file.WriteLE<int32_t>(item._iPLGetHit);
-	file.WriteLE<int32_t>(item._iPLLight);
-	file.WriteLE<int8_t>(item._iSplLvlAdd);
-	file.WriteLE<int8_t>(item._iRequest ? 1 : 0);
-	file.Skip(2); // Alignment
-	file.WriteLE<int32_t>(item._iUid);
-	file.WriteLE<int32_t>(item._iFMinDam);
-	file.WriteLE<int32_t>(item._iFMaxDam);
-	file.WriteLE<int32_t>(item._iLMinDam);
-	file.WriteLE<int32_t>(item._iLMaxDam);
-	file.WriteLE<int32_t>(item._iPLEnAc);
-	file.WriteLE<int8_t>(item._iPrePower);
-	file.WriteLE<int8_t>(item._iSufPower);
-	file.Skip(2); // Alignment
-	file.WriteLE<int32_t>(item._iVAdd1);
-	file.WriteLE<int32_t>(item._iVMult1);
-	file.WriteLE<int32_t>(item._iVAdd2);
-	file.WriteLE<int32_t>(item._iVMult2);
-	file.WriteLE<int8_t>(item._iMinStr);
-	file.WriteLE<uint8_t>(item._iMinMag);
-	file.WriteLE<int8_t>(item._iMinDex);
-	file.Skip(1); // Alignment
-	file.WriteLE<uint32_t>(item._iStatFlag ? 1 : 0);
-	file.WriteLE<int32_t>(idx);
-	file.WriteLE<uint32_t>(item.dwBuff);
+	ItemSchema(file, item, iType, idx);
 	if (gbIsHellfire)
 		file.WriteLE<uint32_t>(item._iDamAcFlags);
 }
@@ -1237,71 +1432,7 @@ void SavePlayer(SaveHelper &file, const Player &player)
 
 void SaveMonster(SaveHelper *file, Monster &monster)
 {
-	file->WriteLE<int32_t>(monster._mMTidx);
-	file->WriteLE<int32_t>(static_cast<int>(monster._mmode));
-	file->WriteLE<uint8_t>(monster._mgoal);
-	file->Skip(3); // Alignment
-	file->WriteLE<int32_t>(monster._mgoalvar1);
-	file->WriteLE<int32_t>(monster._mgoalvar2);
-	file->WriteLE<int32_t>(monster._mgoalvar3);
-	file->Skip(4); // Unused
-	file->WriteLE<uint8_t>(monster._pathcount);
-	file->Skip(3); // Alignment
-	file->WriteLE<int32_t>(monster.position.tile.x);
-	file->WriteLE<int32_t>(monster.position.tile.y);
-	file->WriteLE<int32_t>(monster.position.future.x);
-	file->WriteLE<int32_t>(monster.position.future.y);
-	file->WriteLE<int32_t>(monster.position.old.x);
-	file->WriteLE<int32_t>(monster.position.old.y);
-	file->WriteLE<int32_t>(monster.position.offset.deltaX);
-	file->WriteLE<int32_t>(monster.position.offset.deltaY);
-	file->WriteLE<int32_t>(monster.position.velocity.deltaX);
-	file->WriteLE<int32_t>(monster.position.velocity.deltaY);
-	file->WriteLE<int32_t>(static_cast<int32_t>(monster._mdir));
-	file->WriteLE<int32_t>(monster._menemy);
-	file->WriteLE<uint8_t>(monster.enemyPosition.x);
-	file->WriteLE<uint8_t>(monster.enemyPosition.y);
-	file->Skip(2); // Unused
-
-	file->Skip(4); // Skip pointer _mAnimData
-	file->WriteLE<int32_t>(monster.AnimInfo.TicksPerFrame);
-	file->WriteLE<int32_t>(monster.AnimInfo.TickCounterOfCurrentFrame);
-	file->WriteLE<int32_t>(monster.AnimInfo.NumberOfFrames);
-	file->WriteLE<int32_t>(monster.AnimInfo.CurrentFrame);
-	file->Skip<uint32_t>(); // Skip _meflag
-	file->WriteLE<uint32_t>(monster._mDelFlag ? 1 : 0);
-	file->WriteLE<int32_t>(monster._mVar1);
-	file->WriteLE<int32_t>(monster._mVar2);
-	file->WriteLE<int32_t>(monster._mVar3);
-	file->WriteLE<int32_t>(monster.position.temp.x);
-	file->WriteLE<int32_t>(monster.position.temp.y);
-	file->WriteLE<int32_t>(monster.position.offset2.deltaX);
-	file->WriteLE<int32_t>(monster.position.offset2.deltaY);
-	file->Skip<int32_t>(); // Skip _mVar8
-	file->WriteLE<int32_t>(monster._mmaxhp);
-	file->WriteLE<int32_t>(monster._mhitpoints);
-
-	file->WriteLE<uint8_t>(monster._mAi);
-	file->WriteLE<uint8_t>(monster._mint);
-	file->Skip(2); // Alignment
-	file->WriteLE<uint32_t>(monster._mFlags);
-	file->WriteLE<uint8_t>(monster._msquelch);
-	file->Skip(3); // Alignment
-	file->Skip(4); // Unused
-	file->WriteLE<int32_t>(monster.position.last.x);
-	file->WriteLE<int32_t>(monster.position.last.y);
-	file->WriteLE<uint32_t>(monster._mRndSeed);
-	file->WriteLE<uint32_t>(monster._mAISeed);
-	file->Skip(4); // Unused
-
-	file->WriteLE<uint8_t>(monster._uniqtype);
-	file->WriteLE<uint8_t>(monster._uniqtrans);
-	file->WriteLE<int8_t>(monster._udeadval);
-
-	file->WriteLE<int8_t>(monster.mWhoHit);
-	file->WriteLE<int8_t>(monster.mLevel);
-	file->Skip(1); // Alignment
-	file->WriteLE<uint16_t>(monster.mExp);
+	MonsterSchema(*file, monster);
 
 	file->WriteLE<uint8_t>(std::min<uint16_t>(monster.mHit, std::numeric_limits<uint8_t>::max())); // For backwards compatibility
 	file->WriteLE<uint8_t>(monster.mMinDamage);
@@ -1331,51 +1462,7 @@ void SaveMonster(SaveHelper *file, Monster &monster)
 
 void SaveMissile(SaveHelper *file, Missile &missile)
 {
-	file->WriteLE<int32_t>(missile._mitype);
-	file->WriteLE<int32_t>(missile.position.tile.x);
-	file->WriteLE<int32_t>(missile.position.tile.y);
-	file->WriteLE<int32_t>(missile.position.offset.deltaX);
-	file->WriteLE<int32_t>(missile.position.offset.deltaY);
-	file->WriteLE<int32_t>(missile.position.velocity.deltaX);
-	file->WriteLE<int32_t>(missile.position.velocity.deltaY);
-	file->WriteLE<int32_t>(missile.position.start.x);
-	file->WriteLE<int32_t>(missile.position.start.y);
-	file->WriteLE<int32_t>(missile.position.traveled.deltaX);
-	file->WriteLE<int32_t>(missile.position.traveled.deltaY);
-	file->WriteLE<int32_t>(missile._mimfnum);
-	file->WriteLE<int32_t>(missile._mispllvl);
-	file->WriteLE<uint32_t>(missile._miDelFlag ? 1 : 0);
-	file->WriteLE<uint8_t>(missile._miAnimType);
-	file->Skip(3); // Alignment
-	file->WriteLE<int32_t>(static_cast<int32_t>(missile._miAnimFlags));
-	file->Skip(4); // Skip pointer _miAnimData
-	file->WriteLE<int32_t>(missile._miAnimDelay);
-	file->WriteLE<int32_t>(missile._miAnimLen);
-	file->WriteLE<int32_t>(missile._miAnimWidth);
-	file->WriteLE<int32_t>(missile._miAnimWidth2);
-	file->WriteLE<int32_t>(missile._miAnimCnt);
-	file->WriteLE<int32_t>(missile._miAnimAdd);
-	file->WriteLE<int32_t>(missile._miAnimFrame);
-	file->WriteLE<uint32_t>(missile._miDrawFlag ? 1 : 0);
-	file->WriteLE<uint32_t>(missile._miLightFlag ? 1 : 0);
-	file->WriteLE<uint32_t>(missile._miPreFlag ? 1 : 0);
-	file->WriteLE<uint32_t>(missile._miUniqTrans);
-	file->WriteLE<int32_t>(missile._mirange);
-	file->WriteLE<int32_t>(missile._misource);
-	file->WriteLE<int32_t>(missile._micaster);
-	file->WriteLE<int32_t>(missile._midam);
-	file->WriteLE<uint32_t>(missile._miHitFlag ? 1 : 0);
-	file->WriteLE<int32_t>(missile._midist);
-	file->WriteLE<int32_t>(missile._mlid);
-	file->WriteLE<int32_t>(missile._mirnd);
-	file->WriteLE<int32_t>(missile.var1);
-	file->WriteLE<int32_t>(missile.var2);
-	file->WriteLE<int32_t>(missile.var3);
-	file->WriteLE<int32_t>(missile.var4);
-	file->WriteLE<int32_t>(missile.var5);
-	file->WriteLE<int32_t>(missile.var6);
-	file->WriteLE<int32_t>(missile.var7);
-	file->WriteLE<uint32_t>(missile.limitReached ? 1 : 0);
+	MissileSchema(*file, missile);
 }
 
 void SaveObject(SaveHelper &file, const Object &object)
@@ -1696,7 +1783,7 @@ void LoadGame(bool firstflag)
 	if (!file.IsValid())
 		app_fatal("%s", _("Unable to open save file archive"));
 
-	if (!IsHeaderValid(file.NextLE<uint32_t>()))
+	if (!IsHeaderValid(file.NextLE<uint32_t>()) || !file.NextFormatHeader())
 		app_fatal("%s", _("Invalid save file"));
 
 	if (gbIsHellfireSaveGame) {
@@ -1811,49 +1898,20 @@ void LoadGame(bool firstflag)
 	for (bool &uniqueItemFlag : UniqueItemFlags)
 		uniqueItemFlag = file.NextBool8();
 
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			dLight[i][j] = file.NextLE<int8_t>();
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			dFlags[i][j] = file.NextLE<int8_t>() & ~(BFLAG_PLAYERLR | BFLAG_MONSTLR);
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			dPlayer[i][j] = file.NextLE<int8_t>();
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			dItem[i][j] = file.NextLE<int8_t>();
-	}
+	file.NextGrid<int8_t>(dLight);
+	file.NextGrid<int8_t>(dFlags, [](int8_t flags) { return flags & ~(BFLAG_PLAYERLR | BFLAG_MONSTLR); });
+	file.NextGrid<int8_t>(dPlayer);
+	file.NextGrid<int8_t>(dItem);
 
 	if (leveltype != DTYPE_TOWN) {
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dMonster[i][j] = file.NextBE<int32_t>();
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dCorpse[i][j] = file.NextLE<int8_t>();
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dObject[i][j] = file.NextLE<int8_t>();
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dLight[i][j] = file.NextLE<int8_t>();
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dPreLight[i][j] = file.NextLE<int8_t>();
-		}
-		for (int j = 0; j < DMAXY; j++) {
-			for (int i = 0; i < DMAXX; i++) // NOLINT(modernize-loop-convert)
-				AutomapView[i][j] = file.NextLE<uint8_t>();
-		}
-		file.Skip(MAXDUNX * MAXDUNY); // dMissile
+		file.NextGrid<int32_t>(dMonster);
+		file.NextGrid<int8_t>(dCorpse);
+		file.NextGrid<int8_t>(dObject);
+		file.NextGrid<int8_t>(dLight);
+		file.NextGrid<int8_t>(dPreLight);
+		file.NextGrid<uint8_t>(AutomapView);
+		if (!file.HasCompactGrids())
+			file.Skip(MAXDUNX * MAXDUNY); // dMissile
 	}
 
 	numpremium = file.NextBE<int32_t>();
@@ -1912,7 +1970,7 @@ void SaveHeroItems(Player &player)
 
 void SaveGameData()
 {
-	SaveHelper file("game", 320 * 1024);
+	SaveHelper file("game", 64 * 1024);
 
 	if (gbIsSpawn && !gbIsHellfire)
 		file.WriteLE<uint32_t>(LoadLE32("SHAR"));
@@ -1925,6 +1983,8 @@ void SaveGameData()
 	else
 		app_fatal("%s", _("Invalid game state"));
 
+	file.WriteFormatHeader();
+
 	if (gbIsHellfire) {
 		giNumberOfLevels = 25;
 		giNumberQuests = 24;
@@ -2005,52 +2065,18 @@ void SaveGameData()
 	for (bool uniqueItemFlag : UniqueItemFlags)
 		file.WriteLE<uint8_t>(uniqueItemFlag ? 1 : 0);
 
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			file.WriteLE<int8_t>(dLight[i][j]);
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			file.WriteLE<int8_t>(dFlags[i][j] & ~(BFLAG_MISSILE | BFLAG_VISIBLE | BFLAG_DEAD_PLAYER));
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			file.WriteLE<int8_t>(dPlayer[i][j]);
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			file.WriteLE<int8_t>(dItem[i][j]);
-	}
+	file.WriteGrid<int8_t>(dLight);
+	file.WriteGrid<int8_t>(dFlags, [](int8_t flags) { return flags & ~(BFLAG_MISSILE | BFLAG_VISIBLE | BFLAG_DEAD_PLAYER); });
+	file.WriteGrid<int8_t>(dPlayer);
+	file.WriteGrid<int8_t>(dItem);
 
 	if (leveltype != DTYPE_TOWN) {
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteBE<int32_t>(dMonster[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dCorpse[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dObject[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dLight[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dPreLight[i][j]);
-		}
-		for (int j = 0; j < DMAXY; j++) {
-			for (int i = 0; i < DMAXX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<uint8_t>(AutomapView[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++)                                       // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>((dFlags[i][j] & BFLAG_MISSILE) != 0 ? -1 : 0); // For backwards compatability
-		}
+		file.WriteGrid<int32_t>(dMonster);
+		file.WriteGrid<int8_t>(dCorpse);
+		file.WriteGrid<int8_t>(dObject);
+		file.WriteGrid<int8_t>(dLight);
+		file.WriteGrid<int8_t>(dPreLight);
+		file.WriteGrid<uint8_t>(AutomapView);
 	}
 
 	file.WriteBE<int32_t>(numpremium);
@@ -2082,13 +2108,12 @@ void SaveLevel()
 
 	char szName[MAX_PATH];
 	GetTempLevelNames(szName);
-	SaveHelper file(szName, 256 * 1024);
+	SaveHelper file(szName, 64 * 1024);
+
+	file.WriteFormatHeader();
 
 	if (leveltype != DTYPE_TOWN) {
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dCorpse[i][j]);
-		}
+		file.WriteGrid<int8_t>(dCorpse);
 	}
 
 	file.WriteBE<int32_t>(ActiveMonsterCount);
@@ -2116,36 +2141,15 @@ void SaveLevel()
 	for (int i = 0; i < ActiveItemCount; i++)
 		SaveItem(file, Items[ActiveItems[i]]);
 
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			file.WriteLE<int8_t>(dFlags[i][j] & ~(BFLAG_MISSILE | BFLAG_VISIBLE | BFLAG_DEAD_PLAYER));
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			file.WriteLE<int8_t>(dItem[i][j]);
-	}
+	file.WriteGrid<int8_t>(dFlags, [](int8_t flags) { return flags & ~(BFLAG_MISSILE | BFLAG_VISIBLE | BFLAG_DEAD_PLAYER); });
+	file.WriteGrid<int8_t>(dItem);
 
 	if (leveltype != DTYPE_TOWN) {
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteBE<int32_t>(dMonster[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dObject[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dLight[i][j]);
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<int8_t>(dPreLight[i][j]);
-		}
-		for (int j = 0; j < DMAXY; j++) {
-			for (int i = 0; i < DMAXX; i++) // NOLINT(modernize-loop-convert)
-				file.WriteLE<uint8_t>(AutomapView[i][j]);
-		}
+		file.WriteGrid<int32_t>(dMonster);
+		file.WriteGrid<int8_t>(dObject);
+		file.WriteGrid<int8_t>(dLight);
+		file.WriteGrid<int8_t>(dPreLight);
+		file.WriteGrid<uint8_t>(AutomapView);
 	}
 
 	if (!setlevel)
@@ -2161,12 +2165,11 @@ void LoadLevel()
 	LoadHelper file(szName);
 	if (!file.IsValid())
 		app_fatal("%s", _("Unable to open save file archive"));
+	if (!file.NextFormatHeader())
+		app_fatal("%s", _("Invalid save file"));
 
 	if (leveltype != DTYPE_TOWN) {
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dCorpse[i][j] = file.NextLE<int8_t>();
-		}
+		file.NextGrid<int8_t>(dCorpse);
 		SyncUniqDead();
 	}
 
@@ -2198,38 +2201,15 @@ void LoadLevel()
 	for (int i = 0; i < ActiveItemCount; i++)
 		LoadItem(file, Items[ActiveItems[i]]);
 
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			dFlags[i][j] = file.NextLE<int8_t>() & ~(BFLAG_PLAYERLR | BFLAG_MONSTLR);
-	}
-	for (int j = 0; j < MAXDUNY; j++) {
-		for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-			dItem[i][j] = file.NextLE<int8_t>();
-	}
+	file.NextGrid<int8_t>(dFlags, [](int8_t flags) { return flags & ~(BFLAG_PLAYERLR | BFLAG_MONSTLR); });
+	file.NextGrid<int8_t>(dItem);
 
 	if (leveltype != DTYPE_TOWN) {
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dMonster[i][j] = file.NextBE<int32_t>();
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dObject[i][j] = file.NextLE<int8_t>();
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dLight[i][j] = file.NextLE<int8_t>();
-		}
-		for (int j = 0; j < MAXDUNY; j++) {
-			for (int i = 0; i < MAXDUNX; i++) // NOLINT(modernize-loop-convert)
-				dPreLight[i][j] = file.NextLE<int8_t>();
-		}
-		for (int j = 0; j < DMAXY; j++) {
-			for (int i = 0; i < DMAXX; i++) { // NOLINT(modernize-loop-convert)
-				uint8_t automapView = file.NextLE<uint8_t>();
-				AutomapView[i][j] = automapView == MAP_EXP_OLD ? MAP_EXP_SELF : automapView;
-			}
-		}
+		file.NextGrid<int32_t>(dMonster);
+		file.NextGrid<int8_t>(dObject);
+		file.NextGrid<int8_t>(dLight);
+		file.NextGrid<int8_t>(dPreLight);
+		file.NextGrid<uint8_t>(AutomapView, [](uint8_t automapView) { return automapView == MAP_EXP_OLD ? MAP_EXP_SELF : automapView; });
 	}
 
 	if (gbIsHellfireSaveGame != gbIsHellfire) {
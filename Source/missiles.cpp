@@ -22,6 +22,7 @@
 #include "monster.h"
 #include "spells.h"
 #include "trigs.h"
+#include "utils/profiler.hpp"
 
 namespace devilution {
 
@@ -4234,6 +4235,7 @@ void ProcessManaShield()
 
 void ProcessMissiles()
 {
+	DVL_PROFILE_SCOPE("ProcessMissiles");
 	for (int i = 0; i < ActiveMissileCount; i++) {
 		auto &missile = Missiles[ActiveMissiles[i]];
 		const auto &position = missile.position.tile;
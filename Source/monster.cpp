@@ -32,6 +32,7 @@
 #include "towners.h"
 #include "trigs.h"
 #include "utils/language.h"
+#include "utils/profiler.hpp"
 
 #ifdef _DEBUG
 #include "debug.h"
@@ -4300,6 +4301,7 @@ void DeleteMonsterList()
 
 void ProcessMonsters()
 {
+	DVL_PROFILE_SCOPE("ProcessMonsters");
 	DeleteMonsterList();
 
 	assert(ActiveMonsterCount >= 0 && ActiveMonsterCount <= MAXMONSTERS);
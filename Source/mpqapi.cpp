@@ -5,6 +5,8 @@
  */
 #include "mpqapi.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
@@ -12,6 +14,8 @@
 #include <fstream>
 #include <memory>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include "appfat.h"
 #include "encrypt.h"
@@ -19,6 +23,7 @@
 #include "utils/endian.hpp"
 #include "utils/file_util.h"
 #include "utils/log.hpp"
+#include "utils/sdl_thread.h"
 
 namespace devilution {
 
@@ -165,6 +170,8 @@ struct Archive {
 	std::uintmax_t size;
 	bool modified;
 	bool exists;
+	/** Whether `stream` refers to the temporary copy rather than the original archive. */
+	bool writable;
 
 #ifndef CAN_SEEKP_BEYOND_EOF
 	std::streampos stream_begin;
@@ -173,47 +180,121 @@ struct Archive {
 	_HASHENTRY *sgpHashTbl;
 	_BLOCKENTRY *sgpBlockTbl;
 
+	/** Identifies the contents of a file written by `mpqapi_write_file`. */
+	struct WrittenFile {
+		uint32_t offset;
+		uint32_t sizefile;
+		uint64_t contentHash;
+	};
+
+	/**
+	 * Files written to this archive during the session, see `mpqapi_has_unchanged_file`.
+	 * Kept across `Close` so that it survives the tables being freed.
+	 */
+	std::unordered_map<std::string, WrittenFile> writtenFiles;
+	std::string writtenFilesArchive;
+
 	bool Open(const char *path)
 	{
 		Close();
 		LogDebug("Opening {}", path);
 		exists = FileExists(path);
-		std::ios::openmode mode = std::ios::in | std::ios::out | std::ios::binary;
+		if (!exists || writtenFilesArchive != path) {
+			writtenFiles.clear();
+			writtenFilesArchive = path;
+		}
+		writable = false;
 		if (exists) {
 			if (!GetFileSize(path, &size)) {
 				Log(R"(GetFileSize("{}") failed with "{}")", path, std::strerror(errno));
 				return false;
 			}
 			LogDebug("GetFileSize(\"{}\") = {}", path, size);
+			if (!stream.Open(path, std::ios::in | std::ios::binary)) {
+				stream.Close();
+				return false;
+			}
+		}
+		modified = !exists;
+
+		name = path;
+		return true;
+	}
+
+	/**
+	 * @brief Switches the stream over to a temporary copy of the archive.
+	 *
+	 * All modifications go to the copy, which only replaces the original archive
+	 * once it has been written out completely in `Close`.
+	 */
+	bool PrepareForWrite()
+	{
+		if (writable)
+			return true;
+
+		stream.Close();
+		const std::string tmpPath = TempPath();
+		std::ios::openmode mode = std::ios::in | std::ios::out | std::ios::binary;
+		if (exists) {
+			LogDebug("CopyFileOverwrite(\"{}\", \"{}\")", name, tmpPath);
+			if (!CopyFileOverwrite(name.c_str(), tmpPath.c_str())) {
+				LogError(R"(CopyFileOverwrite("{}", "{}") failed with "{}")", name, tmpPath, std::strerror(errno));
+				return false;
+			}
 		} else {
 			mode |= std::ios::trunc;
 		}
-		if (!stream.Open(path, mode)) {
+		if (!stream.Open(tmpPath.c_str(), mode)) {
 			stream.Close();
 			return false;
 		}
-		modified = !exists;
+		writable = true;
 
-		name = path;
+#ifndef CAN_SEEKP_BEYOND_EOF
+		if (!stream.Seekp(0, std::ios::beg))
+			return false;
+
+		// Memorize stream begin, we'll need it for calculations later.
+		if (!stream.Tellp(&stream_begin))
+			return false;
+
+		// Write garbage header and tables because some platforms cannot `Seekp` beyond EOF.
+		// The data is incorrect at this point, it will be overwritten on Close.
+		if (!exists && !WriteHeaderAndTables())
+			return false;
+#endif
 		return true;
 	}
 
 	bool Close(bool clearTables = true)
 	{
-		if (!stream.IsOpen())
+		if (name.empty())
 			return true;
 		LogDebug("Closing {}", name);
 
 		bool result = true;
-		if (modified && !(stream.Seekp(0, std::ios::beg) && WriteHeaderAndTables()))
+		if (modified && !(PrepareForWrite() && stream.Seekp(0, std::ios::beg) && WriteHeaderAndTables()))
 			result = false;
 		stream.Close();
-		if (modified && result && size != 0) {
-			LogDebug("ResizeFile(\"{}\", {})", name, size);
-			result = ResizeFile(name.c_str(), size);
+		if (writable) {
+			const std::string tmpPath = TempPath();
+			if (result && size != 0) {
+				LogDebug("ResizeFile(\"{}\", {})", tmpPath, size);
+				result = ResizeFile(tmpPath.c_str(), size);
+			}
+			if (result) {
+				LogDebug("RenameFile(\"{}\", \"{}\")", tmpPath, name);
+				result = RenameFile(tmpPath.c_str(), name.c_str());
+			}
+			if (!result)
+				RemoveFile(tmpPath.c_str());
 		}
 		name.clear();
-		if (clearTables) {
+		writable = false;
+		if (!result)
+			writtenFiles.clear();
+		// The tables no longer match the archive on disk if writing failed.
+		if (clearTables || !result) {
 			delete[] sgpHashTbl;
 			sgpHashTbl = nullptr;
 			delete[] sgpBlockTbl;
@@ -233,6 +314,11 @@ struct Archive {
 	}
 
 private:
+	[[nodiscard]] std::string TempPath() const
+	{
+		return name + ".tmp";
+	}
+
 	bool WriteHeader()
 	{
 		_FILEHEADER fhdr;
@@ -470,6 +556,75 @@ _BLOCKENTRY *AddFile(const char *pszName, _BLOCKENTRY *pBlk, int blockIndex)
 	return pBlk;
 }
 
+constexpr size_t SectorSize = 4096;
+
+/** Upper bound on the number of threads compressing the sectors of a single file. */
+constexpr int MaxCompressionThreads = 4;
+
+/** Minimum number of sectors each thread should get to be worth the cost of starting it. */
+constexpr uint32_t MinSectorsPerThread = 8;
+
+/**
+ * @brief Work shared between all threads compressing the sectors of one file.
+ *
+ * Threads claim sectors one at a time, so they are kept busy even if some sectors compress slower than others.
+ */
+struct SectorCompressor {
+	const byte *data;
+	size_t dataLen;
+	/** Sector slots, each SectorSize bytes. Receive the compressed sector, or the original data if it doesn't compress. */
+	byte *sectors;
+	uint32_t numSectors;
+	uint32_t *compressedSizes;
+	std::atomic<uint32_t> nextSector { 0 };
+
+	SectorCompressor(const byte *data, size_t dataLen, byte *sectors, uint32_t numSectors, uint32_t *compressedSizes)
+	    : data(data)
+	    , dataLen(dataLen)
+	    , sectors(sectors)
+	    , numSectors(numSectors)
+	    , compressedSizes(compressedSizes)
+	{
+	}
+
+	void Run()
+	{
+		PkwareWorkBuffer work;
+		for (uint32_t i = nextSector++; i < numSectors; i = nextSector++) {
+			const size_t offset = i * SectorSize;
+			const auto len = static_cast<uint32_t>(std::min(dataLen - offset, SectorSize));
+			uint32_t compressedSize = PkwareCompress(&data[offset], len, &sectors[offset], len, work);
+			if (compressedSize == 0) {
+				memcpy(&sectors[offset], &data[offset], len);
+				compressedSize = len;
+			}
+			compressedSizes[i] = compressedSize;
+		}
+	}
+};
+
+int SDLCALL CompressSectorsThread(void *data)
+{
+	static_cast<SectorCompressor *>(data)->Run();
+	return 0;
+}
+
+void CompressSectors(SectorCompressor &compressor)
+{
+	const int numThreads = std::min({ SDL_GetCPUCount(), MaxCompressionThreads, static_cast<int>(compressor.numSectors / MinSectorsPerThread) });
+
+	std::vector<SdlThread> helpers;
+	if (numThreads > 1)
+		helpers.reserve(numThreads - 1);
+	for (int i = 1; i < numThreads; i++)
+		helpers.emplace_back(CompressSectorsThread, &compressor);
+
+	compressor.Run();
+
+	for (SdlThread &helper : helpers)
+		helper.join();
+}
+
 bool WriteFileContents(const char *pszName, const byte *pbData, size_t dwLen, _BLOCKENTRY *pBlk)
 {
 	const char *tmp;
@@ -479,20 +634,37 @@ bool WriteFileContents(const char *pszName, const byte *pbData, size_t dwLen, _B
 		pszName = tmp + 1;
 	Hash(pszName, 3);
 
-	constexpr size_t SectorSize = 4096;
+	if (!cur_archive.PrepareForWrite())
+		return false;
+
 	const uint32_t numSectors = (dwLen + (SectorSize - 1)) / SectorSize;
 	const uint32_t offsetTableByteSize = sizeof(uint32_t) * (numSectors + 1);
 	pBlk->offset = FindFreeBlock(dwLen + offsetTableByteSize, &pBlk->sizealloc);
 	pBlk->sizefile = dwLen;
 	pBlk->flags = 0x80000100;
 
-	// We populate the table of sector offset while we write the data.
-	// We can't pre-populate it because we don't know the compressed sector sizes yet.
+	// Each sector is compressed in its own slot of the staging buffer. The compressed sectors are
+	// then packed behind the sector offset table so that the whole block is written in one go.
+	std::unique_ptr<byte[]> staging { new byte[offsetTableByteSize + numSectors * SectorSize] };
+	std::unique_ptr<uint32_t[]> compressedSizes { new uint32_t[numSectors] };
+
+	SectorCompressor compressor { pbData, dwLen, &staging[offsetTableByteSize], numSectors, compressedSizes.get() };
+	CompressSectors(compressor);
+
 	// First offset is the start of the first sector, last offset is the end of the last sector.
 	std::unique_ptr<uint32_t[]> sectoroffsettable { new uint32_t[numSectors + 1] };
+	uint32_t destsize = offsetTableByteSize;
+	for (uint32_t i = 0; i < numSectors; i++) {
+		sectoroffsettable[i] = SDL_SwapLE32(destsize);
+		// Compressed sectors are never larger than their slot, so this only ever moves data towards the front.
+		memmove(&staging[destsize], &staging[offsetTableByteSize + i * SectorSize], compressedSizes[i]);
+		destsize += compressedSizes[i];
+	}
+	sectoroffsettable[numSectors] = SDL_SwapLE32(destsize);
+	memcpy(staging.get(), sectoroffsettable.get(), offsetTableByteSize);
 
 #ifdef CAN_SEEKP_BEYOND_EOF
-	if (!cur_archive.stream.Seekp(pBlk->offset + offsetTableByteSize, std::ios::beg))
+	if (!cur_archive.stream.Seekp(pBlk->offset, std::ios::beg))
 		return false;
 #else
 	// Ensure we do not Seekp beyond EOF by filling the missing space.
@@ -500,44 +672,17 @@ bool WriteFileContents(const char *pszName, const byte *pbData, size_t dwLen, _B
 	if (!cur_archive.stream.Seekp(0, std::ios::end) || !cur_archive.stream.Tellp(&stream_end))
 		return false;
 	const std::uintmax_t cur_size = stream_end - cur_archive.stream_begin;
-	if (cur_size < pBlk->offset + offsetTableByteSize) {
-		if (cur_size < pBlk->offset) {
-			std::unique_ptr<char[]> filler { new char[pBlk->offset - cur_size] };
-			if (!cur_archive.stream.Write(filler.get(), pBlk->offset - cur_size))
-				return false;
-		}
-		if (!cur_archive.stream.Write(reinterpret_cast<const char *>(sectoroffsettable.get()), offsetTableByteSize))
+	if (cur_size < pBlk->offset) {
+		std::unique_ptr<char[]> filler { new char[pBlk->offset - cur_size] };
+		if (!cur_archive.stream.Write(filler.get(), pBlk->offset - cur_size))
 			return false;
 	} else {
-		if (!cur_archive.stream.Seekp(pBlk->offset + offsetTableByteSize, std::ios::beg))
+		if (!cur_archive.stream.Seekp(pBlk->offset, std::ios::beg))
 			return false;
 	}
 #endif
 
-	uint32_t destsize = offsetTableByteSize;
-	byte mpqBuf[SectorSize];
-	std::size_t curSector = 0;
-	while (true) {
-		uint32_t len = std::min(dwLen, SectorSize);
-		memcpy(mpqBuf, pbData, len);
-		pbData += len;
-		len = PkwareCompress(mpqBuf, len);
-		if (!cur_archive.stream.Write((char *)mpqBuf, len))
-			return false;
-		sectoroffsettable[curSector++] = SDL_SwapLE32(destsize);
-		destsize += len; // compressed length
-		if (dwLen > SectorSize)
-			dwLen -= SectorSize;
-		else
-			break;
-	}
-
-	sectoroffsettable[numSectors] = SDL_SwapLE32(destsize);
-	if (!cur_archive.stream.Seekp(pBlk->offset, std::ios::beg))
-		return false;
-	if (!cur_archive.stream.Write(reinterpret_cast<const char *>(sectoroffsettable.get()), offsetTableByteSize))
-		return false;
-	if (!cur_archive.stream.Seekp(destsize - offsetTableByteSize, std::ios::cur))
+	if (!cur_archive.stream.Write(reinterpret_cast<const char *>(staging.get()), destsize))
 		return false;
 
 	if (destsize < pBlk->sizealloc) {
@@ -554,6 +699,7 @@ bool WriteFileContents(const char *pszName, const byte *pbData, size_t dwLen, _B
 
 void mpqapi_remove_hash_entry(const char *pszName)
 {
+	cur_archive.writtenFiles.erase(pszName);
 	int hIdx = FetchHandle(pszName);
 	if (hIdx == -1) {
 		return;
@@ -592,6 +738,31 @@ bool mpqapi_write_file(const char *pszName, const byte *pbData, size_t dwLen)
 	return true;
 }
 
+bool mpqapi_write_file(const char *pszName, const byte *pbData, size_t dwLen, uint64_t contentHash)
+{
+	if (!mpqapi_write_file(pszName, pbData, dwLen))
+		return false;
+
+	const _BLOCKENTRY &blockEntry = cur_archive.sgpBlockTbl[cur_archive.sgpHashTbl[FetchHandle(pszName)].block];
+	cur_archive.writtenFiles[pszName] = { blockEntry.offset, blockEntry.sizefile, contentHash };
+	return true;
+}
+
+bool mpqapi_has_unchanged_file(const char *pszName, uint64_t contentHash)
+{
+	const auto it = cur_archive.writtenFiles.find(pszName);
+	if (it == cur_archive.writtenFiles.end() || it->second.contentHash != contentHash)
+		return false;
+
+	const int hIdx = FetchHandle(pszName);
+	if (hIdx == -1)
+		return false;
+
+	// Make sure the file wasn't replaced behind our back, e.g. by a rename.
+	const _BLOCKENTRY &blockEntry = cur_archive.sgpBlockTbl[cur_archive.sgpHashTbl[hIdx].block];
+	return blockEntry.offset == it->second.offset && blockEntry.sizefile == it->second.sizefile;
+}
+
 void mpqapi_rename(char *pszOld, char *pszNew)
 {
 	int index = FetchHandle(pszOld);
@@ -599,6 +770,13 @@ void mpqapi_rename(char *pszOld, char *pszNew)
 		return;
 	}
 
+	cur_archive.writtenFiles.erase(pszNew);
+	const auto written = cur_archive.writtenFiles.find(pszOld);
+	if (written != cur_archive.writtenFiles.end()) {
+		const Archive::WrittenFile writtenFile = written->second;
+		cur_archive.writtenFiles.erase(written);
+		cur_archive.writtenFiles[pszNew] = writtenFile;
+	}
 	_HASHENTRY *hashEntry = &cur_archive.sgpHashTbl[index];
 	int block = hashEntry->block;
 	_BLOCKENTRY *blockEntry = &cur_archive.sgpBlockTbl[block];
@@ -642,19 +820,6 @@ bool OpenMPQ(const char *pszArchive)
 			Decrypt((DWORD *)cur_archive.sgpHashTbl, HashEntrySize, key);
 		}
 
-#ifndef CAN_SEEKP_BEYOND_EOF
-		if (!cur_archive.stream.Seekp(0, std::ios::beg))
-			goto on_error;
-
-		// Memorize stream begin, we'll need it for calculations later.
-		if (!cur_archive.stream.Tellp(&cur_archive.stream_begin))
-			goto on_error;
-
-		// Write garbage header and tables because some platforms cannot `Seekp` beyond EOF.
-		// The data is incorrect at this point, it will be overwritten on Close.
-		if (!cur_archive.exists)
-			cur_archive.WriteHeaderAndTables();
-#endif
 	}
 	return true;
 on_error:
@@ -40,6 +40,20 @@ struct _BLOCKENTRY {
 void mpqapi_remove_hash_entry(const char *pszName);
 void mpqapi_remove_hash_entries(bool (*fnGetName)(uint8_t, char *));
 bool mpqapi_write_file(const char *pszName, const byte *pbData, size_t dwLen);
+
+/**
+ * @brief Writes a file and remembers the hash of its unencoded contents.
+ * @see mpqapi_has_unchanged_file
+ */
+bool mpqapi_write_file(const char *pszName, const byte *pbData, size_t dwLen, uint64_t contentHash);
+
+/**
+ * @brief Checks whether the archive still holds the file as it was last written during this session.
+ * @param pszName File name
+ * @param contentHash Hash of the unencoded contents that would be written
+ * @return True if writing the file again can be skipped
+ */
+bool mpqapi_has_unchanged_file(const char *pszName, uint64_t contentHash);
 void mpqapi_rename(char *pszOld, char *pszNew);
 bool mpqapi_has_file(const char *pszName);
 bool OpenMPQ(const char *pszArchive);
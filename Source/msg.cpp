@@ -5,12 +5,13 @@
  */
 #include <climits>
 #include <memory>
+#include <vector>
 
 #include <fmt/format.h>
-#include <list>
 
 #include "DiabloUI/diabloui.h"
 #include "automap.h"
+#include "cmdbatch.h"
 #include "control.h"
 #include "dead.h"
 #include "drlg_l1.h"
@@ -25,6 +26,7 @@
 #include "pfile.h"
 #include "plrmsg.h"
 #include "spells.h"
+#include "statehash.h"
 #include "storm/storm.h"
 #include "sync.h"
 #include "town.h"
@@ -41,112 +43,140 @@ int dwRecCount;
 
 namespace {
 
-struct TMegaPkt {
-	uint32_t spaceLeft;
-	byte data[32000];
+/**
+ * @brief Commands received while the level is loading, replayed in order once it is ready
+ *
+ * The commands are stored back to back with an index of where each one starts, so replaying
+ * them doesn't need to know the size of a command up front.
+ */
+class CommandArena {
+public:
+	void Reserve(size_t size)
+	{
+		data_.reserve(size);
+		index_.reserve(size / sizeof(TCmdLoc));
+	}
 
-	TMegaPkt()
-	    : spaceLeft(sizeof(data))
+	void Append(uint8_t playerId, const void *cmd, size_t size)
 	{
+		const auto *src = static_cast<const byte *>(cmd);
+		index_.push_back({ playerId, static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(size) });
+		data_.insert(data_.end(), src, src + size);
 	}
+
+	/** @brief Calls fn(playerId, cmd, size) for every command until it returns false */
+	template <typename Fn>
+	void ForEach(Fn fn) const
+	{
+		for (const Entry &entry : index_) {
+			if (!fn(entry.playerId, &data_[entry.offset], entry.size))
+				return;
+		}
+	}
+
+	/** @brief Drops all commands and releases the memory */
+	void Reset()
+	{
+		data_ = {};
+		index_ = {};
+	}
+
+private:
+	struct Entry {
+		uint8_t playerId;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	std::vector<byte> data_;
+	std::vector<Entry> index_;
 };
 
-#define MAX_CHUNKS (NUMLEVELS + 4)
+/** Largest amount of delta data compressed as one chunk */
+constexpr size_t DeltaChunkSize = 2048;
+
+enum DeltaSection : uint8_t {
+	DeltaSectionItems,
+	DeltaSectionObjects,
+	DeltaSectionMonsters,
+};
+
+enum class DeltaTransfer : uint8_t {
+	WaitForOwner,
+	Receiving,
+	Received,
+	Done,
+};
 
 uint32_t sgdwOwnerWait;
+/** Bytes received of the chunk currently being reassembled */
 uint32_t sgdwRecvOffset;
-int sgnCurrMegaPlayer;
 DLevel sgLevels[NUMLEVELS];
 BYTE sbLastCmd;
-byte sgRecvBuf[sizeof(DLevel) + 1];
+byte sgRecvBuf[sizeof(TDeltaChunk) + DeltaChunkSize];
+/** Command of the chunk currently being reassembled, CMD_DLEVEL_END if there is none */
 _cmd_id sgbRecvCmd;
 LocalLevel sgLocals[NUMLEVELS];
 DJunk sgJunk;
 bool sgbDeltaChanged;
-BYTE sgbDeltaChunks;
-std::list<TMegaPkt> MegaPktList;
+DeltaTransfer sgDeltaTransfer;
+uint32_t sgdwDeltaBytesReceived;
+uint32_t sgdwDeltaBytesTotal;
+CommandArena BufferedCommands;
+/** Scratch memory for compressing and decompressing level deltas. */
+PkwareWorkBuffer sgPkwareWork;
 
 void GetNextPacket()
 {
-	MegaPktList.emplace_back();
+	// Roughly what a level load buffers in a busy game
+	BufferedCommands.Reserve(32000);
 }
 
 void FreePackets()
 {
-	MegaPktList.clear();
+	BufferedCommands.Reset();
 }
 
 void PrePacket()
 {
-	uint8_t playerId = std::numeric_limits<uint8_t>::max();
-	for (TMegaPkt &pkt : MegaPktList) {
-		byte *data = pkt.data;
-		size_t spaceLeft = sizeof(pkt.data);
-		while (spaceLeft != pkt.spaceLeft) {
-			auto cmdId = static_cast<_cmd_id>(*data);
-
-			if (cmdId == FAKE_CMD_SETID) {
-				auto *cmd = (TFakeCmdPlr *)data;
-				data += sizeof(*cmd);
-				spaceLeft -= sizeof(*cmd);
-				playerId = cmd->bPlr;
-				continue;
-			}
+	BufferedCommands.ForEach([](uint8_t playerId, const byte *data, uint32_t size) {
+		auto cmdId = static_cast<_cmd_id>(*data);
 
-			if (cmdId == FAKE_CMD_DROPID) {
-				auto *cmd = (TFakeDropPlr *)data;
-				data += sizeof(*cmd);
-				spaceLeft -= sizeof(*cmd);
-				multi_player_left(cmd->bPlr, cmd->dwReason);
-				continue;
-			}
+		if (cmdId == FAKE_CMD_DROPID) {
+			const auto *cmd = reinterpret_cast<const TFakeDropPlr *>(data);
+			multi_player_left(cmd->bPlr, cmd->dwReason);
+			return true;
+		}
 
-			if (playerId >= MAX_PLRS) {
-				Log("Missing source of network message");
-				return;
-			}
+		if (playerId >= MAX_PLRS) {
+			Log("Missing source of network message");
+			return false;
+		}
 
-			uint32_t size = ParseCmd(playerId, (TCmd *)data);
-			if (size == 0) {
-				Log("Discarding bad network message");
-				return;
-			}
-			uint32_t pktSize = size;
-			data += pktSize;
-			spaceLeft -= pktSize;
+		if (ParseCmd(playerId, reinterpret_cast<const TCmd *>(data)) == 0) {
+			Log("Discarding bad network message");
+			return false;
 		}
-	}
+		return true;
+	});
 }
 
 void SendPacket(int pnum, const void *packet, DWORD dwSize)
 {
-	TFakeCmdPlr cmd;
-
-	if (pnum != sgnCurrMegaPlayer) {
-		sgnCurrMegaPlayer = pnum;
-		cmd.bCmd = FAKE_CMD_SETID;
-		cmd.bPlr = pnum;
-		SendPacket(pnum, &cmd, sizeof(cmd));
-	}
-	if (MegaPktList.back().spaceLeft < dwSize)
-		GetNextPacket();
-
-	TMegaPkt &currMegaPkt = MegaPktList.back();
-	memcpy(currMegaPkt.data + sizeof(currMegaPkt.data) - currMegaPkt.spaceLeft, packet, dwSize);
-	currMegaPkt.spaceLeft -= dwSize;
+	BufferedCommands.Append(pnum, packet, dwSize);
 }
 
 int WaitForTurns()
 {
 	DWORD turns;
 
-	if (sgbDeltaChunks == 0) {
+	if (sgDeltaTransfer == DeltaTransfer::WaitForOwner) {
 		nthread_send_and_recv_turn(0, 0);
 		if (!SNetGetOwnerTurnsWaiting(&turns) && SErrGetLastError() == STORM_ERROR_NOT_IN_GAME)
 			return 100;
 		if (SDL_GetTicks() - sgdwOwnerWait <= 2000 && turns < gdwTurnsInTransit)
 			return 0;
-		sgbDeltaChunks++;
+		sgDeltaTransfer = DeltaTransfer::Receiving;
 	}
 	multi_process_network_packets();
 	nthread_send_and_recv_turn(0, 0);
@@ -157,21 +187,23 @@ int WaitForTurns()
 	if (gbGameDestroyed)
 		return 100;
 	if (gbDeltaSender >= MAX_PLRS) {
-		sgbDeltaChunks = 0;
+		sgDeltaTransfer = DeltaTransfer::WaitForOwner;
 		sgbRecvCmd = CMD_DLEVEL_END;
 		gbDeltaSender = MyPlayerId;
 		nthread_set_turn_upper_bit();
 	}
-	if (sgbDeltaChunks == MAX_CHUNKS - 1) {
-		sgbDeltaChunks = MAX_CHUNKS;
+	if (sgDeltaTransfer == DeltaTransfer::Received) {
+		sgDeltaTransfer = DeltaTransfer::Done;
 		return 99;
 	}
-	return 100 * sgbDeltaChunks / MAX_CHUNKS;
+	if (sgdwDeltaBytesTotal == 0)
+		return 1;
+	return 1 + 97 * std::min(sgdwDeltaBytesReceived, sgdwDeltaBytesTotal) / sgdwDeltaBytesTotal;
 }
 
-byte *DeltaExportItem(byte *dst, const TCmdPItem *src)
+byte *DeltaExportItem(byte *dst, const TCmdPItem *src, int count)
 {
-	for (int i = 0; i < MAXITEMS; i++, src++) {
+	for (int i = 0; i < count; i++, src++) {
 		if (src->bCmd == CMD_INVALID) {
 			*dst++ = byte { 0xFF };
 		} else {
@@ -183,10 +215,10 @@ byte *DeltaExportItem(byte *dst, const TCmdPItem *src)
 	return dst;
 }
 
-size_t DeltaImportItem(const byte *src, TCmdPItem *dst)
+size_t DeltaImportItem(const byte *src, TCmdPItem *dst, int count)
 {
 	size_t size = 0;
-	for (int i = 0; i < MAXITEMS; i++, dst++) {
+	for (int i = 0; i < count; i++, dst++) {
 		if (src[size] == byte { 0xFF }) {
 			memset(dst, 0xFF, sizeof(TCmdPItem));
 			size++;
@@ -199,21 +231,21 @@ size_t DeltaImportItem(const byte *src, TCmdPItem *dst)
 	return size;
 }
 
-byte *DeltaExportObject(byte *dst, const DObjectStr *src)
+byte *DeltaExportObject(byte *dst, const DObjectStr *src, int count)
 {
-	memcpy(dst, src, sizeof(DObjectStr) * MAXOBJECTS);
-	return dst + sizeof(DObjectStr) * MAXOBJECTS;
+	memcpy(dst, src, sizeof(DObjectStr) * count);
+	return dst + sizeof(DObjectStr) * count;
 }
 
-size_t DeltaImportObject(const byte *src, DObjectStr *dst)
+size_t DeltaImportObject(const byte *src, DObjectStr *dst, int count)
 {
-	memcpy(dst, src, sizeof(DObjectStr) * MAXOBJECTS);
-	return sizeof(DObjectStr) * MAXOBJECTS;
+	memcpy(dst, src, sizeof(DObjectStr) * count);
+	return sizeof(DObjectStr) * count;
 }
 
-byte *DeltaExportMonster(byte *dst, const DMonsterStr *src)
+byte *DeltaExportMonster(byte *dst, const DMonsterStr *src, int count)
 {
-	for (int i = 0; i < MAXMONSTERS; i++, src++) {
+	for (int i = 0; i < count; i++, src++) {
 		if (src->_mx == 0xFF) {
 			*dst++ = byte { 0xFF };
 		} else {
@@ -225,10 +257,10 @@ byte *DeltaExportMonster(byte *dst, const DMonsterStr *src)
 	return dst;
 }
 
-void DeltaImportMonster(const byte *src, DMonsterStr *dst)
+void DeltaImportMonster(const byte *src, DMonsterStr *dst, int count)
 {
 	size_t size = 0;
-	for (int i = 0; i < MAXMONSTERS; i++, dst++) {
+	for (int i = 0; i < count; i++, dst++) {
 		if (src[size] == byte { 0xFF }) {
 			memset(dst, 0xFF, sizeof(DMonsterStr));
 			size++;
@@ -298,75 +330,244 @@ void DeltaImportJunk(const byte *src)
 	}
 }
 
-DWORD CompressData(byte *buffer, byte *end)
+/**
+ * @brief Collects the level deltas as a series of small chunks that can be applied as they arrive
+ */
+class DeltaChunkWriter {
+public:
+	void AddLevel(int level)
+	{
+		const DLevel &delta = sgLevels[level];
+		const auto cmd = static_cast<_cmd_id>(CMD_DLEVEL_0 + level);
+		AddSection(cmd, DeltaSectionItems, MAXITEMS, sizeof(TCmdPItem), [&](int i) { return delta.item[i].bCmd == CMD_INVALID; },
+		    [&](byte *dst, int i) { return DeltaExportItem(dst, &delta.item[i], 1); });
+		AddSection(cmd, DeltaSectionObjects, MAXOBJECTS, sizeof(DObjectStr), [&](int i) { return delta.object[i].bCmd == CMD_INVALID; },
+		    [&](byte *dst, int i) { return DeltaExportObject(dst, &delta.object[i], 1); });
+		AddSection(cmd, DeltaSectionMonsters, MAXMONSTERS, sizeof(DMonsterStr), [&](int i) { return delta.monster[i]._mx == 0xFF; },
+		    [&](byte *dst, int i) { return DeltaExportMonster(dst, &delta.monster[i], 1); });
+	}
+
+	void AddJunk()
+	{
+		static_assert(sizeof(DJunk) <= DeltaChunkSize, "Junk must fit in a single chunk");
+		byte *end = DeltaExportJunk(raw_);
+		AddChunk(CMD_DLEVEL_JUNK, 0, 0, 0, end - raw_);
+	}
+
+	void Send(int pnum)
+	{
+		for (const Chunk &chunk : chunks_) {
+			auto *header = reinterpret_cast<TDeltaChunk *>(&data_[chunk.offset]);
+			header->dwTotal = static_cast<uint32_t>(data_.size());
+			multi_send_zero_packet(pnum, chunk.cmd, &data_[chunk.offset], chunk.size);
+		}
+	}
+
+private:
+	struct Chunk {
+		_cmd_id cmd;
+		size_t offset;
+		size_t size;
+	};
+
+	/**
+	 * @brief Splits a section of a level into chunks, leaving out runs of unused entries
+	 */
+	template <typename IsEmpty, typename Export>
+	void AddSection(_cmd_id cmd, DeltaSection section, int count, size_t maxEntrySize, IsEmpty isEmpty, Export exportEntry)
+	{
+		int first = -1;
+		byte *end = raw_;
+		for (int i = 0; i < count; i++) {
+			if (first == -1) {
+				if (isEmpty(i))
+					continue;
+				first = i;
+				end = raw_;
+			}
+			end = exportEntry(end, i);
+			if (static_cast<size_t>(end - raw_) + maxEntrySize > DeltaChunkSize || i - first == UINT8_MAX - 1) {
+				AddChunk(cmd, section, first, i - first + 1, end - raw_);
+				first = -1;
+			}
+		}
+		if (first != -1)
+			AddChunk(cmd, section, first, count - first, end - raw_);
+	}
+
+	void AddChunk(_cmd_id cmd, uint8_t section, int first, int count, size_t rawSize)
+	{
+		const size_t offset = data_.size();
+		data_.resize(offset + sizeof(TDeltaChunk) + rawSize);
+		byte *payload = &data_[offset + sizeof(TDeltaChunk)];
+		uint32_t size = PkwareCompress(raw_, rawSize, payload, rawSize, sgPkwareWork);
+		if (size == 0) {
+			memcpy(payload, raw_, rawSize);
+			size = rawSize;
+		}
+		data_.resize(offset + sizeof(TDeltaChunk) + size);
+
+		TDeltaChunk header {};
+		header.wIndex = static_cast<uint16_t>(chunks_.size());
+		header.wBytes = static_cast<uint16_t>(size);
+		header.bSection = section;
+		header.bFirst = first;
+		header.bCount = count;
+		header.bCompressed = size != rawSize ? 1 : 0;
+		memcpy(&data_[offset], &header, sizeof(header));
+		chunks_.push_back({ cmd, offset, data_.size() - offset });
+	}
+
+	byte raw_[DeltaChunkSize];
+	std::vector<byte> data_;
+	std::vector<Chunk> chunks_;
+};
+
+/**
+ * @brief Returns the size of entries exported with every unused one as a single 0xFF byte
+ * @return Bytes taken by the entries, more than size if they don't fit in it
+ */
+size_t DeltaEntriesSize(const byte *src, size_t size, size_t entrySize, int count)
 {
-	DWORD size = end - buffer - 1;
-	DWORD pkSize = PkwareCompress(buffer + 1, size);
+	size_t used = 0;
+	for (int i = 0; i < count; i++) {
+		if (used >= size)
+			return size + 1;
+		used += src[used] == byte { 0xFF } ? 1 : entrySize;
+	}
+	return used;
+}
 
-	*buffer = size != pkSize ? byte { 1 } : byte { 0 };
+size_t DeltaJunkSize(const byte *src, size_t size)
+{
+	size_t used = DeltaEntriesSize(src, size, sizeof(DPortal), MAXPORTAL);
+	for (auto &quest : Quests) {
+		if (!QuestsData[quest._qidx].isSinglePlayerOnly)
+			used += sizeof(MultiQuests);
+	}
+	return used;
+}
 
-	return pkSize + 1;
+/**
+ * @brief Checks that a received chunk holds all the entries it announces
+ */
+bool IsDeltaChunkComplete(_cmd_id cmd, const TDeltaChunk &chunk, const byte *src, size_t size)
+{
+	if (cmd == CMD_DLEVEL_JUNK)
+		return DeltaJunkSize(src, size) <= size;
+	if (cmd < CMD_DLEVEL_0 || cmd > CMD_DLEVEL_24) {
+		Log("Unknown level delta message type: {}", static_cast<int>(cmd));
+		return false;
+	}
+	const int first = chunk.bFirst;
+	const int count = chunk.bCount;
+	switch (chunk.bSection) {
+	case DeltaSectionItems:
+		return first + count <= MAXITEMS && DeltaEntriesSize(src, size, sizeof(TCmdPItem), count) <= size;
+	case DeltaSectionObjects:
+		return first + count <= MAXOBJECTS && sizeof(DObjectStr) * count <= size;
+	case DeltaSectionMonsters:
+		return first + count <= MAXMONSTERS && DeltaEntriesSize(src, size, sizeof(DMonsterStr), count) <= size;
+	default:
+		Log("Unknown level delta section: {}", chunk.bSection);
+		return false;
+	}
 }
 
-void DeltaImportData(_cmd_id cmd, DWORD recvOffset)
+void DeltaImportChunk(_cmd_id cmd)
 {
-	if (sgRecvBuf[0] != byte { 0 })
-		PkwareDecompress(&sgRecvBuf[1], recvOffset, sizeof(sgRecvBuf) - 1);
+	TDeltaChunk chunk;
+	memcpy(&chunk, sgRecvBuf, sizeof(chunk));
+	const byte *src = &sgRecvBuf[sizeof(chunk)];
+	size_t size = chunk.wBytes;
+	byte raw[DeltaChunkSize];
+	if (chunk.bCompressed != 0) {
+		size = PkwareDecompress(src, chunk.wBytes, raw, sizeof(raw), sgPkwareWork);
+		src = raw;
+	}
+	// The chunk comes from another player, drop it rather than read past its end
+	if (!IsDeltaChunkComplete(cmd, chunk, src, size)) {
+		Log("Dropping level delta chunk {} of {} bytes", chunk.wIndex, size);
+		return;
+	}
 
-	byte *src = &sgRecvBuf[1];
 	if (cmd == CMD_DLEVEL_JUNK) {
 		DeltaImportJunk(src);
-	} else if (cmd >= CMD_DLEVEL_0 && cmd <= CMD_DLEVEL_24) {
-		uint8_t i = cmd - CMD_DLEVEL_0;
-		src += DeltaImportItem(src, sgLevels[i].item);
-		src += DeltaImportObject(src, sgLevels[i].object);
-		DeltaImportMonster(src, sgLevels[i].monster);
 	} else {
-		app_fatal("Unkown network message type: %i", cmd);
+		DLevel &delta = sgLevels[cmd - CMD_DLEVEL_0];
+		const int first = chunk.bFirst;
+		const int count = chunk.bCount;
+		switch (chunk.bSection) {
+		case DeltaSectionItems:
+			DeltaImportItem(src, &delta.item[first], count);
+			break;
+		case DeltaSectionObjects:
+			DeltaImportObject(src, &delta.object[first], count);
+			break;
+		case DeltaSectionMonsters:
+			DeltaImportMonster(src, &delta.monster[first], count);
+			break;
+		}
 	}
 
-	sgbDeltaChunks++;
 	sgbDeltaChanged = true;
 }
 
+bool IsFirstDeltaChunk(const TCmdPlrInfoHdr &message)
+{
+	if (message.wOffset != 0 || message.wBytes < sizeof(TDeltaChunk))
+		return false;
+	TDeltaChunk chunk;
+	memcpy(&chunk, &message + 1, sizeof(chunk));
+	return chunk.wIndex == 0;
+}
+
 DWORD OnLevelData(int pnum, const TCmd *pCmd)
 {
 	const auto &message = *reinterpret_cast<const TCmdPlrInfoHdr *>(pCmd);
 
 	if (gbDeltaSender != pnum) {
-		if (message.bCmd != CMD_DLEVEL_END && (message.bCmd != CMD_DLEVEL_0 || message.wOffset != 0)) {
+		if (message.bCmd != CMD_DLEVEL_END && !IsFirstDeltaChunk(message)) {
 			return message.wBytes + sizeof(message);
 		}
 
 		gbDeltaSender = pnum;
 		sgbRecvCmd = CMD_DLEVEL_END;
+		sgdwDeltaBytesReceived = 0;
+		sgdwDeltaBytesTotal = 0;
 	}
 
-	if (sgbRecvCmd == CMD_DLEVEL_END) {
-		if (message.bCmd == CMD_DLEVEL_END) {
-			sgbDeltaChunks = MAX_CHUNKS - 1;
-			return message.wBytes + sizeof(message);
-		}
-		if (message.bCmd != CMD_DLEVEL_0 || message.wOffset != 0) {
-			return message.wBytes + sizeof(message);
-		}
+	if (message.bCmd == CMD_DLEVEL_END) {
+		sgDeltaTransfer = DeltaTransfer::Received;
+		sgbRecvCmd = CMD_DLEVEL_END;
+		return message.wBytes + sizeof(message);
+	}
 
+	if (message.wOffset == 0) {
 		sgdwRecvOffset = 0;
 		sgbRecvCmd = message.bCmd;
-	} else if (sgbRecvCmd != message.bCmd) {
-		DeltaImportData(sgbRecvCmd, sgdwRecvOffset);
-		if (message.bCmd == CMD_DLEVEL_END) {
-			sgbDeltaChunks = MAX_CHUNKS - 1;
-			sgbRecvCmd = CMD_DLEVEL_END;
-			return message.wBytes + sizeof(message);
-		}
-		sgdwRecvOffset = 0;
-		sgbRecvCmd = message.bCmd;
+	} else if (message.bCmd != sgbRecvCmd || message.wOffset != sgdwRecvOffset) {
+		return message.wBytes + sizeof(message);
 	}
 
-	assert(message.wOffset == sgdwRecvOffset);
-	memcpy(&sgRecvBuf[message.wOffset], &message + 1, message.wBytes);
+	if (sgdwRecvOffset + message.wBytes > sizeof(sgRecvBuf)) {
+		sgbRecvCmd = CMD_DLEVEL_END;
+		return message.wBytes + sizeof(message);
+	}
+	memcpy(&sgRecvBuf[sgdwRecvOffset], &message + 1, message.wBytes);
 	sgdwRecvOffset += message.wBytes;
+	sgdwDeltaBytesReceived += message.wBytes;
+
+	if (sgdwRecvOffset < sizeof(TDeltaChunk))
+		return message.wBytes + sizeof(message);
+	TDeltaChunk chunk;
+	memcpy(&chunk, sgRecvBuf, sizeof(chunk));
+	sgdwDeltaBytesTotal = chunk.dwTotal;
+	if (sgdwRecvOffset == sizeof(chunk) + chunk.wBytes) {
+		DeltaImportChunk(sgbRecvCmd);
+		sgbRecvCmd = CMD_DLEVEL_END;
+	}
+
 	return message.wBytes + sizeof(message);
 }
 
@@ -1933,6 +2134,43 @@ DWORD OnOpenCrypt(const TCmd *pCmd)
 	return sizeof(*pCmd);
 }
 
+DWORD OnStateHash(const TCmd *pCmd, int pnum)
+{
+	const auto &message = *reinterpret_cast<const TCmdStateHash *>(pCmd);
+
+	// Hashes that arrive while loading a level are stale by the time the level runs
+	if (gbBufferMsgs != 1 && pnum != MyPlayerId) {
+		StateHashes hashes;
+		memcpy(hashes.data(), message.dwHashes, sizeof(message.dwHashes));
+		ReceiveStateHash(pnum, message.dwTick, message.bLevel, hashes);
+	}
+
+	return sizeof(message);
+}
+
+DWORD OnCommandBatch(const TCmd *pCmd, int pnum)
+{
+	const auto &message = *reinterpret_cast<const TCmdBatch *>(pCmd);
+	const byte *data = reinterpret_cast<const byte *>(&message) + sizeof(message);
+	size_t remaining = message.wBytes;
+
+	while (remaining > 0) {
+		byte cmd[MaxQueuedCommandSize];
+		size_t cmdSize;
+		size_t packedSize = UnpackCommand(data, remaining, cmd, cmdSize);
+		if (packedSize == 0) {
+			SNetDropPlayer(pnum, LEAVE_DROP);
+			return 0;
+		}
+		if (ParseCmd(pnum, reinterpret_cast<const TCmd *>(cmd)) == 0)
+			return 0;
+		data += packedSize;
+		remaining -= packedSize;
+	}
+
+	return sizeof(message) + message.wBytes;
+}
+
 } // namespace
 
 void msg_send_drop_pkt(int pnum, int reason)
@@ -1950,8 +2188,9 @@ bool msg_wait_resync()
 	bool success;
 
 	GetNextPacket();
-	sgbDeltaChunks = 0;
-	sgnCurrMegaPlayer = -1;
+	sgDeltaTransfer = DeltaTransfer::WaitForOwner;
+	sgdwDeltaBytesReceived = 0;
+	sgdwDeltaBytesTotal = 0;
 	sgbRecvCmd = CMD_DLEVEL_END;
 	gbBufferMsgs = 1;
 	sgdwOwnerWait = SDL_GetTicks();
@@ -1968,7 +2207,7 @@ bool msg_wait_resync()
 		return false;
 	}
 
-	if (sgbDeltaChunks != MAX_CHUNKS) {
+	if (sgDeltaTransfer != DeltaTransfer::Done) {
 		DrawDlg("%s", _("Unable to get level data"));
 		FreePackets();
 		return false;
@@ -1977,6 +2216,13 @@ bool msg_wait_resync()
 	return true;
 }
 
+/** Ends msg_wait_resync when no other player is left that could send the level data */
+void msg_skip_resync()
+{
+	if (sgDeltaTransfer == DeltaTransfer::WaitForOwner || sgDeltaTransfer == DeltaTransfer::Receiving)
+		sgDeltaTransfer = DeltaTransfer::Received;
+}
+
 void run_delta_info()
 {
 	if (!gbIsMultiplayer)
@@ -1991,21 +2237,17 @@ void run_delta_info()
 void DeltaExportData(int pnum)
 {
 	if (sgbDeltaChanged) {
+		// Send the level the player is on first, followed by the rest of the levels that were visited
+		const Player &player = Players[pnum];
+		const int playerLevel = player.plractive && player.plrlevel < NUMLEVELS ? player.plrlevel : 0;
+		auto writer = std::make_unique<DeltaChunkWriter>();
+		writer->AddLevel(playerLevel);
 		for (int i = 0; i < NUMLEVELS; i++) {
-			std::unique_ptr<byte[]> dst { new byte[sizeof(DLevel) + 1] };
-			byte *dstEnd = &dst.get()[1];
-			dstEnd = DeltaExportItem(dstEnd, sgLevels[i].item);
-			dstEnd = DeltaExportObject(dstEnd, sgLevels[i].object);
-			dstEnd = DeltaExportMonster(dstEnd, sgLevels[i].monster);
-			int size = CompressData(dst.get(), dstEnd);
-			multi_send_zero_packet(pnum, static_cast<_cmd_id>(i + CMD_DLEVEL_0), dst.get(), size);
+			if (i != playerLevel)
+				writer->AddLevel(i);
 		}
-
-		byte dst[sizeof(DJunk) + 1];
-		byte *dstEnd = &dst[1];
-		dstEnd = DeltaExportJunk(dstEnd);
-		uint32_t size = CompressData(dst, dstEnd);
-		multi_send_zero_packet(pnum, CMD_DLEVEL_JUNK, dst, size);
+		writer->AddJunk();
+		writer->Send(pnum);
 	}
 
 	byte src[1] = { static_cast<byte>(0) };
@@ -2824,6 +3066,10 @@ uint32_t ParseCmd(int pnum, const TCmd *pCmd)
 		return OnOpenHive(pCmd, pnum);
 	case CMD_OPENCRYPT:
 		return OnOpenCrypt(pCmd);
+	case CMD_STATEHASH:
+		return OnStateHash(pCmd, pnum);
+	case CMD_BATCH:
+		return OnCommandBatch(pCmd, pnum);
 	default:
 		break;
 	}
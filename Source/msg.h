@@ -124,7 +124,8 @@ enum _cmd_id : uint8_t {
 	CMD_NAKRUL,
 	CMD_OPENHIVE,
 	CMD_OPENCRYPT,
-	FAKE_CMD_SETID,
+	CMD_STATEHASH,
+	CMD_BATCH,
 	FAKE_CMD_DROPID,
 	NUM_CMDS,
 	CMD_INVALID = 0xFF,
@@ -201,6 +202,12 @@ struct TCmdParam4 {
 	uint16_t wParam4;
 };
 
+/** Header of the commands queued during one turn, packed by PackQueuedCommands */
+struct TCmdBatch {
+	_cmd_id bCmd;
+	uint16_t wBytes;
+};
+
 struct TCmdGolem {
 	_cmd_id bCmd;
 	uint8_t _mx;
@@ -311,14 +318,35 @@ struct TCmdPlrInfoHdr {
 	uint16_t wBytes;
 };
 
-struct TCmdString {
+/**
+ * Header of one independently compressed piece of the level deltas sent to a joining player,
+ * sent with CMD_DLEVEL_0 + level or CMD_DLEVEL_JUNK
+ */
+struct TDeltaChunk {
+	/** Size of all chunks of the transfer, used to report progress */
+	uint32_t dwTotal;
+	uint16_t wIndex;
+	/** Size of the data following the header */
+	uint16_t wBytes;
+	/** @see DeltaSection */
+	uint8_t bSection;
+	uint8_t bFirst;
+	uint8_t bCount;
+	uint8_t bCompressed;
+};
+
+/** Hashes of the game state of the sender, compared to detect desyncs */
+struct TCmdStateHash {
 	_cmd_id bCmd;
-	char str[MAX_SEND_STR_LEN];
+	uint32_t dwTick;
+	uint8_t bLevel;
+	/** @see StateHashSubsystem */
+	uint32_t dwHashes[6];
 };
 
-struct TFakeCmdPlr {
+struct TCmdString {
 	_cmd_id bCmd;
-	uint8_t bPlr;
+	char str[MAX_SEND_STR_LEN];
 };
 
 struct TFakeDropPlr {
@@ -432,6 +460,7 @@ extern int dwRecCount;
 
 void msg_send_drop_pkt(int pnum, int reason);
 bool msg_wait_resync();
+void msg_skip_resync();
 void run_delta_info();
 void DeltaExportData(int pnum);
 void delta_init();
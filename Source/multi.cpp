@@ -10,6 +10,7 @@
 #include <fmt/format.h>
 
 #include "DiabloUI/diabloui.h"
+#include "cmdbatch.h"
 #include "diablo.h"
 #include "engine/point.hpp"
 #include "engine/random.hpp"
@@ -17,12 +18,15 @@
 #include "nthread.h"
 #include "options.h"
 #include "pfile.h"
+#include "pkthdr.h"
+#include "statehash.h"
 #include "plrmsg.h"
 #include "storm/storm.h"
 #include "sync.h"
 #include "tmsg.h"
 #include "utils/endian.hpp"
 #include "utils/language.h"
+#include "utils/profiler.hpp"
 #include "utils/stdcompat/cstddef.hpp"
 
 namespace devilution {
@@ -69,47 +73,119 @@ namespace {
 
 uint32_t sgbSentThisCycle;
 
+/** Last player header each peer received from us */
+PktHdrBaseline sgSentHeaders[MAX_PLRS];
+/** Last player header received from each peer */
+PktHdrBaseline sgReceivedHeaders[MAX_PLRS];
+
+PeerTraffic sgTrafficCounters[MAX_PLRS];
+PeerTraffic sgTraffic[MAX_PLRS];
+uint32_t sgTrafficWindowStart;
+
+void UpdateTrafficWindow()
+{
+	uint32_t now = SDL_GetTicks();
+	uint32_t elapsed = now - sgTrafficWindowStart;
+	if (elapsed < 1000)
+		return;
+	for (int i = 0; i < MAX_PLRS; i++) {
+		sgTraffic[i].bytesSentPerSec = sgTrafficCounters[i].bytesSentPerSec * 1000 / elapsed;
+		sgTraffic[i].bytesReceivedPerSec = sgTrafficCounters[i].bytesReceivedPerSec * 1000 / elapsed;
+		sgTrafficCounters[i] = {};
+	}
+	sgTrafficWindowStart = now;
+}
+
+void ResetPktHdrBaselines()
+{
+	memset(sgSentHeaders, 0, sizeof(sgSentHeaders));
+	memset(sgReceivedHeaders, 0, sizeof(sgReceivedHeaders));
+	memset(sgTrafficCounters, 0, sizeof(sgTrafficCounters));
+	memset(sgTraffic, 0, sizeof(sgTraffic));
+	sgTrafficWindowStart = SDL_GetTicks();
+}
+
+bool IsHeaderRecipient(int playerId, int pnum)
+{
+	if (playerId != SNPLAYER_OTHERS)
+		return playerId == pnum;
+	return pnum != MyPlayerId && (player_state[pnum] & PS_CONNECTED) != 0;
+}
+
+/**
+ * @brief Sends the packet with its header encoded against what the recipients last received
+ *
+ * A broadcast is only sent as a delta if every recipient has the same baseline, otherwise it
+ * carries the full header and all recipients start over from it.
+ * @param playerId Recipient, or SNPLAYER_OTHERS
+ * @param pkt Packet with the header filled in and the body starting at pkt.body
+ * @param bodySize Size of the body
+ * @param full Send the full header
+ */
+bool SendPktMessage(int playerId, const TPkt &pkt, size_t bodySize, bool full)
+{
+	PktHdrBaseline baseline {};
+	bool first = true;
+	for (int i = 0; i < MAX_PLRS; i++) {
+		if (!IsHeaderRecipient(playerId, i)) {
+			if (playerId == SNPLAYER_OTHERS && i != MyPlayerId)
+				sgSentHeaders[i].valid = false;
+			continue;
+		}
+		if (first)
+			baseline = sgSentHeaders[i];
+		else if (!SamePktHdrBaseline(baseline, sgSentHeaders[i]))
+			full = true;
+		first = false;
+	}
+
+	// Encoded next to the body, the header would overwrite the end of pkt.hdr that the
+	// next recipient of multi_send_msg_packet still needs
+	byte message[sizeof(TPkt)];
+	size_t messageSize = EncodePktMessage(pkt, bodySize, baseline, full, message);
+
+	bool sent = SNetSendMessage(playerId, message, messageSize);
+	for (int i = 0; i < MAX_PLRS; i++) {
+		if (!IsHeaderRecipient(playerId, i))
+			continue;
+		sgSentHeaders[i] = baseline;
+		sgSentHeaders[i].valid = sent;
+		if (sent)
+			sgTrafficCounters[i].bytesSentPerSec += messageSize;
+	}
+	return sent;
+}
+
 void BufferInit(TBuffer *pBuf)
 {
 	pBuf->dwNextWriteOffset = 0;
 	pBuf->bData[0] = byte { 0 };
 }
 
-void CopyPacket(TBuffer *buf, const byte *packet, uint8_t size)
+/**
+ * @brief Moves the commands queued for this turn into a CMD_BATCH
+ * @param body Destination for the batch
+ * @param size Space left in the message, reduced by the size of the batch
+ * @return Position after the batch
+ */
+byte *ReceiveCommandBatch(byte *body, size_t *size)
 {
-	if (buf->dwNextWriteOffset + size + 2 > 0x1000) {
-		return;
-	}
+	if (*size <= sizeof(TCmdBatch))
+		return body;
 
-	byte *p = &buf->bData[buf->dwNextWriteOffset];
-	buf->dwNextWriteOffset += size + 1;
-	*p = static_cast<byte>(size);
-	p++;
-	memcpy(p, packet, size);
-	p[size] = byte { 0 };
-}
-
-byte *ReceivePacket(TBuffer *pBuf, byte *body, size_t *size)
-{
-	if (pBuf->dwNextWriteOffset != 0) {
-		byte *srcPtr = pBuf->bData;
-		while (true) {
-			auto chunkSize = static_cast<uint8_t>(*srcPtr);
-			if (chunkSize == 0)
-				break;
-			if (chunkSize > *size)
-				break;
-			srcPtr++;
-			memcpy(body, srcPtr, chunkSize);
-			body += chunkSize;
-			srcPtr += chunkSize;
-			*size -= chunkSize;
-		}
-		memcpy(pBuf->bData, srcPtr, (pBuf->bData - srcPtr) + pBuf->dwNextWriteOffset + 1);
-		pBuf->dwNextWriteOffset += (pBuf->bData - srcPtr);
+	byte *packed = body + sizeof(TCmdBatch);
+	const size_t capacity = std::min<size_t>(*size - sizeof(TCmdBatch), UINT16_MAX);
+	size_t packedSize = PackQueuedCommands(sgHiPriBuf, packed, capacity);
+	packedSize += PackQueuedCommands(sgLoPriBuf, packed + packedSize, capacity - packedSize);
+	if (packedSize == 0)
 		return body;
-	}
-	return body;
+
+	TCmdBatch batch;
+	batch.bCmd = CMD_BATCH;
+	batch.wBytes = static_cast<uint16_t>(packedSize);
+	memcpy(body, &batch, sizeof(batch));
+	*size -= sizeof(batch) + packedSize;
+	return packed + packedSize;
 }
 
 void NetReceivePlayerData(TPkt *pkt)
@@ -134,9 +210,8 @@ void SendPacket(int playerId, const byte *packet, size_t size)
 	TPkt pkt;
 
 	NetReceivePlayerData(&pkt);
-	pkt.hdr.wLen = size + sizeof(pkt.hdr);
 	memcpy(pkt.body, packet, size);
-	if (!SNetSendMessage(playerId, &pkt.hdr, pkt.hdr.wLen))
+	if (!SendPktMessage(playerId, pkt, size, false))
 		nthread_terminate_game("SNetSendMessage0");
 }
 
@@ -160,7 +235,13 @@ void HandleTurnUpperBit(int pnum)
 	if (MyPlayerId == i) {
 		sgbSendDeltaTbl[pnum] = true;
 	} else if (MyPlayerId == pnum) {
-		gbDeltaSender = i;
+		if (i == MAX_PLRS && DvlNet_JoinedEmptyGame()) {
+			// We are alone in a game kept open by a dedicated server
+			msg_skip_resync();
+		} else {
+			// Without a sender WaitForTurns asks again once the other players are known
+			gbDeltaSender = i;
+		}
 	}
 }
 
@@ -466,7 +547,7 @@ bool InitMulti(GameData *gameData)
 void NetSendLoPri(int playerId, const byte *data, size_t size)
 {
 	if (data != nullptr && size != 0) {
-		CopyPacket(&sgLoPriBuf, data, size);
+		QueueCommand(sgLoPriBuf, data, size);
 		SendPacket(playerId, data, size);
 	}
 }
@@ -474,7 +555,7 @@ void NetSendLoPri(int playerId, const byte *data, size_t size)
 void NetSendHiPri(int playerId, const byte *data, size_t size)
 {
 	if (data != nullptr && size != 0) {
-		CopyPacket(&sgHiPriBuf, data, size);
+		QueueCommand(sgHiPriBuf, data, size);
 		SendPacket(playerId, data, size);
 	}
 	if (!gbShouldValidatePackage) {
@@ -482,12 +563,10 @@ void NetSendHiPri(int playerId, const byte *data, size_t size)
 		TPkt pkt;
 		NetReceivePlayerData(&pkt);
 		size_t msgSize = gdwNormalMsgSize - sizeof(TPktHdr);
-		byte *hipriBody = ReceivePacket(&sgHiPriBuf, pkt.body, &msgSize);
-		byte *lowpriBody = ReceivePacket(&sgLoPriBuf, hipriBody, &msgSize);
-		msgSize = sync_all_monsters(lowpriBody, msgSize);
-		size_t len = gdwNormalMsgSize - msgSize;
-		pkt.hdr.wLen = len;
-		if (!SNetSendMessage(SNPLAYER_OTHERS, &pkt.hdr, len))
+		byte *batchEnd = ReceiveCommandBatch(pkt.body, &msgSize);
+		msgSize = sync_all_monsters(batchEnd, msgSize);
+		size_t len = gdwNormalMsgSize - msgSize - sizeof(TPktHdr);
+		if (!SendPktMessage(SNPLAYER_OTHERS, pkt, len, false))
 			nthread_terminate_game("SNetSendMessage");
 	}
 }
@@ -496,13 +575,11 @@ void multi_send_msg_packet(uint32_t pmask, const byte *data, size_t size)
 {
 	TPkt pkt;
 	NetReceivePlayerData(&pkt);
-	size_t t = size + sizeof(pkt.hdr);
-	pkt.hdr.wLen = t;
 	memcpy(pkt.body, data, size);
 	size_t p = 0;
 	for (size_t v = 1; p < MAX_PLRS; p++, v <<= 1) {
 		if ((v & pmask) != 0) {
-			if (!SNetSendMessage(p, &pkt.hdr, t) && SErrGetLastError() != STORM_ERROR_INVALID_PLAYER) {
+			if (!SendPktMessage(p, pkt, size, false) && SErrGetLastError() != STORM_ERROR_INVALID_PLAYER) {
 				nthread_terminate_game("SNetSendMessage");
 				return;
 			}
@@ -524,6 +601,9 @@ void multi_player_left(int pnum, int reason)
 {
 	sgbPlayerLeftGameTbl[pnum] = true;
 	sgdwPlayerLeftReasonTbl[pnum] = reason;
+	sgSentHeaders[pnum].valid = false;
+	sgReceivedHeaders[pnum].valid = false;
+	ForgetStateHashes(pnum);
 	ClearPlayerLeftState();
 }
 
@@ -572,26 +652,29 @@ bool multi_handle_delta()
 
 void multi_process_network_packets()
 {
+	DVL_PROFILE_SCOPE("NetworkPoll");
 	ClearPlayerLeftState();
 	ProcessTmsgs();
 
 	int dwID = -1;
-	TPktHdr *pkt;
+	byte *data;
 	uint32_t dwMsgSize = 0;
-	while (SNetReceiveMessage(&dwID, (void **)&pkt, &dwMsgSize)) {
+	while (SNetReceiveMessage(&dwID, (void **)&data, &dwMsgSize)) {
 		dwRecCount++;
 		ClearPlayerLeftState();
-		if (dwMsgSize < sizeof(TPktHdr))
-			continue;
 		if (dwID < 0 || dwID >= MAX_PLRS)
 			continue;
-		if (pkt->wCheck != LoadBE32("\0\0ip"))
-			continue;
-		if (pkt->wLen != dwMsgSize)
+		TPktHdr hdr;
+		bool resolved;
+		size_t hdrSize = DecodePktHdr(data, dwMsgSize, sgReceivedHeaders[dwID], hdr, resolved);
+		if (hdrSize == 0)
 			continue;
+		sgTrafficCounters[dwID].bytesReceivedPerSec += dwMsgSize;
+		const TPktHdr *pkt = &hdr;
 		auto &player = Players[dwID];
-		player.position.last = { pkt->px, pkt->py };
-		if (dwID != MyPlayerId) {
+		if (resolved)
+			player.position.last = { pkt->px, pkt->py };
+		if (resolved && dwID != MyPlayerId) {
 			assert(gbBufferMsgs != 2);
 			player._pHitPoints = pkt->php;
 			player._pMaxHP = pkt->pmhp;
@@ -623,7 +706,7 @@ void multi_process_network_packets()
 				}
 			}
 		}
-		HandleAllPackets(dwID, (const byte *)(pkt + 1), dwMsgSize - sizeof(TPktHdr));
+		HandleAllPackets(dwID, data + hdrSize, dwMsgSize - hdrSize);
 	}
 	if (SErrGetLastError() != STORM_ERROR_NO_MESSAGES_WAITING)
 		nthread_terminate_game("SNetReceiveMsg");
@@ -649,12 +732,10 @@ void multi_send_zero_packet(int pnum, _cmd_id bCmd, const byte *data, size_t siz
 
 		memcpy(&pkt.body[sizeof(message)], &data[offset], message.wBytes);
 
-		size_t dwMsg = sizeof(pkt.hdr);
-		dwMsg += sizeof(message);
+		size_t dwMsg = sizeof(message);
 		dwMsg += message.wBytes;
-		pkt.hdr.wLen = dwMsg;
 
-		if (!SNetSendMessage(pnum, &pkt, dwMsg)) {
+		if (!SendPktMessage(pnum, pkt, dwMsg, true)) {
 			nthread_terminate_game("SNetSendMessage2");
 			return;
 		}
@@ -670,6 +751,7 @@ void NetClose()
 	}
 
 	sgbNetInited = false;
+	ResetPktHdrBaselines();
 	nthread_cleanup();
 	tmsg_cleanup();
 	EventHandler(false);
@@ -688,6 +770,7 @@ bool NetInit(bool bSinglePlayer)
 		sgGameInitInfo.versionMajor = PROJECT_VERSION_MAJOR;
 		sgGameInitInfo.versionMinor = PROJECT_VERSION_MINOR;
 		sgGameInitInfo.versionPatch = PROJECT_VERSION_PATCH;
+		sgGameInitInfo.protocolVersion = NetProtocolVersion;
 		sgGameInitInfo.nTickRate = sgOptions.Gameplay.nTickRate;
 		sgGameInitInfo.bRunInTown = sgOptions.Gameplay.bRunInTown ? 1 : 0;
 		sgGameInitInfo.bTheoQuest = sgOptions.Gameplay.bTheoQuest ? 1 : 0;
@@ -702,6 +785,7 @@ bool NetInit(bool bSinglePlayer)
 			player.Reset();
 		}
 		memset(sgwPackPlrOffsetTbl, 0, sizeof(sgwPackPlrOffsetTbl));
+		ResetPktHdrBaselines();
 		SNetSetBasePlayer(0);
 		if (bSinglePlayer) {
 			if (!InitSingle(&sgGameInitInfo))
@@ -721,6 +805,7 @@ bool NetInit(bool bSinglePlayer)
 		nthread_start(sgbPlayerTurnBitTbl[MyPlayerId]);
 		tmsg_start();
 		sgdwGameLoops = 0;
+		ResetStateHashes();
 		sgbSentThisCycle = 0;
 		gbDeltaSender = MyPlayerId;
 		gbSomebodyWonGameKludge = false;
@@ -754,6 +839,12 @@ bool NetInit(bool bSinglePlayer)
 	return true;
 }
 
+PeerTraffic GetPeerTraffic(int pnum)
+{
+	UpdateTrafficWindow();
+	return sgTraffic[pnum];
+}
+
 void recv_plrinfo(int pnum, const TCmdPlrInfoHdr &header, bool recv)
 {
 	static PlayerPack PackedPlayerBuffer[MAX_PLRS];
@@ -14,6 +14,9 @@ namespace devilution {
 // must be unsigned to generate unsigned comparisons with pnum
 #define MAX_PLRS 4
 
+/** Raised whenever the encoding of the messages exchanged by players changes, 2 introduced CMD_BATCH, 3 CMD_STATEHASH */
+constexpr uint8_t NetProtocolVersion = 3;
+
 enum event_type : uint8_t {
 	EVENT_TYPE_PLAYER_CREATE_GAME,
 	EVENT_TYPE_PLAYER_LEAVE_GAME,
@@ -34,6 +37,14 @@ struct GameData {
 	uint8_t bTheoQuest;
 	uint8_t bCowQuest;
 	uint8_t bFriendlyFire;
+	/** Occupies what used to be padding, so hosts from before it was introduced report 0 */
+	uint8_t protocolVersion;
+};
+
+/** Message traffic exchanged with one peer, averaged over the last second */
+struct PeerTraffic {
+	uint32_t bytesSentPerSec;
+	uint32_t bytesReceivedPerSec;
 };
 
 extern bool gbSomebodyWonGameKludge;
@@ -48,6 +59,8 @@ extern char szPlayerName[128];
 extern bool PublicGame;
 extern BYTE gbDeltaSender;
 extern uint32_t player_state[MAX_PLRS];
+/** Game ticks since the start of the game, kept in step with the other players by the turns */
+extern DWORD sgdwGameLoops;
 
 void NetSendLoPri(int playerId, const byte *data, size_t size);
 void NetSendHiPri(int playerId, const byte *data, size_t size);
@@ -64,6 +77,7 @@ void multi_process_network_packets();
 void multi_send_zero_packet(int pnum, _cmd_id bCmd, const byte *data, size_t size);
 void NetClose();
 bool NetInit(bool bSinglePlayer);
+PeerTraffic GetPeerTraffic(int pnum);
 void recv_plrinfo(int pnum, const TCmdPlrInfoHdr &header, bool recv);
 
 } // namespace devilution
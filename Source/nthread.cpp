@@ -49,11 +49,16 @@ void NthreadHandler()
 		}
 		nthread_send_and_recv_turn(0, 0);
 		int delta = gnTickDelay;
-		if (nthread_recv_turns())
+		bool turnsArrived = nthread_recv_turns();
+		if (turnsArrived)
 			delta = last_tick - SDL_GetTicks();
 		MemCrit.unlock();
-		if (delta > 0)
-			SDL_Delay(delta);
+		if (delta > 0) {
+			// While turns are missing, check again as soon as the network delivers something
+			// instead of a whole tick later
+			if (turnsArrived || !DvlNet_WaitForData(delta))
+				SDL_Delay(delta);
+		}
 		if (!nthread_should_run)
 			return;
 	}
@@ -34,6 +34,7 @@
 #include "track.h"
 #include "utils/language.h"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 
 namespace devilution {
 
@@ -4768,6 +4769,7 @@ void Obj_Trap(int i)
 
 void ProcessObjects()
 {
+	DVL_PROFILE_SCOPE("ProcessObjects");
 	for (int i = 0; i < ActiveObjectCount; ++i) {
 		int oi = ActiveObjects[i];
 		switch (Objects[oi]._otype) {
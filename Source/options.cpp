@@ -52,6 +52,9 @@ namespace devilution {
 #ifndef DEFAULT_AUDIO_RESAMPLING_QUALITY
 #define DEFAULT_AUDIO_RESAMPLING_QUALITY 5
 #endif
+#ifndef DEFAULT_AUDIO_SOUND_BANK_SIZE
+#define DEFAULT_AUDIO_SOUND_BANK_SIZE 32
+#endif
 
 #if defined(VIRTUAL_GAMEPAD) && !defined(USE_SDL1)
 #define AUTO_PICKUP_DEFAULT(bValue) true
@@ -234,6 +237,7 @@ void LoadOptions()
 	sgOptions.Audio.nChannels = GetIniInt("Audio", "Channels", DEFAULT_AUDIO_CHANNELS);
 	sgOptions.Audio.nBufferSize = GetIniInt("Audio", "Buffer Size", DEFAULT_AUDIO_BUFFER_SIZE);
 	sgOptions.Audio.nResamplingQuality = GetIniInt("Audio", "Resampling Quality", DEFAULT_AUDIO_RESAMPLING_QUALITY);
+	sgOptions.Audio.nSoundBankSize = GetIniInt("Audio", "Sound Bank Size", DEFAULT_AUDIO_SOUND_BANK_SIZE);
 
 	sgOptions.Graphics.nWidth = GetIniInt("Graphics", "Width", DEFAULT_WIDTH);
 	sgOptions.Graphics.nHeight = GetIniInt("Graphics", "Height", DEFAULT_HEIGHT);
@@ -392,6 +396,7 @@ void SaveOptions()
 	SetIniValue("Audio", "Channels", sgOptions.Audio.nChannels);
 	SetIniValue("Audio", "Buffer Size", sgOptions.Audio.nBufferSize);
 	SetIniValue("Audio", "Resampling Quality", sgOptions.Audio.nResamplingQuality);
+	SetIniValue("Audio", "Sound Bank Size", sgOptions.Audio.nSoundBankSize);
 	SetIniValue("Graphics", "Width", sgOptions.Graphics.nWidth);
 	SetIniValue("Graphics", "Height", sgOptions.Graphics.nHeight);
 #ifndef __vita__
@@ -56,6 +56,8 @@ struct AudioOptions {
 	std::uint32_t nBufferSize;
 	/** @brief Quality of the resampler, from 0 (lowest) to 10 (highest) */
 	std::uint8_t nResamplingQuality;
+	/** @brief Size of the decoded sound effects kept in memory (MiB) */
+	std::uint32_t nSoundBankSize;
 };
 
 struct GraphicsOptions {
@@ -208,7 +208,7 @@ void DrawShadowString(const Surface &out, const PanelEntry &entry)
 		return;
 
 	constexpr int Spacing = 0;
-	const std::string &textStr = LanguageTranslate(entry.label.c_str());
+	const string_view textStr = LanguageTranslate(entry.label.c_str());
 	string_view text;
 	std::string wrapped;
 	if (entry.labelLength > 0) {
@@ -5,10 +5,14 @@
  */
 #include "pfile.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <vector>
 
 #include "codec.h"
 #include "engine.h"
+#include "heroindex.h"
 #include "init.h"
 #include "loadsave.h"
 #include "menu.h"
@@ -17,8 +21,10 @@
 #include "storm/storm.h"
 #include "utils/endian.hpp"
 #include "utils/file_util.h"
+#include "utils/hash.hpp"
 #include "utils/language.h"
 #include "utils/paths.h"
+#include "utils/sdl_thread.h"
 
 namespace devilution {
 
@@ -34,13 +40,17 @@ namespace {
 /** List of character names for the character selection screen. */
 char hero_names[MAX_CHARACTERS][PLR_NAME_LEN];
 
-std::string GetSavePath(uint32_t saveNum)
+/** Upper bound on the number of threads decoding the saves that are missing from the hero index. */
+constexpr int MaxHeroDecodeThreads = 4;
+
+const char *GetSaveExtension()
 {
-	std::string path = paths::PrefPath();
-	const char *ext = ".sv";
-	if (gbIsHellfire)
-		ext = ".hsv";
+	return gbIsHellfire ? ".hsv" : ".sv";
+}
 
+std::string GetSavePrefix()
+{
+	std::string path = paths::PrefPath();
 	if (gbIsSpawn) {
 		if (!gbIsMultiplayer) {
 			path.append("spawn_");
@@ -54,14 +64,25 @@ std::string GetSavePath(uint32_t saveNum)
 			path.append("multi_");
 		}
 	}
+	return path;
+}
 
+std::string GetSavePath(uint32_t saveNum)
+{
+	std::string path = GetSavePrefix();
 	char saveNumStr[21];
 	snprintf(saveNumStr, sizeof(saveNumStr) / sizeof(char), "%i", saveNum);
 	path.append(saveNumStr);
-	path.append(ext);
+	path.append(GetSaveExtension());
 	return path;
 }
 
+/** The index lists the heroes of the saves that share its prefix and extension */
+std::string GetHeroIndexPath()
+{
+	return GetSavePrefix() + "heroes" + GetSaveExtension() + ".idx";
+}
+
 bool GetPermSaveNames(uint8_t dwIndex, char *szPerm)
 {
 	const char *fmt;
@@ -117,7 +138,7 @@ std::unique_ptr<byte[]> ReadArchive(HANDLE archive, const char *pszName, size_t
 {
 	HANDLE file;
 
-	if (!SFileOpenFileEx(archive, pszName, 0, &file))
+	if (!SFileOpenFileExThreadSafe(archive, pszName, 0, &file))
 		return nullptr;
 
 	size_t length = SFileGetFileSize(file);
@@ -158,12 +179,16 @@ bool ReadHero(HANDLE archive, PlayerPack *pPack)
 
 void EncodeHero(const PlayerPack *pack)
 {
+	const uint64_t contentHash = Fnv1a(reinterpret_cast<const byte *>(pack), sizeof(*pack));
+	if (mpqapi_has_unchanged_file("hero", contentHash))
+		return;
+
 	size_t packedLen = codec_get_encoded_len(sizeof(*pack));
 	std::unique_ptr<byte[]> packed { new byte[packedLen] };
 
 	memcpy(packed.get(), pack, sizeof(*pack));
 	codec_encode(packed.get(), sizeof(*pack), packedLen, pfile_get_password());
-	mpqapi_write_file("hero", packed.get(), packedLen);
+	mpqapi_write_file("hero", packed.get(), packedLen, contentHash);
 }
 
 bool OpenArchive(uint32_t saveNum)
@@ -175,7 +200,7 @@ HANDLE OpenSaveArchive(uint32_t saveNum)
 {
 	HANDLE archive;
 
-	if (SFileOpenArchive(GetSavePath(saveNum).c_str(), 0, 0, &archive))
+	if (SFileOpenArchiveThreadSafe(GetSavePath(saveNum).c_str(), 0, 0, &archive))
 		return archive;
 	return nullptr;
 }
@@ -185,7 +210,7 @@ void CloseArchive(HANDLE *hsArchive)
 	if (*hsArchive == nullptr)
 		return;
 
-	SFileCloseArchive(*hsArchive);
+	SFileCloseArchiveThreadSafe(*hsArchive);
 	*hsArchive = nullptr;
 }
 
@@ -229,7 +254,7 @@ bool GetFileName(uint8_t lvl, char *dst)
 	return true;
 }
 
-bool ArchiveContainsGame(HANDLE hsArchive)
+bool ReadGameHeader(HANDLE hsArchive, uint32_t *header)
 {
 	if (gbIsMultiplayer)
 		return false;
@@ -238,9 +263,100 @@ bool ArchiveContainsGame(HANDLE hsArchive)
 	if (gameData == nullptr)
 		return false;
 
-	uint32_t hdr = LoadLE32(gameData.get());
+	*header = LoadLE32(gameData.get());
+	return true;
+}
 
-	return IsHeaderValid(hdr);
+bool ArchiveContainsGame(HANDLE hsArchive)
+{
+	uint32_t hdr;
+	return ReadGameHeader(hsArchive, &hdr) && IsHeaderValid(hdr);
+}
+
+/**
+ * @brief Gets the size and modification time of a save, which tell whether its hero index entry is current
+ * @return false if the save doesn't exist
+ */
+bool GetSaveStamp(uint32_t saveNum, HeroIndexEntry &entry)
+{
+	const std::string path = GetSavePath(saveNum);
+	std::uintmax_t size;
+	if (!GetFileSize(path.c_str(), &size) || !GetFileModificationTime(path.c_str(), &entry.modified))
+		return false;
+	entry.fileSize = size;
+	entry.hero.saveNumber = saveNum;
+	return true;
+}
+
+/** @brief Records the hero of a save that was just written in the hero index */
+void UpdateHeroIndex(uint32_t saveNum, const Player &player, bool hasSaveGame)
+{
+	HeroIndexEntry entry {};
+	if (!GetSaveStamp(saveNum, entry))
+		return;
+	Game2UiPlayer(player, &entry.hero, hasSaveGame);
+
+	const std::string indexPath = GetHeroIndexPath();
+	std::vector<HeroIndexEntry> entries = LoadHeroIndex(indexPath);
+	UpdateHeroIndexEntry(entries, entry);
+	SaveHeroIndex(indexPath, entries);
+}
+
+/** A save that is missing from the hero index */
+struct HeroDecodeJob {
+	HeroIndexEntry entry;
+	bool hasHero;
+	PlayerPack pack;
+	bool hasGame;
+	/** Start of the saved game, tells whether it is a valid Diablo or Hellfire game */
+	uint32_t gameHeader;
+};
+
+/**
+ * @brief Work shared between all threads reading the saves that are missing from the hero index.
+ *
+ * StormLib is not thread safe, so opening, reading and closing the archives is serialized by the
+ * storm mutex and only codec_decode runs in parallel. Unpacking the heroes uses the game state, so
+ * it is left to the main thread.
+ */
+struct HeroDecoder {
+	std::vector<HeroDecodeJob> jobs;
+	std::atomic<size_t> nextJob { 0 };
+
+	void Run()
+	{
+		for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+			HeroDecodeJob &job = jobs[i];
+			HANDLE archive = OpenSaveArchive(job.entry.hero.saveNumber);
+			if (archive == nullptr)
+				continue;
+			job.hasHero = ReadHero(archive, &job.pack);
+			job.hasGame = job.hasHero && ReadGameHeader(archive, &job.gameHeader);
+			CloseArchive(&archive);
+		}
+	}
+};
+
+int SDLCALL DecodeHeroesThread(void *data)
+{
+	static_cast<HeroDecoder *>(data)->Run();
+	return 0;
+}
+
+void DecodeHeroes(HeroDecoder &decoder)
+{
+	const int numThreads = std::min({ SDL_GetCPUCount(), MaxHeroDecodeThreads, static_cast<int>(decoder.jobs.size()) });
+
+	std::vector<SdlThread> helpers;
+	if (numThreads > 1)
+		helpers.reserve(numThreads - 1);
+	for (int i = 1; i < numThreads; i++)
+		helpers.emplace_back(DecodeHeroesThread, &decoder);
+
+	decoder.Run();
+
+	for (SdlThread &helper : helpers)
+		helper.join();
 }
 
 } // namespace
@@ -267,55 +383,83 @@ PFileScopedArchiveWriter::~PFileScopedArchiveWriter()
 
 void pfile_write_hero(bool writeGameData, bool clearTables)
 {
-	PFileScopedArchiveWriter scopedWriter(clearTables);
-	if (writeGameData) {
-		SaveGameData();
-		RenameTempToPerm();
-	}
-	PlayerPack pkplr;
 	auto &myPlayer = Players[MyPlayerId];
+	bool hasSaveGame;
+	{
+		PFileScopedArchiveWriter scopedWriter(clearTables);
+		if (writeGameData) {
+			SaveGameData();
+			RenameTempToPerm();
+		}
+		PlayerPack pkplr;
 
-	PackPlayer(&pkplr, myPlayer, !gbIsMultiplayer);
-	EncodeHero(&pkplr);
-	if (!gbVanilla) {
-		SaveHotkeys();
-		SaveHeroItems(myPlayer);
+		PackPlayer(&pkplr, myPlayer, !gbIsMultiplayer);
+		EncodeHero(&pkplr);
+		if (!gbVanilla) {
+			SaveHotkeys();
+			SaveHeroItems(myPlayer);
+		}
+		hasSaveGame = !gbIsMultiplayer && mpqapi_has_file("game");
 	}
+	UpdateHeroIndex(gSaveNumber, myPlayer, hasSaveGame);
 }
 
 bool pfile_ui_set_hero_infos(bool (*uiAddHeroInfo)(_uiheroinfo *))
 {
 	memset(hero_names, 0, sizeof(hero_names));
 
+	const std::string indexPath = GetHeroIndexPath();
+	const std::vector<HeroIndexEntry> index = LoadHeroIndex(indexPath);
+	std::vector<HeroIndexEntry> heroes;
+	HeroDecoder decoder;
+
 	for (uint32_t i = 0; i < MAX_CHARACTERS; i++) {
-		HANDLE archive = OpenSaveArchive(i);
-		if (archive != nullptr) {
-			PlayerPack pkplr;
-			if (ReadHero(archive, &pkplr)) {
-				_uiheroinfo uihero;
-				uihero.saveNumber = i;
-				strcpy(hero_names[i], pkplr.pName);
-				bool hasSaveGame = ArchiveContainsGame(archive);
-				if (hasSaveGame)
-					pkplr.bIsHellfire = gbIsHellfireSaveGame ? 1 : 0;
-
-				auto &player = Players[0];
-
-				player = {};
-
-				if (UnPackPlayer(&pkplr, player, false)) {
-					LoadHeroItems(player);
-					RemoveEmptyInventory(player);
-					CalcPlrInv(player, false);
-
-					Game2UiPlayer(player, &uihero, hasSaveGame);
-					uiAddHeroInfo(&uihero);
-				}
-			}
-			CloseArchive(&archive);
+		HeroDecodeJob job {};
+		if (!GetSaveStamp(i, job.entry))
+			continue;
+		const HeroIndexEntry *indexed = FindHeroIndexEntry(index, job.entry);
+		if (indexed != nullptr)
+			heroes.push_back(*indexed);
+		else
+			decoder.jobs.push_back(job);
+	}
+
+	// Only saves that were written without updating the index, or by an older version, are decoded
+	DecodeHeroes(decoder);
+	for (HeroDecodeJob &job : decoder.jobs) {
+		if (!job.hasHero)
+			continue;
+
+		strcpy(hero_names[job.entry.hero.saveNumber], job.pack.pName);
+		bool hasSaveGame = job.hasGame && IsHeaderValid(job.gameHeader);
+		if (hasSaveGame)
+			job.pack.bIsHellfire = gbIsHellfireSaveGame ? 1 : 0;
+
+		auto &player = Players[0];
+
+		player = {};
+
+		if (UnPackPlayer(&job.pack, player, false)) {
+			LoadHeroItems(player);
+			RemoveEmptyInventory(player);
+			CalcPlrInv(player, false);
+
+			Game2UiPlayer(player, &job.entry.hero, hasSaveGame);
+			heroes.push_back(job.entry);
 		}
 	}
 
+	std::sort(heroes.begin(), heroes.end(), [](const HeroIndexEntry &a, const HeroIndexEntry &b) {
+		return a.hero.saveNumber < b.hero.saveNumber;
+	});
+	for (HeroIndexEntry &entry : heroes) {
+		strcpy(hero_names[entry.hero.saveNumber], entry.hero.name);
+		uiAddHeroInfo(&entry.hero);
+	}
+
+	if (!decoder.jobs.empty() || heroes.size() != index.size())
+		SaveHeroIndex(indexPath, heroes);
+
 	return true;
 }
 
@@ -367,6 +511,7 @@ bool pfile_ui_save_create(_uiheroinfo *heroinfo)
 	}
 
 	mpqapi_flush_and_close(true);
+	UpdateHeroIndex(saveNum, player, false);
 	return true;
 }
 
@@ -0,0 +1,186 @@
+/**
+ * @file pkthdr.cpp
+ *
+ * Implementation of the delta encoding of the player header that prefixes every multiplayer message.
+ */
+#include "pkthdr.h"
+
+#include <cstring>
+
+#include "utils/endian.hpp"
+
+namespace devilution {
+
+namespace {
+
+enum PktHdrField : uint8_t {
+	// clang-format off
+	PktHdrPosition  = 1 << 0,
+	PktHdrTarget    = 1 << 1,
+	PktHdrHitPoints = 1 << 2,
+	PktHdrMaxHP     = 1 << 3,
+	PktHdrStr       = 1 << 4,
+	PktHdrMag       = 1 << 5,
+	PktHdrDex       = 1 << 6,
+	PktHdrFull      = 1 << 7,
+	// clang-format on
+};
+
+uint16_t PktHdrCheck()
+{
+	return static_cast<uint16_t>(LoadBE32("\0\0ip"));
+}
+
+uint8_t ChangedFields(const TPktHdr &hdr, const TPktHdr &base)
+{
+	uint8_t fields = 0;
+	if (hdr.px != base.px || hdr.py != base.py)
+		fields |= PktHdrPosition;
+	if (hdr.targx != base.targx || hdr.targy != base.targy)
+		fields |= PktHdrTarget;
+	if (hdr.php != base.php)
+		fields |= PktHdrHitPoints;
+	if (hdr.pmhp != base.pmhp)
+		fields |= PktHdrMaxHP;
+	if (hdr.bstr != base.bstr)
+		fields |= PktHdrStr;
+	if (hdr.bmag != base.bmag)
+		fields |= PktHdrMag;
+	if (hdr.bdex != base.bdex)
+		fields |= PktHdrDex;
+	return fields;
+}
+
+size_t FieldsSize(uint8_t fields)
+{
+	size_t size = 0;
+	if ((fields & PktHdrPosition) != 0)
+		size += 2;
+	if ((fields & PktHdrTarget) != 0)
+		size += 2;
+	if ((fields & PktHdrHitPoints) != 0)
+		size += sizeof(int32_t);
+	if ((fields & PktHdrMaxHP) != 0)
+		size += sizeof(int32_t);
+	if ((fields & PktHdrStr) != 0)
+		size++;
+	if ((fields & PktHdrMag) != 0)
+		size++;
+	if ((fields & PktHdrDex) != 0)
+		size++;
+	return size;
+}
+
+} // namespace
+
+size_t EncodePktHdr(const TPktHdr &hdr, PktHdrBaseline &baseline, bool full, byte *out)
+{
+	const auto seq = static_cast<uint8_t>(baseline.seq + 1);
+	if (!baseline.valid || seq % PktHdrKeyframeInterval == 0)
+		full = true;
+	const uint8_t fields = full ? 0xFF : ChangedFields(hdr, baseline.hdr);
+
+	const uint16_t check = PktHdrCheck();
+	memcpy(out, &check, sizeof(check));
+	out[2] = static_cast<byte>(fields);
+	out[3] = static_cast<byte>(seq);
+	byte *p = out + PktHdrPrefixSize;
+	if ((fields & PktHdrPosition) != 0) {
+		*p++ = static_cast<byte>(hdr.px);
+		*p++ = static_cast<byte>(hdr.py);
+	}
+	if ((fields & PktHdrTarget) != 0) {
+		*p++ = static_cast<byte>(hdr.targx);
+		*p++ = static_cast<byte>(hdr.targy);
+	}
+	if ((fields & PktHdrHitPoints) != 0) {
+		memcpy(p, &hdr.php, sizeof(hdr.php));
+		p += sizeof(hdr.php);
+	}
+	if ((fields & PktHdrMaxHP) != 0) {
+		memcpy(p, &hdr.pmhp, sizeof(hdr.pmhp));
+		p += sizeof(hdr.pmhp);
+	}
+	if ((fields & PktHdrStr) != 0)
+		*p++ = static_cast<byte>(hdr.bstr);
+	if ((fields & PktHdrMag) != 0)
+		*p++ = static_cast<byte>(hdr.bmag);
+	if ((fields & PktHdrDex) != 0)
+		*p++ = static_cast<byte>(hdr.bdex);
+
+	baseline.hdr = hdr;
+	baseline.seq = seq;
+	baseline.valid = true;
+	return p - out;
+}
+
+size_t EncodePktMessage(const TPkt &pkt, size_t bodySize, PktHdrBaseline &baseline, bool full, byte *out)
+{
+	const size_t hdrSize = EncodePktHdr(pkt.hdr, baseline, full, out);
+	memcpy(out + hdrSize, pkt.body, bodySize);
+	return hdrSize + bodySize;
+}
+
+size_t DecodePktHdr(const byte *data, size_t size, PktHdrBaseline &baseline, TPktHdr &hdr, bool &resolved)
+{
+	resolved = false;
+	if (size < PktHdrPrefixSize)
+		return 0;
+	uint16_t check;
+	memcpy(&check, data, sizeof(check));
+	if (check != PktHdrCheck())
+		return 0;
+	const auto fields = static_cast<uint8_t>(data[2]);
+	const auto seq = static_cast<uint8_t>(data[3]);
+	const size_t hdrSize = PktHdrPrefixSize + FieldsSize(fields);
+	if (size < hdrSize)
+		return 0;
+
+	if ((fields & PktHdrFull) == 0 && (!baseline.valid || seq != static_cast<uint8_t>(baseline.seq + 1))) {
+		// A delta against a header we never saw, wait for the next full header
+		baseline.valid = false;
+		return hdrSize;
+	}
+
+	hdr = baseline.hdr;
+	const byte *p = data + PktHdrPrefixSize;
+	if ((fields & PktHdrPosition) != 0) {
+		hdr.px = static_cast<uint8_t>(*p++);
+		hdr.py = static_cast<uint8_t>(*p++);
+	}
+	if ((fields & PktHdrTarget) != 0) {
+		hdr.targx = static_cast<uint8_t>(*p++);
+		hdr.targy = static_cast<uint8_t>(*p++);
+	}
+	if ((fields & PktHdrHitPoints) != 0) {
+		memcpy(&hdr.php, p, sizeof(hdr.php));
+		p += sizeof(hdr.php);
+	}
+	if ((fields & PktHdrMaxHP) != 0) {
+		memcpy(&hdr.pmhp, p, sizeof(hdr.pmhp));
+		p += sizeof(hdr.pmhp);
+	}
+	if ((fields & PktHdrStr) != 0)
+		hdr.bstr = static_cast<uint8_t>(*p++);
+	if ((fields & PktHdrMag) != 0)
+		hdr.bmag = static_cast<uint8_t>(*p++);
+	if ((fields & PktHdrDex) != 0)
+		hdr.bdex = static_cast<uint8_t>(*p++);
+	hdr.wCheck = PktHdrCheck();
+	hdr.wLen = static_cast<uint16_t>(size);
+
+	baseline.hdr = hdr;
+	baseline.seq = seq;
+	baseline.valid = true;
+	resolved = true;
+	return hdrSize;
+}
+
+bool SamePktHdrBaseline(const PktHdrBaseline &a, const PktHdrBaseline &b)
+{
+	if (!a.valid || !b.valid)
+		return false;
+	return a.seq == b.seq && ChangedFields(a.hdr, b.hdr) == 0;
+}
+
+} // namespace devilution
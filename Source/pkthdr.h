@@ -0,0 +1,73 @@
+/**
+ * @file pkthdr.h
+ *
+ * Interface of the delta encoding of the player header that prefixes every multiplayer message.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "msg.h"
+#include "utils/stdcompat/cstddef.hpp"
+
+namespace devilution {
+
+/** Size of the check word, field mask and sequence number in front of every encoded header */
+constexpr size_t PktHdrPrefixSize = 4;
+/** Size of a header with every field present, the same as the size of TPktHdr */
+constexpr size_t MaxPktHdrSize = PktHdrPrefixSize + 15;
+/** A full header is sent at least this often so a receiver that lost track resynchronises */
+constexpr uint8_t PktHdrKeyframeInterval = 64;
+
+/**
+ * @brief The last header exchanged between a sender and one receiver.
+ *
+ * Both sides keep one per peer and update it for every message, so a header only has to
+ * carry the fields that differ from it. Messages between two players arrive in order, the
+ * sequence number catches the rare case of a message being dropped on the way.
+ */
+struct PktHdrBaseline {
+	TPktHdr hdr;
+	uint8_t seq;
+	bool valid;
+};
+
+/**
+ * @brief Writes the header, containing only the fields that changed since the baseline
+ * @param hdr Header to send
+ * @param baseline State of the receiver, updated to hdr
+ * @param full Send every field even if the baseline is valid
+ * @param out Buffer of at least MaxPktHdrSize bytes
+ * @return Number of bytes written
+ */
+size_t EncodePktHdr(const TPktHdr &hdr, PktHdrBaseline &baseline, bool full, byte *out);
+
+/**
+ * @brief Writes the message for a packet, the encoded header followed by the body
+ *
+ * The packet itself is left untouched, so the same packet can be encoded again for other players.
+ * @param pkt Packet with the header filled in
+ * @param bodySize Size of the body
+ * @param baseline State of the receiver, updated to the header of the packet
+ * @param full Send every field even if the baseline is valid
+ * @param out Buffer of at least MaxPktHdrSize + bodySize bytes
+ * @return Size of the message
+ */
+size_t EncodePktMessage(const TPkt &pkt, size_t bodySize, PktHdrBaseline &baseline, bool full, byte *out);
+
+/**
+ * @brief Reads a header written by EncodePktHdr
+ * @param data Received message
+ * @param size Size of the message
+ * @param baseline State of the sender, updated to the received header
+ * @param hdr Receives the complete header if it could be resolved
+ * @param resolved Set to false if the header is a delta against a baseline that is not known
+ * @return Size of the encoded header, or 0 if the message doesn't start with a valid header
+ */
+size_t DecodePktHdr(const byte *data, size_t size, PktHdrBaseline &baseline, TPktHdr &hdr, bool &resolved);
+
+/** @brief Returns true if deltas against both baselines are identical */
+bool SamePktHdrBaseline(const PktHdrBaseline &a, const PktHdrBaseline &b);
+
+} // namespace devilution
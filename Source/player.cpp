@@ -31,6 +31,7 @@
 #include "towners.h"
 #include "utils/language.h"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 
 namespace devilution {
 
@@ -3297,6 +3298,7 @@ void StartWarpLvl(int pnum, int pidx)
 
 void ProcessPlayers()
 {
+	DVL_PROFILE_SCOPE("ProcessPlayers");
 	if ((DWORD)MyPlayerId >= MAX_PLRS) {
 		app_fatal("ProcessPlayers: illegal player %i", MyPlayerId);
 	}
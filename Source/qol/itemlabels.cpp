@@ -1,7 +1,8 @@
 #include "itemlabels.h"
 
+#include <algorithm>
+#include <array>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
 #include "common.h"
@@ -13,6 +14,7 @@
 #include "inv.h"
 #include "itemlabels.h"
 #include "utils/language.h"
+#include "utils/stdcompat/string_view.hpp"
 
 namespace devilution {
 
@@ -21,10 +23,30 @@ namespace {
 struct ItemLabel {
 	int id, width;
 	Point pos;
+	string_view text;
+};
+
+/** Name of an item as last shown on its label, the width is only measured again when the name changes */
+struct LabelText {
 	std::string text;
+	int width;
+};
+
+/** Label of an item as queued and where it ended up after moving it away from the others */
+struct LabelPlacement {
+	int id, width;
+	Point queued;
+	Point placed;
 };
 
 std::vector<ItemLabel> labelQueue;
+std::array<LabelText, MAXITEMS + 1> labelTexts;
+/** Placement of the labels of the last frame in which they changed, reused while the items and the view stay put */
+std::vector<LabelPlacement> lastPlacements;
+/** Indices of the queued labels by row, a row being as high as labels have to be apart vertically */
+std::vector<std::vector<size_t>> labelRows;
+std::vector<size_t> labelNeighbours;
+std::vector<int> backtrace;
 
 bool altPressed = false;
 bool isLabelHighlighted = false;
@@ -73,8 +95,12 @@ void AddItemToLabelQueue(int id, int x, int y)
 		textOnGround = item._iIdentified ? item._iIName : item._iName;
 	}
 
-	int nameWidth = GetLineWidth(textOnGround);
-	nameWidth += MarginX * 2;
+	LabelText &labelText = labelTexts[id];
+	if (labelText.text != textOnGround) {
+		labelText.text = textOnGround;
+		labelText.width = GetLineWidth(labelText.text) + MarginX * 2;
+	}
+	int nameWidth = labelText.width;
 	int index = ItemCAnimTbl[item._iCurs];
 	if (!labelCenterOffsets[index]) {
 		std::pair<int, int> itemBounds = MeasureSolidHorizontalBounds(*item.AnimInfo.pCelSprite, item.AnimInfo.CurrentFrame);
@@ -88,7 +114,7 @@ void AddItemToLabelQueue(int id, int x, int y)
 		y *= 2;
 	}
 	x -= nameWidth / 2;
-	labelQueue.push_back(ItemLabel { id, nameWidth, { x, y - Height }, textOnGround });
+	labelQueue.push_back(ItemLabel { id, nameWidth, { x, y - Height }, labelText.text });
 }
 
 bool IsMouseOverGameArea()
@@ -110,17 +136,64 @@ void FillRect(const Surface &out, int x, int y, int width, int height, Uint8 col
 	}
 }
 
-void DrawItemNameLabels(const Surface &out)
+/**
+ * @brief Collects the labels placed so far in the given row and the rows next to it, in the order they were placed
+ */
+void CollectLabelNeighbours(size_t row)
 {
-	isLabelHighlighted = false;
+	std::array<const std::vector<size_t> *, 3> rows {};
+	std::array<size_t, 3> next {};
+	for (size_t i = 0; i < rows.size(); i++) {
+		if (row + i >= 1 && row + i - 1 < labelRows.size())
+			rows[i] = &labelRows[row + i - 1];
+	}
+
+	labelNeighbours.clear();
+	while (true) {
+		const std::vector<size_t> *first = nullptr;
+		size_t *firstNext = nullptr;
+		for (size_t i = 0; i < rows.size(); i++) {
+			if (rows[i] == nullptr || next[i] >= rows[i]->size())
+				continue;
+			if (first == nullptr || (*rows[i])[next[i]] < (*first)[*firstNext]) {
+				first = rows[i];
+				firstNext = &next[i];
+			}
+		}
+		if (first == nullptr)
+			break;
+		labelNeighbours.push_back((*first)[(*firstNext)++]);
+	}
+}
+
+/**
+ * @brief Moves the labels sideways until none of them overlap
+ *
+ * Labels that are further apart vertically than a row can't overlap, so each label is only compared
+ * to the labels before it in the neighbouring rows.
+ */
+void ResolveLabelOverlaps()
+{
+	const int rowHeight = Height + BorderY;
+	int top = labelQueue[0].pos.y;
+	int bottom = top;
+	for (const ItemLabel &label : labelQueue) {
+		top = std::min(top, label.pos.y);
+		bottom = std::max(bottom, label.pos.y);
+	}
+	labelRows.resize((bottom - top) / rowHeight + 1);
+	for (std::vector<size_t> &labelRow : labelRows)
+		labelRow.clear();
 
-	for (unsigned int i = 0; i < labelQueue.size(); ++i) {
-		std::unordered_set<int> backtrace;
+	for (size_t i = 0; i < labelQueue.size(); ++i) {
+		const size_t row = (labelQueue[i].pos.y - top) / rowHeight;
+		CollectLabelNeighbours(row);
+		backtrace.clear();
 
 		bool canShow;
 		do {
 			canShow = true;
-			for (unsigned int j = 0; j < i; ++j) {
+			for (size_t j : labelNeighbours) {
 				ItemLabel &a = labelQueue[i];
 				ItemLabel &b = labelQueue[j];
 				if (abs(b.pos.y - a.pos.y) < Height + BorderY) {
@@ -129,21 +202,62 @@ void DrawItemNameLabels(const Surface &out)
 					int newpos = b.pos.x;
 					if (b.pos.x >= a.pos.x && b.pos.x - a.pos.x < widthA) {
 						newpos -= widthA;
-						if (backtrace.find(newpos) != backtrace.end())
+						if (std::find(backtrace.begin(), backtrace.end(), newpos) != backtrace.end())
 							newpos = b.pos.x + widthB;
 					} else if (b.pos.x < a.pos.x && a.pos.x - b.pos.x < widthB) {
 						newpos += widthB;
-						if (backtrace.find(newpos) != backtrace.end())
+						if (std::find(backtrace.begin(), backtrace.end(), newpos) != backtrace.end())
 							newpos = b.pos.x - widthA;
 					} else
 						continue;
 					canShow = false;
 					a.pos.x = newpos;
-					backtrace.insert(newpos);
+					backtrace.push_back(newpos);
 				}
 			}
 		} while (!canShow);
+
+		labelRows[row].push_back(i);
 	}
+}
+
+/**
+ * @brief Places the labels where they were in the last frame if the same labels were queued at the same positions
+ * @return false if the labels changed and have to be placed again
+ */
+bool RestoreLabelPlacements()
+{
+	if (lastPlacements.size() != labelQueue.size())
+		return false;
+	for (size_t i = 0; i < labelQueue.size(); i++) {
+		const ItemLabel &label = labelQueue[i];
+		const LabelPlacement &placement = lastPlacements[i];
+		if (label.id != placement.id || label.width != placement.width || label.pos != placement.queued)
+			return false;
+	}
+	for (size_t i = 0; i < labelQueue.size(); i++)
+		labelQueue[i].pos = lastPlacements[i].placed;
+	return true;
+}
+
+void PlaceLabels()
+{
+	if (labelQueue.empty() || RestoreLabelPlacements())
+		return;
+
+	lastPlacements.clear();
+	for (const ItemLabel &label : labelQueue)
+		lastPlacements.push_back(LabelPlacement { label.id, label.width, label.pos, label.pos });
+	ResolveLabelOverlaps();
+	for (size_t i = 0; i < labelQueue.size(); i++)
+		lastPlacements[i].placed = labelQueue[i].pos;
+}
+
+void DrawItemNameLabels(const Surface &out)
+{
+	isLabelHighlighted = false;
+
+	PlaceLabels();
 
 	for (const ItemLabel &label : labelQueue) {
 		Item &item = Items[label.id];
@@ -4,12 +4,15 @@
  * Implementation of functionality for rendering the dungeons, monsters and calling other render routines.
  */
 
+#include <fmt/format.h>
+
 #include "automap.h"
 #include "controls/touch/renderers.h"
 #include "cursor.h"
 #include "dead.h"
 #include "doom.h"
 #include "dx.h"
+#include "engine/benchmark.hpp"
 #include "engine/render/cel_render.hpp"
 #include "engine/render/cl2_render.hpp"
 #include "engine/render/dun_render.hpp"
@@ -25,6 +28,7 @@
 #include "lighting.h"
 #include "minitext.h"
 #include "missiles.h"
+#include "multi.h"
 #include "nthread.h"
 #include "plrmsg.h"
 #include "qol/itemlabels.h"
@@ -35,6 +39,7 @@
 #include "utils/display.h"
 #include "utils/endian.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
 
 #ifdef _DEBUG
 #include "debug.h"
@@ -1085,6 +1090,7 @@ int tileRows;
  */
 void DrawGame(const Surface &fullOut, Point position)
 {
+	DVL_PROFILE_SCOPE("DrawGame");
 	// Limit rendering to the view area
 	const Surface &out = zoomflag
 	    ? fullOut.subregionY(0, gnViewportHeight)
@@ -1192,6 +1198,7 @@ void DrawGame(const Surface &fullOut, Point position)
  */
 void DrawView(const Surface &out, Point startPosition)
 {
+	DVL_PROFILE_SCOPE("DrawView");
 #ifdef _DEBUG
 	DebugCoordsMap.clear();
 #endif
@@ -1328,6 +1335,40 @@ void DrawFPS(const Surface &out)
 	DrawString(out, string, Point { 8, 53 }, UiFlags::ColorRed);
 }
 
+#ifdef ZONE_PROFILER
+/**
+ * @brief Show that a profiler capture is running, above the FPS
+ */
+void DrawProfilerStatus(const Surface &out)
+{
+	if (!profiler::IsCapturing())
+		return;
+
+	DrawString(out, "Profiling", Point { 8, 38 }, UiFlags::ColorRed);
+}
+#endif
+
+#ifdef _DEBUG
+/**
+ * @brief Display the message traffic exchanged with each player below the FPS
+ */
+void DrawNetStats(const Surface &out)
+{
+	if (!DebugNetStats || !gbIsMultiplayer)
+		return;
+
+	int y = 68;
+	for (int i = 0; i < MAX_PLRS; i++) {
+		if (i == MyPlayerId || !Players[i].plractive)
+			continue;
+		PeerTraffic traffic = GetPeerTraffic(i);
+		std::string string = fmt::format("P{}: {} B/s out, {} B/s in", i, traffic.bytesSentPerSec, traffic.bytesReceivedPerSec);
+		DrawString(out, string, Point { 8, y }, UiFlags::ColorRed);
+		y += 15;
+	}
+}
+#endif
+
 /**
  * @brief Update part of the screen from the back buffer
  * @param dwX Back buffer coordinate
@@ -1666,6 +1707,8 @@ void DrawAndBlit()
 		return;
 	}
 
+	BenchmarkTimer timer(BenchmarkPhase::DrawAndBlit);
+
 	int hgt = 0;
 	bool ddsdesc = false;
 	bool ctrlPan = false;
@@ -1722,6 +1765,12 @@ void DrawAndBlit()
 	}
 
 	DrawFPS(out);
+#ifdef ZONE_PROFILER
+	DrawProfilerStatus(out);
+#endif
+#ifdef _DEBUG
+	DrawNetStats(out);
+#endif
 
 	DrawMain(hgt, ddsdesc, drawhpflag, drawmanaflag, drawsbarflag, drawbtnflag);
 
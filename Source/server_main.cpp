@@ -0,0 +1,153 @@
+/**
+ * @file server_main.cpp
+ *
+ * Entry point of devilutionx-server, which hosts a TCP game without taking part in it.
+ */
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+#include <asio/signal_set.hpp>
+#include <asio/ts/io_context.hpp>
+#include <config.h>
+
+#include "diablo.h"
+#include "dvlnet/tcp_server.h"
+#include "multi.h"
+#include "utils/log.hpp"
+
+namespace devilution {
+
+[[noreturn]] void app_fatal(const char *pszFmt, ...)
+{
+	char text[256];
+	va_list va;
+	va_start(va, pszFmt);
+	vsnprintf(text, sizeof(text), pszFmt, va);
+	va_end(va);
+	LogCritical("{}", text);
+	exit(1);
+}
+
+namespace {
+
+struct ServerOptions {
+	std::string bindAddress = "0.0.0.0";
+	unsigned short port = 6112;
+	std::string password;
+	GameData gameData {};
+};
+
+[[noreturn]] void PrintHelpAndExit()
+{
+	printf("Usage: devilutionx-server [options]\n");
+	printf("Hosts a TCP game, run one server per game to host several on the same machine.\n\n");
+	printf("Options:\n");
+	printf("    %-20s %-30s\n", "-h, --help", "Print this message and exit");
+	printf("    %-20s %-30s\n", "--version", "Print the version and exit");
+	printf("    %-20s %-30s\n", "--bind <address>", "Address to listen on (default 0.0.0.0)");
+	printf("    %-20s %-30s\n", "--port <#>", "Port to listen on (default 6112)");
+	printf("    %-20s %-30s\n", "--password <text>", "Password players need to join");
+	printf("    %-20s %-30s\n", "--seed <#>", "Seed of the dungeon layout (default random)");
+	printf("    %-20s %-30s\n", "--difficulty <#>", "0 normal, 1 nightmare, 2 hell");
+	printf("    %-20s %-30s\n", "--tickrate <#>", "Game speed in ticks per second (default 20)");
+	printf("    %-20s %-30s\n", "--run-in-town", "Allow running in town");
+	printf("    %-20s %-30s\n", "--theo-quest", "Enable the Little Girl quest");
+	printf("    %-20s %-30s\n", "--cow-quest", "Enable the Jersey's quest");
+	printf("    %-20s %-30s\n", "--no-friendly-fire", "Players can't hurt each other");
+	exit(0);
+}
+
+ServerOptions ParseArgs(int argc, char **argv)
+{
+	ServerOptions options;
+	GameData &gameData = options.gameData;
+	gameData.size = sizeof(gameData);
+	gameData.dwSeed = static_cast<uint32_t>(time(nullptr));
+	gameData.programid = GAME_ID;
+	gameData.versionMajor = PROJECT_VERSION_MAJOR;
+	gameData.versionMinor = PROJECT_VERSION_MINOR;
+	gameData.versionPatch = PROJECT_VERSION_PATCH;
+	gameData.protocolVersion = NetProtocolVersion;
+	gameData.nDifficulty = DIFF_NORMAL;
+	gameData.nTickRate = 20;
+	gameData.bFriendlyFire = 1;
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasValue = i + 1 < argc;
+		if (SDL_strcasecmp("-h", argv[i]) == 0 || SDL_strcasecmp("--help", argv[i]) == 0) {
+			PrintHelpAndExit();
+		} else if (SDL_strcasecmp("--version", argv[i]) == 0) {
+			printf("%s-server v%s\n", PROJECT_NAME, PROJECT_VERSION);
+			exit(0);
+		} else if (SDL_strcasecmp("--bind", argv[i]) == 0 && hasValue) {
+			options.bindAddress = argv[++i];
+		} else if (SDL_strcasecmp("--port", argv[i]) == 0 && hasValue) {
+			options.port = static_cast<unsigned short>(SDL_atoi(argv[++i]));
+		} else if (SDL_strcasecmp("--password", argv[i]) == 0 && hasValue) {
+			options.password = argv[++i];
+		} else if (SDL_strcasecmp("--seed", argv[i]) == 0 && hasValue) {
+			gameData.dwSeed = static_cast<uint32_t>(SDL_strtoul(argv[++i], nullptr, 10));
+		} else if (SDL_strcasecmp("--difficulty", argv[i]) == 0 && hasValue) {
+			const int difficulty = SDL_atoi(argv[++i]);
+			if (difficulty < DIFF_NORMAL || difficulty > DIFF_HELL)
+				app_fatal("Invalid difficulty %i", difficulty);
+			gameData.nDifficulty = static_cast<_difficulty>(difficulty);
+		} else if (SDL_strcasecmp("--tickrate", argv[i]) == 0 && hasValue) {
+			const int tickRate = SDL_atoi(argv[++i]);
+			if (tickRate < 20 || tickRate > 50)
+				app_fatal("Tick rate must be between 20 and 50");
+			gameData.nTickRate = tickRate;
+		} else if (SDL_strcasecmp("--run-in-town", argv[i]) == 0) {
+			gameData.bRunInTown = 1;
+		} else if (SDL_strcasecmp("--theo-quest", argv[i]) == 0) {
+			gameData.bTheoQuest = 1;
+		} else if (SDL_strcasecmp("--cow-quest", argv[i]) == 0) {
+			gameData.bCowQuest = 1;
+		} else if (SDL_strcasecmp("--no-friendly-fire", argv[i]) == 0) {
+			gameData.bFriendlyFire = 0;
+		} else {
+			printf("unrecognized option '%s'\n", argv[i]);
+			PrintHelpAndExit();
+		}
+	}
+
+	return options;
+}
+
+} // namespace
+
+} // namespace devilution
+
+int main(int argc, char **argv)
+{
+	using namespace devilution;
+
+	const ServerOptions options = ParseArgs(argc, argv);
+	const auto *gameData = reinterpret_cast<const unsigned char *>(&options.gameData);
+	net::buffer_t gameInitInfo(gameData, gameData + sizeof(options.gameData));
+	net::packet_factory pktfty(options.password);
+
+	try {
+		asio::io_context ioc;
+		net::tcp_server server(ioc, options.bindAddress, options.port, pktfty, std::move(gameInitInfo));
+		asio::signal_set signals(ioc, SIGINT, SIGTERM);
+		signals.async_wait([&](const asio::error_code & /*ec*/, int /*signal*/) {
+			Log("Shutting down");
+			server.Close();
+			ioc.stop();
+		});
+		Log("Hosting game with seed {} on {}:{}", options.gameData.dwSeed, options.bindAddress, options.port);
+		ioc.run();
+	} catch (std::exception &e) {
+		LogCritical("{}", e.what());
+		return 1;
+	}
+
+	return 0;
+}
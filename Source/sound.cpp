@@ -6,9 +6,10 @@
 #include "sound.h"
 
 #include <cstdint>
-#include <list>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <string>
 
 #include <Aulib/DecoderDrwav.h>
 #include <Aulib/ResamplerSpeex.h>
@@ -22,10 +23,15 @@
 #include "utils/log.hpp"
 #include "utils/math.h"
 #include "utils/sdl_mutex.h"
+#include "utils/sdl_thread.h"
+#include "utils/pcm_aulib_decoder.h"
+#include "utils/sound_mixer.h"
+#include "utils/soundbank.h"
 #include "utils/stdcompat/algorithm.hpp"
 #include "utils/stdcompat/optional.hpp"
 #include "utils/stdcompat/shared_ptr_array.hpp"
 #include "utils/stubs.h"
+#include "utils/voice_pool.hpp"
 
 namespace devilution {
 
@@ -68,28 +74,134 @@ void CleanupMusic()
 #endif
 }
 
-std::list<std::unique_ptr<SoundSample>> duplicateSounds;
-std::optional<SdlMutex> duplicateSoundsMutex;
+/** Number of sounds that can overlap with a sound effect already playing */
+constexpr size_t MaxSoundVoices = 32;
 
-SoundSample *DuplicateSound(const SoundSample &sound)
+/** Voices for sounds that are started again while their first instance is still playing */
+VoicePool<SoundSample, MaxSoundVoices> duplicateSounds;
+
+/**
+ * @param lVolume Attenuation of the new sound, quieter sounds are the first to lose their voice
+ */
+SoundSample *DuplicateSound(const SoundSample &sound, int lVolume)
 {
-	auto duplicate = std::make_unique<SoundSample>();
-	if (duplicate->DuplicateFrom(sound) != 0)
+	const auto lease = duplicateSounds.Acquire(lVolume);
+	if (lease.voice == nullptr)
+		return nullptr;
+
+	SoundSample &duplicate = *lease.voice;
+	// A stolen voice is still playing, a finished one keeps its stream for the next duplicate of the same sound
+	duplicate.Stop();
+	if (!duplicate.HasSameSource(sound) && duplicate.DuplicateFrom(sound) != 0) {
+		duplicateSounds.Release(lease.index, lease.token);
 		return nullptr;
-	auto *result = duplicate.get();
-	decltype(duplicateSounds.begin()) it;
-	{
-		const std::lock_guard<SdlMutex> lock(*duplicateSoundsMutex);
-		duplicateSounds.push_back(std::move(duplicate));
-		it = duplicateSounds.end();
-		--it;
 	}
-	result->SetFinishCallback([it]([[maybe_unused]] Aulib::Stream &stream) {
-		const std::lock_guard<SdlMutex> lock(*duplicateSoundsMutex);
-		duplicateSounds.erase(it);
+	const uint32_t index = lease.index;
+	const uint32_t token = lease.token;
+	duplicate.SetFinishCallback([index, token]([[maybe_unused]] Aulib::Stream &stream) {
+		duplicateSounds.Release(index, token);
 	});
-	return result;
+	return &duplicate;
+}
+
+#ifndef STREAM_ALL_AUDIO
+/** Decoded sound effects, kept across levels up to the configured size */
+SoundBank soundBank;
+
+/** Plays the decoded sound effects recorded at the output rate, all through mixerStream */
+SoundMixer soundMixer;
+std::optional<Aulib::Stream> mixerStream;
+
+void OpenMixer()
+{
+	soundMixer.Open(Aulib::sampleRate(), Aulib::channelCount());
+	mixerStream.emplace(/*rwops=*/nullptr, std::make_unique<MixerAulibDecoder>(soundMixer, Aulib::channelCount(), Aulib::sampleRate()),
+	    /*resampler=*/nullptr, /*closeRw=*/false);
+	if (!mixerStream->open()) {
+		LogError(LogCategory::Audio, "Aulib::Stream::open (from OpenMixer): {}", SDL_GetError());
+		mixerStream = std::nullopt;
+		return;
+	}
+	if (!mixerStream->play()) {
+		LogError(LogCategory::Audio, "Aulib::Stream::play (from OpenMixer): {}", SDL_GetError());
+		mixerStream = std::nullopt;
+	}
+}
+
+/** Guards preloadQueue and preloadRunning */
+SdlMutex preloadMutex;
+/** Sounds for the worker to decode, in the order they were loaded */
+std::deque<std::string> preloadQueue;
+bool preloadRunning = false;
+SdlThread preloadThread;
+
+/**
+ * @brief Decodes a sound into the sound bank, unless it is there already
+ * @return nullptr if the sound is missing or compressed
+ */
+std::shared_ptr<const PcmSound> DecodeSound(const std::string &path)
+{
+	std::shared_ptr<const PcmSound> sound = soundBank.Find(path);
+	if (sound != nullptr)
+		return sound;
+
+	SDL_RWops *file = SFileOpenRw(path.c_str());
+	if (file == nullptr)
+		return nullptr;
+	const Sint64 size = SDL_RWsize(file);
+	if (size <= 0) {
+		SDL_RWclose(file);
+		return nullptr;
+	}
+	auto data = std::make_unique<std::uint8_t[]>(size);
+	const bool read = SDL_RWread(file, data.get(), size, 1) == 1;
+	SDL_RWclose(file);
+
+	PcmSound decoded;
+	if (!read || !DecodeWav(data.get(), size, decoded))
+		return nullptr;
+	return soundBank.Add(path, std::move(decoded));
+}
+
+int SDLCALL PreloadSounds(void * /*data*/)
+{
+	while (true) {
+		std::string path;
+		{
+			const std::lock_guard<SdlMutex> lock(preloadMutex);
+			if (preloadQueue.empty()) {
+				preloadRunning = false;
+				return 0;
+			}
+			path = std::move(preloadQueue.front());
+			preloadQueue.pop_front();
+		}
+		DecodeSound(path);
+	}
+}
+
+void QueuePreload(std::string path)
+{
+	const std::lock_guard<SdlMutex> lock(preloadMutex);
+	preloadQueue.push_back(std::move(path));
+	if (preloadRunning)
+		return;
+
+	// A previous worker ran out of sounds, it only has to be joined
+	preloadThread.join();
+	preloadThread = SdlThread(PreloadSounds, nullptr);
+	preloadRunning = true;
+}
+
+void StopPreloading()
+{
+	{
+		const std::lock_guard<SdlMutex> lock(preloadMutex);
+		preloadQueue.clear();
+	}
+	preloadThread.join();
 }
+#endif
 
 /** Maps from track ID to track name in spawn. */
 const char *const SpawnMusicTracks[NUM_MUSIC] = {
@@ -123,8 +235,26 @@ int CapVolume(int volume)
 
 void ClearDuplicateSounds()
 {
-	const std::lock_guard<SdlMutex> lock(*duplicateSoundsMutex);
-	duplicateSounds.clear();
+	for (size_t i = 0; i < duplicateSounds.size(); i++)
+		duplicateSounds[i].Stop();
+	duplicateSounds.ReleaseAll();
+#ifndef STREAM_ALL_AUDIO
+	soundMixer.StopAll();
+#endif
+}
+
+VoicePoolStats GetSoundVoiceStats()
+{
+	return duplicateSounds.GetStats();
+}
+
+SoundMixerStats GetSoundMixerStats()
+{
+#ifndef STREAM_ALL_AUDIO
+	return soundMixer.GetStats();
+#else
+	return {};
+#endif
 }
 
 void snd_play_snd(TSnd *pSnd, int lVolume, int lPan)
@@ -138,9 +268,12 @@ void snd_play_snd(TSnd *pSnd, int lVolume, int lPan)
 		return;
 	}
 
+	snd_finish_load(pSnd);
+
 	SoundSample *sound = &pSnd->DSB;
-	if (sound->IsPlaying()) {
-		sound = DuplicateSound(*sound);
+	// Mixed sounds start another voice on every play
+	if (!sound->IsMixed() && sound->IsPlaying()) {
+		sound = DuplicateSound(*sound, lVolume);
 		if (sound == nullptr)
 			return;
 	}
@@ -163,6 +296,16 @@ std::unique_ptr<TSnd> sound_file_load(const char *path, bool stream)
 		}
 #ifndef STREAM_ALL_AUDIO
 	} else {
+		std::shared_ptr<const PcmSound> sound = DecodeSound(path);
+		if (sound != nullptr) {
+			SoundMixer *mixer = mixerStream ? &soundMixer : nullptr;
+			if (snd->DSB.SetPcm(std::move(sound), mixer) != 0) {
+				ErrSdl();
+			}
+			return snd;
+		}
+
+		// Compressed sounds are still decoded by the audio library as they play
 		SDL_RWops *file = SFileOpenRw(path);
 		if (path == nullptr) {
 			ErrDlg("SFileOpenFile failed", path, __FILE__, __LINE__);
@@ -181,8 +324,40 @@ std::unique_ptr<TSnd> sound_file_load(const char *path, bool stream)
 	return snd;
 }
 
+std::unique_ptr<TSnd> sound_file_preload(const char *path)
+{
+#ifdef STREAM_ALL_AUDIO
+	return sound_file_load(path);
+#else
+	auto snd = std::make_unique<TSnd>();
+	snd->start_tc = SDL_GetTicks() - 80 - 1;
+	snd->pendingPath = path;
+	// The decoded sound only has the bank holding it until snd_finish_load, so it must not be dropped before
+	soundBank.Pin(snd->pendingPath);
+	QueuePreload(path);
+	return snd;
+#endif
+}
+
+void snd_finish_load(TSnd *pSnd)
+{
+	if (pSnd->pendingPath.empty())
+		return;
+
+	const std::unique_ptr<TSnd> loaded = sound_file_load(pSnd->pendingPath.c_str());
+	pSnd->DSB = std::move(loaded->DSB);
+#ifndef STREAM_ALL_AUDIO
+	soundBank.Unpin(pSnd->pendingPath);
+#endif
+	pSnd->pendingPath.clear();
+}
+
 TSnd::~TSnd()
 {
+#ifndef STREAM_ALL_AUDIO
+	if (!pendingPath.empty())
+		soundBank.Unpin(pendingPath);
+#endif
 	DSB.Stop();
 	DSB.Release();
 }
@@ -206,15 +381,28 @@ void snd_init()
 	LogVerbose(LogCategory::Audio, "Aulib sampleRate={} channels={} frameSize={} format={:#x}",
 	    Aulib::sampleRate(), Aulib::channelCount(), Aulib::frameSize(), Aulib::sampleFormat());
 
-	duplicateSoundsMutex.emplace();
+#ifndef STREAM_ALL_AUDIO
+	soundBank.SetBudget(static_cast<size_t>(sgOptions.Audio.nSoundBankSize) * 1024 * 1024);
+	OpenMixer();
+#endif
+
 	gbSndInited = true;
 }
 
 void snd_deinit()
 {
 	if (gbSndInited) {
+#ifndef STREAM_ALL_AUDIO
+		StopPreloading();
+		soundBank.Clear();
+#endif
+		ClearDuplicateSounds();
+		for (size_t i = 0; i < duplicateSounds.size(); i++)
+			duplicateSounds[i].Release();
+#ifndef STREAM_ALL_AUDIO
+		mixerStream = std::nullopt;
+#endif
 		Aulib::quit();
-		duplicateSoundsMutex = std::nullopt;
 	}
 
 	gbSndInited = false;
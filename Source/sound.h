@@ -10,6 +10,8 @@
 #include <memory>
 
 #include "miniwin/miniwin.h"
+#include "utils/sound_mixer.h"
+#include "utils/voice_pool.hpp"
 
 #ifndef NOSOUND
 #include "utils/soundsample.h"
@@ -44,6 +46,8 @@ struct TSnd {
 
 #ifndef NOSOUND
 	SoundSample DSB;
+	/** Path of a sound that is still being decoded in the background, its sample is set up once it is needed */
+	std::string pendingPath;
 
 	bool isPlaying()
 	{
@@ -61,9 +65,19 @@ struct TSnd {
 
 extern bool gbSndInited;
 void ClearDuplicateSounds();
+/** @brief Usage of the voices that play overlapping copies of sound effects */
+VoicePoolStats GetSoundVoiceStats();
+/** @brief Voices and timing of the mixer that plays the decoded sound effects */
+SoundMixerStats GetSoundMixerStats();
 void snd_stop_snd(TSnd *pSnd);
 void snd_play_snd(TSnd *pSnd, int lVolume, int lPan);
 std::unique_ptr<TSnd> sound_file_load(const char *path, bool stream = false);
+/**
+ * @brief Loads a sound whose file is decoded by a worker thread, so loading a level doesn't wait for it
+ */
+std::unique_ptr<TSnd> sound_file_preload(const char *path);
+/** @brief Sets up the sample of a preloaded sound, decoding it now if the worker didn't get to it yet */
+void snd_finish_load(TSnd *pSnd);
 void snd_init();
 void snd_deinit();
 void music_stop();
@@ -11,8 +11,12 @@ bool gbSoundOn;
 // AllowShortFunctionsOnASingleLine: None
 // clang-format off
 void ClearDuplicateSounds() { }
+VoicePoolStats GetSoundVoiceStats() { return {}; }
+SoundMixerStats GetSoundMixerStats() { return {}; }
 void snd_play_snd(TSnd *pSnd, int lVolume, int lPan) { }
 std::unique_ptr<TSnd> sound_file_load(const char *path, bool stream) { return nullptr; }
+std::unique_ptr<TSnd> sound_file_preload(const char *path) { return nullptr; }
+void snd_finish_load(TSnd *pSnd) { }
 TSnd::~TSnd()
 {
 }
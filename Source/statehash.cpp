@@ -0,0 +1,319 @@
+/**
+ * @file statehash.cpp
+ *
+ * Implementation of the hashing of the game state that detects when the games of the players diverge.
+ */
+#include "statehash.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "gendung.h"
+#include "items.h"
+#include "missiles.h"
+#include "monster.h"
+#include "objects.h"
+#include "player.h"
+#include "utils/log.hpp"
+
+namespace devilution {
+
+namespace {
+
+constexpr uint32_t FnvOffset = 2166136261U;
+constexpr uint32_t FnvPrime = 16777619U;
+
+/** Rows of the dungeon grids hashed each tick, so the whole level is covered once per interval */
+constexpr int DungeonRowsPerTick = (MAXDUNX + StateHashInterval - 1) / StateHashInterval;
+
+/** Flags that only describe what the local player sees are left out */
+constexpr int8_t SharedDungeonFlags = BFLAG_MISSILE | BFLAG_DEAD_PLAYER | BFLAG_POPULATED | BFLAG_MONSTLR | BFLAG_PLAYERLR;
+
+static_assert(sizeof(TCmdStateHash::dwHashes) == sizeof(StateHashes), "TCmdStateHash must hold a hash per subsystem");
+
+DesyncDetector Detector;
+/** Hash of the dungeon rows covered so far in the current interval */
+uint32_t DungeonHash;
+uint32_t LastTick;
+uint8_t IntervalLevel;
+/** Cleared when a tick of the interval was missed or the level changed, the hash isn't comparable then */
+bool IntervalComplete;
+
+/** FNV-1a over 32 bit words instead of bytes, the fields of the state are hashed one at a time */
+uint32_t Mix(uint32_t hash, uint32_t value)
+{
+	return (hash ^ value) * FnvPrime;
+}
+
+uint32_t Mix(uint32_t hash, Point position)
+{
+	return Mix(hash, static_cast<uint32_t>(position.x) | static_cast<uint32_t>(position.y) << 16);
+}
+
+/** Spreads the high bits to the low ones, as word wise FNV-1a doesn't carry them downwards */
+uint32_t Finish(uint32_t hash)
+{
+	return hash ^ (hash >> 15);
+}
+
+uint32_t HashPlayers()
+{
+	uint32_t hash = FnvOffset;
+	for (int i = 0; i < MAX_PLRS; i++) {
+		const Player &player = Players[i];
+		if (!player.plractive || player.plrlevel != currlevel)
+			continue;
+		hash = Mix(hash, i);
+		hash = Mix(hash, player.position.tile);
+		hash = Mix(hash, player.position.future);
+		hash = Mix(hash, player._pmode);
+	}
+	return Finish(hash);
+}
+
+uint32_t HashMonsters()
+{
+	uint32_t hash = FnvOffset;
+	for (int i = 0; i < ActiveMonsterCount; i++) {
+		const int id = ActiveMonsters[i];
+		const Monster &monster = Monsters[id];
+		hash = Mix(hash, id);
+		hash = Mix(hash, monster.position.tile);
+		hash = Mix(hash, monster.position.future);
+		hash = Mix(hash, static_cast<uint32_t>(monster._mmode));
+		hash = Mix(hash, monster._mhitpoints);
+	}
+	return Finish(hash);
+}
+
+uint32_t HashItems()
+{
+	uint32_t hash = FnvOffset;
+	for (int i = 0; i < ActiveItemCount; i++) {
+		const int id = ActiveItems[i];
+		const Item &item = Items[id];
+		hash = Mix(hash, id);
+		hash = Mix(hash, item.position);
+		hash = Mix(hash, item.IDidx);
+		hash = Mix(hash, item._iSeed);
+	}
+	return Finish(hash);
+}
+
+uint32_t HashMissiles()
+{
+	uint32_t hash = FnvOffset;
+	for (int i = 0; i < ActiveMissileCount; i++) {
+		const Missile &missile = Missiles[ActiveMissiles[i]];
+		hash = Mix(hash, missile._mitype);
+		hash = Mix(hash, missile.position.tile);
+		hash = Mix(hash, missile._mirange);
+		hash = Mix(hash, missile._misource);
+	}
+	return Finish(hash);
+}
+
+uint32_t HashObjects()
+{
+	uint32_t hash = FnvOffset;
+	for (int i = 0; i < ActiveObjectCount; i++) {
+		const int id = ActiveObjects[i];
+		const Object &object = Objects[id];
+		hash = Mix(hash, id);
+		hash = Mix(hash, object._otype);
+		hash = Mix(hash, object.position);
+		hash = Mix(hash, object._oSelFlag | (object._oSolidFlag ? 1 : 0) << 8 | (object._oDoorFlag ? 1 : 0) << 9);
+	}
+	return Finish(hash);
+}
+
+uint8_t CurrentLevelId()
+{
+	return static_cast<uint8_t>(currlevel | (setlevel ? 0x80 : 0));
+}
+
+void LogDesync(const DesyncReport &report)
+{
+	LogWarn("Game state differs from player {} ({}) at tick {}, first in {}", report.player, Players[report.player]._pName, report.tick, StateHashSubsystemName(report.subsystem));
+}
+
+void SendStateHash(uint32_t tick, uint8_t level, const StateHashes &hashes)
+{
+	TCmdStateHash cmd;
+
+	cmd.bCmd = CMD_STATEHASH;
+	cmd.dwTick = tick;
+	cmd.bLevel = level;
+	memcpy(cmd.dwHashes, hashes.data(), sizeof(cmd.dwHashes));
+	NetSendLoPri(MyPlayerId, (byte *)&cmd, sizeof(cmd));
+}
+
+} // namespace
+
+const char *StateHashSubsystemName(StateHashSubsystem subsystem)
+{
+	switch (subsystem) {
+	case StateHashSubsystem::Players:
+		return "players";
+	case StateHashSubsystem::Monsters:
+		return "monsters";
+	case StateHashSubsystem::Items:
+		return "items";
+	case StateHashSubsystem::Missiles:
+		return "missiles";
+	case StateHashSubsystem::Objects:
+		return "objects";
+	case StateHashSubsystem::Dungeon:
+		return "dungeon";
+	}
+	return "unknown";
+}
+
+uint32_t HashSubsystem(StateHashSubsystem subsystem)
+{
+	switch (subsystem) {
+	case StateHashSubsystem::Players:
+		return HashPlayers();
+	case StateHashSubsystem::Monsters:
+		return HashMonsters();
+	case StateHashSubsystem::Items:
+		return HashItems();
+	case StateHashSubsystem::Missiles:
+		return HashMissiles();
+	case StateHashSubsystem::Objects:
+		return HashObjects();
+	case StateHashSubsystem::Dungeon:
+		return Finish(HashDungeonRows(FnvOffset, 0, MAXDUNX));
+	}
+	return 0;
+}
+
+uint32_t HashDungeonRows(uint32_t hash, int firstRow, int lastRow)
+{
+	for (int x = firstRow; x < lastRow; x++) {
+		for (int y = 0; y < MAXDUNY; y++) {
+			hash = Mix(hash, dPiece[x][y]);
+			hash = Mix(hash, static_cast<uint16_t>(dMonster[x][y]) | static_cast<uint8_t>(dPlayer[x][y]) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(dItem[x][y])) << 24);
+			hash = Mix(hash, static_cast<uint8_t>(dObject[x][y]) | static_cast<uint8_t>(dCorpse[x][y]) << 8 | static_cast<uint8_t>(dFlags[x][y] & SharedDungeonFlags) << 16);
+		}
+	}
+	return hash;
+}
+
+void DesyncDetector::Clear()
+{
+	history_ = {};
+	nextEntry_ = 0;
+	pending_ = {};
+	mismatches_ = {};
+}
+
+void DesyncDetector::Clear(int player)
+{
+	pending_[player].valid = false;
+	mismatches_[player] = 0;
+}
+
+std::vector<DesyncReport> DesyncDetector::AddLocal(uint32_t tick, uint8_t level, const StateHashes &hashes)
+{
+	Entry &local = history_[nextEntry_];
+	local = { true, tick, level, hashes };
+	nextEntry_ = (nextEntry_ + 1) % HistorySize;
+
+	std::vector<DesyncReport> reports;
+	for (int player = 0; player < MAX_PLRS; player++) {
+		Entry &remote = pending_[player];
+		if (!remote.valid || remote.tick != tick)
+			continue;
+		remote.valid = false;
+		if (auto report = Compare(player, local, remote))
+			reports.push_back(*report);
+	}
+	return reports;
+}
+
+std::optional<DesyncReport> DesyncDetector::AddRemote(int player, uint32_t tick, uint8_t level, const StateHashes &hashes)
+{
+	const Entry remote { true, tick, level, hashes };
+	for (const Entry &local : history_) {
+		if (local.valid && local.tick == tick)
+			return Compare(player, local, remote);
+	}
+	// The other game is ahead, compare once the local game gets there
+	pending_[player] = remote;
+	return {};
+}
+
+std::optional<DesyncReport> DesyncDetector::Compare(int player, const Entry &local, const Entry &remote)
+{
+	// Hashes of players on different levels have nothing in common
+	if (local.level != remote.level)
+		return {};
+
+	const auto mismatch = std::mismatch(local.hashes.begin(), local.hashes.end(), remote.hashes.begin());
+	if (mismatch.first == local.hashes.end()) {
+		mismatches_[player] = 0;
+		return {};
+	}
+
+	mismatches_[player]++;
+	// Only the first check of a run of differing ones is reported, so a desync isn't logged every interval
+	if (mismatches_[player] != MismatchesToReport)
+		return {};
+	return DesyncReport { player, remote.tick, static_cast<StateHashSubsystem>(mismatch.first - local.hashes.begin()) };
+}
+
+void ResetStateHashes()
+{
+	Detector.Clear();
+	IntervalComplete = false;
+}
+
+void ForgetStateHashes(int pnum)
+{
+	Detector.Clear(pnum);
+}
+
+void StateHashTick()
+{
+	if (!gbIsMultiplayer)
+		return;
+
+	const uint32_t tick = sgdwGameLoops;
+	const uint8_t level = CurrentLevelId();
+	const uint32_t phase = tick % StateHashInterval;
+	if (phase == 0) {
+		DungeonHash = FnvOffset;
+		IntervalLevel = level;
+		IntervalComplete = true;
+	} else if (tick != LastTick + 1 || level != IntervalLevel) {
+		IntervalComplete = false;
+	}
+	LastTick = tick;
+
+	// Spread the cost of the grids over the interval, every game hashes the same rows on the same tick
+	const int firstRow = phase * DungeonRowsPerTick;
+	if (firstRow < MAXDUNX)
+		DungeonHash = HashDungeonRows(DungeonHash, firstRow, std::min(firstRow + DungeonRowsPerTick, MAXDUNX));
+
+	if (phase != StateHashInterval - 1 || !IntervalComplete)
+		return;
+
+	StateHashes hashes;
+	for (size_t i = 0; i < NumStateHashSubsystems; i++) {
+		const auto subsystem = static_cast<StateHashSubsystem>(i);
+		hashes[i] = subsystem == StateHashSubsystem::Dungeon ? Finish(DungeonHash) : HashSubsystem(subsystem);
+	}
+
+	for (const DesyncReport &report : Detector.AddLocal(tick, level, hashes))
+		LogDesync(report);
+	SendStateHash(tick, level, hashes);
+}
+
+void ReceiveStateHash(int pnum, uint32_t tick, uint8_t level, const StateHashes &hashes)
+{
+	if (auto report = Detector.AddRemote(pnum, tick, level, hashes))
+		LogDesync(*report);
+}
+
+} // namespace devilution
@@ -0,0 +1,111 @@
+/**
+ * @file statehash.h
+ *
+ * Interface of the hashing of the game state that detects when the games of the players diverge.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "multi.h"
+#include "utils/stdcompat/optional.hpp"
+
+namespace devilution {
+
+enum class StateHashSubsystem : uint8_t {
+	Players,
+	Monsters,
+	Items,
+	Missiles,
+	Objects,
+	/** The d* grids of the level */
+	Dungeon,
+
+	LAST = Dungeon,
+};
+
+constexpr size_t NumStateHashSubsystems = static_cast<size_t>(StateHashSubsystem::LAST) + 1;
+
+/** Game ticks between two state hashes, the dungeon grids are hashed a few rows per tick in between */
+constexpr uint32_t StateHashInterval = 64;
+
+using StateHashes = std::array<uint32_t, NumStateHashSubsystems>;
+
+const char *StateHashSubsystemName(StateHashSubsystem subsystem);
+
+/** @brief Hashes the entities of one subsystem on the current level, or the complete dungeon grids */
+uint32_t HashSubsystem(StateHashSubsystem subsystem);
+
+/**
+ * @brief Adds the d* grids of the given rows of the level to a hash
+ * @param hash Hash of the rows before firstRow
+ * @param firstRow First row to hash
+ * @param lastRow Row after the last row to hash
+ */
+uint32_t HashDungeonRows(uint32_t hash, int firstRow, int lastRow);
+
+struct DesyncReport {
+	int player;
+	uint32_t tick;
+	StateHashSubsystem subsystem;
+};
+
+/**
+ * @brief Compares the state hashes of the local game to the ones the other players send.
+ *
+ * Commands reach the players at slightly different ticks, so a single difference is expected now
+ * and then. A desync is only reported once the hashes of a player differ in consecutive checks.
+ */
+class DesyncDetector {
+public:
+	/** Number of local hashes kept for messages that arrive late */
+	static constexpr size_t HistorySize = 8;
+	/** Consecutive checks that have to differ before a desync is reported */
+	static constexpr int MismatchesToReport = 2;
+
+	void Clear();
+
+	/** @brief Forgets the hashes of a player that left */
+	void Clear(int player);
+
+	/**
+	 * @brief Records the hashes of the local game
+	 * @return Desyncs found with hashes other players sent ahead of this tick
+	 */
+	std::vector<DesyncReport> AddLocal(uint32_t tick, uint8_t level, const StateHashes &hashes);
+
+	/** @brief Compares hashes sent by another player to the local ones of the same tick */
+	std::optional<DesyncReport> AddRemote(int player, uint32_t tick, uint8_t level, const StateHashes &hashes);
+
+private:
+	struct Entry {
+		bool valid;
+		uint32_t tick;
+		uint8_t level;
+		StateHashes hashes;
+	};
+
+	std::optional<DesyncReport> Compare(int player, const Entry &local, const Entry &remote);
+
+	std::array<Entry, HistorySize> history_ {};
+	size_t nextEntry_ = 0;
+	/** Hashes that arrived before the local game reached their tick */
+	std::array<Entry, MAX_PLRS> pending_ {};
+	std::array<int, MAX_PLRS> mismatches_ {};
+};
+
+/** @brief Drops all hashes, called when a game starts */
+void ResetStateHashes();
+
+/** @brief Forgets the hashes of a player that left */
+void ForgetStateHashes(int pnum);
+
+/** @brief Continues the state hash of the local game, sending it to the other players every StateHashInterval ticks */
+void StateHashTick();
+
+/** @brief Handles the state hash another player sent */
+void ReceiveStateHash(int pnum, uint32_t tick, uint8_t level, const StateHashes &hashes);
+
+} // namespace devilution
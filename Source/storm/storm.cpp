@@ -46,8 +46,29 @@ bool SFileCloseFileThreadSafe(HANDLE hFile)
 	return SFileCloseFile(hFile);
 }
 
+bool SFileOpenArchiveThreadSafe(const char *szMpqName, DWORD dwPriority, DWORD dwFlags, HANDLE *phMpq)
+{
+	const std::lock_guard<SdlMutex> lock(Mutex);
+	return SFileOpenArchive(szMpqName, dwPriority, dwFlags, phMpq);
+}
+
+bool SFileCloseArchiveThreadSafe(HANDLE hArchive)
+{
+	const std::lock_guard<SdlMutex> lock(Mutex);
+	return SFileCloseArchive(hArchive);
+}
+
+bool SFileOpenFileExThreadSafe(HANDLE hMpq, const char *szFileName, DWORD dwSearchScope, HANDLE *phFile)
+{
+	const std::lock_guard<SdlMutex> lock(Mutex);
+	return SFileOpenFileEx(hMpq, szFileName, dwSearchScope, phFile);
+}
+
 bool SFileOpenFile(const char *filename, HANDLE *phFile)
 {
+	// Sound effects are opened by a worker thread while the main thread loads a level
+	const std::lock_guard<SdlMutex> lock(Mutex);
+
 	bool result = false;
 
 	if (!result && font_mpq != nullptr) {
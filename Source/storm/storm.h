@@ -22,6 +22,8 @@ enum conn_type : uint8_t {
 	SELCONN_ZT,
 	SELCONN_TCP,
 	SELCONN_LOOPBACK,
+	/** In-process network for tests, not offered in the menu */
+	SELCONN_SIM,
 };
 
 extern const char *ConnectionNames[];
@@ -270,6 +272,11 @@ bool SFileOpenArchive(const char *szMpqName, DWORD dwPriority, DWORD dwFlags, HA
 bool SFileReadFileThreadSafe(HANDLE hFile, void *buffer, size_t nNumberOfBytesToRead, size_t *read = nullptr, int *lpDistanceToMoveHigh = nullptr);
 bool SFileCloseFileThreadSafe(HANDLE hFile);
 
+// Locks opening and closing an archive, and opening a file from it, under the same mutex.
+bool SFileOpenArchiveThreadSafe(const char *szMpqName, DWORD dwPriority, DWORD dwFlags, HANDLE *phMpq);
+bool SFileCloseArchiveThreadSafe(HANDLE hArchive);
+bool SFileOpenFileExThreadSafe(HANDLE hMpq, const char *szFileName, DWORD dwSearchScope, HANDLE *phFile);
+
 // Sets the file's 64-bit seek position.
 inline std::uint64_t SFileSetFilePointer(HANDLE hFile, std::int64_t offset, int whence)
 {
@@ -295,5 +302,12 @@ std::vector<std::string> DvlNet_GetGamelist();
 void DvlNet_SetPassword(std::string pw);
 void DvlNet_ClearPassword();
 bool DvlNet_IsPublicGame();
+/**
+ * @brief Blocks until the network provider has received data or the timeout expires
+ * @return False if the provider can't signal incoming data, in which case nothing was waited for
+ */
+bool DvlNet_WaitForData(uint32_t timeoutMs);
+/** @brief Returns true if the server said no other player was in the game when we joined */
+bool DvlNet_JoinedEmptyGame();
 
 } // namespace devilution
@@ -252,4 +252,18 @@ bool DvlNet_IsPublicGame()
 	return GameIsPublic;
 }
 
+bool DvlNet_WaitForData(uint32_t timeoutMs)
+{
+	// Not under storm_net_mutex, the game thread has to be able to send and receive while this blocks
+	return dvlnet_inst->SNetWaitForData(timeoutMs);
+}
+
+bool DvlNet_JoinedEmptyGame()
+{
+#ifndef NONET
+	std::lock_guard<SdlMutex> lg(storm_net_mutex);
+#endif
+	return dvlnet_inst->SNetJoinedEmptyGame();
+}
+
 } // namespace devilution
@@ -8,6 +8,7 @@
 #include "minitext.h"
 #include "stores.h"
 #include "utils/language.h"
+#include "utils/profiler.hpp"
 
 namespace devilution {
 namespace {
@@ -848,6 +849,7 @@ void FreeTownerGFX()
 
 void ProcessTowners()
 {
+	DVL_PROFILE_SCOPE("ProcessTowners");
 	// BUGFIX: should be `i < numtowners`, was `i < NUM_TOWNERS`
 	for (auto &towner : Towners) {
 		if (towner._ttype == TOWN_DEADGUY) {
@@ -111,6 +111,31 @@ bool GetFileSize(const char *path, std::uintmax_t *size)
 #endif
 }
 
+bool GetFileModificationTime(const char *path, std::int64_t *time)
+{
+#if defined(_WIN64) || defined(_WIN32)
+	const auto pathUtf16 = ToWideChar(path);
+	if (pathUtf16 == nullptr) {
+		LogError("UTF-8 -> UTF-16 conversion error code {}", ::GetLastError());
+		return false;
+	}
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+	if (!GetFileAttributesExW(&pathUtf16[0], GetFileExInfoStandard, &attr)) {
+		return false;
+	}
+	// FILETIME counts 100 nanosecond intervals
+	const uint64_t ticks = static_cast<uint64_t>(attr.ftLastWriteTime.dwHighDateTime) << (sizeof(attr.ftLastWriteTime.dwHighDateTime) * 8) | attr.ftLastWriteTime.dwLowDateTime;
+	*time = static_cast<std::int64_t>(ticks / 10000000);
+	return true;
+#else
+	struct ::stat statResult;
+	if (::stat(path, &statResult) == -1)
+		return false;
+	*time = static_cast<std::int64_t>(statResult.st_mtime);
+	return true;
+#endif
+}
+
 bool ResizeFile(const char *path, std::uintmax_t size)
 {
 #if defined(_WIN64) || defined(_WIN32)
@@ -140,6 +165,48 @@ bool ResizeFile(const char *path, std::uintmax_t size)
 #endif
 }
 
+bool CopyFileOverwrite(const char *from, const char *to)
+{
+#if defined(_WIN64) || defined(_WIN32)
+	const auto fromUtf16 = ToWideChar(from);
+	const auto toUtf16 = ToWideChar(to);
+	if (fromUtf16 == nullptr || toUtf16 == nullptr) {
+		LogError("UTF-8 -> UTF-16 conversion error code {}", ::GetLastError());
+		return false;
+	}
+	return ::CopyFileW(&fromUtf16[0], &toUtf16[0], /*bFailIfExists=*/FALSE) != 0;
+#else
+	std::optional<std::fstream> src = CreateFileStream(from, std::ios::in | std::ios::binary);
+	if (!src || src->fail())
+		return false;
+	std::optional<std::fstream> dst = CreateFileStream(to, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!dst || dst->fail())
+		return false;
+	char buffer[4096];
+	while (src->read(buffer, sizeof(buffer)) || src->gcount() > 0) {
+		if (!dst->write(buffer, src->gcount()))
+			return false;
+	}
+	return !src->bad() && dst->flush().good();
+#endif
+}
+
+bool RenameFile(const char *from, const char *to)
+{
+#if defined(_WIN64) || defined(_WIN32)
+	const auto fromUtf16 = ToWideChar(from);
+	const auto toUtf16 = ToWideChar(to);
+	if (fromUtf16 == nullptr || toUtf16 == nullptr) {
+		LogError("UTF-8 -> UTF-16 conversion error code {}", ::GetLastError());
+		return false;
+	}
+	return ::MoveFileExW(&fromUtf16[0], &toUtf16[0], MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	// POSIX `rename` atomically replaces the destination if it exists.
+	return std::rename(from, to) == 0;
+#endif
+}
+
 void RemoveFile(const char *lpFileName)
 {
 #if defined(_WIN64) || defined(_WIN32)
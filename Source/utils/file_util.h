@@ -13,7 +13,11 @@ namespace devilution {
 bool FileExists(const char *path);
 bool FileExistsAndIsWriteable(const char *path);
 bool GetFileSize(const char *path, std::uintmax_t *size);
+/** @brief Gets the time of the last write to a file, in seconds since an unspecified point */
+bool GetFileModificationTime(const char *path, std::int64_t *time);
 bool ResizeFile(const char *path, std::uintmax_t size);
+bool CopyFileOverwrite(const char *from, const char *to);
+bool RenameFile(const char *from, const char *to);
 void RemoveFile(const char *lpFileName);
 std::optional<std::fstream> CreateFileStream(const char *path, std::ios::openmode mode);
 FILE *FOpen(const char *path, const char *mode);
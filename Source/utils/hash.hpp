@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/stdcompat/cstddef.hpp"
+
+namespace devilution {
+
+/** Initial value of a 64-bit FNV-1a hash. */
+constexpr uint64_t Fnv1aOffsetBasis = 0xCBF29CE484222325;
+
+/**
+ * @brief Continues a 64-bit FNV-1a hash with the given bytes.
+ *
+ * This is a fast non-cryptographic hash, it is only meant for detecting changes and for lookups.
+ */
+inline uint64_t Fnv1a(const byte *data, size_t size, uint64_t hash = Fnv1aOffsetBasis)
+{
+	constexpr uint64_t Prime = 0x100000001B3;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<uint8_t>(data[i]);
+		hash *= Prime;
+	}
+	return hash;
+}
+
+} // namespace devilution
@@ -1,7 +1,7 @@
 #include "utils/language.h"
 
+#include <cstring>
 #include <functional>
-#include <map>
 #include <memory>
 #include <vector>
 
@@ -15,14 +15,25 @@ using namespace devilution;
 
 namespace {
 
-struct CStringCmp {
-	bool operator()(const char *s1, const char *s2) const
-	{
-		return strcmp(s1, s2) < 0;
-	}
+struct TranslationEntry {
+	string_view key;
+	/** Index of the translation in TranslationForms, followed by its plural forms */
+	uint32_t firstForm;
+	uint32_t numForms;
+};
+
+struct TranslationSlot {
+	uint32_t hash;
+	/** Index in Translations plus one, 0 marks an empty slot */
+	uint32_t entry;
 };
 
-std::vector<std::map<std::string, std::string, std::less<>>> translation = { {}, {} };
+/** Contents of the .mo file, the keys and translations point into it */
+std::unique_ptr<char[]> Catalogue;
+std::vector<TranslationEntry> Translations;
+std::vector<string_view> TranslationForms;
+/** Open addressing table of the translations by the hash of their key, at most half full */
+std::vector<TranslationSlot> TranslationSlots;
 
 struct MoHead {
 	uint32_t magic;
@@ -214,56 +225,124 @@ void ParseMetadata(char *ptr)
 	}
 }
 
-bool ReadEntry(SDL_RWops *rw, MoEntry *e, std::vector<char> &result)
+/**
+ * @brief Gets a string of the catalogue
+ * @param tableOffset Offset of the table of source or target strings
+ * @param index Entry of the table
+ */
+bool ReadEntry(size_t size, uint32_t tableOffset, uint32_t index, string_view &result)
 {
-	if (SDL_RWseek(rw, e->offset, RW_SEEK_SET) == -1)
+	MoEntry e;
+	const uint64_t entryOffset = tableOffset + static_cast<uint64_t>(index) * sizeof(MoEntry);
+	if (entryOffset + sizeof(MoEntry) > size)
+		return false;
+	// FIXME: Endianness.
+	memcpy(&e, &Catalogue[entryOffset], sizeof(MoEntry));
+	// Strings are followed by a null terminator, which lets the lookups hand them out directly
+	if (static_cast<uint64_t>(e.offset) + e.length >= size || Catalogue[e.offset + e.length] != '\0')
 		return false;
-	result.resize(e->length + 1);
-	result.back() = '\0';
-	return (SDL_RWread(rw, result.data(), sizeof(char), e->length) == e->length);
+	result = string_view(&Catalogue[e.offset], e.length);
+	return true;
 }
 
-} // namespace
+template <typename Matches>
+const TranslationEntry *FindTranslation(uint32_t hash, Matches matches)
+{
+	if (TranslationSlots.empty())
+		return nullptr;
+
+	const size_t mask = TranslationSlots.size() - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		const TranslationSlot &slot = TranslationSlots[i];
+		if (slot.entry == 0)
+			return nullptr;
+		if (slot.hash == hash) {
+			const TranslationEntry &entry = Translations[slot.entry - 1];
+			if (matches(entry.key))
+				return &entry;
+		}
+	}
+}
 
-const std::string &LanguageParticularTranslate(const char *context, const char *message)
+const TranslationEntry *FindTranslation(const char *key, uint32_t hash)
 {
-	constexpr const char *glue = "\004";
+	return FindTranslation(hash, [key](string_view entryKey) { return entryKey == key; });
+}
 
-	std::string key = context;
-	key += glue;
-	key += message;
+void AddTranslation(string_view key, string_view value)
+{
+	// The key of a plural is the singular followed by the plural, it is looked up by the singular
+	key = string_view(key.data());
+	const uint32_t hash = TranslationHash(key.data());
+	const size_t mask = TranslationSlots.size() - 1;
+	size_t i = hash & mask;
+	for (; TranslationSlots[i].entry != 0; i = (i + 1) & mask) {
+		// The first translation of a key wins
+		if (TranslationSlots[i].hash == hash && Translations[TranslationSlots[i].entry - 1].key == key)
+			return;
+	}
 
-	auto it = translation[0].find(key);
-	if (it == translation[0].end()) {
-		it = translation[0].insert({ key, message }).first;
+	TranslationEntry entry { key, static_cast<uint32_t>(TranslationForms.size()), 0 };
+	const char *text = value.data();
+	const char *end = value.data() + value.size();
+	for (int j = 0; j < PluralForms && text <= end; j++) {
+		TranslationForms.emplace_back(text);
+		entry.numForms++;
+		text += TranslationForms.back().size() + 1;
+	}
+	// Untranslated messages are kept as they are
+	if (TranslationForms[entry.firstForm].empty()) {
+		TranslationForms.resize(entry.firstForm);
+		return;
 	}
 
-	return it->second;
+	Translations.push_back(entry);
+	TranslationSlots[i] = { hash, static_cast<uint32_t>(Translations.size()) };
 }
 
-const std::string &LanguagePluralTranslate(const char *singular, const char *plural, int count)
+void ClearTranslations()
 {
-	int n = GetLocalPluralId(count);
-
-	auto it = translation[n].find(singular);
-	if (it == translation[n].end()) {
-		if (count != 1)
-			it = translation[1].insert({ singular, plural }).first;
-		else
-			it = translation[0].insert({ singular, singular }).first;
-	}
+	Translations.clear();
+	TranslationForms.clear();
+	TranslationSlots.clear();
+	Catalogue = nullptr;
+	PluralForms = 2;
+	GetLocalPluralId = [](int n) -> int { return n != 1 ? 1 : 0; };
+}
+
+} // namespace
 
-	return it->second;
+string_view LanguageParticularTranslate(const char *context, const char *message, uint32_t hash)
+{
+	const TranslationEntry *entry = FindTranslation(hash, [context, message](string_view key) {
+		// The key is the context and the message separated by \004
+		const size_t contextLength = strlen(context);
+		return key.size() > contextLength && key.compare(0, contextLength, context) == 0
+		    && key[contextLength] == '\004' && key.substr(contextLength + 1) == message;
+	});
+	if (entry == nullptr)
+		return message;
+
+	return TranslationForms[entry->firstForm];
 }
 
-const std::string &LanguageTranslate(const char *key)
+string_view LanguagePluralTranslate(const char *singular, const char *plural, int count, uint32_t hash)
 {
-	auto it = translation[0].find(key);
-	if (it == translation[0].end()) {
-		it = translation[0].insert({ key, key }).first;
-	}
+	const TranslationEntry *entry = FindTranslation(singular, hash);
+	const uint32_t n = GetLocalPluralId(count);
+	if (entry == nullptr || n >= entry->numForms)
+		return count != 1 ? plural : singular;
+
+	return TranslationForms[entry->firstForm + n];
+}
+
+string_view LanguageTranslate(const char *key, uint32_t hash)
+{
+	const TranslationEntry *entry = FindTranslation(key, hash);
+	if (entry == nullptr)
+		return key;
 
-	return it->second;
+	return TranslationForms[entry->firstForm];
 }
 
 bool HasTranslation(const std::string &locale)
@@ -284,6 +363,8 @@ void LanguageInitialize()
 	const std::string lang = sgOptions.Language.szCode;
 	SDL_RWops *rw;
 
+	ClearTranslations();
+
 	// Translations normally come in ".gmo" files.
 	// We also support ".mo" because that is what poedit generates
 	// and what translators use to test their work.
@@ -294,83 +375,53 @@ void LanguageInitialize()
 	if (rw == nullptr)
 		return;
 
-	// Read header and do sanity checks
-	// FIXME: Endianness.
-	MoHead head;
-	if (SDL_RWread(rw, &head, sizeof(MoHead), 1) != 1) {
+	// The catalogue is read at once and the lookups point into it
+	const Sint64 size = SDL_RWsize(rw);
+	if (size < static_cast<Sint64>(sizeof(MoHead))) {
 		SDL_RWclose(rw);
 		return;
 	}
-
-	if (head.magic != MO_MAGIC) {
-		SDL_RWclose(rw);
-		return; // not a MO file
-	}
-
-	if (head.revision.major > 1 || head.revision.minor > 1) {
-		SDL_RWclose(rw);
-		return; // unsupported revision
-	}
-
-	// Read entries of source strings
-	std::unique_ptr<MoEntry[]> src { new MoEntry[head.nbMappings] };
-	if (SDL_RWseek(rw, head.srcOffset, RW_SEEK_SET) == -1) {
-		SDL_RWclose(rw);
-		return;
-	}
-	// FIXME: Endianness.
-	if (SDL_RWread(rw, src.get(), sizeof(MoEntry), head.nbMappings) != head.nbMappings) {
-		SDL_RWclose(rw);
+	Catalogue.reset(new char[size]);
+	const bool read = SDL_RWread(rw, Catalogue.get(), size, 1) == 1;
+	SDL_RWclose(rw);
+	if (!read) {
+		ClearTranslations();
 		return;
 	}
 
-	// Read entries of target strings
-	std::unique_ptr<MoEntry[]> dst { new MoEntry[head.nbMappings] };
-	if (SDL_RWseek(rw, head.dstOffset, RW_SEEK_SET) == -1) {
-		SDL_RWclose(rw);
-		return;
-	}
+	// Read header and do sanity checks
 	// FIXME: Endianness.
-	if (SDL_RWread(rw, dst.get(), sizeof(MoEntry), head.nbMappings) != head.nbMappings) {
-		SDL_RWclose(rw);
-		return;
+	MoHead head;
+	memcpy(&head, Catalogue.get(), sizeof(MoHead));
+
+	if (head.magic != MO_MAGIC || head.revision.major > 1 || head.revision.minor > 1 || head.nbMappings == 0) {
+		ClearTranslations();
+		return; // not a MO file or unsupported revision
 	}
 
-	std::vector<char> key;
-	std::vector<char> value;
+	string_view key;
+	string_view value;
 
 	// MO header
-	if (!ReadEntry(rw, &src[0], key) || !ReadEntry(rw, &dst[0], value)) {
-		SDL_RWclose(rw);
+	if (!ReadEntry(size, head.srcOffset, 0, key) || !ReadEntry(size, head.dstOffset, 0, value) || !key.empty()) {
+		ClearTranslations();
 		return;
 	}
 
-	if (key[0] != '\0') {
-		SDL_RWclose(rw);
-		return;
-	}
+	// Parsing cuts the metadata into pieces, the catalogue stays as it is
+	std::string metadata(value.data(), value.size());
+	ParseMetadata(&metadata[0]);
 
-	ParseMetadata(value.data());
+	size_t numSlots = 1;
+	while (numSlots < 2 * static_cast<size_t>(head.nbMappings))
+		numSlots *= 2;
+	TranslationSlots.resize(numSlots);
+	Translations.reserve(head.nbMappings);
+	TranslationForms.reserve(head.nbMappings);
 
-	translation.resize(PluralForms);
-	for (int i = 0; i < PluralForms; i++)
-		translation[i] = {};
-
-	// Read strings described by entries
+	// Index the strings described by entries
 	for (uint32_t i = 1; i < head.nbMappings; i++) {
-		if (ReadEntry(rw, &src[i], key) && ReadEntry(rw, &dst[i], value)) {
-			size_t offset = 0;
-			for (int j = 0; j < PluralForms; j++) {
-				const char *text = value.data() + offset;
-				translation[j].emplace(key.data(), text);
-
-				if (dst[i].length <= offset + strlen(value.data()))
-					break;
-
-				offset += strlen(text) + 1;
-			}
-		}
+		if (ReadEntry(size, head.srcOffset, i, key) && ReadEntry(size, head.dstOffset, i, value))
+			AddTranslation(key, value);
 	}
-
-	SDL_RWclose(rw);
 }
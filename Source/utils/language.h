@@ -1,16 +1,54 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
-#define _(x) LanguageTranslate(x).c_str()
-#define ngettext(x, y, z) LanguagePluralTranslate(x, y, z).c_str()
-#define pgettext(context, x) LanguageParticularTranslate(context, x).c_str()
+#include "utils/stdcompat/string_view.hpp"
+
+#define _(x) LanguageTranslate(x).data()
+#define ngettext(x, y, z) LanguagePluralTranslate(x, y, z).data()
+#define pgettext(context, x) LanguageParticularTranslate(context, x).data()
 #define N_(x) (x)
 #define P_(context, x) (x)
 
+/**
+ * @brief FNV-1a hash of a msgid, the key of a translation
+ *
+ * The inline overloads below hash the msgid they are given, which the compiler can fold for literals.
+ * @param hash Hash of the part of the key in front of str
+ */
+constexpr uint32_t TranslationHash(const char *str, uint32_t hash = 2166136261U)
+{
+	for (; *str != '\0'; str++)
+		hash = (hash ^ static_cast<uint8_t>(*str)) * 16777619U;
+	return hash;
+}
+
 bool HasTranslation(const std::string &locale);
 void LanguageInitialize();
-const std::string &LanguageParticularTranslate(const char *context, const char *message);
-const std::string &LanguagePluralTranslate(const char *singular, const char *plural, int count);
-const std::string &LanguageTranslate(const char *key);
+
+/*
+ * The translations point into the loaded catalogue and are null-terminated. Messages without a
+ * translation are returned as they are.
+ */
+devilution::string_view LanguageParticularTranslate(const char *context, const char *message, uint32_t hash);
+devilution::string_view LanguagePluralTranslate(const char *singular, const char *plural, int count, uint32_t hash);
+devilution::string_view LanguageTranslate(const char *key, uint32_t hash);
+
+inline devilution::string_view LanguageTranslate(const char *key)
+{
+	return LanguageTranslate(key, TranslationHash(key));
+}
+
+inline devilution::string_view LanguagePluralTranslate(const char *singular, const char *plural, int count)
+{
+	return LanguagePluralTranslate(singular, plural, count, TranslationHash(singular));
+}
+
+/** The key of a message with a context is the context and the message separated by \004 */
+inline devilution::string_view LanguageParticularTranslate(const char *context, const char *message)
+{
+	return LanguageParticularTranslate(context, message, TranslationHash(message, TranslationHash("\004", TranslationHash(context))));
+}
+
 const char *LanguageMetadata(const char *key);
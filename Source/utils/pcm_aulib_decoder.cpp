@@ -0,0 +1,78 @@
+#include "pcm_aulib_decoder.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "appfat.h"
+
+namespace devilution {
+
+bool PcmAulibDecoder::open([[maybe_unused]] SDL_RWops *rwops)
+{
+	assert(rwops == nullptr);
+	pos_ = 0;
+	return true;
+}
+
+bool PcmAulibDecoder::rewind()
+{
+	pos_ = 0;
+	return true;
+}
+
+std::chrono::microseconds PcmAulibDecoder::duration() const
+{
+	const auto frames = static_cast<std::int64_t>(sound_->samples.size() / sound_->channels);
+	return std::chrono::microseconds { frames * 1000000 / sound_->sampleRate };
+}
+
+bool PcmAulibDecoder::seekToTime(std::chrono::microseconds pos)
+{
+	const auto frame = static_cast<std::size_t>(std::max<std::int64_t>(pos.count(), 0) * sound_->sampleRate / 1000000);
+	pos_ = std::min(frame * sound_->channels, sound_->samples.size());
+	return true;
+}
+
+int PcmAulibDecoder::doDecoding(float buf[], int len, bool &callAgain)
+{
+	callAgain = false;
+
+	constexpr float Scale = std::numeric_limits<std::int16_t>::max() + 1.F;
+	const std::int16_t *samples = sound_->samples.data() + pos_;
+	const std::size_t count = std::min(static_cast<std::size_t>(len), sound_->samples.size() - pos_);
+	for (std::size_t i = 0; i < count; ++i) {
+		buf[i] = static_cast<float>(samples[i]) / Scale;
+	}
+	pos_ += count;
+	return static_cast<int>(count);
+}
+
+bool MixerAulibDecoder::open([[maybe_unused]] SDL_RWops *rwops)
+{
+	assert(rwops == nullptr);
+	return true;
+}
+
+bool MixerAulibDecoder::rewind()
+{
+	return false;
+}
+
+std::chrono::microseconds MixerAulibDecoder::duration() const
+{
+	return {};
+}
+
+bool MixerAulibDecoder::seekToTime([[maybe_unused]] std::chrono::microseconds pos)
+{
+	return false;
+}
+
+int MixerAulibDecoder::doDecoding(float buf[], int len, bool &callAgain)
+{
+	callAgain = false;
+	mixer_.Mix(buf, len / numChannels_);
+	return len;
+}
+
+} // namespace devilution
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include <Aulib/Decoder.h>
+
+#include "utils/sound_mixer.h"
+#include "utils/soundbank.h"
+
+namespace devilution {
+
+/**
+ * @brief A Decoder interface implementation that plays a sound decoded beforehand.
+ *
+ * The samples are shared, every stream playing the sound only keeps its own position.
+ */
+class PcmAulibDecoder final : public ::Aulib::Decoder {
+public:
+	explicit PcmAulibDecoder(std::shared_ptr<const PcmSound> sound)
+	    : sound_(std::move(sound))
+	{
+	}
+
+	bool open(SDL_RWops *rwops) override;
+
+	[[nodiscard]] int getChannels() const override
+	{
+		return sound_->channels;
+	}
+
+	[[nodiscard]] int getRate() const override
+	{
+		return sound_->sampleRate;
+	}
+
+	bool rewind() override;
+	[[nodiscard]] std::chrono::microseconds duration() const override;
+	bool seekToTime(std::chrono::microseconds pos) override;
+
+protected:
+	int doDecoding(float buf[], int len, bool &callAgain) override;
+
+private:
+	std::shared_ptr<const PcmSound> sound_;
+	/** Next sample to play */
+	std::size_t pos_ = 0;
+};
+
+/**
+ * @brief A Decoder interface implementation that plays the voices of a SoundMixer, it never ends.
+ */
+class MixerAulibDecoder final : public ::Aulib::Decoder {
+public:
+	MixerAulibDecoder(SoundMixer &mixer, int numChannels, int sampleRate)
+	    : mixer_(mixer)
+	    , numChannels_(numChannels)
+	    , sampleRate_(sampleRate)
+	{
+	}
+
+	bool open(SDL_RWops *rwops) override;
+
+	[[nodiscard]] int getChannels() const override
+	{
+		return numChannels_;
+	}
+
+	[[nodiscard]] int getRate() const override
+	{
+		return sampleRate_;
+	}
+
+	bool rewind() override;
+	[[nodiscard]] std::chrono::microseconds duration() const override;
+	bool seekToTime(std::chrono::microseconds pos) override;
+
+protected:
+	int doDecoding(float buf[], int len, bool &callAgain) override;
+
+private:
+	SoundMixer &mixer_;
+	const int numChannels_;
+	const int sampleRate_;
+};
+
+} // namespace devilution
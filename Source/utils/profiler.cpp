@@ -0,0 +1,157 @@
+/**
+ * @file profiler.cpp
+ *
+ * Implementation of the zone profiler.
+ */
+#include "utils/profiler.hpp"
+
+#include <array>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "utils/log.hpp"
+#include "utils/paths.h"
+#include "utils/sdl_mutex.h"
+
+namespace devilution {
+
+namespace profiler {
+
+std::atomic<bool> gbCapturing;
+
+namespace {
+
+struct ZoneEvent {
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+};
+
+/** Zones of one thread, only written by that thread */
+struct ThreadRing {
+	std::array<ZoneEvent, ZonesPerThread> zones;
+	std::atomic<uint64_t> written { 0 };
+	/** Cleared when the thread exits, so the next new thread can take over the ring */
+	std::atomic<bool> inUse { true };
+	uint32_t id;
+};
+
+/** Releases the ring of a thread when it exits */
+struct RingOwner {
+	ThreadRing *ring = nullptr;
+
+	~RingOwner()
+	{
+		if (ring != nullptr)
+			ring->inUse.store(false, std::memory_order_release);
+	}
+};
+
+thread_local RingOwner CurrentRing;
+std::vector<std::unique_ptr<ThreadRing>> Rings;
+uint64_t CaptureStart;
+
+uint64_t Timestamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SdlMutex &RingsMutex()
+{
+	static SdlMutex mutex;
+	return mutex;
+}
+
+ThreadRing &GetRing()
+{
+	if (CurrentRing.ring != nullptr)
+		return *CurrentRing.ring;
+
+	const std::lock_guard<SdlMutex> lock(RingsMutex());
+	for (auto &ring : Rings) {
+		bool inUse = false;
+		if (ring->inUse.compare_exchange_strong(inUse, true, std::memory_order_acq_rel)) {
+			CurrentRing.ring = ring.get();
+			return *ring;
+		}
+	}
+	Rings.push_back(std::make_unique<ThreadRing>());
+	ThreadRing &ring = *Rings.back();
+	ring.id = static_cast<uint32_t>(Rings.size());
+	CurrentRing.ring = &ring;
+	return ring;
+}
+
+} // namespace
+
+uint64_t Zone::Now()
+{
+	return Timestamp();
+}
+
+void Zone::Record(const char *name, uint64_t start, uint64_t end)
+{
+	ThreadRing &ring = GetRing();
+	const uint64_t written = ring.written.load(std::memory_order_relaxed);
+	ring.zones[written % ZonesPerThread] = { name, start, end };
+	ring.written.store(written + 1, std::memory_order_release);
+}
+
+void StartCapture()
+{
+	const std::lock_guard<SdlMutex> lock(RingsMutex());
+	for (auto &ring : Rings)
+		ring->written.store(0, std::memory_order_relaxed);
+	CaptureStart = Timestamp();
+	gbCapturing.store(true, std::memory_order_release);
+}
+
+void StopCapture()
+{
+	gbCapturing.store(false, std::memory_order_release);
+}
+
+std::string ExportChromeTrace()
+{
+	const std::lock_guard<SdlMutex> lock(RingsMutex());
+	std::string json = "{\"traceEvents\":[";
+	bool first = true;
+	for (auto &ring : Rings) {
+		const uint64_t written = ring->written.load(std::memory_order_acquire);
+		const uint64_t begin = written > ZonesPerThread ? written - ZonesPerThread : 0;
+		for (uint64_t i = begin; i < written; i++) {
+			const ZoneEvent &zone = ring->zones[i % ZonesPerThread];
+			// Zones that started before the capture belong to the previous one
+			if (zone.start < CaptureStart)
+				continue;
+			json += fmt::format("{}\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+			    first ? "" : ",", zone.name, ring->id, (zone.start - CaptureStart) / 1000.0, (zone.end - zone.start) / 1000.0);
+			first = false;
+		}
+	}
+	json += "\n]}\n";
+	return json;
+}
+
+std::string SaveCapture()
+{
+	StopCapture();
+	const std::string path = paths::PrefPath() + fmt::format("trace_{}.json", static_cast<int64_t>(time(nullptr)));
+	std::ofstream file(path, std::ios::trunc);
+	file << ExportChromeTrace();
+	if (!file) {
+		LogError("Unable to write profiler capture to {}", path);
+		return {};
+	}
+	return path;
+}
+
+} // namespace profiler
+
+} // namespace devilution
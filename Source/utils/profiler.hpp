@@ -0,0 +1,84 @@
+/**
+ * @file profiler.hpp
+ *
+ * Interface of the zone profiler, which records where the time of a frame goes.
+ *
+ * Scopes marked with DVL_PROFILE_SCOPE are only measured in builds with ZONE_PROFILER, and
+ * only while a capture runs. Each thread writes its zones to its own ring buffer, so a capture
+ * keeps the most recent zones of every thread. A capture is saved in the Chrome trace format,
+ * which chrome://tracing and Perfetto can open.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace devilution {
+
+namespace profiler {
+
+/** Number of zones kept per thread, older ones are overwritten */
+constexpr size_t ZonesPerThread = 1 << 15;
+
+extern std::atomic<bool> gbCapturing;
+
+inline bool IsCapturing()
+{
+	return gbCapturing.load(std::memory_order_relaxed);
+}
+
+/** @brief Drops the zones of a previous capture and starts recording */
+void StartCapture();
+
+/** @brief Stops recording, the zones of the capture stay available until the next one starts */
+void StopCapture();
+
+/** @brief Formats the zones of the last capture as Chrome trace JSON */
+std::string ExportChromeTrace();
+
+/**
+ * @brief Stops the capture and saves it next to the save files
+ * @return Path of the trace, empty if it couldn't be written
+ */
+std::string SaveCapture();
+
+class Zone {
+public:
+	explicit Zone(const char *name)
+	{
+		if (IsCapturing()) {
+			name_ = name;
+			start_ = Now();
+		}
+	}
+
+	~Zone()
+	{
+		if (name_ != nullptr)
+			Record(name_, start_, Now());
+	}
+
+	Zone(const Zone &) = delete;
+	Zone &operator=(const Zone &) = delete;
+
+private:
+	static uint64_t Now();
+	static void Record(const char *name, uint64_t start, uint64_t end);
+
+	const char *name_ = nullptr;
+	uint64_t start_ = 0;
+};
+
+} // namespace profiler
+
+} // namespace devilution
+
+#ifdef ZONE_PROFILER
+#define DVL_PROFILE_CONCAT_(a, b) a##b
+#define DVL_PROFILE_CONCAT(a, b) DVL_PROFILE_CONCAT_(a, b)
+/** Measures the rest of the enclosing scope as a zone with the given name, which must be a string literal */
+#define DVL_PROFILE_SCOPE(name) const ::devilution::profiler::Zone DVL_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define DVL_PROFILE_SCOPE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+
+#include <SDL_mutex.h>
+
+#include "appfat.h"
+
+namespace devilution {
+
+/*
+ * RAII wrapper for SDL_sem.
+ */
+class SdlSemaphore final {
+public:
+	SdlSemaphore(uint32_t initialValue = 0)
+	    : semaphore_(SDL_CreateSemaphore(initialValue))
+	{
+		if (semaphore_ == nullptr)
+			ErrSdl();
+	}
+
+	~SdlSemaphore()
+	{
+		SDL_DestroySemaphore(semaphore_);
+	}
+
+	SdlSemaphore(const SdlSemaphore &) = delete;
+	SdlSemaphore(SdlSemaphore &&) = delete;
+	SdlSemaphore &operator=(const SdlSemaphore &) = delete;
+	SdlSemaphore &operator=(SdlSemaphore &&) = delete;
+
+	void Post()
+	{
+		if (SDL_SemPost(semaphore_) == -1)
+			ErrSdl();
+	}
+
+	/**
+	 * @brief Waits until the semaphore is posted or the timeout expires
+	 * @return True if the semaphore was posted
+	 */
+	bool WaitTimeout(uint32_t ms)
+	{
+		int ret = SDL_SemWaitTimeout(semaphore_, ms);
+		if (ret == -1)
+			ErrSdl();
+		return ret == 0;
+	}
+
+	/** @brief Resets the count so that only posts made from now on wake up a waiter */
+	void Drain()
+	{
+		while (SDL_SemTryWait(semaphore_) == 0) {
+		}
+	}
+
+private:
+	SDL_sem *semaphore_;
+};
+
+} // namespace devilution
@@ -0,0 +1,171 @@
+/**
+ * @file sound_mixer.cpp
+ *
+ * Implementation of the mixer of the decoded sound effects.
+ */
+#include "utils/sound_mixer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+namespace devilution {
+
+void SoundMixer::Open(int sampleRate, int channels)
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	sampleRate_ = sampleRate;
+	channels_ = channels;
+}
+
+uint32_t SoundMixer::Play(std::shared_ptr<const PcmSound> sound, float volume, float pan)
+{
+	constexpr float Scale = 1.F / (std::numeric_limits<int16_t>::max() + 1.F);
+
+	// Declared before the lock so the replaced sound is freed after unlocking
+	std::shared_ptr<const PcmSound> released;
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	Voice *voice = AcquireVoice(volume);
+	if (voice == nullptr) {
+		dropped_++;
+		return 0;
+	}
+
+	if (++nextHandle_ == 0)
+		++nextHandle_;
+	// The sound a finished voice kept is released on the game thread, never in the callback
+	released = std::exchange(voice->sound, std::move(sound));
+	voice->handle = nextHandle_;
+	voice->pos = 0;
+	voice->volume = volume;
+	// Like the stereo position of an audio stream, panning only attenuates the opposite side
+	const bool stereo = channels_ == 2;
+	voice->gainLeft = volume * Scale * (stereo && pan > 0 ? 1 - pan : 1);
+	voice->gainRight = volume * Scale * (stereo && pan < 0 ? 1 + pan : 1);
+
+	const size_t active = std::count_if(voices_.begin(), voices_.end(), [](const Voice &other) { return other.handle != 0; });
+	peak_ = std::max(peak_, active);
+	return voice->handle;
+}
+
+void SoundMixer::Stop(uint32_t voice)
+{
+	if (voice == 0)
+		return;
+
+	std::shared_ptr<const PcmSound> released;
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	for (Voice &candidate : voices_) {
+		if (candidate.handle == voice) {
+			candidate.handle = 0;
+			released = std::move(candidate.sound);
+			return;
+		}
+	}
+}
+
+bool SoundMixer::IsPlaying(uint32_t voice) const
+{
+	if (voice == 0)
+		return false;
+
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	return std::any_of(voices_.begin(), voices_.end(), [voice](const Voice &candidate) { return candidate.handle == voice; });
+}
+
+void SoundMixer::StopAll()
+{
+	std::array<std::shared_ptr<const PcmSound>, MaxVoices> released;
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	for (size_t i = 0; i < MaxVoices; i++) {
+		voices_[i].handle = 0;
+		released[i] = std::move(voices_[i].sound);
+	}
+}
+
+void SoundMixer::Mix(float *out, size_t frames)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	std::fill_n(out, frames * channels_, 0.F);
+	for (Voice &voice : voices_) {
+		if (voice.handle != 0 && !MixVoice(voice, out, frames))
+			voice.handle = 0;
+	}
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+	lastFrames_ = frames;
+	lastMixMicroseconds_ = static_cast<uint32_t>(elapsed.count());
+	maxMixMicroseconds_ = std::max(maxMixMicroseconds_, lastMixMicroseconds_);
+}
+
+SoundMixerStats SoundMixer::GetStats() const
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	SoundMixerStats stats {};
+	stats.voices = MaxVoices;
+	stats.active = std::count_if(voices_.begin(), voices_.end(), [](const Voice &voice) { return voice.handle != 0; });
+	stats.peak = peak_;
+	stats.stolen = stolen_;
+	stats.dropped = dropped_;
+	stats.frames = lastFrames_;
+	stats.mixMicroseconds = lastMixMicroseconds_;
+	stats.maxMixMicroseconds = maxMixMicroseconds_;
+	return stats;
+}
+
+SoundMixer::Voice *SoundMixer::AcquireVoice(float volume)
+{
+	Voice *quietest = nullptr;
+	for (Voice &voice : voices_) {
+		if (voice.handle == 0)
+			return &voice;
+		if (quietest == nullptr || voice.volume < quietest->volume)
+			quietest = &voice;
+	}
+
+	if (quietest->volume >= volume)
+		return nullptr;
+	stolen_++;
+	return quietest;
+}
+
+bool SoundMixer::MixVoice(Voice &voice, float *out, size_t frames) const
+{
+	const PcmSound &sound = *voice.sound;
+	const size_t inChannels = sound.channels;
+	const size_t count = std::min(frames, (sound.samples.size() - voice.pos) / inChannels);
+	const int16_t *in = sound.samples.data() + voice.pos;
+	const float left = voice.gainLeft;
+	const float right = voice.gainRight;
+
+	// Branch-free loops over contiguous samples; GCC only vectorizes them with -ftree-vectorize, which the build sets for this file
+	if (channels_ == 2 && inChannels == 1) {
+		for (size_t i = 0; i < count; i++) {
+			const auto sample = static_cast<float>(in[i]);
+			out[i * 2] += sample * left;
+			out[i * 2 + 1] += sample * right;
+		}
+	} else if (channels_ == 2) {
+		for (size_t i = 0; i < count * 2; i += 2) {
+			out[i] += static_cast<float>(in[i]) * left;
+			out[i + 1] += static_cast<float>(in[i + 1]) * right;
+		}
+	} else if (inChannels == 1) {
+		for (size_t i = 0; i < count; i++)
+			out[i] += static_cast<float>(in[i]) * left;
+	} else {
+		const float half = left / 2;
+		for (size_t i = 0; i < count; i++)
+			out[i] += static_cast<float>(in[i * 2] + in[i * 2 + 1]) * half;
+	}
+
+	voice.pos += count * inChannels;
+	return voice.pos < sound.samples.size();
+}
+
+} // namespace devilution
@@ -0,0 +1,109 @@
+/**
+ * @file sound_mixer.h
+ *
+ * Mixes the decoded sound effects into a single output stream.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "utils/sdl_mutex.h"
+#include "utils/soundbank.h"
+
+namespace devilution {
+
+struct SoundMixerStats {
+	/** Number of voices of the mixer */
+	size_t voices;
+	/** Voices currently playing */
+	size_t active;
+	/** Most voices that played at once */
+	size_t peak;
+	/** Sounds that cut off a quieter one because every voice was busy */
+	uint32_t stolen;
+	/** Sounds skipped because every voice was playing something louder */
+	uint32_t dropped;
+	/** Frames mixed in the last call */
+	size_t frames;
+	/** Time it took to mix them */
+	uint32_t mixMicroseconds;
+	/** Longest time a mix took */
+	uint32_t maxMixMicroseconds;
+};
+
+/**
+ * @brief Plays decoded sounds by summing them into one buffer, so overlapping effects don't each need an audio stream.
+ *
+ * Voices are started and stopped on the game thread and mixed by the audio thread. Finished voices keep their
+ * sound until the game thread reuses them, so the audio thread never frees samples.
+ */
+class SoundMixer {
+public:
+	static constexpr size_t MaxVoices = 64;
+
+	/**
+	 * @param sampleRate Output rate, only sounds recorded at this rate can be mixed
+	 * @param channels Output channels, 1 or 2
+	 */
+	void Open(int sampleRate, int channels);
+
+	[[nodiscard]] int GetSampleRate() const
+	{
+		return sampleRate_;
+	}
+
+	/**
+	 * @brief Starts playing a sound
+	 * @param volume Linear volume from 0 to 1, quieter sounds are the first to lose their voice
+	 * @param pan Linear stereo position from -1 (left) to 1 (right)
+	 * @return Handle of the voice, 0 if the sound was dropped
+	 */
+	uint32_t Play(std::shared_ptr<const PcmSound> sound, float volume, float pan);
+
+	void Stop(uint32_t voice);
+	[[nodiscard]] bool IsPlaying(uint32_t voice) const;
+	void StopAll();
+
+	/**
+	 * @brief Called by the audio thread, overwrites the buffer with the sum of the playing voices
+	 * @param out Interleaved samples of all output channels
+	 * @param frames Number of samples per channel
+	 */
+	void Mix(float *out, size_t frames);
+
+	[[nodiscard]] SoundMixerStats GetStats() const;
+
+private:
+	struct Voice {
+		std::shared_ptr<const PcmSound> sound;
+		/** Handle the voice was started with, 0 when it isn't playing */
+		uint32_t handle;
+		/** Next sample to mix */
+		size_t pos;
+		float volume;
+		float gainLeft;
+		float gainRight;
+	};
+
+	/** @return Voice to play a new sound of the given volume on, nullptr if every voice is louder */
+	Voice *AcquireVoice(float volume);
+	/** @brief Adds a voice to the output, @return false once the sound ended */
+	bool MixVoice(Voice &voice, float *out, size_t frames) const;
+
+	mutable SdlMutex mutex_;
+	std::array<Voice, MaxVoices> voices_ {};
+	int sampleRate_ = 0;
+	int channels_ = 2;
+	uint32_t nextHandle_ = 0;
+	size_t peak_ = 0;
+	uint32_t stolen_ = 0;
+	uint32_t dropped_ = 0;
+	size_t lastFrames_ = 0;
+	uint32_t lastMixMicroseconds_ = 0;
+	uint32_t maxMixMicroseconds_ = 0;
+};
+
+} // namespace devilution
@@ -0,0 +1,153 @@
+/**
+ * @file soundbank.cpp
+ *
+ * Implementation of the decoded sound effects shared by every sample that plays them.
+ */
+#include "utils/soundbank.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "utils/endian.hpp"
+
+namespace devilution {
+
+namespace {
+
+constexpr std::uint16_t WaveFormatPcm = 1;
+constexpr std::size_t ChunkHeaderSize = 8;
+constexpr std::size_t FormatChunkSize = 16;
+
+} // namespace
+
+bool DecodeWav(const std::uint8_t *data, std::size_t size, PcmSound &sound)
+{
+	if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+		return false;
+
+	int bitsPerSample = 0;
+	sound.channels = 0;
+	std::size_t pos = 12;
+	while (size - pos >= ChunkHeaderSize) {
+		const std::uint8_t *chunk = data + pos;
+		const std::size_t chunkSize = std::min<std::size_t>(LoadLE32(chunk + 4), size - pos - ChunkHeaderSize);
+		const std::uint8_t *chunkData = chunk + ChunkHeaderSize;
+
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			if (chunkSize < FormatChunkSize || LoadLE16(chunkData) != WaveFormatPcm)
+				return false;
+			sound.channels = LoadLE16(chunkData + 2);
+			sound.sampleRate = static_cast<int>(LoadLE32(chunkData + 4));
+			bitsPerSample = LoadLE16(chunkData + 14);
+			if (sound.channels < 1 || sound.channels > 2 || sound.sampleRate <= 0 || (bitsPerSample != 8 && bitsPerSample != 16))
+				return false;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			if (sound.channels == 0)
+				return false;
+			const std::size_t bytesPerFrame = sound.channels * bitsPerSample / 8;
+			// Truncated files are played up to the last complete frame, like the audio library does
+			const std::size_t numSamples = chunkSize / bytesPerFrame * sound.channels;
+			sound.samples.resize(numSamples);
+			if (bitsPerSample == 8) {
+				constexpr std::int16_t Center = 128;
+				constexpr std::int16_t Scale = 256;
+				for (std::size_t i = 0; i < numSamples; i++)
+					sound.samples[i] = static_cast<std::int16_t>((chunkData[i] - Center) * Scale);
+			} else {
+				for (std::size_t i = 0; i < numSamples; i++)
+					sound.samples[i] = static_cast<std::int16_t>(LoadLE16(chunkData + i * 2));
+			}
+			return true;
+		}
+
+		// Chunks are padded to an even size
+		pos += ChunkHeaderSize + chunkSize + (chunkSize & 1);
+		if (pos > size)
+			break;
+	}
+
+	return false;
+}
+
+void SoundBank::SetBudget(std::size_t budget)
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	budget_ = budget;
+	Trim(nullptr);
+}
+
+std::shared_ptr<const PcmSound> SoundBank::Find(const std::string &path)
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	auto entry = entries_.find(path);
+	if (entry == entries_.end())
+		return nullptr;
+	entry->second.lastUse = ++uses_;
+	return entry->second.sound;
+}
+
+std::shared_ptr<const PcmSound> SoundBank::Add(const std::string &path, PcmSound &&sound)
+{
+	auto decoded = std::make_shared<const PcmSound>(std::move(sound));
+
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	auto inserted = entries_.emplace(path, Entry { decoded, ++uses_ });
+	if (!inserted.second)
+		return inserted.first->second.sound;
+
+	size_ += decoded->GetByteSize();
+	Trim(decoded.get());
+	return decoded;
+}
+
+void SoundBank::Pin(const std::string &path)
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	pins_[path]++;
+}
+
+void SoundBank::Unpin(const std::string &path)
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	auto pin = pins_.find(path);
+	if (pin == pins_.end())
+		return;
+	if (--pin->second == 0)
+		pins_.erase(pin);
+	Trim(nullptr);
+}
+
+std::size_t SoundBank::GetSize() const
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	return size_;
+}
+
+void SoundBank::Clear()
+{
+	const std::lock_guard<SdlMutex> lock(mutex_);
+	entries_.clear();
+	pins_.clear();
+	size_ = 0;
+}
+
+void SoundBank::Trim(const PcmSound *keep)
+{
+	while (size_ > budget_) {
+		auto oldest = entries_.end();
+		for (auto entry = entries_.begin(); entry != entries_.end(); entry++) {
+			// Sounds held by anything but the bank stay in memory even if they are dropped
+			if (entry->second.sound.use_count() > 1 || entry->second.sound.get() == keep || pins_.count(entry->first) != 0)
+				continue;
+			if (oldest == entries_.end() || entry->second.lastUse < oldest->second.lastUse)
+				oldest = entry;
+		}
+		if (oldest == entries_.end())
+			return;
+		size_ -= oldest->second.sound->GetByteSize();
+		entries_.erase(oldest);
+	}
+}
+
+} // namespace devilution
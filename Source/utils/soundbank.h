@@ -0,0 +1,91 @@
+/**
+ * @file soundbank.h
+ *
+ * Decoded sound effects shared by every sample that plays them.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/sdl_mutex.h"
+
+namespace devilution {
+
+/** A sound effect decoded to 16-bit samples, it isn't changed once decoded */
+struct PcmSound {
+	int sampleRate;
+	int channels;
+	/** Interleaved samples of all channels */
+	std::vector<std::int16_t> samples;
+
+	[[nodiscard]] std::size_t GetByteSize() const
+	{
+		return samples.size() * sizeof(samples[0]);
+	}
+};
+
+/**
+ * @brief Decodes a WAV file of 8 or 16-bit PCM samples
+ * @return false if the file is damaged or compressed, in which case it has to be left to the audio library
+ */
+bool DecodeWav(const std::uint8_t *data, std::size_t size, PcmSound &sound);
+
+/**
+ * @brief Keeps the decoded sound effects, so they are decoded once and shared by everything that plays them.
+ *
+ * When the bank is over budget, sounds that nothing holds any more are dropped, the ones used the longest time ago
+ * first. Sounds that are still loaded stay in memory either way, so they are never dropped. Neither are pinned
+ * sounds, which are waiting for something to load them.
+ */
+class SoundBank {
+public:
+	/** @param budget Bytes of samples kept in total before unused sounds are dropped */
+	explicit SoundBank(std::size_t budget = 0)
+	    : budget_(budget)
+	{
+	}
+
+	void SetBudget(std::size_t budget);
+
+	/** @return The decoded sound, nullptr if it isn't in the bank */
+	std::shared_ptr<const PcmSound> Find(const std::string &path);
+
+	/**
+	 * @brief Adds a decoded sound
+	 * @return The sound in the bank, which is the one added before if another thread was quicker
+	 */
+	std::shared_ptr<const PcmSound> Add(const std::string &path, PcmSound &&sound);
+
+	/** @brief Keeps the sound of a path in the bank until it is unpinned, also if it is added later */
+	void Pin(const std::string &path);
+	void Unpin(const std::string &path);
+
+	/** @return Bytes of samples in the bank */
+	[[nodiscard]] std::size_t GetSize() const;
+
+	void Clear();
+
+private:
+	struct Entry {
+		std::shared_ptr<const PcmSound> sound;
+		std::uint32_t lastUse;
+	};
+
+	/** Drops unused sounds while the bank is over budget, requires holding mutex_ */
+	void Trim(const PcmSound *keep);
+
+	mutable SdlMutex mutex_;
+	std::unordered_map<std::string, Entry> entries_;
+	/** Number of pins of each pinned path */
+	std::unordered_map<std::string, int> pins_;
+	std::size_t budget_;
+	std::size_t size_ = 0;
+	std::uint32_t uses_ = 0;
+};
+
+} // namespace devilution
@@ -7,6 +7,7 @@
 #include <Aulib/DecoderDrwav.h>
 #include <Aulib/ResamplerSpeex.h>
 #include <SDL.h>
+#include <aulib.h>
 #ifdef USE_SDL1
 #include "utils/sdl2_to_1_2_backports.h"
 #else
@@ -17,6 +18,7 @@
 #include "storm/storm_sdl_rw.h"
 #include "utils/log.hpp"
 #include "utils/math.h"
+#include "utils/pcm_aulib_decoder.h"
 #include "utils/stubs.h"
 
 namespace devilution {
@@ -72,6 +74,9 @@ void SoundSample::Release()
 #ifndef STREAM_ALL_AUDIO
 	file_data_ = nullptr;
 	file_data_size_ = 0;
+	pcm_ = nullptr;
+	mixer_ = nullptr;
+	voice_ = 0;
 #endif
 }
 
@@ -80,6 +85,10 @@ void SoundSample::Release()
  */
 bool SoundSample::IsPlaying()
 {
+#ifndef STREAM_ALL_AUDIO
+	if (mixer_ != nullptr)
+		return mixer_->IsPlaying(voice_);
+#endif
 	return stream_ && stream_->isPlaying();
 }
 
@@ -88,14 +97,21 @@ bool SoundSample::IsPlaying()
  */
 void SoundSample::Play(int logSoundVolume, int logUserVolume, int logPan)
 {
+	const int combinedLogVolume = logSoundVolume + logUserVolume * (ATTENUATION_MIN / VOLUME_MIN);
+	const float linearVolume = VolumeLogToLinear(combinedLogVolume, ATTENUATION_MIN, 0);
+	const float linearPan = PanLogToLinear(logPan);
+
+#ifndef STREAM_ALL_AUDIO
+	if (mixer_ != nullptr) {
+		voice_ = mixer_->Play(pcm_, linearVolume, linearPan);
+		return;
+	}
+#endif
+
 	if (!stream_)
 		return;
 
-	const int combinedLogVolume = logSoundVolume + logUserVolume * (ATTENUATION_MIN / VOLUME_MIN);
-	const float linearVolume = VolumeLogToLinear(combinedLogVolume, ATTENUATION_MIN, 0);
 	stream_->setVolume(linearVolume);
-
-	const float linearPan = PanLogToLinear(logPan);
 	stream_->setStereoPosition(linearPan);
 
 	if (!stream_->play()) {
@@ -109,6 +125,10 @@ void SoundSample::Play(int logSoundVolume, int logUserVolume, int logPan)
  */
 void SoundSample::Stop()
 {
+#ifndef STREAM_ALL_AUDIO
+	if (mixer_ != nullptr)
+		mixer_->Stop(voice_);
+#endif
 	if (stream_)
 		stream_->stop();
 }
@@ -124,6 +144,13 @@ int SoundSample::SetChunkStream(std::string filePath)
 
 	stream_ = std::make_unique<Aulib::Stream>(handle, std::make_unique<Aulib::DecoderDrwav>(),
 	    std::make_unique<Aulib::ResamplerSpeex>(sgOptions.Audio.nResamplingQuality), /*closeRw=*/true);
+#ifndef STREAM_ALL_AUDIO
+	// Only release the data of a previous chunk once its stream is gone
+	file_data_ = nullptr;
+	file_data_size_ = 0;
+	pcm_ = nullptr;
+	mixer_ = nullptr;
+#endif
 	if (!stream_->open()) {
 		stream_ = nullptr;
 		LogError(LogCategory::Audio, "Aulib::Stream::open (from SoundSample::SetChunkStream): {}", SDL_GetError());
@@ -144,6 +171,8 @@ int SoundSample::SetChunk(ArraySharedPtr<std::uint8_t> fileData, std::size_t dwB
 
 	stream_ = std::make_unique<Aulib::Stream>(buf, std::make_unique<Aulib::DecoderDrwav>(),
 	    std::make_unique<Aulib::ResamplerSpeex>(sgOptions.Audio.nResamplingQuality), /*closeRw=*/true);
+	pcm_ = nullptr;
+	mixer_ = nullptr;
 	if (!stream_->open()) {
 		stream_ = nullptr;
 		file_data_ = nullptr;
@@ -153,6 +182,37 @@ int SoundSample::SetChunk(ArraySharedPtr<std::uint8_t> fileData, std::size_t dwB
 
 	return 0;
 }
+
+int SoundSample::SetPcm(std::shared_ptr<const PcmSound> sound, SoundMixer *mixer)
+{
+	file_data_ = nullptr;
+	file_data_size_ = 0;
+
+	if (mixer != nullptr && sound->sampleRate == mixer->GetSampleRate()) {
+		stream_ = nullptr;
+		pcm_ = std::move(sound);
+		mixer_ = mixer;
+		return 0;
+	}
+
+	// Sounds recorded at the output rate, which the game's are by default, are played without resampling
+	std::unique_ptr<Aulib::Resampler> resampler;
+	if (sound->sampleRate != Aulib::sampleRate())
+		resampler = std::make_unique<Aulib::ResamplerSpeex>(sgOptions.Audio.nResamplingQuality);
+
+	stream_ = std::make_unique<Aulib::Stream>(/*rwops=*/nullptr, std::make_unique<PcmAulibDecoder>(sound),
+	    std::move(resampler), /*closeRw=*/false);
+	pcm_ = std::move(sound);
+	mixer_ = nullptr;
+	if (!stream_->open()) {
+		stream_ = nullptr;
+		pcm_ = nullptr;
+		LogError(LogCategory::Audio, "Aulib::Stream::open (from SoundSample::SetPcm): {}", SDL_GetError());
+		return -1;
+	}
+
+	return 0;
+}
 #endif
 
 /**
@@ -160,6 +220,10 @@ int SoundSample::SetChunk(ArraySharedPtr<std::uint8_t> fileData, std::size_t dwB
  */
 int SoundSample::GetLength() const
 {
+#ifndef STREAM_ALL_AUDIO
+	if (mixer_ != nullptr)
+		return static_cast<int>(pcm_->samples.size() / pcm_->channels * 1000 / pcm_->sampleRate);
+#endif
 	if (!stream_)
 		return 0;
 	return std::chrono::duration_cast<std::chrono::milliseconds>(stream_->duration()).count();
@@ -3,9 +3,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string>
 
 #include <Aulib/Stream.h>
 
+#include "utils/sound_mixer.h"
+#include "utils/soundbank.h"
 #include "utils/stdcompat/shared_ptr_array.hpp"
 
 namespace devilution {
@@ -44,15 +47,49 @@ public:
 	 * @return 0 on success, -1 otherwise
 	 */
 	int SetChunk(ArraySharedPtr<std::uint8_t> fileData, std::size_t dwBytes);
+
+	/**
+	 * @brief Sets the sample's decoded samples, which are played without decoding them again.
+	 * @param sound Samples shared with the sound bank and other samples playing the same sound
+	 * @param mixer Mixer that plays the sound if it is recorded at the output rate, otherwise it gets its own stream
+	 * @return 0 on success, -1 otherwise
+	 */
+	int SetPcm(std::shared_ptr<const PcmSound> sound, SoundMixer *mixer = nullptr);
 #endif
 
+	/**
+	 * @brief Whether the sample is played by a SoundMixer, which starts another voice when it is played again
+	 */
+	[[nodiscard]] bool IsMixed() const
+	{
+#ifndef STREAM_ALL_AUDIO
+		return mixer_ != nullptr;
+#else
+		return false;
+#endif
+	}
+
 #ifndef STREAM_ALL_AUDIO
 	[[nodiscard]] bool IsStreaming() const
 	{
-		return file_data_ == nullptr;
+		return file_data_ == nullptr && pcm_ == nullptr;
 	}
 #endif
 
+	/**
+	 * @brief Whether both samples play the same data, so this sample's stream can play the other's sound
+	 */
+	[[nodiscard]] bool HasSameSource(const SoundSample &other) const
+	{
+		if (!stream_)
+			return false;
+#ifndef STREAM_ALL_AUDIO
+		if (!IsStreaming() || !other.IsStreaming())
+			return file_data_ == other.file_data_ && pcm_ == other.pcm_;
+#endif
+		return file_path_ == other.file_path_;
+	}
+
 	int DuplicateFrom(const SoundSample &other)
 	{
 #ifdef STREAM_ALL_AUDIO
@@ -60,6 +97,8 @@ public:
 #else
 		if (other.IsStreaming())
 			return SetChunkStream(other.file_path_);
+		if (other.pcm_ != nullptr)
+			return SetPcm(other.pcm_, other.mixer_);
 		return SetChunk(other.file_data_, other.file_data_size_);
 #endif
 	}
@@ -71,6 +110,10 @@ private:
 	// Non-streaming audio fields:
 	ArraySharedPtr<std::uint8_t> file_data_;
 	std::size_t file_data_size_;
+	std::shared_ptr<const PcmSound> pcm_;
+	SoundMixer *mixer_ = nullptr;
+	/** Voice of the mixer that last played the sample */
+	uint32_t voice_ = 0;
 #endif
 
 	// Set for streaming audio to allow for duplicating it:
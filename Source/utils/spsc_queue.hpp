@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace devilution {
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ * Slots are reused in place, so elements that own memory (such as vectors) keep their
+ * capacity when they are moved in and out.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	/** @brief Called by the producer, leaves value untouched and returns false when the queue is full */
+	bool TryPush(T &&value)
+	{
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == Capacity)
+			return false;
+		items_[tail & (Capacity - 1)] = std::move(value);
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** @brief Called by the consumer, returns false when the queue is empty */
+	bool TryPop(T &value)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+			return false;
+		value = std::move(items_[head & (Capacity - 1)]);
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Empty() const
+	{
+		return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+	}
+
+private:
+	std::array<T, Capacity> items_ = {};
+	// Keep the indices on separate cache lines so the two threads don't contend
+	alignas(64) std::atomic<size_t> head_ { 0 };
+	alignas(64) std::atomic<size_t> tail_ { 0 };
+};
+
+} // namespace devilution
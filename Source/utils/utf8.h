@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <utility>
 
+#include "utils/stdcompat/string_view.hpp"
+
 /* Branchless UTF-8 decoder
  *
  * This is free and unencumbered software released into the public domain.
@@ -66,6 +70,25 @@ inline const char *utf8_decode(const char *buf, char32_t *c, int *e)
 	return reinterpret_cast<const char *>(next);
 }
 
+/**
+ * @brief Decodes the first character of the text, which unlike utf8_decode doesn't need padding
+ * @param text Text to decode, must not be empty
+ * @param c Receives the character
+ * @param e Receives the errors, see utf8_decode
+ * @return Number of bytes read, at least one
+ */
+inline size_t Utf8DecodeFirst(devilution::string_view text, char32_t *c, int *e)
+{
+	if (text.size() >= 4)
+		return utf8_decode(text.data(), c, e) - text.data();
+
+	// Only the last few characters of a text are copied to be padded
+	char buffer[4] = {};
+	memcpy(buffer, text.data(), text.size());
+	const size_t length = utf8_decode(buffer, c, e) - buffer;
+	return std::min(length, text.size());
+}
+
 inline int FindLastUtf8Symbols(const char *text)
 {
 	std::string textBuffer(text);
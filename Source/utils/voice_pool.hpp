@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace devilution {
+
+struct VoicePoolStats {
+	/** Number of voices in the pool */
+	size_t voices;
+	/** Voices currently playing */
+	size_t active;
+	/** Sounds that cut off a less important one because every voice was busy */
+	uint32_t stolen;
+	/** Sounds skipped because every voice was playing something more important */
+	uint32_t dropped;
+};
+
+/**
+ * @brief Fixed set of preallocated voices handed out by one thread and given back from any thread.
+ *
+ * Voices are acquired on the game thread and released by the audio thread once they finish
+ * playing. When every voice is busy, the one with the lowest priority, the oldest among equals,
+ * is stolen. Each acquisition gets a new token, so the release of a stolen sound that arrives
+ * late can't free the voice again.
+ */
+template <typename T, size_t Size>
+class VoicePool {
+public:
+	struct Lease {
+		/** The voice, nullptr if none could be acquired */
+		T *voice;
+		uint32_t index;
+		uint32_t token;
+	};
+
+	/**
+	 * @brief Called by the owning thread, finds a free voice or steals the least important one
+	 * @param priority Importance of the new sound, voices with a lower priority are stolen first
+	 * @return Lease of the voice, a stolen voice may still be playing and must be stopped by the caller
+	 */
+	Lease Acquire(int priority)
+	{
+		Slot *slot = nullptr;
+		uint32_t token = 0;
+		for (Slot &candidate : slots_) {
+			uint32_t state = candidate.state.load(std::memory_order_acquire);
+			if ((state & Playing) != 0)
+				continue;
+			token = NextToken(state);
+			if (candidate.state.compare_exchange_strong(state, token, std::memory_order_acq_rel)) {
+				slot = &candidate;
+				break;
+			}
+		}
+
+		if (slot == nullptr) {
+			Slot *victim = &slots_[0];
+			for (Slot &candidate : slots_) {
+				if (candidate.priority < victim->priority || (candidate.priority == victim->priority && candidate.sequence - victim->sequence > UINT32_MAX / 2))
+					victim = &candidate;
+			}
+			if (victim->priority > priority) {
+				dropped_++;
+				return { nullptr, 0, 0 };
+			}
+			token = NextToken(victim->state.load(std::memory_order_acquire));
+			victim->state.store(token, std::memory_order_release);
+			stolen_++;
+			slot = victim;
+		}
+
+		slot->priority = priority;
+		slot->sequence = nextSequence_++;
+		return { &slot->voice, static_cast<uint32_t>(slot - slots_.data()), token };
+	}
+
+	/** @brief Called from any thread, does nothing if the voice has been acquired again since */
+	void Release(uint32_t index, uint32_t token)
+	{
+		uint32_t expected = token;
+		slots_[index].state.compare_exchange_strong(expected, token & ~Playing, std::memory_order_acq_rel);
+	}
+
+	/** @brief Called by the owning thread after stopping every voice */
+	void ReleaseAll()
+	{
+		for (Slot &slot : slots_)
+			slot.state.store(NextToken(slot.state.load(std::memory_order_acquire)) & ~Playing, std::memory_order_release);
+	}
+
+	T &operator[](size_t index)
+	{
+		return slots_[index].voice;
+	}
+
+	static constexpr size_t size()
+	{
+		return Size;
+	}
+
+	VoicePoolStats GetStats() const
+	{
+		size_t active = 0;
+		for (const Slot &slot : slots_) {
+			if ((slot.state.load(std::memory_order_relaxed) & Playing) != 0)
+				active++;
+		}
+		return { Size, active, stolen_, dropped_ };
+	}
+
+private:
+	/** Set in the state of a voice while it plays, the other bits count its acquisitions */
+	static constexpr uint32_t Playing = 1;
+
+	struct Slot {
+		T voice {};
+		std::atomic<uint32_t> state { 0 };
+		// Only used by the owning thread
+		int priority = 0;
+		uint32_t sequence = 0;
+	};
+
+	static uint32_t NextToken(uint32_t state)
+	{
+		return ((state | Playing) + 2);
+	}
+
+	std::array<Slot, Size> slots_;
+	uint32_t nextSequence_ = 0;
+	uint32_t stolen_ = 0;
+	uint32_t dropped_ = 0;
+};
+
+} // namespace devilution
@@ -0,0 +1,42 @@
+/**
+ * @file bench.hpp
+ *
+ * Timing loops shared by the benchmarks of devilutionx-bench.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "engine/benchmark.hpp"
+
+namespace devilution {
+
+/**
+ * @brief Times repeated runs of a function and prints their distribution
+ * @param name Label of the printed line
+ * @param runs Number of times the function is called
+ * @param bytes Data processed by one run, to print the throughput, or 0
+ */
+template <typename Function>
+PhaseTimings TimeRuns(const char *name, int runs, uint64_t bytes, Function &&run)
+{
+	std::vector<uint64_t> samples;
+	samples.reserve(runs);
+	for (int i = 0; i < runs; i++) {
+		const auto start = std::chrono::steady_clock::now();
+		run();
+		samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	const PhaseTimings timings = SummarizeSamples(samples);
+	std::cout << name << ": mean " << timings.meanMs << " ms, p50 " << timings.p50Ms << " ms, p95 " << timings.p95Ms << " ms over " << timings.samples << " runs";
+	if (bytes != 0 && timings.p50Ms > 0)
+		std::cout << ", " << bytes / (1024.0 * 1024.0) / (timings.p50Ms / 1000) << " MiB/s";
+	std::cout << std::endl;
+	return timings;
+}
+
+} // namespace devilution
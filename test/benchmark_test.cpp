@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include "engine/benchmark.hpp"
+
+using namespace devilution;
+
+namespace {
+
+BenchmarkReport MakeReport()
+{
+	BenchmarkReport report {};
+	report.demo = 2;
+	report.frames = 12000;
+	report.seconds = 41.5;
+	report.peakRssKb = 250000;
+	for (size_t i = 0; i < NumBenchmarkPhases; i++)
+		report.phases[i] = { 12000, 1.0 + i, 0.9 + i, 2.0 + i, 3.5 + i };
+	return report;
+}
+
+TEST(Benchmark, Percentiles)
+{
+	std::vector<uint64_t> samples;
+	for (uint64_t i = 100; i >= 1; i--)
+		samples.push_back(i * 1000000);
+
+	const PhaseTimings timings = SummarizeSamples(samples);
+	EXPECT_EQ(timings.samples, 100U);
+	EXPECT_DOUBLE_EQ(timings.meanMs, 50.5);
+	EXPECT_DOUBLE_EQ(timings.p50Ms, 50);
+	EXPECT_DOUBLE_EQ(timings.p95Ms, 95);
+	EXPECT_DOUBLE_EQ(timings.p99Ms, 99);
+}
+
+TEST(Benchmark, NoSamples)
+{
+	std::vector<uint64_t> samples;
+	EXPECT_EQ(SummarizeSamples(samples).samples, 0U);
+}
+
+TEST(Benchmark, JsonRoundTrip)
+{
+	const BenchmarkReport report = MakeReport();
+	BenchmarkReport parsed;
+	ASSERT_TRUE(ParseBenchmarkJson(FormatBenchmarkJson(report), parsed));
+	EXPECT_EQ(parsed.demo, report.demo);
+	EXPECT_EQ(parsed.frames, report.frames);
+	EXPECT_DOUBLE_EQ(parsed.seconds, report.seconds);
+	EXPECT_EQ(parsed.peakRssKb, report.peakRssKb);
+	for (size_t i = 0; i < NumBenchmarkPhases; i++) {
+		EXPECT_EQ(parsed.phases[i].samples, report.phases[i].samples);
+		EXPECT_DOUBLE_EQ(parsed.phases[i].p95Ms, report.phases[i].p95Ms);
+	}
+}
+
+TEST(Benchmark, RejectsOtherJson)
+{
+	BenchmarkReport parsed;
+	EXPECT_FALSE(ParseBenchmarkJson("{ \"demo\": 1 }", parsed));
+	EXPECT_FALSE(ParseBenchmarkJson("{ \"demo\": ", parsed));
+	EXPECT_FALSE(ParseBenchmarkJson("not json", parsed));
+}
+
+TEST(Benchmark, FindsRegressions)
+{
+	const BenchmarkReport baseline = MakeReport();
+	BenchmarkReport current = baseline;
+	EXPECT_TRUE(FindBenchmarkRegressions(baseline, current, 0.1).empty());
+
+	current.phases[static_cast<size_t>(BenchmarkPhase::ProcessMonsters)].p95Ms *= 1.05;
+	EXPECT_TRUE(FindBenchmarkRegressions(baseline, current, 0.1).empty());
+
+	current.phases[static_cast<size_t>(BenchmarkPhase::ProcessMonsters)].p95Ms = baseline.phases[static_cast<size_t>(BenchmarkPhase::ProcessMonsters)].p95Ms * 1.5;
+	current.peakRssKb = baseline.peakRssKb * 2;
+	const std::vector<std::string> regressions = FindBenchmarkRegressions(baseline, current, 0.1);
+	ASSERT_EQ(regressions.size(), 2U);
+	EXPECT_EQ(regressions[0], "ProcessMonsters p95: 4.000 ms -> 6.000 ms (+50%)");
+	EXPECT_EQ(regressions[1], "peak RSS: 250000 KiB -> 500000 KiB");
+}
+
+TEST(Benchmark, IgnoresNoiseOnFastPhases)
+{
+	BenchmarkReport baseline = MakeReport();
+	baseline.phases[0] = { 100, 0.001, 0.001, 0.002, 0.003 };
+	BenchmarkReport current = baseline;
+	current.phases[0].p95Ms = 0.006;
+	EXPECT_TRUE(FindBenchmarkRegressions(baseline, current, 0.1).empty());
+}
+
+} // namespace
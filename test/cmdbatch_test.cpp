@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "cmdbatch.h"
+
+using namespace devilution;
+
+namespace {
+
+using Command = std::vector<byte>;
+using Turn = std::vector<Command>;
+
+/** Remote view of a player, changed by commands the same way their handlers in msg.cpp do */
+struct PlayerState {
+	int destX = -1;
+	int destY = -1;
+	int action = -1;
+	int param1 = -1;
+	int strength = 0;
+	std::vector<Command> events;
+
+	bool operator==(const PlayerState &other) const
+	{
+		return destX == other.destX && destY == other.destY && action == other.action
+		    && param1 == other.param1 && strength == other.strength && events == other.events;
+	}
+};
+
+template <typename T>
+Command MakeCommand(const T &cmd)
+{
+	Command data(sizeof(cmd));
+	memcpy(data.data(), &cmd, sizeof(cmd));
+	return data;
+}
+
+Command MakeLoc(_cmd_id id, uint8_t x, uint8_t y)
+{
+	TCmdLoc cmd { id, x, y };
+	return MakeCommand(cmd);
+}
+
+Command MakeParam1(_cmd_id id, uint16_t param1)
+{
+	TCmdParam1 cmd { id, param1 };
+	return MakeCommand(cmd);
+}
+
+Command MakeSpell(uint16_t monster, uint16_t spell)
+{
+	TCmdParam4 cmd { CMD_SPELLID, monster, spell, 0, 3 };
+	return MakeCommand(cmd);
+}
+
+Command MakeString(const char *text)
+{
+	Command data(1 + strlen(text) + 1);
+	data[0] = static_cast<byte>(CMD_STRING);
+	memcpy(&data[1], text, strlen(text) + 1);
+	return data;
+}
+
+void Apply(PlayerState &state, const Command &cmd)
+{
+	switch (static_cast<_cmd_id>(cmd[0])) {
+	case CMD_WALKXY:
+		state.destX = static_cast<uint8_t>(cmd[1]);
+		state.destY = static_cast<uint8_t>(cmd[2]);
+		state.action = -1;
+		break;
+	case CMD_ATTACKXY:
+		state.destX = static_cast<uint8_t>(cmd[1]);
+		state.destY = static_cast<uint8_t>(cmd[2]);
+		state.action = CMD_ATTACKXY;
+		break;
+	case CMD_ATTACKID: {
+		TCmdParam1 message;
+		memcpy(&message, cmd.data(), sizeof(message));
+		state.action = CMD_ATTACKID;
+		state.param1 = message.wParam1;
+	} break;
+	case CMD_ADDSTR: {
+		TCmdParam1 message;
+		memcpy(&message, cmd.data(), sizeof(message));
+		state.strength += message.wParam1;
+	} break;
+	default:
+		state.events.push_back(cmd);
+		break;
+	}
+}
+
+/** A scripted play session: running around, holding the mouse on monsters, casting and chatting */
+std::vector<Turn> RecordSession()
+{
+	std::vector<Turn> session;
+	uint32_t seed = 1;
+	auto next = [&seed](uint32_t range) {
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) % range;
+	};
+
+	uint8_t x = 40;
+	uint8_t y = 40;
+	for (int i = 0; i < 200; i++) {
+		Turn turn;
+		const uint32_t count = next(12);
+		for (uint32_t c = 0; c < count; c++) {
+			switch (next(8)) {
+			case 0:
+			case 1:
+			case 2:
+				x += next(3) - 1;
+				y += next(3) - 1;
+				turn.push_back(MakeLoc(CMD_WALKXY, x, y));
+				break;
+			case 3:
+			case 4:
+				turn.push_back(MakeParam1(CMD_ATTACKID, next(3) + 4));
+				break;
+			case 5:
+				turn.push_back(MakeLoc(CMD_ATTACKXY, x + 1, y));
+				break;
+			case 6:
+				turn.push_back(MakeSpell(next(200), next(40)));
+				break;
+			default:
+				if (next(4) == 0)
+					turn.push_back(MakeString("hello there"));
+				else
+					turn.push_back(MakeParam1(CMD_ADDSTR, 1));
+				break;
+			}
+		}
+		session.push_back(turn);
+	}
+	return session;
+}
+
+size_t RawSize(const Turn &turn)
+{
+	size_t size = 0;
+	for (const Command &cmd : turn)
+		size += cmd.size();
+	return size;
+}
+
+TEST(CmdBatch, PackedCommandsRoundTrip)
+{
+	const Turn commands = {
+		MakeLoc(CMD_WALKXY, 10, 200),
+		MakeParam1(CMD_ATTACKID, 199),
+		MakeSpell(0xFFFF, 36),
+		MakeString("a message that has no packed layout"),
+		Command { static_cast<byte>(CMD_DEACTIVATEPORTAL) },
+	};
+
+	for (const Command &cmd : commands) {
+		byte packed[MaxQueuedCommandSize + 4];
+		const size_t packedSize = PackCommand(cmd.data(), cmd.size(), packed, sizeof(packed));
+		ASSERT_NE(packedSize, 0U);
+
+		byte unpacked[MaxQueuedCommandSize];
+		size_t unpackedSize;
+		ASSERT_EQ(UnpackCommand(packed, packedSize, unpacked, unpackedSize), packedSize);
+		ASSERT_EQ(unpackedSize, cmd.size());
+		EXPECT_EQ(memcmp(unpacked, cmd.data(), cmd.size()), 0);
+	}
+}
+
+TEST(CmdBatch, SmallParametersTakeOneByte)
+{
+	const Command cmd = MakeParam1(CMD_ATTACKID, 12);
+	byte packed[8];
+	EXPECT_EQ(PackCommand(cmd.data(), cmd.size(), packed, sizeof(packed)), 2U);
+}
+
+TEST(CmdBatch, RejectsMalformedData)
+{
+	byte cmd[MaxQueuedCommandSize];
+	size_t cmdSize;
+
+	const byte batch[] = { static_cast<byte>(CMD_BATCH), byte { 0 } };
+	EXPECT_EQ(UnpackCommand(batch, sizeof(batch), cmd, cmdSize), 0U);
+
+	const byte truncated[] = { static_cast<byte>(CMD_SPELLID), byte { 0x80 } };
+	EXPECT_EQ(UnpackCommand(truncated, sizeof(truncated), cmd, cmdSize), 0U);
+
+	const byte tooLong[] = { static_cast<byte>(CMD_STRING | 0x80), byte { 0x7F } };
+	EXPECT_EQ(UnpackCommand(tooLong, sizeof(tooLong), cmd, cmdSize), 0U);
+}
+
+TEST(CmdBatch, QueueCollapsesRedundantCommands)
+{
+	TBuffer buf {};
+	const Command walk1 = MakeLoc(CMD_WALKXY, 1, 1);
+	const Command walk2 = MakeLoc(CMD_WALKXY, 2, 2);
+	const Command attack = MakeParam1(CMD_ATTACKID, 5);
+	const Command str = MakeParam1(CMD_ADDSTR, 1);
+
+	for (const Command *cmd : { &walk1, &attack, &attack, &str, &str, &walk2 })
+		QueueCommand(buf, cmd->data(), cmd->size());
+
+	byte packed[64];
+	const size_t packedSize = PackQueuedCommands(buf, packed, sizeof(packed));
+	EXPECT_EQ(buf.dwNextWriteOffset, 0U);
+
+	std::vector<Command> sent;
+	for (size_t offset = 0; offset < packedSize;) {
+		byte cmd[MaxQueuedCommandSize];
+		size_t cmdSize;
+		const size_t consumed = UnpackCommand(&packed[offset], packedSize - offset, cmd, cmdSize);
+		ASSERT_NE(consumed, 0U);
+		sent.emplace_back(cmd, cmd + cmdSize);
+		offset += consumed;
+	}
+
+	const std::vector<Command> expected = { attack, str, str, walk2 };
+	EXPECT_EQ(sent, expected);
+}
+
+TEST(CmdBatch, ReplayedSessionReachesSameState)
+{
+	const std::vector<Turn> session = RecordSession();
+
+	PlayerState reference;
+	PlayerState batched;
+	TBuffer buf {};
+	size_t rawBytes = 0;
+	size_t packedBytes = 0;
+
+	for (const Turn &turn : session) {
+		for (const Command &cmd : turn) {
+			Apply(reference, cmd);
+			QueueCommand(buf, cmd.data(), static_cast<uint8_t>(cmd.size()));
+		}
+		rawBytes += RawSize(turn);
+
+		// Leave room for the player header and the monster sync like NetSendHiPri does
+		byte packed[400];
+		const size_t packedSize = PackQueuedCommands(buf, packed, sizeof(packed));
+		ASSERT_EQ(buf.dwNextWriteOffset, 0U);
+		packedBytes += packedSize;
+
+		for (size_t offset = 0; offset < packedSize;) {
+			byte cmd[MaxQueuedCommandSize];
+			size_t cmdSize;
+			const size_t consumed = UnpackCommand(&packed[offset], packedSize - offset, cmd, cmdSize);
+			ASSERT_NE(consumed, 0U);
+			Apply(batched, Command(cmd, cmd + cmdSize));
+			offset += consumed;
+		}
+
+		ASSERT_EQ(batched, reference);
+	}
+
+	EXPECT_LT(packedBytes, rawBytes * 3 / 4);
+}
+
+} // namespace
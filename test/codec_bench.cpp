@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "bench.hpp"
+#include "codec.h"
+
+using namespace devilution;
+
+namespace {
+
+std::vector<byte> MakeCodecTestData(size_t size)
+{
+	std::vector<byte> data(codec_get_encoded_len(size));
+	for (size_t i = 0; i < size; i++)
+		data[i] = static_cast<byte>((i * 7 + (i >> 8)) & 0xFF);
+	return data;
+}
+
+TEST(CodecBench, EncodeDecode)
+{
+	constexpr size_t Size = 16 * 1024 * 1024;
+	std::vector<byte> data = MakeCodecTestData(Size);
+
+	TimeRuns("Encode and decode 16 MiB", 10, 2 * Size, [&]() {
+		codec_encode(data.data(), Size, data.size(), "xrgyrkj1");
+		ASSERT_EQ(codec_decode(data.data(), data.size(), "xrgyrkj1"), Size);
+	});
+}
+
+} // namespace
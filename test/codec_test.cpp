@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "codec.h"
+#include "utils/hash.hpp"
 
 using namespace devilution;
 
@@ -13,3 +18,49 @@ TEST(Codec, codec_get_encoded_len_eq)
 {
 	EXPECT_EQ(codec_get_encoded_len(128), 136);
 }
+
+namespace {
+
+std::vector<byte> MakeCodecTestData(size_t size)
+{
+	std::vector<byte> data(codec_get_encoded_len(size));
+	for (size_t i = 0; i < size; i++)
+		data[i] = static_cast<byte>((i * 7 + (i >> 8)) & 0xFF);
+	return data;
+}
+
+} // namespace
+
+TEST(Codec, EncodeMatchesExistingSaves)
+{
+	// Hashes of the output of the original byte-at-a-time implementation
+	const std::pair<size_t, uint64_t> expected[] = {
+		{ 0, 0xACB22139F9BD966DULL },
+		{ 1, 0xE11E55B2C666F79BULL },
+		{ 63, 0x00FAE7E091EE9953ULL },
+		{ 64, 0x22819C286F65DB57ULL },
+		{ 65, 0x4D4C1441342AC510ULL },
+		{ 1000, 0xA90812C87F4C4865ULL },
+		{ 300000, 0x352643A6D2F57E1AULL },
+	};
+
+	for (const auto &entry : expected) {
+		std::vector<byte> data = MakeCodecTestData(entry.first);
+		codec_encode(data.data(), entry.first, data.size(), "xrgyrkj1");
+		EXPECT_EQ(Fnv1a(data.data(), data.size()), entry.second) << entry.first;
+	}
+}
+
+TEST(Codec, DecodeRoundTrip)
+{
+	constexpr size_t Size = 1000;
+	std::vector<byte> data = MakeCodecTestData(Size);
+	const std::vector<byte> original = data;
+	codec_encode(data.data(), Size, data.size(), "xrgyrkj1");
+	EXPECT_EQ(codec_decode(data.data(), data.size(), "szqnlsk1"), 0);
+
+	data = original;
+	codec_encode(data.data(), Size, data.size(), "xrgyrkj1");
+	ASSERT_EQ(codec_decode(data.data(), data.size(), "xrgyrkj1"), Size);
+	EXPECT_TRUE(std::equal(original.begin(), original.begin() + Size, data.begin()));
+}
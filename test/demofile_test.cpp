@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "engine/demofile.hpp"
+
+using namespace devilution;
+
+namespace {
+
+constexpr const char *DemoPath = "demofile_test.dmo";
+
+bool operator==(const DemoEvent &a, const DemoEvent &b)
+{
+	return a.type == b.type && a.message == b.message && a.wParam == b.wParam && a.lParam == b.lParam
+	    && a.progressToNextGameTick == b.progressToNextGameTick;
+}
+
+/** A session of ticks, extra frames in between and mouse movement, with a keyframe every 600 ticks */
+std::vector<DemoEvent> RecordSession(uint32_t ticks)
+{
+	DemoWriter writer;
+	EXPECT_TRUE(writer.Open(DemoPath, { 3, 800, 600 }));
+
+	std::vector<DemoEvent> events;
+	uint32_t seed = 1;
+	auto next = [&seed](uint32_t range) {
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) % range;
+	};
+	int32_t x = 320;
+	int32_t y = 240;
+	for (uint32_t tick = 0; tick < ticks; tick++) {
+		for (uint32_t i = next(4); i > 0; i--) {
+			x += static_cast<int32_t>(next(9)) - 4;
+			y += static_cast<int32_t>(next(9)) - 4;
+			const DemoEvent move { DemoMsgType::Message, 0x0200, 0, static_cast<int32_t>((static_cast<uint32_t>(y) << 16) | static_cast<uint16_t>(x)), next(3) / 3.F };
+			writer.WriteEvent(move);
+			events.push_back(move);
+			const DemoEvent render { DemoMsgType::Rendering, 0, 0, 0, next(3) / 3.F };
+			writer.WriteEvent(render);
+			events.push_back(render);
+		}
+		if (tick % DemoKeyframeInterval == 0)
+			writer.WriteKeyframe(tick, tick * 7);
+		const DemoEvent gameTick { DemoMsgType::GameTick, 0, 0, 0, 0 };
+		writer.WriteEvent(gameTick);
+		events.push_back(gameTick);
+	}
+	writer.Close();
+	return events;
+}
+
+TEST(DemoFile, EventsRoundTrip)
+{
+	const std::vector<DemoEvent> recorded = RecordSession(5000);
+
+	DemoReader reader;
+	DemoHeader header;
+	ASSERT_TRUE(reader.Open(DemoPath, header));
+	EXPECT_EQ(header.saveNumber, 3U);
+	EXPECT_EQ(header.width, 800U);
+	EXPECT_EQ(header.height, 600U);
+
+	std::vector<DemoEvent> played;
+	std::vector<uint32_t> keyframeTicks;
+	uint32_t tick = 0;
+	DemoEvent event;
+	while (reader.Peek(event)) {
+		DemoKeyframe keyframe;
+		if (reader.TakeKeyframe(keyframe)) {
+			EXPECT_EQ(keyframe.tick, tick);
+			EXPECT_EQ(keyframe.stateHash, tick * 7);
+			keyframeTicks.push_back(keyframe.tick);
+		}
+		played.push_back(event);
+		reader.Pop();
+		if (event.type == DemoMsgType::GameTick)
+			tick++;
+	}
+	reader.Close();
+	remove(DemoPath);
+
+	ASSERT_EQ(played.size(), recorded.size());
+	for (size_t i = 0; i < played.size(); i++)
+		ASSERT_TRUE(played[i] == recorded[i]) << "event " << i;
+	EXPECT_EQ(keyframeTicks, (std::vector<uint32_t> { 0, 600, 1200, 1800, 2400, 3000, 3600, 4200, 4800 }));
+}
+
+TEST(DemoFile, SeeksToKeyframe)
+{
+	RecordSession(2000);
+
+	DemoReader reader;
+	DemoHeader header;
+	ASSERT_TRUE(reader.Open(DemoPath, header));
+	ASSERT_TRUE(reader.SeekToKeyframe(1500));
+
+	DemoEvent event;
+	ASSERT_TRUE(reader.Peek(event));
+	EXPECT_EQ(event.type, DemoMsgType::GameTick);
+	DemoKeyframe keyframe;
+	ASSERT_TRUE(reader.TakeKeyframe(keyframe));
+	EXPECT_EQ(keyframe.tick, 1200U);
+	reader.Close();
+	remove(DemoPath);
+}
+
+TEST(DemoFile, RejectsTextDemo)
+{
+	FILE *file = fopen(DemoPath, "wb");
+	ASSERT_NE(file, nullptr);
+	fputs("0,1,640,480\n0,0\n", file);
+	fclose(file);
+
+	DemoReader reader;
+	DemoHeader header;
+	EXPECT_FALSE(reader.Open(DemoPath, header));
+	remove(DemoPath);
+}
+
+TEST(DemoFile, IsSmallerThanTextFormat)
+{
+	const std::vector<DemoEvent> recorded = RecordSession(5000);
+	size_t textSize = 0;
+	for (const DemoEvent &event : recorded) {
+		char line[64];
+		if (event.type == DemoMsgType::Message)
+			textSize += snprintf(line, sizeof(line), "2,%g,%u,%d,%d\n", event.progressToNextGameTick, event.message, event.wParam, event.lParam);
+		else
+			textSize += snprintf(line, sizeof(line), "%d,%g\n", static_cast<int>(event.type), event.progressToNextGameTick);
+	}
+
+	FILE *file = fopen(DemoPath, "rb");
+	ASSERT_NE(file, nullptr);
+	fseek(file, 0, SEEK_END);
+	const long binarySize = ftell(file);
+	fclose(file);
+	remove(DemoPath);
+
+	EXPECT_LT(static_cast<size_t>(binarySize), textSize / 4);
+}
+
+} // namespace
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "bench.hpp"
+#include "encrypt.h"
+#include "msg.h"
+
+using namespace devilution;
+
+namespace {
+
+/** Data shaped like a level delta: mostly unused 0xFF entries with a few filled in. */
+std::vector<byte> MakeDeltaData()
+{
+	std::vector<byte> data(sizeof(DLevel), byte { 0xFF });
+	uint32_t seed = 1;
+	for (size_t i = 0; i < data.size(); i += 22) {
+		seed = seed * 1103515245 + 12345;
+		if (((seed >> 16) & 7) == 0) {
+			for (size_t j = i; j < std::min(i + 22, data.size()); j++)
+				data[j] = static_cast<byte>(j * 3);
+		}
+	}
+	return data;
+}
+
+/** Data shaped like a saved level: mostly empty grids with scattered entries. */
+std::vector<byte> MakeLevelData(size_t size)
+{
+	std::vector<byte> data(size);
+	uint32_t seed = 2;
+	for (byte &value : data) {
+		seed = seed * 1103515245 + 12345;
+		if (((seed >> 16) & 7) == 0)
+			value = static_cast<byte>(seed >> 24);
+	}
+	return data;
+}
+
+TEST(PkwareBench, CompressDeltaAndSectors)
+{
+	const std::vector<byte> delta = MakeDeltaData();
+	const std::vector<byte> level = MakeLevelData(128 * 1024);
+	std::vector<byte> compressed(level.size());
+	std::vector<byte> decompressed(level.size());
+	PkwareWorkBuffer work;
+
+	TimeRuns("Compress and decompress a delta and a level", 20, delta.size() + level.size(), [&]() {
+		const uint32_t deltaSize = PkwareCompress(delta.data(), delta.size(), compressed.data(), compressed.size(), work);
+		PkwareDecompress(compressed.data(), deltaSize, decompressed.data(), decompressed.size(), work);
+		for (size_t offset = 0; offset < level.size(); offset += 4096) {
+			const uint32_t sectorSize = PkwareCompress(&level[offset], 4096, compressed.data(), 4096, work);
+			PkwareDecompress(compressed.data(), sectorSize, decompressed.data(), 4096, work);
+		}
+	});
+}
+
+} // namespace
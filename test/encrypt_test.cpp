@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "encrypt.h"
+#include "msg.h"
+
+using namespace devilution;
+
+namespace {
+
+/** Data shaped like a level delta: mostly unused 0xFF entries with a few filled in. */
+std::vector<byte> MakeDeltaData()
+{
+	std::vector<byte> data(sizeof(DLevel), byte { 0xFF });
+	uint32_t seed = 1;
+	for (size_t i = 0; i < data.size(); i += 22) {
+		seed = seed * 1103515245 + 12345;
+		if (((seed >> 16) & 7) == 0) {
+			for (size_t j = i; j < std::min(i + 22, data.size()); j++)
+				data[j] = static_cast<byte>(j * 3);
+		}
+	}
+	return data;
+}
+
+/** Data shaped like a saved level: mostly empty grids with scattered entries. */
+std::vector<byte> MakeLevelData(size_t size)
+{
+	std::vector<byte> data(size);
+	uint32_t seed = 2;
+	for (byte &value : data) {
+		seed = seed * 1103515245 + 12345;
+		if (((seed >> 16) & 7) == 0)
+			value = static_cast<byte>(seed >> 24);
+	}
+	return data;
+}
+
+std::vector<byte> MakeRandomData(size_t size)
+{
+	std::vector<byte> data(size);
+	uint32_t seed = 3;
+	for (byte &value : data) {
+		seed = seed * 1103515245 + 12345;
+		value = static_cast<byte>(seed >> 24);
+	}
+	return data;
+}
+
+void ExpectRoundTrip(const std::vector<byte> &original, PkwareWorkBuffer &work)
+{
+	std::vector<byte> compressed(original.size());
+	const uint32_t compressedSize = PkwareCompress(original.data(), original.size(), compressed.data(), compressed.size(), work);
+	ASSERT_NE(compressedSize, 0);
+	ASSERT_LT(compressedSize, original.size());
+
+	std::vector<byte> decompressed(original.size());
+	ASSERT_EQ(PkwareDecompress(compressed.data(), compressedSize, decompressed.data(), decompressed.size(), work), original.size());
+	EXPECT_EQ(decompressed, original);
+}
+
+} // namespace
+
+TEST(Pkware, RoundTrip)
+{
+	PkwareWorkBuffer work;
+	ExpectRoundTrip(MakeDeltaData(), work);
+	ExpectRoundTrip(MakeLevelData(4096), work);
+	ExpectRoundTrip(MakeLevelData(100), work);
+}
+
+TEST(Pkware, InPlaceMatchesSeparateBuffers)
+{
+	PkwareWorkBuffer work;
+	const std::vector<byte> original = MakeDeltaData();
+	std::vector<byte> separate(original.size());
+	const uint32_t separateSize = PkwareCompress(original.data(), original.size(), separate.data(), separate.size(), work);
+
+	std::vector<byte> inPlace = original;
+	ASSERT_EQ(PkwareCompress(inPlace.data(), inPlace.size(), work), separateSize);
+	EXPECT_EQ(memcmp(inPlace.data(), separate.data(), separateSize), 0);
+
+	PkwareDecompress(inPlace.data(), separateSize, inPlace.size(), work);
+	EXPECT_EQ(inPlace, original);
+}
+
+TEST(Pkware, IncompressibleData)
+{
+	PkwareWorkBuffer work;
+	const std::vector<byte> original = MakeRandomData(4096);
+	std::vector<byte> compressed(original.size());
+	EXPECT_EQ(PkwareCompress(original.data(), original.size(), compressed.data(), compressed.size(), work), 0);
+
+	std::vector<byte> inPlace = original;
+	EXPECT_EQ(PkwareCompress(inPlace.data(), inPlace.size(), work), original.size());
+	EXPECT_EQ(inPlace, original);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "bench.hpp"
+#include "dvlnet/frame_queue.h"
+
+#if !defined(NONET) && !defined(DISABLE_TCP)
+#include <array>
+#include <thread>
+
+#include <asio/ts/buffer.hpp>
+#include <asio/ts/internet.hpp>
+#include <asio/ts/io_context.hpp>
+#include <asio/ts/net.hpp>
+#endif
+
+using namespace devilution;
+using namespace devilution::net;
+
+namespace {
+
+/** Mix of small game messages and level sized deltas */
+std::vector<buffer_t> MakePayloads()
+{
+	std::vector<buffer_t> payloads;
+	for (int i = 0; i < 256; i++) {
+		buffer_t payload(i % 16 == 0 ? 30000 : 20 + i % 200);
+		for (size_t j = 0; j < payload.size(); j++)
+			payload[j] = static_cast<unsigned char>(i + j * 7);
+		payloads.push_back(std::move(payload));
+	}
+	return payloads;
+}
+
+TEST(FrameQueueBench, Parse)
+{
+	const std::vector<buffer_t> payloads = MakePayloads();
+	buffer_t stream;
+	for (const buffer_t &payload : payloads) {
+		buffer_t frame = frame_queue::MakeFrame(payload);
+		stream.insert(stream.end(), frame.begin(), frame.end());
+	}
+
+	frame_queue queue;
+	TimeRuns("Parse a stream of 256 frames", 200, stream.size(), [&]() {
+		size_t frames = 0;
+		for (size_t pos = 0; pos < stream.size();) {
+			size_t len = std::min<size_t>(1460, stream.size() - pos);
+			std::memcpy(queue.WriteBuffer(), &stream[pos], len);
+			queue.CommitWrite(len);
+			pos += len;
+			while (queue.PacketReady()) {
+				frames++;
+				queue.PopPacket();
+			}
+		}
+		ASSERT_EQ(frames, payloads.size());
+	});
+}
+
+#if !defined(NONET) && !defined(DISABLE_TCP)
+TEST(FrameQueueBench, Loopback)
+{
+	const std::vector<buffer_t> payloads = MakePayloads();
+	size_t bytes = 0;
+	std::vector<std::shared_ptr<const outgoing_frame>> frames;
+	for (const buffer_t &payload : payloads) {
+		frames.push_back(frame_queue::MakeOutgoingFrame(std::make_shared<const buffer_t>(payload)));
+		bytes += payload.size();
+	}
+
+	asio::io_context ioc;
+	asio::ip::tcp::acceptor acceptor(ioc, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+	asio::ip::tcp::socket receiver(ioc);
+	asio::ip::tcp::socket sender(ioc);
+	sender.connect(acceptor.local_endpoint());
+	acceptor.accept(receiver);
+	sender.set_option(asio::ip::tcp::no_delay(true));
+
+	frame_queue queue;
+	TimeRuns("Send 256 frames over loopback", 50, bytes, [&]() {
+		// Blocking writes would stall once the socket buffers fill, so the receiver runs alongside
+		std::thread sendThread([&]() {
+			for (const auto &frame : frames) {
+				std::array<asio::const_buffer, 2> bufs { asio::buffer(frame->header), asio::buffer(*frame->payload) };
+				asio::write(sender, bufs);
+			}
+		});
+		size_t received = 0;
+		while (received < payloads.size()) {
+			size_t len = receiver.receive(asio::buffer(queue.WriteBuffer(), queue.WriteCapacity()));
+			queue.CommitWrite(len);
+			while (queue.PacketReady()) {
+				EXPECT_EQ(queue.PeekPacket().size, payloads[received].size());
+				queue.PopPacket();
+				received++;
+			}
+		}
+		sendThread.join();
+	});
+}
+#endif
+
+} // namespace
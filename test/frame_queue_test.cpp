@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "dvlnet/frame_queue.h"
+
+using namespace devilution;
+using namespace devilution::net;
+
+namespace {
+
+buffer_t MakePayload(size_t size, unsigned char seed)
+{
+	buffer_t payload(size);
+	for (size_t i = 0; i < size; i++)
+		payload[i] = static_cast<unsigned char>(seed + i * 7);
+	return payload;
+}
+
+buffer_t MakeStream(const std::vector<buffer_t> &payloads)
+{
+	buffer_t stream;
+	for (const buffer_t &payload : payloads) {
+		buffer_t frame = frame_queue::MakeFrame(payload);
+		stream.insert(stream.end(), frame.begin(), frame.end());
+	}
+	return stream;
+}
+
+/** Feeds the stream to the queue in chunks of the given size, the way a socket would, and collects the frames */
+std::vector<buffer_t> ReceiveInChunks(frame_queue &queue, const buffer_t &stream, size_t chunkSize)
+{
+	std::vector<buffer_t> frames;
+	for (size_t pos = 0; pos < stream.size(); pos += chunkSize) {
+		size_t len = std::min(chunkSize, stream.size() - pos);
+		unsigned char *dest = queue.WriteBuffer();
+		if (len <= queue.WriteCapacity()) {
+			std::memcpy(dest, &stream[pos], len);
+			queue.CommitWrite(len);
+		} else {
+			queue.Write(&stream[pos], len);
+		}
+		while (queue.PacketReady())
+			frames.push_back(queue.ReadPacket());
+	}
+	return frames;
+}
+
+TEST(FrameQueue, ChunkBoundaries)
+{
+	const std::vector<buffer_t> payloads = {
+		MakePayload(1, 1),
+		MakePayload(100, 2),
+		MakePayload(frame_queue::max_frame_size, 3),
+		MakePayload(3, 4),
+		MakePayload(frame_queue::max_frame_size, 5),
+		MakePayload(5000, 6),
+	};
+	const buffer_t stream = MakeStream(payloads);
+
+	for (size_t chunkSize : { size_t { 1 }, size_t { 3 }, size_t { 1000 }, size_t { 65539 }, stream.size() }) {
+		frame_queue queue;
+		EXPECT_EQ(ReceiveInChunks(queue, stream, chunkSize), payloads) << "chunk size " << chunkSize;
+		EXPECT_FALSE(queue.PacketReady());
+	}
+}
+
+TEST(FrameQueue, PeekDoesNotConsume)
+{
+	frame_queue queue;
+	const buffer_t payload = MakePayload(10, 9);
+	const buffer_t frame = frame_queue::MakeFrame(payload);
+	queue.Write(frame.data(), frame.size());
+
+	ASSERT_TRUE(queue.PacketReady());
+	frame_view view = queue.PeekPacket();
+	ASSERT_EQ(view.size, payload.size());
+	EXPECT_EQ(std::memcmp(view.data, payload.data(), payload.size()), 0);
+	EXPECT_TRUE(queue.PacketReady());
+	queue.PopPacket();
+	EXPECT_FALSE(queue.PacketReady());
+	EXPECT_THROW(queue.PeekPacket(), frame_queue_exception);
+}
+
+TEST(FrameQueue, WriteGrowsForBacklog)
+{
+	// ZeroTier peers queue everything they receive before frames are read
+	const std::vector<buffer_t> payloads(8, MakePayload(frame_queue::max_frame_size, 1));
+	const buffer_t stream = MakeStream(payloads);
+	frame_queue queue;
+	queue.Write(stream.data(), stream.size());
+	for (const buffer_t &payload : payloads) {
+		ASSERT_TRUE(queue.PacketReady());
+		EXPECT_EQ(queue.ReadPacket(), payload);
+	}
+	EXPECT_FALSE(queue.PacketReady());
+}
+
+TEST(FrameQueue, RejectsInvalidSizes)
+{
+	for (framesize_t size : { framesize_t { 0 }, framesize_t { frame_queue::max_frame_size + 1 } }) {
+		frame_queue queue;
+		unsigned char header[sizeof(framesize_t)];
+		std::memcpy(header, &size, sizeof(header));
+		queue.Write(header, sizeof(header));
+		EXPECT_THROW(queue.PacketReady(), frame_queue_exception);
+	}
+}
+
+TEST(FrameQueue, OutgoingFrameMatchesStream)
+{
+	const buffer_t payload = MakePayload(300, 4);
+	auto frame = frame_queue::MakeOutgoingFrame(std::make_shared<const buffer_t>(payload));
+	buffer_t joined(frame->header.begin(), frame->header.end());
+	joined.insert(joined.end(), frame->payload->begin(), frame->payload->end());
+	EXPECT_EQ(joined, frame_queue::MakeFrame(payload));
+}
+
+TEST(FrameQueue, StreamReceptionKeepsBuffer)
+{
+	// Mix of small game messages and level sized deltas
+	std::vector<buffer_t> payloads;
+	for (int i = 0; i < 256; i++)
+		payloads.push_back(MakePayload(i % 16 == 0 ? 30000 : 20 + i % 200, i));
+	const buffer_t stream = MakeStream(payloads);
+
+	frame_queue queue;
+	const unsigned char *storage = queue.WriteBuffer();
+	size_t frames = 0;
+	for (size_t pos = 0; pos < stream.size();) {
+		size_t len = std::min<size_t>(1460, stream.size() - pos);
+		std::memcpy(queue.WriteBuffer(), &stream[pos], len);
+		queue.CommitWrite(len);
+		pos += len;
+		while (queue.PacketReady()) {
+			EXPECT_EQ(queue.PeekPacket().size, payloads[frames].size());
+			frames++;
+			queue.PopPacket();
+		}
+	}
+	EXPECT_EQ(frames, payloads.size());
+	// Stream reception never reallocates the receive buffer
+	EXPECT_EQ(queue.WriteBuffer(), storage);
+}
+
+} // namespace
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "heroindex.h"
+
+using namespace devilution;
+
+namespace {
+
+HeroIndexEntry MakeEntry(uint32_t saveNumber, const char *name, HeroClass heroClass)
+{
+	HeroIndexEntry entry {};
+	entry.fileSize = 40000 + saveNumber;
+	entry.modified = 1600000000 + saveNumber;
+	entry.hero.saveNumber = saveNumber;
+	strcpy(entry.hero.name, name);
+	entry.hero.level = 30;
+	entry.hero.heroclass = heroClass;
+	entry.hero.herorank = 2;
+	entry.hero.strength = 250;
+	entry.hero.magic = 15;
+	entry.hero.dexterity = 60;
+	entry.hero.vitality = 300;
+	entry.hero.hassaved = true;
+	entry.hero.spawned = false;
+	return entry;
+}
+
+} // namespace
+
+TEST(HeroIndex, RoundTrip)
+{
+	const std::vector<HeroIndexEntry> entries = {
+		MakeEntry(0, "Aidan", HeroClass::Warrior),
+		MakeEntry(7, "Jersey", HeroClass::Barbarian),
+	};
+
+	std::vector<HeroIndexEntry> parsed;
+	ASSERT_TRUE(ParseHeroIndex(FormatHeroIndex(entries), parsed));
+	ASSERT_EQ(parsed.size(), entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		EXPECT_EQ(parsed[i].fileSize, entries[i].fileSize);
+		EXPECT_EQ(parsed[i].modified, entries[i].modified);
+		EXPECT_EQ(parsed[i].hero.saveNumber, entries[i].hero.saveNumber);
+		EXPECT_STREQ(parsed[i].hero.name, entries[i].hero.name);
+		EXPECT_EQ(parsed[i].hero.level, entries[i].hero.level);
+		EXPECT_EQ(parsed[i].hero.heroclass, entries[i].hero.heroclass);
+		EXPECT_EQ(parsed[i].hero.herorank, entries[i].hero.herorank);
+		EXPECT_EQ(parsed[i].hero.strength, entries[i].hero.strength);
+		EXPECT_EQ(parsed[i].hero.magic, entries[i].hero.magic);
+		EXPECT_EQ(parsed[i].hero.dexterity, entries[i].hero.dexterity);
+		EXPECT_EQ(parsed[i].hero.vitality, entries[i].hero.vitality);
+		EXPECT_EQ(parsed[i].hero.hassaved, entries[i].hero.hassaved);
+		EXPECT_EQ(parsed[i].hero.spawned, entries[i].hero.spawned);
+	}
+}
+
+TEST(HeroIndex, RejectsDamagedIndex)
+{
+	const std::string data = FormatHeroIndex({ MakeEntry(3, "Pepin", HeroClass::Monk) });
+	std::vector<HeroIndexEntry> parsed;
+
+	EXPECT_FALSE(ParseHeroIndex(data.substr(0, data.size() - 1), parsed));
+	EXPECT_FALSE(ParseHeroIndex("", parsed));
+
+	std::string badMagic = data;
+	badMagic[0] = 'X';
+	EXPECT_FALSE(ParseHeroIndex(badMagic, parsed));
+	EXPECT_TRUE(parsed.empty());
+}
+
+TEST(HeroIndex, ChangedSaveIsStale)
+{
+	std::vector<HeroIndexEntry> entries = { MakeEntry(1, "Gillian", HeroClass::Rogue) };
+
+	HeroIndexEntry save {};
+	save.hero.saveNumber = 1;
+	save.fileSize = entries[0].fileSize;
+	save.modified = entries[0].modified;
+	EXPECT_EQ(FindHeroIndexEntry(entries, save), &entries[0]);
+
+	save.modified++;
+	EXPECT_EQ(FindHeroIndexEntry(entries, save), nullptr);
+
+	save.modified--;
+	save.fileSize++;
+	EXPECT_EQ(FindHeroIndexEntry(entries, save), nullptr);
+
+	save.hero.saveNumber = 2;
+	EXPECT_EQ(FindHeroIndexEntry(entries, save), nullptr);
+}
+
+TEST(HeroIndex, UpdateReplacesEntryOfSave)
+{
+	std::vector<HeroIndexEntry> entries = { MakeEntry(1, "Gillian", HeroClass::Rogue) };
+
+	HeroIndexEntry update = MakeEntry(1, "Gillian", HeroClass::Rogue);
+	update.hero.level = 31;
+	UpdateHeroIndexEntry(entries, update);
+	ASSERT_EQ(entries.size(), 1);
+	EXPECT_EQ(entries[0].hero.level, 31);
+
+	UpdateHeroIndexEntry(entries, MakeEntry(4, "Adria", HeroClass::Sorcerer));
+	EXPECT_EQ(entries.size(), 2);
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "options.h"
+#include "utils/language.h"
+#include "utils/paths.h"
+
+using namespace devilution;
+
+namespace {
+
+void AppendUint32(std::string &out, uint32_t value)
+{
+	out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/** Writes a .mo file with the given msgid and msgstr pairs, the first one being the metadata */
+void WriteCatalogue(const char *path, const std::vector<std::pair<std::string, std::string>> &messages)
+{
+	const auto count = static_cast<uint32_t>(messages.size());
+	const uint32_t srcOffset = 28;
+	const uint32_t dstOffset = srcOffset + count * 8;
+	std::string tables;
+	std::string strings;
+	uint32_t offset = dstOffset + count * 8;
+	for (bool translations : { false, true }) {
+		for (const auto &message : messages) {
+			const std::string &text = translations ? message.second : message.first;
+			AppendUint32(tables, static_cast<uint32_t>(text.size()));
+			AppendUint32(tables, offset + static_cast<uint32_t>(strings.size()));
+			strings.append(text);
+			strings += '\0';
+		}
+	}
+
+	std::string mo;
+	AppendUint32(mo, 0x950412de);
+	AppendUint32(mo, 0);
+	AppendUint32(mo, count);
+	AppendUint32(mo, srcOffset);
+	AppendUint32(mo, dstOffset);
+	AppendUint32(mo, 0);
+	AppendUint32(mo, 0);
+	mo += tables;
+	mo += strings;
+
+	FILE *file = std::fopen(path, "wb");
+	ASSERT_NE(file, nullptr);
+	std::fwrite(mo.data(), mo.size(), 1, file);
+	std::fclose(file);
+}
+
+class LanguageTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		using namespace std::string_literals;
+		std::vector<std::pair<std::string, std::string>> messages {
+			{ "", "Content-Type: text/plain; charset=UTF-8\nPlural-Forms: nplurals=3; plural=(n==1) ? 0 : (n>=2 && n<=4) ? 1 : 2;\n" },
+			{ "Hello", "Ahoj" },
+			{ "Open", "Otevri" },
+			{ "menu\004Open", "Otevrit" },
+			{ "apple\0apples"s, "jablko\0jablka\0jablek"s },
+			{ "Untranslated", "" },
+		};
+		// Enough keys for some of them to share a slot of the table
+		for (int i = 0; i < 40; i++)
+			messages.emplace_back("Message " + std::to_string(i), "Zprava " + std::to_string(i));
+		WriteCatalogue("tt.mo", messages);
+
+		paths::SetMpqDir("./");
+		language = sgOptions.Language.szCode;
+		strcpy(sgOptions.Language.szCode, "tt");
+		LanguageInitialize();
+	}
+
+	void TearDown() override
+	{
+		std::remove("tt.mo");
+		// Without a catalogue for the language the translations are dropped
+		LanguageInitialize();
+		strcpy(sgOptions.Language.szCode, language.c_str());
+	}
+
+	std::string language;
+};
+
+} // namespace
+
+TEST_F(LanguageTest, TranslatesMessages)
+{
+	EXPECT_STREQ(_("Hello"), "Ahoj");
+	EXPECT_STREQ(_("Open"), "Otevri");
+	for (int i = 0; i < 40; i++) {
+		const std::string message = "Message " + std::to_string(i);
+		EXPECT_EQ(_(message.c_str()), "Zprava " + std::to_string(i));
+	}
+}
+
+TEST_F(LanguageTest, ReturnsMissingMessages)
+{
+	EXPECT_STREQ(_("Goodbye"), "Goodbye");
+	EXPECT_STREQ(_("Untranslated"), "Untranslated");
+	EXPECT_STREQ(_("Hell"), "Hell");
+}
+
+TEST_F(LanguageTest, PicksPluralForms)
+{
+	EXPECT_STREQ(ngettext("apple", "apples", 1), "jablko");
+	EXPECT_STREQ(ngettext("apple", "apples", 3), "jablka");
+	EXPECT_STREQ(ngettext("apple", "apples", 5), "jablek");
+	EXPECT_STREQ(ngettext("pear", "pears", 1), "pear");
+	EXPECT_STREQ(ngettext("pear", "pears", 5), "pears");
+}
+
+TEST_F(LanguageTest, MatchesContext)
+{
+	EXPECT_STREQ(pgettext("menu", "Open"), "Otevrit");
+	EXPECT_STREQ(pgettext("door", "Open"), "Open");
+	EXPECT_STREQ(pgettext("menu", "Close"), "Close");
+}
+
+TEST_F(LanguageTest, EvaluatesArgumentsOnce)
+{
+	int calls = 0;
+	auto hello = [&calls]() {
+		calls++;
+		return "Hello";
+	};
+	EXPECT_STREQ(_(hello()), "Ahoj");
+	EXPECT_STREQ(ngettext(hello(), "Hellos", 1), "Ahoj");
+	EXPECT_STREQ(pgettext(hello(), "Open"), "Open");
+	EXPECT_EQ(calls, 3);
+}
+
+TEST_F(LanguageTest, ForgetsCatalogueWithoutFile)
+{
+	std::remove("tt.mo");
+	LanguageInitialize();
+	EXPECT_STREQ(_("Hello"), "Hello");
+	EXPECT_STREQ(ngettext("apple", "apples", 5), "apples");
+}
@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "automap.h"
+#include "codec.h"
+#include "gendung.h"
+#include "items.h"
+#include "loadsave.h"
+#include "menu.h"
+#include "mpqapi.h"
+#include "pfile.h"
+#include "player.h"
+#include "quests.h"
+#include "utils/paths.h"
+
+using namespace devilution;
+
+namespace {
+
+/** A single value at the start, runs longer than a control byte can describe and a single value at the end */
+int RunsAtEdges(size_t n, size_t size)
+{
+	if (n == 0)
+		return 1;
+	if (n < 300)
+		return 2;
+	if (n < 500)
+		return static_cast<int>(n % 7);
+	if (n == size - 1)
+		return 3;
+	return 0;
+}
+
+/** Literals followed by a repeated value that ends one past the longest run */
+int RepeatAtEnd(size_t n, size_t size)
+{
+	if (n < 200)
+		return static_cast<int>(n % 5);
+	if (n + 130 >= size)
+		return 4;
+	return 1;
+}
+
+/** Fills the grid in the order it is stored, column by column within each row */
+template <typename T, size_t Width, size_t Height, typename Pattern>
+void FillGrid(T (&grid)[Width][Height], Pattern pattern)
+{
+	size_t n = 0;
+	for (size_t j = 0; j < Height; j++) {
+		for (size_t i = 0; i < Width; i++) // NOLINT(modernize-loop-convert)
+			grid[i][j] = static_cast<T>(pattern(n++, Width * Height));
+	}
+}
+
+template <typename T, size_t Width, size_t Height>
+std::vector<T> CopyGrid(const T (&grid)[Width][Height])
+{
+	std::vector<T> copy(Width * Height);
+	memcpy(copy.data(), grid, sizeof(grid));
+	return copy;
+}
+
+template <typename T, size_t Width, size_t Height>
+void ExpectGrid(const T (&grid)[Width][Height], const std::vector<T> &expected, const char *name)
+{
+	EXPECT_EQ(CopyGrid(grid), expected) << name;
+}
+
+/** Flags that survive saving and loading, see `SaveLevel` and `LoadLevel` */
+int8_t StoredFlags(int value)
+{
+	return static_cast<int8_t>(((value & 1) != 0 ? BFLAG_POPULATED : 0) | ((value & 2) != 0 ? BFLAG_EXPLORED : 0));
+}
+
+void AppendBE32(std::vector<byte> &out, int32_t value)
+{
+	const auto bits = static_cast<uint32_t>(value);
+	for (int shift = 24; shift >= 0; shift -= 8)
+		out.push_back(static_cast<byte>(bits >> shift));
+}
+
+template <typename T, size_t Width, size_t Height>
+void AppendRawGrid(std::vector<byte> &out, const T (&grid)[Width][Height])
+{
+	for (size_t j = 0; j < Height; j++) {
+		for (size_t i = 0; i < Width; i++) // NOLINT(modernize-loop-convert)
+			out.push_back(static_cast<byte>(grid[i][j]));
+	}
+}
+
+class LoadSaveTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		paths::SetPrefPath(".");
+		std::remove("multi_0.sv");
+
+		gbVanilla = true;
+		gbIsHellfire = false;
+		gbIsMultiplayer = true;
+		gbIsHellfireSaveGame = false;
+		giNumberOfLevels = 17;
+		gSaveNumber = 0;
+		setlevel = false;
+
+		MyPlayerId = 0;
+		MyPlayer = &Players[MyPlayerId];
+		*MyPlayer = {};
+
+		_uiheroinfo info {};
+		strcpy(info.name, "TestPlayer");
+		info.heroclass = HeroClass::Warrior;
+		ASSERT_TRUE(pfile_ui_save_create(&info));
+
+		// Loading a level resyncs the quests, which would change the dungeon for the active ones
+		for (auto &quest : Quests)
+			quest._qactive = QUEST_NOTAVAIL;
+		ActiveMonsterCount = 0;
+		ActiveItemCount = 0;
+		ActiveObjectCount = 0;
+	}
+
+	void TearDown() override
+	{
+		std::remove("multi_0.sv");
+	}
+};
+
+} // namespace
+
+TEST_F(LoadSaveTest, RoundTripsLevelGrids)
+{
+	leveltype = DTYPE_CATHEDRAL;
+	currlevel = 1;
+
+	FillGrid(dCorpse, RunsAtEdges);
+	FillGrid(dFlags, [](size_t n, size_t size) { return StoredFlags(RepeatAtEnd(n, size)); });
+	FillGrid(dItem, RunsAtEdges);
+	FillGrid(dMonster, [](size_t n, size_t size) { return RunsAtEdges(n, size) * 1000 - 2000; });
+	FillGrid(dObject, RepeatAtEnd);
+	FillGrid(dLight, [](size_t n, size_t size) { return RunsAtEdges(n, size) - 3; });
+	FillGrid(dPreLight, RepeatAtEnd);
+	FillGrid(AutomapView, [](size_t n, size_t size) {
+		constexpr MapExplorationType Views[] = { MAP_EXP_NONE, MAP_EXP_SHRINE, MAP_EXP_SELF };
+		return Views[RepeatAtEnd(n, size) % 3];
+	});
+
+	const auto corpses = CopyGrid(dCorpse);
+	const auto flags = CopyGrid(dFlags);
+	const auto items = CopyGrid(dItem);
+	const auto monsters = CopyGrid(dMonster);
+	const auto objects = CopyGrid(dObject);
+	const auto light = CopyGrid(dLight);
+	const auto preLight = CopyGrid(dPreLight);
+	const auto automapView = CopyGrid(AutomapView);
+
+	SaveLevel();
+
+	size_t size;
+	auto data = pfile_read("templ01", &size);
+	ASSERT_NE(data, nullptr);
+	// The format header is followed by grids that are much smaller than the raw arrays
+	EXPECT_EQ(static_cast<uint8_t>(data[0]), 0xFF);
+	EXPECT_LT(size, sizeof(dCorpse));
+
+	memset(dCorpse, 0, sizeof(dCorpse));
+	memset(dFlags, 0, sizeof(dFlags));
+	memset(dItem, 0, sizeof(dItem));
+	memset(dMonster, 0, sizeof(dMonster));
+	memset(dObject, 0, sizeof(dObject));
+	memset(dLight, 0, sizeof(dLight));
+	memset(dPreLight, 0, sizeof(dPreLight));
+	memset(AutomapView, 0, sizeof(AutomapView));
+
+	LoadLevel();
+
+	ExpectGrid(dCorpse, corpses, "dCorpse");
+	ExpectGrid(dFlags, flags, "dFlags");
+	ExpectGrid(dItem, items, "dItem");
+	ExpectGrid(dMonster, monsters, "dMonster");
+	ExpectGrid(dObject, objects, "dObject");
+	ExpectGrid(dLight, light, "dLight");
+	ExpectGrid(dPreLight, preLight, "dPreLight");
+	ExpectGrid(AutomapView, automapView, "AutomapView");
+}
+
+TEST_F(LoadSaveTest, LoadsLevelWithoutFormatHeader)
+{
+	leveltype = DTYPE_TOWN;
+	currlevel = 0;
+
+	FillGrid(dFlags, [](size_t n, size_t size) { return StoredFlags(RunsAtEdges(n, size)); });
+	FillGrid(dItem, RepeatAtEnd);
+	const auto flags = CopyGrid(dFlags);
+	const auto items = CopyGrid(dItem);
+
+	// The town level as it was written before the grids were run-length encoded
+	std::vector<byte> level;
+	AppendBE32(level, 0);
+	AppendBE32(level, 0);
+	AppendBE32(level, 0);
+	level.insert(level.end(), 2 * MAXITEMS, byte { 0 });
+	AppendRawGrid(level, dFlags);
+	AppendRawGrid(level, dItem);
+	const size_t legacySize = level.size();
+	{
+		PFileScopedArchiveWriter scopedWriter;
+		const size_t encodedLen = codec_get_encoded_len(legacySize);
+		level.resize(encodedLen);
+		codec_encode(level.data(), legacySize, encodedLen, pfile_get_password());
+		ASSERT_TRUE(mpqapi_write_file("perml00", level.data(), encodedLen));
+	}
+
+	memset(dFlags, 0, sizeof(dFlags));
+	memset(dItem, 0, sizeof(dItem));
+	LoadLevel();
+	ExpectGrid(dFlags, flags, "dFlags");
+	ExpectGrid(dItem, items, "dItem");
+
+	// Saving the level again converts it to the current format
+	SaveLevel();
+	size_t size;
+	auto data = pfile_read("templ00", &size);
+	ASSERT_NE(data, nullptr);
+	EXPECT_EQ(static_cast<uint8_t>(data[0]), 0xFF);
+	EXPECT_LT(size, legacySize);
+
+	memset(dFlags, 0, sizeof(dFlags));
+	memset(dItem, 0, sizeof(dItem));
+	LoadLevel();
+	ExpectGrid(dFlags, flags, "dFlags");
+	ExpectGrid(dItem, items, "dItem");
+}
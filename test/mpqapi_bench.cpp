@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "mpqapi.h"
+
+using namespace devilution;
+
+namespace {
+
+constexpr const char *ArchiveName = "Bench_MpqApi.sv";
+
+/** A fully explored Hellfire game has a temp file for every dungeon level and every set level. */
+constexpr int NumLevelFiles = 2 * 25;
+
+/** Roughly the size of the data written by `SaveLevel` for a populated level. */
+constexpr size_t LevelFileSize = 128 * 1024;
+
+std::unique_ptr<byte[]> MakeLevelData(uint32_t seed)
+{
+	// Mostly empty grids with scattered entries, similar to the dungeon arrays of a saved level.
+	std::unique_ptr<byte[]> data { new byte[LevelFileSize] {} };
+	for (size_t i = 0; i < LevelFileSize; i++) {
+		seed = seed * 1103515245 + 12345;
+		if (((seed >> 16) & 7) == 0)
+			data[i] = static_cast<byte>(seed >> 24);
+	}
+	return data;
+}
+
+std::string GetLevelFileName(int i)
+{
+	char name[16];
+	if (i < NumLevelFiles / 2)
+		snprintf(name, sizeof(name), "perml%02d", i);
+	else
+		snprintf(name, sizeof(name), "perms%02d", i - NumLevelFiles / 2);
+	return name;
+}
+
+TEST(MpqApiBench, SaveFullyExploredGame)
+{
+	std::vector<std::unique_ptr<byte[]>> levels;
+	for (int i = 0; i < NumLevelFiles; i++)
+		levels.push_back(MakeLevelData(i));
+
+	TimeRuns("Save 50 levels", 10, NumLevelFiles * LevelFileSize, [&]() {
+		std::remove(ArchiveName);
+		ASSERT_TRUE(OpenMPQ(ArchiveName));
+		for (int i = 0; i < NumLevelFiles; i++)
+			ASSERT_TRUE(mpqapi_write_file(GetLevelFileName(i).c_str(), levels[i].get(), LevelFileSize));
+		ASSERT_TRUE(mpqapi_flush_and_close(true));
+	});
+	std::remove(ArchiveName);
+}
+
+} // namespace
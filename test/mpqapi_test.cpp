@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mpqapi.h"
+#include "storm/storm.h"
+#include "utils/file_util.h"
+
+using namespace devilution;
+
+namespace {
+
+constexpr const char *ArchiveName = "Test_MpqApi.sv";
+
+/** A fully explored Hellfire game has a temp file for every dungeon level and every set level. */
+constexpr int NumLevelFiles = 2 * 25;
+
+/** Roughly the size of the data written by `SaveLevel` for a populated level. */
+constexpr size_t LevelFileSize = 128 * 1024;
+
+std::unique_ptr<byte[]> MakeLevelData(uint32_t seed)
+{
+	// Mostly empty grids with scattered entries, similar to the dungeon arrays of a saved level.
+	std::unique_ptr<byte[]> data { new byte[LevelFileSize] {} };
+	for (size_t i = 0; i < LevelFileSize; i++) {
+		seed = seed * 1103515245 + 12345;
+		if (((seed >> 16) & 7) == 0)
+			data[i] = static_cast<byte>(seed >> 24);
+	}
+	return data;
+}
+
+std::string GetLevelFileName(int i)
+{
+	char name[16];
+	if (i < NumLevelFiles / 2)
+		snprintf(name, sizeof(name), "perml%02d", i);
+	else
+		snprintf(name, sizeof(name), "perms%02d", i - NumLevelFiles / 2);
+	return name;
+}
+
+void ExpectFileContents(HANDLE archive, const char *name, const byte *expected, size_t expectedSize)
+{
+	HANDLE file;
+	ASSERT_TRUE(SFileOpenFileEx(archive, name, 0, &file)) << name;
+	ASSERT_EQ(SFileGetFileSize(file), expectedSize) << name;
+	std::unique_ptr<byte[]> data { new byte[expectedSize] };
+	ASSERT_TRUE(SFileReadFileThreadSafe(file, data.get(), expectedSize)) << name;
+	SFileCloseFileThreadSafe(file);
+	EXPECT_EQ(memcmp(data.get(), expected, expectedSize), 0) << name;
+}
+
+TEST(MpqApi, WriteFullyExploredGame)
+{
+	std::remove(ArchiveName);
+
+	std::vector<std::unique_ptr<byte[]>> levels;
+	for (int i = 0; i < NumLevelFiles; i++)
+		levels.push_back(MakeLevelData(i));
+
+	ASSERT_TRUE(OpenMPQ(ArchiveName));
+	for (int i = 0; i < NumLevelFiles; i++)
+		ASSERT_TRUE(mpqapi_write_file(GetLevelFileName(i).c_str(), levels[i].get(), LevelFileSize));
+	ASSERT_TRUE(mpqapi_flush_and_close(true));
+
+	EXPECT_FALSE(FileExists((std::string(ArchiveName) + ".tmp").c_str()));
+
+	HANDLE archive;
+	ASSERT_TRUE(SFileOpenArchive(ArchiveName, 0, 0, &archive));
+	for (int i = 0; i < NumLevelFiles; i++)
+		ExpectFileContents(archive, GetLevelFileName(i).c_str(), levels[i].get(), LevelFileSize);
+	SFileCloseArchive(archive);
+}
+
+TEST(MpqApi, RewriteKeepsOtherFiles)
+{
+	std::remove(ArchiveName);
+
+	const std::unique_ptr<byte[]> level = MakeLevelData(1);
+	ASSERT_TRUE(OpenMPQ(ArchiveName));
+	ASSERT_TRUE(mpqapi_write_file("perml01", level.get(), LevelFileSize));
+	ASSERT_TRUE(mpqapi_flush_and_close(true));
+
+	const std::unique_ptr<byte[]> hero = MakeLevelData(2);
+	ASSERT_TRUE(OpenMPQ(ArchiveName));
+	ASSERT_TRUE(mpqapi_write_file("hero", hero.get(), 1024));
+	ASSERT_TRUE(mpqapi_flush_and_close(true));
+
+	EXPECT_FALSE(FileExists((std::string(ArchiveName) + ".tmp").c_str()));
+
+	HANDLE archive;
+	ASSERT_TRUE(SFileOpenArchive(ArchiveName, 0, 0, &archive));
+	ExpectFileContents(archive, "perml01", level.get(), LevelFileSize);
+	ExpectFileContents(archive, "hero", hero.get(), 1024);
+	SFileCloseArchive(archive);
+}
+
+TEST(MpqApi, DetectsUnchangedFiles)
+{
+	std::remove(ArchiveName);
+
+	const std::unique_ptr<byte[]> level = MakeLevelData(3);
+	ASSERT_TRUE(OpenMPQ(ArchiveName));
+	ASSERT_TRUE(mpqapi_write_file("templ01", level.get(), LevelFileSize, 1));
+	EXPECT_TRUE(mpqapi_has_unchanged_file("templ01", 1));
+	EXPECT_FALSE(mpqapi_has_unchanged_file("templ01", 2));
+	EXPECT_FALSE(mpqapi_has_unchanged_file("templ02", 1));
+	ASSERT_TRUE(mpqapi_flush_and_close(false));
+
+	// The cache survives reopening the same archive and follows renames
+	ASSERT_TRUE(OpenMPQ(ArchiveName));
+	EXPECT_TRUE(mpqapi_has_unchanged_file("templ01", 1));
+	char oldName[] = "templ01";
+	char newName[] = "perml01";
+	mpqapi_rename(oldName, newName);
+	EXPECT_FALSE(mpqapi_has_unchanged_file("templ01", 1));
+	EXPECT_TRUE(mpqapi_has_unchanged_file("perml01", 1));
+	mpqapi_remove_hash_entry("perml01");
+	EXPECT_FALSE(mpqapi_has_unchanged_file("perml01", 1));
+	ASSERT_TRUE(mpqapi_flush_and_close(true));
+}
+
+} // namespace
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include "bench.hpp"
+#include "dvlnet/packet.h"
+
+using namespace devilution;
+using namespace devilution::net;
+
+namespace {
+
+TEST(PacketBench, MessageRoundTrip)
+{
+#ifdef PACKET_ENCRYPTION
+	packet_factory factory("password");
+#else
+	packet_factory factory;
+#endif
+	buffer_t message(64);
+	for (size_t i = 0; i < message.size(); i++)
+		message[i] = static_cast<unsigned char>(i * 13);
+	constexpr int Iterations = 10000;
+
+	TimeRuns("Send and receive 10000 messages", 10, message.size() * Iterations, [&]() {
+		size_t bytes = 0;
+		for (int i = 0; i < Iterations; i++) {
+			auto out = factory.make_packet<PT_MESSAGE>(plr_t { 1 }, plr_t { 2 }, message);
+			auto in = factory.make_packet(out->Data());
+			bytes += in->Message().size();
+		}
+		ASSERT_EQ(bytes, message.size() * Iterations);
+	});
+}
+
+} // namespace
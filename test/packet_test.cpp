@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include "dvlnet/packet.h"
+
+using namespace devilution;
+using namespace devilution::net;
+
+namespace {
+
+buffer_t MakeInfo(size_t size)
+{
+	buffer_t info(size);
+	for (size_t i = 0; i < size; i++)
+		info[i] = static_cast<unsigned char>(i * 13);
+	return info;
+}
+
+void TestRoundTrip(packet_factory &factory)
+{
+	const buffer_t message = MakeInfo(200);
+	auto out = factory.make_packet<PT_MESSAGE>(plr_t { 1 }, PLR_BROADCAST, message);
+	auto in = factory.make_packet(out->Data());
+	EXPECT_EQ(in->Type(), PT_MESSAGE);
+	EXPECT_EQ(in->Source(), 1);
+	EXPECT_EQ(in->Destination(), PLR_BROADCAST);
+	EXPECT_EQ(in->Message(), message);
+	// Received packets keep the original data so servers can forward them
+	EXPECT_EQ(in->Data(), out->Data());
+
+	const buffer_t info = MakeInfo(50);
+	out = factory.make_packet<PT_JOIN_ACCEPT>(PLR_MASTER, PLR_BROADCAST, cookie_t { 0x12345678 }, plr_t { 2 }, info);
+	in = factory.make_packet(out->Data());
+	EXPECT_EQ(in->Type(), PT_JOIN_ACCEPT);
+	EXPECT_EQ(in->Cookie(), 0x12345678U);
+	EXPECT_EQ(in->NewPlayer(), 2);
+	EXPECT_EQ(in->Info(), info);
+
+	out = factory.make_packet<PT_TURN>(plr_t { 3 }, PLR_BROADCAST, turn_t { 0x7FFF0102 });
+	in = factory.make_packet(out->Data());
+	EXPECT_EQ(in->Type(), PT_TURN);
+	EXPECT_EQ(in->Turn(), 0x7FFF0102);
+	EXPECT_THROW(in->Message(), wrong_packet_type_exception);
+}
+
+TEST(Packet, RoundTrip)
+{
+	packet_factory factory;
+	TestRoundTrip(factory);
+}
+
+TEST(Packet, RejectsShortPackets)
+{
+	packet_factory factory;
+	const buffer_t truncated = { PT_TURN, 1, PLR_BROADCAST, 0 };
+	EXPECT_THROW(factory.make_packet(truncated), packet_exception);
+	EXPECT_THROW(factory.make_packet(buffer_t { PT_TURN }), packet_exception);
+}
+
+TEST(Packet, ReusesPooledPackets)
+{
+	packet_factory factory;
+	const packet *first;
+	{
+		auto pkt = factory.make_packet<PT_TURN>(plr_t { 0 }, PLR_BROADCAST, turn_t { 1 });
+		first = pkt.get();
+	}
+	auto pkt = factory.make_packet<PT_TURN>(plr_t { 0 }, PLR_BROADCAST, turn_t { 2 });
+	EXPECT_EQ(pkt.get(), first);
+	EXPECT_EQ(pkt->Turn(), 2);
+	auto in = factory.make_packet(pkt->Data());
+	EXPECT_EQ(in->Turn(), 2);
+}
+
+TEST(Packet, SharesDataWithoutCopying)
+{
+	packet_factory factory;
+	auto pkt = factory.make_packet<PT_TURN>(plr_t { 0 }, PLR_BROADCAST, turn_t { 3 });
+	const buffer_t data = pkt->Data();
+	const std::shared_ptr<const buffer_t> shared = pkt->ShareData();
+	EXPECT_EQ(*shared, data);
+	EXPECT_EQ(&pkt->Data(), shared.get());
+	EXPECT_EQ(pkt->ShareData(), shared);
+	EXPECT_EQ(pkt->Turn(), 3);
+
+	// Reusing the pooled packet leaves the shared buffer alone
+	pkt = factory.make_packet<PT_TURN>(plr_t { 0 }, PLR_BROADCAST, turn_t { 4 });
+	EXPECT_EQ(*shared, data);
+	EXPECT_EQ(pkt->Turn(), 4);
+}
+
+#ifdef PACKET_ENCRYPTION
+TEST(Packet, EncryptedRoundTrip)
+{
+	packet_factory factory("password");
+	TestRoundTrip(factory);
+}
+
+TEST(Packet, EncryptedPacketsAreAuthenticated)
+{
+	packet_factory factory("password");
+	packet_factory other("password");
+	auto out = factory.make_packet<PT_TURN>(plr_t { 3 }, PLR_BROADCAST, turn_t { 42 });
+	const buffer_t &data = out->Data();
+	ASSERT_EQ(data.size(), crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES + sizeof(packet_type) + 2 * sizeof(plr_t) + sizeof(turn_t));
+	EXPECT_EQ(other.make_packet(data)->Turn(), 42);
+
+	buffer_t tampered = data;
+	tampered.back() ^= 1;
+	EXPECT_THROW(other.make_packet(tampered), packet_exception);
+	EXPECT_THROW(packet_factory("wrong").make_packet(data), packet_exception);
+}
+#endif
+
+} // namespace
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "pkthdr.h"
+
+using namespace devilution;
+
+namespace {
+
+TPktHdr MakeHeader()
+{
+	TPktHdr hdr {};
+	hdr.px = 10;
+	hdr.py = 20;
+	hdr.targx = 11;
+	hdr.targy = 21;
+	hdr.php = 120 << 6;
+	hdr.pmhp = 150 << 6;
+	hdr.bstr = 30;
+	hdr.bmag = 15;
+	hdr.bdex = 20;
+	return hdr;
+}
+
+void ExpectSameHeader(const TPktHdr &a, const TPktHdr &b)
+{
+	EXPECT_EQ(a.px, b.px);
+	EXPECT_EQ(a.py, b.py);
+	EXPECT_EQ(a.targx, b.targx);
+	EXPECT_EQ(a.targy, b.targy);
+	EXPECT_EQ(a.php, b.php);
+	EXPECT_EQ(a.pmhp, b.pmhp);
+	EXPECT_EQ(a.bstr, b.bstr);
+	EXPECT_EQ(a.bmag, b.bmag);
+	EXPECT_EQ(a.bdex, b.bdex);
+}
+
+TEST(PktHdr, FullHeaderFitsTPktHdr)
+{
+	EXPECT_EQ(MaxPktHdrSize, sizeof(TPktHdr));
+
+	PktHdrBaseline sent {};
+	PktHdrBaseline received {};
+	byte buf[MaxPktHdrSize];
+	const TPktHdr hdr = MakeHeader();
+	ASSERT_EQ(EncodePktHdr(hdr, sent, false, buf), MaxPktHdrSize);
+
+	TPktHdr decoded {};
+	bool resolved;
+	ASSERT_EQ(DecodePktHdr(buf, sizeof(buf), received, decoded, resolved), MaxPktHdrSize);
+	EXPECT_TRUE(resolved);
+	ExpectSameHeader(decoded, hdr);
+	EXPECT_EQ(decoded.wLen, sizeof(buf));
+}
+
+TEST(PktHdr, DeltaOnlyCarriesChangedFields)
+{
+	PktHdrBaseline sent {};
+	PktHdrBaseline received {};
+	byte buf[MaxPktHdrSize];
+	TPktHdr hdr = MakeHeader();
+	TPktHdr decoded {};
+	bool resolved;
+	size_t size = EncodePktHdr(hdr, sent, false, buf);
+	ASSERT_EQ(DecodePktHdr(buf, size, received, decoded, resolved), size);
+
+	size = EncodePktHdr(hdr, sent, false, buf);
+	EXPECT_EQ(size, PktHdrPrefixSize);
+	ASSERT_EQ(DecodePktHdr(buf, size, received, decoded, resolved), size);
+	EXPECT_TRUE(resolved);
+	ExpectSameHeader(decoded, hdr);
+
+	hdr.px++;
+	hdr.php -= 64;
+	size = EncodePktHdr(hdr, sent, false, buf);
+	EXPECT_EQ(size, PktHdrPrefixSize + 2 + 4);
+	ASSERT_EQ(DecodePktHdr(buf, size, received, decoded, resolved), size);
+	EXPECT_TRUE(resolved);
+	ExpectSameHeader(decoded, hdr);
+}
+
+TEST(PktHdr, LostMessageWaitsForFullHeader)
+{
+	PktHdrBaseline sent {};
+	PktHdrBaseline received {};
+	byte buf[MaxPktHdrSize];
+	TPktHdr hdr = MakeHeader();
+	TPktHdr decoded {};
+	bool resolved;
+	size_t size = EncodePktHdr(hdr, sent, false, buf);
+	DecodePktHdr(buf, size, received, decoded, resolved);
+
+	hdr.bstr++;
+	EncodePktHdr(hdr, sent, false, buf); // never arrives
+	hdr.py++;
+	size = EncodePktHdr(hdr, sent, false, buf);
+	EXPECT_EQ(DecodePktHdr(buf, size, received, decoded, resolved), size);
+	EXPECT_FALSE(resolved);
+	EXPECT_FALSE(received.valid);
+
+	size = EncodePktHdr(hdr, sent, false, buf);
+	DecodePktHdr(buf, size, received, decoded, resolved);
+	EXPECT_FALSE(resolved);
+
+	size = EncodePktHdr(hdr, sent, true, buf);
+	EXPECT_EQ(size, MaxPktHdrSize);
+	DecodePktHdr(buf, size, received, decoded, resolved);
+	EXPECT_TRUE(resolved);
+	ExpectSameHeader(decoded, hdr);
+}
+
+TEST(PktHdr, KeyframesResynchronise)
+{
+	PktHdrBaseline sent {};
+	PktHdrBaseline received {};
+	byte buf[MaxPktHdrSize];
+	const TPktHdr hdr = MakeHeader();
+	TPktHdr decoded {};
+	bool resolved;
+
+	int fullHeaders = 0;
+	for (int i = 0; i < 4 * PktHdrKeyframeInterval; i++) {
+		const size_t size = EncodePktHdr(hdr, sent, false, buf);
+		if (size == MaxPktHdrSize)
+			fullHeaders++;
+		if (i == 10)
+			continue; // dropped
+		DecodePktHdr(buf, size, received, decoded, resolved);
+		if (i >= PktHdrKeyframeInterval)
+			EXPECT_TRUE(resolved) << i;
+	}
+	EXPECT_EQ(fullHeaders, 5);
+}
+
+TEST(PktHdr, MessageToSeveralRecipients)
+{
+	TPkt pkt {};
+	pkt.hdr = MakeHeader();
+	const size_t bodySize = 40;
+	for (size_t i = 0; i < bodySize; i++)
+		pkt.body[i] = static_cast<byte>(i * 3);
+
+	// Recipients that are in sync, have never received a header, and have an older header
+	PktHdrBaseline sent[3] {};
+	PktHdrBaseline received[3] {};
+	byte buf[sizeof(TPkt)];
+	TPktHdr decoded {};
+	bool resolved;
+	TPktHdr older = pkt.hdr;
+	older.px--;
+	older.bdex--;
+	size_t size = EncodePktHdr(pkt.hdr, sent[0], false, buf);
+	DecodePktHdr(buf, size, received[0], decoded, resolved);
+	size = EncodePktHdr(older, sent[2], false, buf);
+	DecodePktHdr(buf, size, received[2], decoded, resolved);
+
+	for (int i = 0; i < 3; i++) {
+		size = EncodePktMessage(pkt, bodySize, sent[i], false, buf);
+		const size_t hdrSize = DecodePktHdr(buf, size, received[i], decoded, resolved);
+		ASSERT_NE(hdrSize, 0) << i;
+		EXPECT_TRUE(resolved) << i;
+		ExpectSameHeader(decoded, MakeHeader());
+		ASSERT_EQ(size - hdrSize, bodySize) << i;
+		EXPECT_EQ(memcmp(buf + hdrSize, pkt.body, bodySize), 0) << i;
+	}
+	ExpectSameHeader(pkt.hdr, MakeHeader());
+}
+
+TEST(PktHdr, RejectsGarbage)
+{
+	PktHdrBaseline received {};
+	TPktHdr decoded {};
+	bool resolved;
+	const byte tooShort[3] {};
+	EXPECT_EQ(DecodePktHdr(tooShort, sizeof(tooShort), received, decoded, resolved), 0);
+	const byte badCheck[MaxPktHdrSize] {};
+	EXPECT_EQ(DecodePktHdr(badCheck, sizeof(badCheck), received, decoded, resolved), 0);
+
+	PktHdrBaseline sent {};
+	byte buf[MaxPktHdrSize];
+	EncodePktHdr(MakeHeader(), sent, false, buf);
+	EXPECT_EQ(DecodePktHdr(buf, MaxPktHdrSize - 1, received, decoded, resolved), 0);
+}
+
+} // namespace
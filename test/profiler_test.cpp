@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "utils/profiler.hpp"
+
+using namespace devilution;
+
+namespace {
+
+size_t CountZones(const std::string &trace, const std::string &name)
+{
+	const std::string needle = "\"name\":\"" + name + "\"";
+	size_t count = 0;
+	for (size_t pos = trace.find(needle); pos != std::string::npos; pos = trace.find(needle, pos + 1))
+		count++;
+	return count;
+}
+
+TEST(Profiler, RecordsOnlyWhileCapturing)
+{
+	{
+		const profiler::Zone zone("BeforeCapture");
+	}
+	profiler::StartCapture();
+	{
+		const profiler::Zone outer("Outer");
+		const profiler::Zone inner("Inner");
+	}
+	profiler::StopCapture();
+	{
+		const profiler::Zone zone("AfterCapture");
+	}
+
+	const std::string trace = profiler::ExportChromeTrace();
+	EXPECT_EQ(trace.rfind("{\"traceEvents\":[", 0), 0U);
+	EXPECT_EQ(CountZones(trace, "Outer"), 1U);
+	EXPECT_EQ(CountZones(trace, "Inner"), 1U);
+	EXPECT_EQ(CountZones(trace, "BeforeCapture"), 0U);
+	EXPECT_EQ(CountZones(trace, "AfterCapture"), 0U);
+	EXPECT_NE(trace.find("\"ph\":\"X\""), std::string::npos);
+}
+
+TEST(Profiler, KeepsZonesOfEachThread)
+{
+	profiler::StartCapture();
+	std::thread worker([]() {
+		for (int i = 0; i < 10; i++)
+			const profiler::Zone zone("Worker");
+	});
+	worker.join();
+	{
+		const profiler::Zone zone("Main");
+	}
+	profiler::StopCapture();
+
+	const std::string trace = profiler::ExportChromeTrace();
+	EXPECT_EQ(CountZones(trace, "Worker"), 10U);
+	EXPECT_EQ(CountZones(trace, "Main"), 1U);
+}
+
+TEST(Profiler, RingKeepsNewestZones)
+{
+	profiler::StartCapture();
+	for (size_t i = 0; i < profiler::ZonesPerThread + 100; i++)
+		const profiler::Zone zone(i < 100 ? "Old" : "New");
+	profiler::StopCapture();
+
+	const std::string trace = profiler::ExportChromeTrace();
+	EXPECT_EQ(CountZones(trace, "Old"), 0U);
+	EXPECT_EQ(CountZones(trace, "New"), profiler::ZonesPerThread);
+}
+
+TEST(Profiler, NewCaptureDropsPreviousZones)
+{
+	profiler::StartCapture();
+	{
+		const profiler::Zone zone("First");
+	}
+	profiler::StopCapture();
+	profiler::StartCapture();
+	profiler::StopCapture();
+
+	EXPECT_EQ(CountZones(profiler::ExportChromeTrace(), "First"), 0U);
+}
+
+} // namespace
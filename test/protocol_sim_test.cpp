@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#ifndef NONET
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "dvlnet/base_protocol.h"
+#include "dvlnet/protocol_sim.h"
+#include "multi.h"
+
+using namespace devilution;
+using namespace devilution::net;
+
+namespace {
+
+std::vector<uint32_t> DeliveryTimes(const sim_settings &settings, int count)
+{
+	sim_network &network = sim_network::get();
+	network.reset(settings);
+	network.use_manual_clock();
+	uint32_t a = network.attach();
+	uint32_t b = network.attach();
+	for (int i = 0; i < count; i++)
+		network.send(a, b, buffer_t(100, static_cast<unsigned char>(i)), false);
+
+	std::vector<uint32_t> times;
+	uint32_t from;
+	buffer_t data;
+	while (static_cast<int>(times.size()) < count) {
+		while (network.recv(b, from, data)) {
+			EXPECT_EQ(from, a);
+			EXPECT_EQ(data[0], static_cast<unsigned char>(times.size())) << "Packets overtook each other";
+			times.push_back(network.now());
+		}
+		network.advance(1);
+	}
+	return times;
+}
+
+TEST(SimNetwork, LatencyAndBandwidth)
+{
+	sim_settings settings;
+	settings.latency_ms = 50;
+	settings.bandwidth = 10000;
+	std::vector<uint32_t> times = DeliveryTimes(settings, 10);
+	EXPECT_EQ(times.front(), 60U);
+	EXPECT_EQ(times.back(), 150U);
+}
+
+TEST(SimNetwork, LossDelaysReliablePackets)
+{
+	sim_settings settings;
+	settings.latency_ms = 20;
+	settings.jitter_ms = 10;
+	settings.loss_percent = 20;
+	settings.seed = 7;
+	std::vector<uint32_t> times = DeliveryTimes(settings, 200);
+	EXPECT_GT(sim_network::get().stats().retransmissions, 0U);
+	EXPECT_EQ(sim_network::get().stats().packets_delivered, 200U);
+
+	// The same seed gives the same timing
+	EXPECT_EQ(DeliveryTimes(settings, 200), times);
+	settings.seed = 8;
+	EXPECT_NE(DeliveryTimes(settings, 200), times);
+}
+
+TEST(SimNetwork, DropsDatagramsAndReportsDisconnects)
+{
+	sim_settings settings;
+	settings.loss_percent = 100;
+	sim_network &network = sim_network::get();
+	network.reset(settings);
+	network.use_manual_clock();
+	uint32_t a = network.attach();
+	uint32_t b = network.attach();
+	network.send_all(a, buffer_t(10));
+	network.advance(1000);
+	uint32_t from;
+	buffer_t data;
+	EXPECT_FALSE(network.recv(b, from, data));
+	EXPECT_EQ(network.stats().oob_dropped, 1U);
+
+	network.send(a, b, buffer_t(10), false);
+	network.detach(a);
+	EXPECT_FALSE(network.recv(b, from, data));
+	ASSERT_TRUE(network.get_disconnected(b, from));
+	EXPECT_EQ(from, a);
+}
+
+TEST(SimNetwork, FindsDesync)
+{
+	sim_network &network = sim_network::get();
+	network.reset();
+	uint32_t turn;
+	network.record_turn_hash(0, 1, 10);
+	network.record_turn_hash(1, 1, 10);
+	EXPECT_FALSE(network.find_desync(turn));
+	network.record_turn_hash(0, 2, 20);
+	network.record_turn_hash(1, 2, 21);
+	network.record_turn_hash(0, 3, 30);
+	network.record_turn_hash(1, 3, 31);
+	ASSERT_TRUE(network.find_desync(turn));
+	EXPECT_EQ(turn, 2U);
+}
+
+TEST(SimNetwork, FourPlayerLockstep)
+{
+	constexpr uint32_t Turns = 200;
+	constexpr size_t SyncMessageSize = 256;
+
+	sim_settings settings;
+	settings.latency_ms = 40;
+	settings.jitter_ms = 20;
+	settings.loss_percent = 2;
+	settings.bandwidth = 64000;
+	settings.seed = 1;
+	sim_network &network = sim_network::get();
+	network.reset(settings);
+	network.use_manual_clock();
+
+	std::vector<std::unique_ptr<base_protocol<protocol_sim>>> players;
+	for (int i = 0; i < MAX_PLRS; i++) {
+		players.push_back(std::make_unique<base_protocol<protocol_sim>>());
+		players.back()->clear_password();
+	}
+	players[0]->setup_gameinfo(buffer_t(sizeof(GameData)));
+	ASSERT_EQ(players[0]->create("sim"), 0);
+	// While a player waits in join() the players already in the game answer it
+	int joining = 1;
+	network.set_idle_handler([&]() {
+		for (int j = 0; j < joining; j++)
+			players[j]->poll();
+		network.advance(10);
+	});
+	for (; joining < MAX_PLRS; joining++)
+		ASSERT_EQ(players[joining]->join("sim"), joining);
+	network.set_idle_handler(nullptr);
+
+	// Players only learn about players that joined after them once they hear from them, keep
+	// greeting until everybody knows everybody so all players take part in the first turn
+	std::vector<std::set<int>> greeted(MAX_PLRS);
+	auto allGreeted = [&]() {
+		return std::all_of(greeted.begin(), greeted.end(), [](const std::set<int> &senders) { return senders.size() == MAX_PLRS - 1; });
+	};
+	while (!allGreeted()) {
+		for (int i = 0; i < MAX_PLRS; i++) {
+			char hello = static_cast<char>(i);
+			players[i]->SNetSendMessage(SNPLAYER_OTHERS, &hello, sizeof(hello));
+		}
+		network.advance(100);
+		for (int i = 0; i < MAX_PLRS; i++) {
+			int sender;
+			void *message;
+			uint32_t messageSize;
+			while (players[i]->SNetReceiveMessage(&sender, &message, &messageSize))
+				greeted[i].insert(sender);
+		}
+	}
+	network.advance(1000);
+	for (int i = 0; i < MAX_PLRS; i++) {
+		int sender;
+		void *message;
+		uint32_t messageSize;
+		while (players[i]->SNetReceiveMessage(&sender, &message, &messageSize)) {
+		}
+	}
+
+	const uint32_t start = network.now();
+	const sim_stats before = network.stats();
+	std::vector<uint64_t> hashes(MAX_PLRS, 14695981039346656037ULL);
+	std::vector<uint32_t> received(MAX_PLRS, 0);
+	for (int i = 0; i < MAX_PLRS; i++) {
+		turn_t turn = i;
+		players[i]->SNetSendTurn(reinterpret_cast<char *>(&turn), sizeof(turn));
+	}
+	while (*std::min_element(received.begin(), received.end()) < Turns) {
+		for (int i = 0; i < MAX_PLRS; i++) {
+			char *data[MAX_PLRS];
+			size_t size[MAX_PLRS];
+			uint32_t status[MAX_PLRS];
+			while (received[i] < Turns && players[i]->SNetReceiveTurns(data, size, status)) {
+				for (int p = 0; p < MAX_PLRS; p++) {
+					ASSERT_NE(status[p] & PS_TURN_ARRIVED, 0U);
+					turn_t turn;
+					memcpy(&turn, data[p], sizeof(turn));
+					hashes[i] = (hashes[i] ^ static_cast<uint32_t>(turn)) * 1099511628211ULL;
+				}
+				network.record_turn_hash(i, received[i], hashes[i]);
+				received[i]++;
+
+				buffer_t sync(SyncMessageSize, static_cast<unsigned char>(i));
+				players[i]->SNetSendMessage(SNPLAYER_OTHERS, sync.data(), sync.size());
+				turn_t turn = received[i] * MAX_PLRS + i;
+				players[i]->SNetSendTurn(reinterpret_cast<char *>(&turn), sizeof(turn));
+			}
+			int sender;
+			void *message;
+			uint32_t messageSize;
+			while (players[i]->SNetReceiveMessage(&sender, &message, &messageSize))
+				EXPECT_EQ(messageSize, SyncMessageSize);
+		}
+		network.advance(1);
+	}
+
+	uint32_t desync;
+	EXPECT_FALSE(network.find_desync(desync)) << "Turn " << desync;
+
+	// Every turn waits for the turns of the others, so it takes at least one trip over the network
+	const uint32_t elapsed = network.now() - start;
+	EXPECT_GE(elapsed, Turns * settings.latency_ms);
+	EXPECT_LT(elapsed, Turns * (settings.latency_ms + settings.jitter_ms + settings.retransmit_ms));
+
+	// Lost packets were sent again instead of being dropped
+	network.advance(1000);
+	for (int i = 0; i < MAX_PLRS; i++)
+		players[i]->poll();
+	const sim_stats after = network.stats();
+	EXPECT_GT(after.retransmissions, before.retransmissions);
+	EXPECT_EQ(after.packets_delivered - before.packets_delivered, after.packets_sent - before.packets_sent);
+	EXPECT_GE(after.bytes_sent - before.bytes_sent, uint64_t { Turns } * MAX_PLRS * (MAX_PLRS - 1) * SyncMessageSize);
+}
+
+} // namespace
+#endif
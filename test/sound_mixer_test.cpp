@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include "utils/sound_mixer.h"
+
+using namespace devilution;
+
+namespace {
+
+std::shared_ptr<const PcmSound> MakeSound(int channels, std::vector<int16_t> samples)
+{
+	return std::make_shared<const PcmSound>(PcmSound { 22050, channels, std::move(samples) });
+}
+
+} // namespace
+
+TEST(SoundMixer, PansMonoSounds)
+{
+	SoundMixer mixer;
+	mixer.Open(22050, 2);
+	mixer.Play(MakeSound(1, { 16384, -16384 }), 1.F, 0.5F);
+
+	std::vector<float> out(4);
+	mixer.Mix(out.data(), 2);
+	EXPECT_EQ(out, (std::vector<float> { 0.25F, 0.5F, -0.25F, -0.5F }));
+}
+
+TEST(SoundMixer, SumsVoices)
+{
+	SoundMixer mixer;
+	mixer.Open(22050, 1);
+	mixer.Play(MakeSound(1, { 8192, 8192 }), 1.F, 0.F);
+	mixer.Play(MakeSound(2, { 16384, 0, 16384, 0 }), 0.5F, 0.F);
+
+	std::vector<float> out(2);
+	mixer.Mix(out.data(), 2);
+	EXPECT_EQ(out, (std::vector<float> { 0.375F, 0.375F }));
+}
+
+TEST(SoundMixer, EndsVoicesWithTheirSound)
+{
+	SoundMixer mixer;
+	mixer.Open(22050, 2);
+	const uint32_t voice = mixer.Play(MakeSound(1, { 1, 2, 3 }), 1.F, 0.F);
+	EXPECT_TRUE(mixer.IsPlaying(voice));
+
+	std::vector<float> out(4, 1.F);
+	mixer.Mix(out.data(), 2);
+	EXPECT_TRUE(mixer.IsPlaying(voice));
+	mixer.Mix(out.data(), 2);
+	EXPECT_FALSE(mixer.IsPlaying(voice));
+	// The rest of the buffer is silence
+	EXPECT_EQ(out[2], 0.F);
+	EXPECT_EQ(mixer.GetStats().active, 0);
+
+	const uint32_t stopped = mixer.Play(MakeSound(1, { 1, 2, 3 }), 1.F, 0.F);
+	mixer.Stop(stopped);
+	EXPECT_FALSE(mixer.IsPlaying(stopped));
+}
+
+TEST(SoundMixer, StealsQuietestVoice)
+{
+	SoundMixer mixer;
+	mixer.Open(22050, 2);
+	const std::shared_ptr<const PcmSound> sound = MakeSound(1, { 1, 2, 3 });
+	std::vector<uint32_t> voices;
+	for (size_t i = 0; i < SoundMixer::MaxVoices; i++)
+		voices.push_back(mixer.Play(sound, i == 3 ? 0.1F : 0.5F, 0.F));
+
+	EXPECT_EQ(mixer.Play(sound, 0.1F, 0.F), 0);
+	const uint32_t louder = mixer.Play(sound, 1.F, 0.F);
+	EXPECT_NE(louder, 0);
+	EXPECT_TRUE(mixer.IsPlaying(louder));
+	EXPECT_FALSE(mixer.IsPlaying(voices[3]));
+	EXPECT_TRUE(mixer.IsPlaying(voices[4]));
+
+	const SoundMixerStats stats = mixer.GetStats();
+	EXPECT_EQ(stats.active, SoundMixer::MaxVoices);
+	EXPECT_EQ(stats.peak, SoundMixer::MaxVoices);
+	EXPECT_EQ(stats.stolen, 1);
+	EXPECT_EQ(stats.dropped, 1);
+
+	mixer.StopAll();
+	EXPECT_EQ(mixer.GetStats().active, 0);
+	EXPECT_EQ(sound.use_count(), 1);
+}
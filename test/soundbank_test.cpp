@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include "utils/soundbank.h"
+
+using namespace devilution;
+
+namespace {
+
+void AppendLE(std::vector<uint8_t> &out, uint32_t value, size_t bytes)
+{
+	for (size_t i = 0; i < bytes; i++)
+		out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void AppendTag(std::vector<uint8_t> &out, const char *tag)
+{
+	out.insert(out.end(), tag, tag + 4);
+}
+
+std::vector<uint8_t> MakeWav(uint16_t format, uint16_t channels, uint16_t bitsPerSample, const std::vector<uint8_t> &data)
+{
+	std::vector<uint8_t> wav;
+	AppendTag(wav, "RIFF");
+	AppendLE(wav, 0, 4);
+	AppendTag(wav, "WAVE");
+	// An odd-sized chunk the decoder has to skip
+	AppendTag(wav, "LIST");
+	AppendLE(wav, 3, 4);
+	wav.insert(wav.end(), { 1, 2, 3, 0 });
+	AppendTag(wav, "fmt ");
+	AppendLE(wav, 16, 4);
+	AppendLE(wav, format, 2);
+	AppendLE(wav, channels, 2);
+	AppendLE(wav, 22050, 4);
+	AppendLE(wav, 22050 * channels * bitsPerSample / 8, 4);
+	AppendLE(wav, channels * bitsPerSample / 8, 2);
+	AppendLE(wav, bitsPerSample, 2);
+	AppendTag(wav, "data");
+	AppendLE(wav, static_cast<uint32_t>(data.size()), 4);
+	wav.insert(wav.end(), data.begin(), data.end());
+	return wav;
+}
+
+PcmSound MakeSound(size_t bytes)
+{
+	PcmSound sound { 22050, 1, {} };
+	sound.samples.resize(bytes / sizeof(int16_t));
+	return sound;
+}
+
+} // namespace
+
+TEST(SoundBank, Decodes16BitWav)
+{
+	const std::vector<uint8_t> wav = MakeWav(1, 2, 16, { 0x01, 0x00, 0xFF, 0xFF, 0x00, 0x80, 0xFF, 0x7F });
+	PcmSound sound;
+	ASSERT_TRUE(DecodeWav(wav.data(), wav.size(), sound));
+	EXPECT_EQ(sound.sampleRate, 22050);
+	EXPECT_EQ(sound.channels, 2);
+	EXPECT_EQ(sound.samples, (std::vector<int16_t> { 1, -1, -32768, 32767 }));
+}
+
+TEST(SoundBank, Decodes8BitWav)
+{
+	const std::vector<uint8_t> wav = MakeWav(1, 1, 8, { 128, 0, 255 });
+	PcmSound sound;
+	ASSERT_TRUE(DecodeWav(wav.data(), wav.size(), sound));
+	EXPECT_EQ(sound.channels, 1);
+	EXPECT_EQ(sound.samples, (std::vector<int16_t> { 0, -32768, 32512 }));
+}
+
+TEST(SoundBank, DecodesTruncatedWavToLastFrame)
+{
+	std::vector<uint8_t> wav = MakeWav(1, 2, 16, { 1, 0, 2, 0, 3, 0, 4, 0 });
+	wav.resize(wav.size() - 3);
+	PcmSound sound;
+	ASSERT_TRUE(DecodeWav(wav.data(), wav.size(), sound));
+	EXPECT_EQ(sound.samples, (std::vector<int16_t> { 1, 2 }));
+}
+
+TEST(SoundBank, LeavesCompressedWav)
+{
+	const std::vector<uint8_t> adpcm = MakeWav(2, 1, 4, { 1, 2, 3, 4 });
+	PcmSound sound;
+	EXPECT_FALSE(DecodeWav(adpcm.data(), adpcm.size(), sound));
+
+	const std::vector<uint8_t> notWav = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'A', 'V', 'I', ' ' };
+	EXPECT_FALSE(DecodeWav(notWav.data(), notWav.size(), sound));
+}
+
+TEST(SoundBank, SharesDecodedSounds)
+{
+	SoundBank bank(1024);
+	EXPECT_EQ(bank.Find("a.wav"), nullptr);
+
+	const std::shared_ptr<const PcmSound> first = bank.Add("a.wav", MakeSound(100));
+	EXPECT_EQ(bank.Find("a.wav"), first);
+	EXPECT_EQ(bank.Add("a.wav", MakeSound(100)), first);
+	EXPECT_EQ(bank.GetSize(), 100);
+}
+
+TEST(SoundBank, DropsLeastRecentlyUsedSounds)
+{
+	SoundBank bank(300);
+	bank.Add("a.wav", MakeSound(100));
+	bank.Add("b.wav", MakeSound(100));
+	bank.Add("c.wav", MakeSound(100));
+	bank.Find("a.wav");
+
+	bank.Add("d.wav", MakeSound(100));
+	EXPECT_EQ(bank.GetSize(), 300);
+	EXPECT_NE(bank.Find("a.wav"), nullptr);
+	EXPECT_EQ(bank.Find("b.wav"), nullptr);
+	EXPECT_NE(bank.Find("d.wav"), nullptr);
+}
+
+TEST(SoundBank, KeepsSoundsInUse)
+{
+	SoundBank bank(100);
+	const std::shared_ptr<const PcmSound> loaded = bank.Add("a.wav", MakeSound(100));
+	bank.Add("b.wav", MakeSound(100));
+
+	EXPECT_EQ(bank.Find("a.wav"), loaded);
+	EXPECT_NE(bank.Find("b.wav"), nullptr);
+	EXPECT_EQ(bank.GetSize(), 200);
+
+	bank.SetBudget(0);
+	EXPECT_EQ(bank.Find("a.wav"), loaded);
+	EXPECT_EQ(bank.Find("b.wav"), nullptr);
+}
+
+TEST(SoundBank, KeepsPinnedSounds)
+{
+	SoundBank bank(100);
+	// Pinned before the sound is decoded, like a sound queued for preloading
+	bank.Pin("a.wav");
+	bank.Add("a.wav", MakeSound(100));
+	bank.Add("b.wav", MakeSound(100));
+	EXPECT_EQ(bank.GetSize(), 200);
+
+	bank.SetBudget(0);
+	EXPECT_NE(bank.Find("a.wav"), nullptr);
+	EXPECT_EQ(bank.Find("b.wav"), nullptr);
+	bank.Unpin("a.wav");
+	EXPECT_EQ(bank.Find("a.wav"), nullptr);
+	EXPECT_EQ(bank.GetSize(), 0);
+	bank.Unpin("a.wav");
+}
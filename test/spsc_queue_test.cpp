@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "utils/spsc_queue.hpp"
+
+using namespace devilution;
+
+namespace {
+
+TEST(SpscQueue, FifoAndCapacity)
+{
+	SpscQueue<int, 4> queue;
+	int value = 0;
+	EXPECT_TRUE(queue.Empty());
+	EXPECT_FALSE(queue.TryPop(value));
+	for (int i = 0; i < 4; i++)
+		EXPECT_TRUE(queue.TryPush(int { i }));
+	EXPECT_FALSE(queue.TryPush(4));
+	for (int i = 0; i < 4; i++) {
+		ASSERT_TRUE(queue.TryPop(value));
+		EXPECT_EQ(value, i);
+	}
+	EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SpscQueue, FailedPushKeepsValue)
+{
+	SpscQueue<std::vector<int>, 1> queue;
+	EXPECT_TRUE(queue.TryPush(std::vector<int> { 1 }));
+	std::vector<int> rejected { 2, 3 };
+	EXPECT_FALSE(queue.TryPush(std::move(rejected)));
+	EXPECT_EQ(rejected.size(), 2);
+}
+
+TEST(SpscQueue, TwoThreads)
+{
+	constexpr int Count = 1000000;
+	SpscQueue<int, 256> queue;
+	std::thread producer([&queue]() {
+		for (int i = 0; i < Count; i++) {
+			while (!queue.TryPush(int { i })) {
+				std::this_thread::yield();
+			}
+		}
+	});
+	int expected = 0;
+	int value;
+	while (expected < Count) {
+		if (!queue.TryPop(value)) {
+			std::this_thread::yield();
+			continue;
+		}
+		ASSERT_EQ(value, expected);
+		expected++;
+	}
+	producer.join();
+	EXPECT_TRUE(queue.Empty());
+}
+
+} // namespace
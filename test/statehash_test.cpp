@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include "gendung.h"
+#include "statehash.h"
+
+using namespace devilution;
+
+namespace {
+
+StateHashes MakeHashes(uint32_t value)
+{
+	StateHashes hashes;
+	hashes.fill(value);
+	return hashes;
+}
+
+} // namespace
+
+TEST(StateHash, DungeonRowsCanBeHashedInSlices)
+{
+	memset(dPiece, 0, sizeof(dPiece));
+	dPiece[10][20] = 5;
+	dPiece[100][30] = 7;
+
+	uint32_t sliced = HashDungeonRows(1, 0, 50);
+	sliced = HashDungeonRows(sliced, 50, MAXDUNX);
+	EXPECT_EQ(sliced, HashDungeonRows(1, 0, MAXDUNX));
+}
+
+TEST(StateHash, DungeonIgnoresLocalVisibility)
+{
+	memset(dFlags, 0, sizeof(dFlags));
+	memset(dMonster, 0, sizeof(dMonster));
+	const uint32_t before = HashSubsystem(StateHashSubsystem::Dungeon);
+
+	dFlags[40][40] = BFLAG_LIT | BFLAG_VISIBLE | BFLAG_EXPLORED;
+	EXPECT_EQ(before, HashSubsystem(StateHashSubsystem::Dungeon));
+
+	dMonster[40][40] = 3;
+	EXPECT_NE(before, HashSubsystem(StateHashSubsystem::Dungeon));
+	dMonster[40][40] = 0;
+}
+
+TEST(StateHash, ReportsConsecutiveMismatches)
+{
+	DesyncDetector detector;
+	StateHashes remote = MakeHashes(1);
+	remote[static_cast<size_t>(StateHashSubsystem::Missiles)] = 2;
+	remote[static_cast<size_t>(StateHashSubsystem::Dungeon)] = 2;
+
+	EXPECT_TRUE(detector.AddLocal(64, 1, MakeHashes(1)).empty());
+	EXPECT_FALSE(detector.AddRemote(1, 64, 1, remote));
+
+	EXPECT_TRUE(detector.AddLocal(128, 1, MakeHashes(1)).empty());
+	auto report = detector.AddRemote(1, 128, 1, remote);
+	ASSERT_TRUE(report);
+	EXPECT_EQ(report->player, 1);
+	EXPECT_EQ(report->tick, 128);
+	EXPECT_EQ(report->subsystem, StateHashSubsystem::Missiles);
+
+	// The same desync isn't reported again
+	EXPECT_TRUE(detector.AddLocal(192, 1, MakeHashes(1)).empty());
+	EXPECT_FALSE(detector.AddRemote(1, 192, 1, remote));
+}
+
+TEST(StateHash, MatchResetsMismatches)
+{
+	DesyncDetector detector;
+	const StateHashes local = MakeHashes(1);
+
+	detector.AddLocal(64, 1, local);
+	EXPECT_FALSE(detector.AddRemote(2, 64, 1, MakeHashes(2)));
+	detector.AddLocal(128, 1, local);
+	EXPECT_FALSE(detector.AddRemote(2, 128, 1, local));
+	detector.AddLocal(192, 1, local);
+	EXPECT_FALSE(detector.AddRemote(2, 192, 1, MakeHashes(2)));
+}
+
+TEST(StateHash, IgnoresOtherLevels)
+{
+	DesyncDetector detector;
+
+	for (uint32_t tick = 64; tick <= 256; tick += 64) {
+		detector.AddLocal(tick, 1, MakeHashes(1));
+		EXPECT_FALSE(detector.AddRemote(3, tick, 2, MakeHashes(2)));
+	}
+}
+
+TEST(StateHash, ComparesHashesReceivedAhead)
+{
+	DesyncDetector detector;
+
+	EXPECT_FALSE(detector.AddRemote(1, 64, 1, MakeHashes(2)));
+	EXPECT_TRUE(detector.AddLocal(64, 1, MakeHashes(1)).empty());
+	EXPECT_FALSE(detector.AddRemote(1, 128, 1, MakeHashes(2)));
+
+	const std::vector<DesyncReport> reports = detector.AddLocal(128, 1, MakeHashes(1));
+	ASSERT_EQ(reports.size(), 1);
+	EXPECT_EQ(reports[0].player, 1);
+	EXPECT_EQ(reports[0].subsystem, StateHashSubsystem::Players);
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include "engine/render/text_render.hpp"
+#include "utils/sdl_wrap.h"
+
+using namespace devilution;
+
+namespace {
+
+class TextRenderTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		UnloadFonts();
+	}
+
+	void TearDown() override
+	{
+		UnloadFonts();
+	}
+
+	/** Draws the text like DrawString at a point, which returns nothing */
+	uint32_t DrawAt(string_view text, Point position)
+	{
+		return DrawString(out, text, { position, { out.w() - position.x, 0 } }, UiFlags::ColorDialogWhite);
+	}
+
+	SDLSurfaceUniquePtr surface = SDLWrap::CreateRGBSurfaceWithFormat(0, 640, 480, 8, SDL_PIXELFORMAT_INDEX8);
+	Surface out { surface.get() };
+};
+
+} // namespace
+
+TEST_F(TextRenderTest, ReusesLayoutAtOtherPositions)
+{
+	const uint32_t bytesDrawn = DrawAt("Scrolling credits", { 10, 10 });
+	EXPECT_EQ(bytesDrawn, 17);
+	EXPECT_EQ(GetTextLayoutCount(), 1);
+
+	EXPECT_EQ(DrawAt("Scrolling credits", { 10, 200 }), bytesDrawn);
+	EXPECT_EQ(DrawAt("Scrolling credits", { 60, 300 }), bytesDrawn);
+	EXPECT_EQ(GetTextLayoutCount(), 1);
+}
+
+TEST_F(TextRenderTest, StopsAtBottomMargin)
+{
+	EXPECT_EQ(DrawAt("First\nSecond", { 10, 10 }), 12);
+	// The second line would start below the buffer
+	EXPECT_EQ(DrawAt("First\nSecond", { 10, 475 }), 5);
+	EXPECT_EQ(GetTextLayoutCount(), 1);
+}
+
+TEST_F(TextRenderTest, WrapsNarrowRectangles)
+{
+	const Rectangle wide { { 0, 0 }, { 600, 100 } };
+	const Rectangle narrow { { 0, 0 }, { 20, 100 } };
+	DrawString(out, "Wrapped text", wide, UiFlags::ColorDialogWhite, 1, 100);
+	EXPECT_EQ(GetTextLayoutCount(), 1);
+
+	// The text wraps, and the line after the first wrap starts below the rectangle
+	EXPECT_LT(DrawString(out, "Wrapped text", narrow, UiFlags::ColorDialogWhite, 1, 100), 12);
+	EXPECT_EQ(GetTextLayoutCount(), 2);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "utils/voice_pool.hpp"
+
+using namespace devilution;
+
+namespace {
+
+TEST(VoicePool, AcquiresFreeVoicesFirst)
+{
+	VoicePool<int, 4> pool;
+	for (int i = 0; i < 4; i++) {
+		const auto lease = pool.Acquire(0);
+		ASSERT_NE(lease.voice, nullptr);
+		EXPECT_EQ(lease.index, static_cast<uint32_t>(i));
+	}
+	const VoicePoolStats stats = pool.GetStats();
+	EXPECT_EQ(stats.voices, 4U);
+	EXPECT_EQ(stats.active, 4U);
+	EXPECT_EQ(stats.stolen, 0U);
+}
+
+TEST(VoicePool, StealsLeastImportantVoice)
+{
+	VoicePool<int, 3> pool;
+	pool.Acquire(-100);
+	const auto quiet = pool.Acquire(-300);
+	pool.Acquire(-200);
+
+	const auto lease = pool.Acquire(-50);
+	ASSERT_NE(lease.voice, nullptr);
+	EXPECT_EQ(lease.index, quiet.index);
+	EXPECT_EQ(pool.GetStats().stolen, 1U);
+}
+
+TEST(VoicePool, StealsOldestAmongEqualPriority)
+{
+	VoicePool<int, 3> pool;
+	const auto oldest = pool.Acquire(0);
+	pool.Acquire(0);
+	pool.Acquire(0);
+
+	const auto first = pool.Acquire(0);
+	EXPECT_EQ(first.index, oldest.index);
+	const auto second = pool.Acquire(0);
+	EXPECT_EQ(second.index, 1U);
+}
+
+TEST(VoicePool, DropsLessImportantSound)
+{
+	VoicePool<int, 2> pool;
+	pool.Acquire(0);
+	pool.Acquire(-10);
+
+	EXPECT_EQ(pool.Acquire(-20).voice, nullptr);
+	const VoicePoolStats stats = pool.GetStats();
+	EXPECT_EQ(stats.dropped, 1U);
+	EXPECT_EQ(stats.stolen, 0U);
+}
+
+TEST(VoicePool, IgnoresReleaseOfStolenVoice)
+{
+	VoicePool<int, 1> pool;
+	const auto stolen = pool.Acquire(0);
+	const auto lease = pool.Acquire(0);
+	ASSERT_EQ(lease.index, stolen.index);
+
+	pool.Release(stolen.index, stolen.token);
+	EXPECT_EQ(pool.GetStats().active, 1U);
+	pool.Release(lease.index, lease.token);
+	EXPECT_EQ(pool.GetStats().active, 0U);
+}
+
+TEST(VoicePool, ReleaseAllFreesEveryVoice)
+{
+	VoicePool<int, 2> pool;
+	const auto first = pool.Acquire(0);
+	pool.Acquire(0);
+	pool.ReleaseAll();
+	EXPECT_EQ(pool.GetStats().active, 0U);
+
+	pool.Release(first.index, first.token);
+	pool.Acquire(0);
+	EXPECT_EQ(pool.GetStats().active, 1U);
+}
+
+TEST(VoicePool, ReleasesFromOtherThread)
+{
+	VoicePool<int, 8> pool;
+	std::vector<std::pair<uint32_t, uint32_t>> leases;
+	for (int i = 0; i < 8; i++) {
+		const auto lease = pool.Acquire(0);
+		leases.emplace_back(lease.index, lease.token);
+	}
+
+	std::thread audio([&]() {
+		for (const auto &lease : leases)
+			pool.Release(lease.first, lease.second);
+	});
+	audio.join();
+
+	EXPECT_EQ(pool.GetStats().active, 0U);
+	for (int i = 0; i < 8; i++)
+		EXPECT_NE(pool.Acquire(0).voice, nullptr);
+	EXPECT_EQ(pool.GetStats().stolen, 0U);
+}
+
+} // namespace